@@ -24,6 +24,7 @@ check_include_file("netinet/in.h"           HAVE_NETINET_IN_H)
 check_include_file("netdb.h"                HAVE_NETDB_H)
 check_include_file("pwd.h"                  HAVE_PWD_H)
 check_include_file("sys/ioctl.h"            HAVE_SYS_IOCTL_H)
+check_include_file("sys/mman.h"             HAVE_SYS_MMAN_H)
 check_include_file("sys/select.h"           HAVE_SYS_SELECT_H)
 check_include_file("sys/socket.h"           HAVE_SYS_SOCKET_H)
 check_include_file("sys/sockio.h"           HAVE_SYS_SOCKIO_H)
@@ -132,6 +133,12 @@ endif()
 check_function_exists("getifaddrs"       HAVE_GETIFADDRS)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
 check_function_exists("mkstemps"         HAVE_MKSTEMPS)
+check_symbol_exists("posix_fadvise" "fcntl.h" HAVE_POSIX_FADVISE)
+check_symbol_exists("posix_fallocate" "fcntl.h" HAVE_POSIX_FALLOCATE)
+cmake_push_check_state()
+set(CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+check_symbol_exists("sched_setaffinity" "sched.h" HAVE_SCHED_SETAFFINITY)
+cmake_pop_check_state()
 check_function_exists("setresgid"        HAVE_SETRESGID)
 check_function_exists("setresuid"        HAVE_SETRESUID)
 check_function_exists("strptime"         HAVE_STRPTIME)
@@ -147,6 +154,8 @@ include(CheckStructHasMember)
 check_struct_has_member("struct sockaddr" sa_len         sys/socket.h HAVE_STRUCT_SOCKADDR_SA_LEN)
 check_struct_has_member("struct stat"     st_flags       sys/stat.h   HAVE_STRUCT_STAT_ST_FLAGS)
 check_struct_has_member("struct stat"     st_blksize     sys/stat.h   HAVE_STRUCT_STAT_ST_BLKSIZE)
+check_struct_has_member("struct stat"     st_mtim.tv_nsec sys/stat.h  HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+check_struct_has_member("struct stat"     st_mtimespec.tv_nsec sys/stat.h HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
 check_struct_has_member("struct stat"     st_birthtime   sys/stat.h   HAVE_STRUCT_STAT_ST_BIRTHTIME)
 check_struct_has_member("struct stat"     __st_birthtime sys/stat.h   HAVE_STRUCT_STAT___ST_BIRTHTIME)
 check_struct_has_member("struct tm"       tm_zone        time.h       HAVE_STRUCT_TM_TM_ZONE)
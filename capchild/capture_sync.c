@@ -444,6 +444,16 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         argv = sync_pipe_add_arg(argv, &argc, "--compress-type");
         argv = sync_pipe_add_arg(argv, &argc, capture_opts->compress_type);
     }
+    if (capture_opts->compress_threads != 0) {
+        char sthreads[ARGV_NUMBER_LEN];
+        argv = sync_pipe_add_arg(argv, &argc, "--compress-threads");
+        g_snprintf(sthreads, ARGV_NUMBER_LEN, "%u", capture_opts->compress_threads);
+        argv = sync_pipe_add_arg(argv, &argc, sthreads);
+    }
+    if (capture_opts->compress_cpus) {
+        argv = sync_pipe_add_arg(argv, &argc, "--compress-cpus");
+        argv = sync_pipe_add_arg(argv, &argc, capture_opts->compress_cpus);
+    }
 
 #ifdef _WIN32
     /* init SECURITY_ATTRIBUTES */
@@ -69,6 +69,7 @@
 #include <wiretap/wtap.h>
 
 #include <ui/cmdarg_err.h>
+#include <ui/clopts_common.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/privileges.h>
 #include <cli_main.h>
@@ -102,6 +103,20 @@
 
 static gboolean stop_after_failure = FALSE;
 
+/*
+ * Reading only the record metadata lets wiretap seek over the packet
+ * data instead of copying it, for file types that support it; nothing
+ * capinfos reports is derived from the packet data itself.  The
+ * downside is that a truncated final packet isn't noticed, so this is
+ * only done if asked for with '-f'.
+ *
+ * With '-j', files are scanned on that many worker threads; the
+ * reports are still printed in the order the files were given.
+ */
+
+static gboolean metadata_only      = FALSE;
+static guint    num_jobs           = 1;
+
 /*
  * table report variables
  */
@@ -159,14 +174,6 @@ static gboolean cap_file_hashes    = TRUE;  /* Calculate file hashes */
 #define HASH_BUF_SIZE (1024 * 1024)
 
 
-static gchar file_sha256[HASH_STR_SIZE];
-static gchar file_rmd160[HASH_STR_SIZE];
-static gchar file_sha1[HASH_STR_SIZE];
-
-static guint num_ipv4_addresses;
-static guint num_ipv6_addresses;
-static guint num_decryption_secrets;
-
 /*
  * If we have at least two packets with time stamps, and they're not in
  * order - i.e., the later packet has a time stamp older than the earlier
@@ -219,8 +226,33 @@ typedef struct _capture_info {
   GArray               *interface_packet_counts;  /* array of per_packet interface_id counts; one entry per file IDB */
   guint32               pkt_interface_id_unknown; /* counts if packet interface_id didn't match a known one */
   GArray               *idb_info_strings;         /* array of IDB info strings */
+
+  guint                 num_ipv4_addresses;
+  guint                 num_ipv6_addresses;
+  guint                 num_decryption_secrets;
+
+  gchar                 file_sha256[HASH_STR_SIZE];
+  gchar                 file_rmd160[HASH_STR_SIZE];
+  gchar                 file_sha1[HASH_STR_SIZE];
 } capture_info;
 
+/*
+ * A file queued for scanning, possibly on a worker thread; the main
+ * thread waits for "done" and prints the results in command-line order.
+ */
+typedef struct _capinfos_job {
+  const char           *filename;
+  int                   status;
+  gboolean              done;
+  capture_info          cf_info;
+} capinfos_job;
+
+static GMutex job_mutex;
+static GCond  job_cond;
+
+/* The capture_info being filled in by the scan running on this thread. */
+static GPrivate scan_cf_info = G_PRIVATE_INIT(NULL);
+
 static char *decimal_point;
 
 static void
@@ -743,9 +775,9 @@ print_stats(const gchar *filename, capture_info *cf_info)
     }
   }
   if (cap_file_hashes) {
-    printf     ("SHA256:              %s\n", file_sha256);
-    printf     ("RIPEMD160:           %s\n", file_rmd160);
-    printf     ("SHA1:                %s\n", file_sha1);
+    printf     ("SHA256:              %s\n", cf_info->file_sha256);
+    printf     ("RIPEMD160:           %s\n", cf_info->file_rmd160);
+    printf     ("SHA1:                %s\n", cf_info->file_sha1);
   }
   if (cap_order)          printf     ("Strict time order:   %s\n", order_string(cf_info->order));
 
@@ -798,14 +830,14 @@ print_stats(const gchar *filename, capture_info *cf_info)
     }
 
     if (cap_file_nrb) {
-      if (num_ipv4_addresses != 0)
-        printf   ("Number of resolved IPv4 addresses in file: %u\n", num_ipv4_addresses);
-      if (num_ipv6_addresses != 0)
-        printf   ("Number of resolved IPv6 addresses in file: %u\n", num_ipv6_addresses);
+      if (cf_info->num_ipv4_addresses != 0)
+        printf   ("Number of resolved IPv4 addresses in file: %u\n", cf_info->num_ipv4_addresses);
+      if (cf_info->num_ipv6_addresses != 0)
+        printf   ("Number of resolved IPv6 addresses in file: %u\n", cf_info->num_ipv6_addresses);
     }
     if (cap_file_dsb) {
-      if (num_decryption_secrets != 0)
-        printf   ("Number of decryption secrets in file: %u\n", num_decryption_secrets);
+      if (cf_info->num_decryption_secrets != 0)
+        printf   ("Number of decryption secrets in file: %u\n", cf_info->num_decryption_secrets);
     }
   }
 }
@@ -1025,17 +1057,17 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   if (cap_file_hashes) {
     putsep();
     putquote();
-    printf("%s", file_sha256);
+    printf("%s", cf_info->file_sha256);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_rmd160);
+    printf("%s", cf_info->file_rmd160);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_sha1);
+    printf("%s", cf_info->file_sha1);
     putquote();
   }
 
@@ -1143,28 +1175,87 @@ cleanup_capture_info(capture_info *cf_info)
   cf_info->idb_info_strings = NULL;
 }
 
+static void
+hash_to_str(const unsigned char *hash, size_t length, char *str) {
+  int i;
+
+  for (i = 0; i < (int) length; i++) {
+    g_snprintf(str+(i*2), 3, "%02x", hash[i]);
+  }
+}
+
+static void
+calculate_file_hashes(const char *filename, capture_info *cf_info)
+{
+  FILE         *fh;
+  char         *hash_buf;
+  size_t        hash_bytes;
+  gcry_md_hd_t  hd = NULL;
+
+  g_strlcpy(cf_info->file_sha256, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_rmd160, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_sha1, "<unknown>", HASH_STR_SIZE);
+
+  if (!cap_file_hashes)
+    return;
+
+  /* Each file gets its own handle, as files may be hashed in parallel. */
+  gcry_md_open(&hd, GCRY_MD_SHA256, 0);
+  if (!hd)
+    return;
+  gcry_md_enable(hd, GCRY_MD_RMD160);
+  gcry_md_enable(hd, GCRY_MD_SHA1);
+
+  fh = ws_fopen(filename, "rb");
+  if (fh) {
+    hash_buf = (char *)g_malloc(HASH_BUF_SIZE);
+    while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
+      gcry_md_write(hd, hash_buf, hash_bytes);
+    }
+    gcry_md_final(hd);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_SHA256), HASH_SIZE_SHA256, cf_info->file_sha256);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, cf_info->file_rmd160);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, cf_info->file_sha1);
+    g_free(hash_buf);
+    fclose(fh);
+  }
+  gcry_md_close(hd);
+}
+
 static void
 count_ipv4_address(const guint addr _U_, const gchar *name _U_)
 {
-  num_ipv4_addresses++;
+  capture_info *cf_info = (capture_info *)g_private_get(&scan_cf_info);
+
+  cf_info->num_ipv4_addresses++;
 }
 
 static void
 count_ipv6_address(const void *addrp _U_, const gchar *name _U_)
 {
-  num_ipv6_addresses++;
+  capture_info *cf_info = (capture_info *)g_private_get(&scan_cf_info);
+
+  cf_info->num_ipv6_addresses++;
 }
 
 static void
 count_decryption_secret(guint32 secrets_type _U_, const void *secrets _U_, guint size _U_)
 {
+  capture_info *cf_info = (capture_info *)g_private_get(&scan_cf_info);
+
   /* XXX - count them based on the secrets type (which is an opaque code,
      not a small integer)? */
-  num_decryption_secrets++;
+  cf_info->num_decryption_secrets++;
 }
 
+/*
+ * Read through a capture file and fill in cf_info.  Returns 0 on
+ * success, 1 if the file was cut short but cf_info is still valid,
+ * and 2 if nothing can be reported for the file, in which case the
+ * file has already been closed.
+ */
 static int
-process_cap_file(const char *filename, gboolean need_separator)
+scan_cap_file(const char *filename, capture_info *cf_info)
 {
   int                   status = 0;
   int                   err;
@@ -1178,7 +1269,6 @@ process_cap_file(const char *filename, gboolean need_separator)
   guint32               snaplen_max_inferred =          0;
   wtap_rec              rec;
   Buffer                buf;
-  capture_info          cf_info;
   gboolean              have_times = TRUE;
   nstime_t              start_time;
   int                   start_time_tsprec;
@@ -1191,15 +1281,22 @@ process_cap_file(const char *filename, gboolean need_separator)
   guint                 i;
   wtapng_iface_descriptions_t *idb_info;
 
-  cf_info.wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
-  if (!cf_info.wth) {
+  cf_info->filename = filename;
+
+  calculate_file_hashes(filename, cf_info);
+
+  cf_info->wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+  if (!cf_info->wth) {
     cfile_open_failure_message("capinfos", filename, err, err_info);
     return 2;
   }
 
-  if (need_separator && long_report) {
-    printf("\n");
-  }
+  /*
+   * If asked, skip over the packet data; this is only a hint, and file
+   * types that can't do it just read the data as usual.
+   */
+  if (metadata_only)
+    wtap_set_metadata_only(cf_info->wth, TRUE);
 
   nstime_set_zero(&start_time);
   start_time_tsprec = WTAP_TSPREC_UNKNOWN;
@@ -1208,35 +1305,37 @@ process_cap_file(const char *filename, gboolean need_separator)
   nstime_set_zero(&cur_time);
   nstime_set_zero(&prev_time);
 
-  cf_info.encap_counts = g_new0(int,WTAP_NUM_ENCAP_TYPES);
+  cf_info->encap_counts = g_new0(int,WTAP_NUM_ENCAP_TYPES);
 
-  idb_info = wtap_file_get_idb_info(cf_info.wth);
+  idb_info = wtap_file_get_idb_info(cf_info->wth);
 
   g_assert(idb_info->interface_data != NULL);
 
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  cf_info.interface_packet_counts  = g_array_sized_new(FALSE, TRUE, sizeof(guint32), cf_info.num_interfaces);
-  g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-  cf_info.pkt_interface_id_unknown = 0;
+  cf_info->num_interfaces = idb_info->interface_data->len;
+  cf_info->interface_packet_counts  = g_array_sized_new(FALSE, TRUE, sizeof(guint32), cf_info->num_interfaces);
+  g_array_set_size(cf_info->interface_packet_counts, cf_info->num_interfaces);
+  cf_info->pkt_interface_id_unknown = 0;
 
   g_free(idb_info);
   idb_info = NULL;
 
   /* Register callbacks for new name<->address maps from the file and
-     decryption secrets from the file. */
-  wtap_set_cb_new_ipv4(cf_info.wth, count_ipv4_address);
-  wtap_set_cb_new_ipv6(cf_info.wth, count_ipv6_address);
-  wtap_set_cb_new_secrets(cf_info.wth, count_decryption_secret);
+     decryption secrets from the file; they count into this thread's
+     cf_info. */
+  g_private_set(&scan_cf_info, cf_info);
+  wtap_set_cb_new_ipv4(cf_info->wth, count_ipv4_address);
+  wtap_set_cb_new_ipv6(cf_info->wth, count_ipv6_address);
+  wtap_set_cb_new_secrets(cf_info->wth, count_decryption_secret);
 
   /* Zero out the counters for the callbacks. */
-  num_ipv4_addresses = 0;
-  num_ipv6_addresses = 0;
-  num_decryption_secrets = 0;
+  cf_info->num_ipv4_addresses = 0;
+  cf_info->num_ipv6_addresses = 0;
+  cf_info->num_decryption_secrets = 0;
 
   /* Tally up data that we need to parse through the file to find */
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
-  while (wtap_read(cf_info.wth, &rec, &buf, &err, &err_info, &data_offset))  {
+  while (wtap_read(cf_info->wth, &rec, &buf, &err, &err_info, &data_offset))  {
     if (rec.presence_flags & WTAP_HAS_TS) {
       prev_time = cur_time;
       cur_time = rec.ts;
@@ -1281,7 +1380,7 @@ process_cap_file(const char *filename, gboolean need_separator)
 
       if ((rec.rec_header.packet_header.pkt_encap > 0) &&
           (rec.rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-        cf_info.encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
+        cf_info->encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
       } else {
         fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
                 rec.rec_header.packet_header.pkt_encap, packet, filename);
@@ -1289,37 +1388,37 @@ process_cap_file(const char *filename, gboolean need_separator)
 
       /* Packet interface_id info */
       if (rec.presence_flags & WTAP_HAS_INTERFACE_ID) {
-        /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-        if (rec.rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
+        /* cf_info->num_interfaces is size, not index, so it's one more than max index */
+        if (rec.rec_header.packet_header.interface_id >= cf_info->num_interfaces) {
           /*
            * OK, re-fetch the number of interfaces, as there might have
            * been an interface that was in the middle of packets, and
            * grow the array to be big enough for the new number of
            * interfaces.
            */
-          idb_info = wtap_file_get_idb_info(cf_info.wth);
+          idb_info = wtap_file_get_idb_info(cf_info->wth);
 
-          cf_info.num_interfaces = idb_info->interface_data->len;
-          g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
+          cf_info->num_interfaces = idb_info->interface_data->len;
+          g_array_set_size(cf_info->interface_packet_counts, cf_info->num_interfaces);
 
           g_free(idb_info);
           idb_info = NULL;
         }
-        if (rec.rec_header.packet_header.interface_id < cf_info.num_interfaces) {
-          g_array_index(cf_info.interface_packet_counts, guint32,
+        if (rec.rec_header.packet_header.interface_id < cf_info->num_interfaces) {
+          g_array_index(cf_info->interface_packet_counts, guint32,
                         rec.rec_header.packet_header.interface_id) += 1;
         }
         else {
-          cf_info.pkt_interface_id_unknown += 1;
+          cf_info->pkt_interface_id_unknown += 1;
         }
       }
       else {
         /* it's for interface_id 0 */
-        if (cf_info.num_interfaces != 0) {
-          g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
+        if (cf_info->num_interfaces != 0) {
+          g_array_index(cf_info->interface_packet_counts, guint32, 0) += 1;
         }
         else {
-          cf_info.pkt_interface_id_unknown += 1;
+          cf_info->pkt_interface_id_unknown += 1;
         }
       }
     }
@@ -1335,14 +1434,14 @@ process_cap_file(const char *filename, gboolean need_separator)
    * we get, for example, a count of the number of statistics entries
    * for each interface as of the *end* of the file.
    */
-  idb_info = wtap_file_get_idb_info(cf_info.wth);
+  idb_info = wtap_file_get_idb_info(cf_info->wth);
 
-  cf_info.idb_info_strings = g_array_sized_new(FALSE, FALSE, sizeof(gchar*), cf_info.num_interfaces);
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  for (i = 0; i < cf_info.num_interfaces; i++) {
+  cf_info->idb_info_strings = g_array_sized_new(FALSE, FALSE, sizeof(gchar*), cf_info->num_interfaces);
+  cf_info->num_interfaces = idb_info->interface_data->len;
+  for (i = 0; i < cf_info->num_interfaces; i++) {
     const wtap_block_t if_descr = g_array_index(idb_info->interface_data, wtap_block_t, i);
     gchar *s = wtap_get_debug_if_descr(if_descr, 21, "\n");
-    g_array_append_val(cf_info.idb_info_strings, s);
+    g_array_append_val(cf_info->idb_info_strings, s);
   }
 
   g_free(idb_info);
@@ -1359,88 +1458,120 @@ process_cap_file(const char *filename, gboolean need_separator)
         fprintf(stderr,
           "  (will continue anyway, checksums might be incorrect)\n");
     } else {
-        cleanup_capture_info(&cf_info);
-        wtap_close(cf_info.wth);
+        cleanup_capture_info(cf_info);
+        wtap_close(cf_info->wth);
+        cf_info->wth = NULL;
         return 2;
     }
   }
 
   /* File size */
-  size = wtap_file_size(cf_info.wth, &err);
+  size = wtap_file_size(cf_info->wth, &err);
   if (size == -1) {
     fprintf(stderr,
         "capinfos: Can't get size of \"%s\": %s.\n",
         filename, g_strerror(err));
-    cleanup_capture_info(&cf_info);
-    wtap_close(cf_info.wth);
+    cleanup_capture_info(cf_info);
+    wtap_close(cf_info->wth);
+    cf_info->wth = NULL;
     return 2;
   }
 
-  cf_info.filesize = size;
+  cf_info->filesize = size;
 
   /* File Type */
-  cf_info.file_type = wtap_file_type_subtype(cf_info.wth);
-  cf_info.compression_type = wtap_get_compression_type(cf_info.wth);
+  cf_info->file_type = wtap_file_type_subtype(cf_info->wth);
+  cf_info->compression_type = wtap_get_compression_type(cf_info->wth);
 
   /* File Encapsulation */
-  cf_info.file_encap = wtap_file_encap(cf_info.wth);
+  cf_info->file_encap = wtap_file_encap(cf_info->wth);
 
-  cf_info.file_tsprec = wtap_file_tsprec(cf_info.wth);
+  cf_info->file_tsprec = wtap_file_tsprec(cf_info->wth);
 
   /* Packet size limit (snaplen) */
-  cf_info.snaplen = wtap_snapshot_length(cf_info.wth);
-  if (cf_info.snaplen > 0)
-    cf_info.snap_set = TRUE;
+  cf_info->snaplen = wtap_snapshot_length(cf_info->wth);
+  if (cf_info->snaplen > 0)
+    cf_info->snap_set = TRUE;
   else
-    cf_info.snap_set = FALSE;
+    cf_info->snap_set = FALSE;
 
-  cf_info.snaplen_min_inferred = snaplen_min_inferred;
-  cf_info.snaplen_max_inferred = snaplen_max_inferred;
+  cf_info->snaplen_min_inferred = snaplen_min_inferred;
+  cf_info->snaplen_max_inferred = snaplen_max_inferred;
 
   /* # of packets */
-  cf_info.packet_count = packet;
+  cf_info->packet_count = packet;
 
   /* File Times */
-  cf_info.times_known = have_times;
-  cf_info.start_time = start_time;
-  cf_info.start_time_tsprec = start_time_tsprec;
-  cf_info.stop_time = stop_time;
-  cf_info.stop_time_tsprec = stop_time_tsprec;
-  nstime_delta(&cf_info.duration, &stop_time, &start_time);
+  cf_info->times_known = have_times;
+  cf_info->start_time = start_time;
+  cf_info->start_time_tsprec = start_time_tsprec;
+  cf_info->stop_time = stop_time;
+  cf_info->stop_time_tsprec = stop_time_tsprec;
+  nstime_delta(&cf_info->duration, &stop_time, &start_time);
   /* Duration precision is the higher of the start and stop time precisions. */
-  if (cf_info.stop_time_tsprec > cf_info.start_time_tsprec)
-    cf_info.duration_tsprec = cf_info.stop_time_tsprec;
+  if (cf_info->stop_time_tsprec > cf_info->start_time_tsprec)
+    cf_info->duration_tsprec = cf_info->stop_time_tsprec;
   else
-    cf_info.duration_tsprec = cf_info.start_time_tsprec;
-  cf_info.know_order = know_order;
-  cf_info.order = order;
+    cf_info->duration_tsprec = cf_info->start_time_tsprec;
+  cf_info->know_order = know_order;
+  cf_info->order = order;
 
   /* Number of packet bytes */
-  cf_info.packet_bytes = bytes;
+  cf_info->packet_bytes = bytes;
 
-  cf_info.data_rate   = 0.0;
-  cf_info.packet_rate = 0.0;
-  cf_info.packet_size = 0.0;
+  cf_info->data_rate   = 0.0;
+  cf_info->packet_rate = 0.0;
+  cf_info->packet_size = 0.0;
 
   if (packet > 0) {
     double delta_time = nstime_to_sec(&stop_time) - nstime_to_sec(&start_time);
     if (delta_time > 0.0) {
-      cf_info.data_rate   = (double)bytes  / delta_time; /* Data rate per second */
-      cf_info.packet_rate = (double)packet / delta_time; /* packet rate per second */
+      cf_info->data_rate   = (double)bytes  / delta_time; /* Data rate per second */
+      cf_info->packet_rate = (double)packet / delta_time; /* packet rate per second */
     }
-    cf_info.packet_size = (double)bytes / packet;                  /* Avg packet size      */
+    cf_info->packet_size = (double)bytes / packet;                  /* Avg packet size      */
+  }
+
+  return status;
+}
+
+static void
+scan_cap_file_job(gpointer data, gpointer user_data _U_)
+{
+  capinfos_job *job = (capinfos_job *)data;
+  int           status;
+
+  status = scan_cap_file(job->filename, &job->cf_info);
+
+  g_mutex_lock(&job_mutex);
+  job->status = status;
+  job->done = TRUE;
+  g_cond_broadcast(&job_cond);
+  g_mutex_unlock(&job_mutex);
+}
+
+static void
+finish_cap_file(capture_info *cf_info)
+{
+  cleanup_capture_info(cf_info);
+  wtap_close(cf_info->wth);
+  cf_info->wth = NULL;
+}
+
+static void
+print_cap_file(capture_info *cf_info, gboolean need_separator)
+{
+  if (need_separator && long_report) {
+    printf("\n");
   }
 
   if (long_report) {
-    print_stats(filename, &cf_info);
+    print_stats(cf_info->filename, cf_info);
   } else {
-    print_stats_table(filename, &cf_info);
+    print_stats_table(cf_info->filename, cf_info);
   }
 
-  cleanup_capture_info(&cf_info);
-  wtap_close(cf_info.wth);
-
-  return status;
+  finish_cap_file(cf_info);
 }
 
 static void
@@ -1502,6 +1633,9 @@ print_usage(FILE *output)
   fprintf(output, "  -C cancel processing if file open fails (default is to continue)\n");
   fprintf(output, "  -A generate all infos (default)\n");
   fprintf(output, "  -K disable displaying the capture comment\n");
+  fprintf(output, "  -f skip over packet data when reading, where the file type allows it\n");
+  fprintf(output, "     (faster, but a truncated last packet is not detected)\n");
+  fprintf(output, "  -j <jobs> process up to <jobs> files in parallel (default 1)\n");
   fprintf(output, "\n");
   fprintf(output, "Options are processed from left to right order with later options superseding\n");
   fprintf(output, "or adding to earlier options.\n");
@@ -1532,15 +1666,6 @@ failure_message_cont(const char *msg_format, va_list ap)
   fprintf(stderr, "\n");
 }
 
-static void
-hash_to_str(const unsigned char *hash, size_t length, char *str) {
-  int i;
-
-  for (i = 0; i < (int) length; i++) {
-    g_snprintf(str+(i*2), 3, "%02x", hash[i]);
-  }
-}
-
 int
 main(int argc, char *argv[])
 {
@@ -1555,10 +1680,9 @@ main(int argc, char *argv[])
   };
 
   int status = 0;
-  FILE  *fh;
-  char  *hash_buf = NULL;
-  gcry_md_hd_t hd = NULL;
-  size_t hash_bytes;
+  int    num_files = 0, i, queued = 0;
+  capinfos_job *jobs = NULL;
+  GThreadPool *pool = NULL;
 
   /*
    * Set the C-language locale to the native environment and set the
@@ -1605,7 +1729,7 @@ main(int argc, char *argv[])
   wtap_init(TRUE);
 
   /* Process the options */
-  while ((opt = getopt_long(argc, argv, "abcdehiklmnoqrstuvxyzABCDEFHIKLMNQRST", long_options, NULL)) !=-1) {
+  while ((opt = getopt_long(argc, argv, "abcdefhij:klmnoqrstuvxyzABCDEFHIKLMNQRST", long_options, NULL)) !=-1) {
 
     switch (opt) {
 
@@ -1721,6 +1845,14 @@ main(int argc, char *argv[])
         stop_after_failure = TRUE;
         break;
 
+      case 'f':
+        metadata_only = TRUE;
+        break;
+
+      case 'j':
+        num_jobs = get_nonzero_guint32(optarg, "number of jobs");
+        break;
+
       case 'A':
         enable_all_infos();
         break;
@@ -1800,38 +1932,46 @@ main(int argc, char *argv[])
 
   if (cap_file_hashes) {
     gcry_check_version(NULL);
-    gcry_md_open(&hd, GCRY_MD_SHA256, 0);
-    if (hd) {
-      gcry_md_enable(hd, GCRY_MD_RMD160);
-      gcry_md_enable(hd, GCRY_MD_SHA1);
-    }
-    hash_buf = (char *)g_malloc(HASH_BUF_SIZE);
   }
 
   overall_error_status = 0;
 
-  for (opt = optind; opt < argc; opt++) {
+  num_files = argc - optind;
+  jobs = g_new0(capinfos_job, num_files);
+  for (i = 0; i < num_files; i++) {
+    jobs[i].filename = argv[optind + i];
+  }
+
+  if (num_jobs > 1 && num_files > 1) {
+    pool = g_thread_pool_new(scan_cap_file_job, NULL, (gint)num_jobs, TRUE, NULL);
+    /*
+     * A scanned file stays open until its report has been printed, so
+     * only let the workers get a bounded distance ahead of the printing.
+     */
+    for (queued = 0; queued < num_files && queued < (int)num_jobs * 2; queued++) {
+      g_thread_pool_push(pool, &jobs[queued], NULL);
+    }
+  }
 
-    g_strlcpy(file_sha256, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_rmd160, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_sha1, "<unknown>", HASH_STR_SIZE);
+  for (i = 0; i < num_files; i++) {
 
-    if (cap_file_hashes) {
-      fh = ws_fopen(argv[opt], "rb");
-      if (fh && hd) {
-        while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
-          gcry_md_write(hd, hash_buf, hash_bytes);
-        }
-        gcry_md_final(hd);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_SHA256), HASH_SIZE_SHA256, file_sha256);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, file_rmd160);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, file_sha1);
+    if (pool) {
+      g_mutex_lock(&job_mutex);
+      while (!jobs[i].done)
+        g_cond_wait(&job_cond, &job_mutex);
+      g_mutex_unlock(&job_mutex);
+      if (queued < num_files) {
+        g_thread_pool_push(pool, &jobs[queued], NULL);
+        queued++;
       }
-      if (fh) fclose(fh);
-      if (hd) gcry_md_reset(hd);
+    } else {
+      scan_cap_file_job(&jobs[i], NULL);
     }
 
-    status = process_cap_file(argv[opt], need_separator);
+    status = jobs[i].status;
+    if (status != 2) {
+      print_cap_file(&jobs[i].cf_info, need_separator);
+    }
     if (status) {
       /* Something failed.  It's been reported; remember that processing
          one file failed and, if -C was specified, stop. */
@@ -1849,8 +1989,18 @@ main(int argc, char *argv[])
   }
 
 exit:
-  g_free(hash_buf);
-  gcry_md_close(hd);
+  if (pool) {
+    /* Drop anything not yet started and wait for the rest. */
+    g_thread_pool_free(pool, TRUE, TRUE);
+  }
+  if (jobs) {
+    /* Close files scanned ahead of a failure with -C. */
+    for (i = 0; i < num_files; i++) {
+      if (jobs[i].done && jobs[i].cf_info.wth != NULL)
+        finish_cap_file(&jobs[i].cf_info);
+    }
+    g_free(jobs);
+  }
   wtap_cleanup();
   free_progdirs();
   return overall_error_status;
@@ -119,6 +119,8 @@ capture_opts_init(capture_options *capture_opts)
     capture_opts->print_file_names                = FALSE;
     capture_opts->print_name_to                   = NULL;
     capture_opts->compress_type                   = NULL;
+    capture_opts->compress_threads                = 0;
+    capture_opts->compress_cpus                   = NULL;
 }
 
 void
@@ -144,6 +146,8 @@ capture_opts_cleanup(capture_options *capture_opts)
         capture_opts->all_ifaces = NULL;
     }
     g_free(capture_opts->save_file);
+    g_free(capture_opts->compress_cpus);
+    capture_opts->compress_cpus = NULL;
 }
 
 /* log content of capture_opts */
@@ -252,6 +256,9 @@ capture_opts_log(const char *log_domain, GLogLevelFlags log_level, capture_optio
     g_log(log_domain, log_level, "FilePackets     (%u) : %u", capture_opts->has_file_packets, capture_opts->file_packets);
     g_log(log_domain, log_level, "RingNumFiles    (%u) : %u", capture_opts->has_ring_num_files, capture_opts->ring_num_files);
     g_log(log_domain, log_level, "RingPrintFiles  (%u) : %s", capture_opts->print_file_names, (capture_opts->print_file_names ? capture_opts->print_name_to : ""));
+    g_log(log_domain, log_level, "CompressType        : %s", capture_opts->compress_type ? capture_opts->compress_type : "none");
+    g_log(log_domain, log_level, "CompressThreads     : %u", capture_opts->compress_threads);
+    g_log(log_domain, log_level, "CompressCPUs        : %s", capture_opts->compress_cpus ? capture_opts->compress_cpus : "");
 
     g_log(log_domain, log_level, "AutostopFiles   (%u) : %u", capture_opts->has_autostop_files, capture_opts->autostop_files);
     g_log(log_domain, log_level, "AutostopPackets (%u) : %u", capture_opts->has_autostop_packets, capture_opts->autostop_packets);
@@ -787,6 +794,29 @@ capture_opts_add_iface_opt(capture_options *capture_opts, const char *optarg_str
     return 0;
 }
 
+/*
+ * Check the syntax of a list of CPUs such as "2,4-7".
+ */
+static gboolean
+cpu_list_is_valid(const char *list)
+{
+    const char *p = list;
+
+    do {
+        if (!g_ascii_isdigit(*p))
+            return FALSE;
+        while (g_ascii_isdigit(*p))
+            p++;
+        if (*p == '-') {
+            p++;
+            if (!g_ascii_isdigit(*p))
+                return FALSE;
+            while (g_ascii_isdigit(*p))
+                p++;
+        }
+    } while (*p++ == ',');
+    return *(p - 1) == '\0';
+}
 
 int
 capture_opts_add_opt(capture_options *capture_opts, int opt, const char *optarg_str_p, gboolean *start_capture)
@@ -988,12 +1018,38 @@ capture_opts_add_opt(capture_options *capture_opts, int opt, const char *optarg_
             ;
         } else if (strcmp(optarg_str_p, "gzip") == 0) {
             ;
+#ifdef HAVE_ZSTD
+        } else if (strcmp(optarg_str_p, "zstd") == 0) {
+            ;
+#endif
+#ifdef HAVE_LZ4FRAME_H
+        } else if (strcmp(optarg_str_p, "lz4") == 0) {
+            ;
+#endif
         } else {
-            cmdarg_err("parameter of --compress-type can be 'none' or 'gzip'");
+            cmdarg_err("parameter of --compress-type can be 'none', 'gzip'"
+#ifdef HAVE_ZSTD
+                       ", 'zstd'"
+#endif
+#ifdef HAVE_LZ4FRAME_H
+                       ", 'lz4'"
+#endif
+                       );
             return 1;
         }
         capture_opts->compress_type = g_strdup(optarg_str_p);
         break;
+    case LONGOPT_COMPRESS_THREADS:  /* number of compression threads */
+        capture_opts->compress_threads = get_positive_int(optarg_str_p, "number of compression threads");
+        break;
+    case LONGOPT_COMPRESS_CPUS:  /* CPUs for compression threads */
+        if (!cpu_list_is_valid(optarg_str_p)) {
+            cmdarg_err("\"%s\" isn't a valid list of CPUs", optarg_str_p);
+            return 1;
+        }
+        g_free(capture_opts->compress_cpus);
+        capture_opts->compress_cpus = g_strdup(optarg_str_p);
+        break;
     default:
         /* the caller is responsible to send us only the right opt's */
         g_assert_not_reached();
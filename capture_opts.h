@@ -47,6 +47,8 @@ extern "C" {
 #define LONGOPT_LIST_TSTAMP_TYPES LONGOPT_BASE_CAPTURE+2
 #define LONGOPT_SET_TSTAMP_TYPE   LONGOPT_BASE_CAPTURE+3
 #define LONGOPT_COMPRESS_TYPE     LONGOPT_BASE_CAPTURE+4
+#define LONGOPT_COMPRESS_THREADS  LONGOPT_BASE_CAPTURE+5
+#define LONGOPT_COMPRESS_CPUS     LONGOPT_BASE_CAPTURE+6
 
 /*
  * Options for capturing common to all capturing programs.
@@ -88,7 +90,9 @@ extern "C" {
     {"linktype",              required_argument, NULL, 'y'}, \
     {"list-time-stamp-types", no_argument,       NULL, LONGOPT_LIST_TSTAMP_TYPES}, \
     {"time-stamp-type",       required_argument, NULL, LONGOPT_SET_TSTAMP_TYPE}, \
-    {"compress-type",         required_argument, NULL, LONGOPT_COMPRESS_TYPE},
+    {"compress-type",         required_argument, NULL, LONGOPT_COMPRESS_TYPE}, \
+    {"compress-threads",      required_argument, NULL, LONGOPT_COMPRESS_THREADS}, \
+    {"compress-cpus",         required_argument, NULL, LONGOPT_COMPRESS_CPUS},
 
 
 #define OPTSTRING_CAPTURE_COMMON \
@@ -321,6 +325,9 @@ typedef struct capture_options_tag {
     gboolean           output_to_pipe;        /**< save_file is a pipe (named or stdout) */
     gboolean           capture_child;         /**< hidden option: Wireshark child mode */
     gchar             *compress_type;         /**< compress type */
+    guint              compress_threads;      /**< number of compression threads,
+                                                   0 for the default */
+    gchar             *compress_cpus;         /**< CPUs for compression threads */
 } capture_options;
 
 /* initialize the capture_options with some reasonable values */
@@ -93,6 +93,9 @@ typedef struct _capture_file {
   gboolean                    redissecting;         /* TRUE if currently redissecting (cf_redissect_packets) */
   gboolean                    read_lock;            /* TRUE if currently processing a file (cf_read) */
   rescan_type                 redissection_queued;  /* Queued redissection type. */
+  gboolean                    first_pass_deferred;  /* TRUE if the frames came from a packet index and haven't all been dissected in order yet */
+  guint32                     first_pass_done;      /* if first_pass_deferred, the frames up to this one have been dissected in order */
+  GQueue                     *filter_cache;         /* Frames that passed recently applied display filters, most recent first */
   /* search */
   gchar                      *sfilter;              /* Filter, hex value, or string being searched */
   gboolean                    hex;                  /* TRUE if "Hex value" search was last selected */
@@ -1,5 +1,6 @@
 /* dftest.c
  * Shows display filter byte-code, for debugging dfilter routines.
+ * Optionally benchmarks the filter against the packets of a capture file.
  *
  * Wireshark - Network traffic analyzer
  * By Gerald Combs <gerald@wireshark.org>
@@ -19,8 +20,11 @@
 #include <glib.h>
 
 #include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
 #include <epan/timestamp.h>
 #include <epan/prefs.h>
+#include <epan/tvbuff.h>
 #include <epan/dfilter/dfilter.h>
 
 #ifdef HAVE_PLUGINS
@@ -32,6 +36,7 @@
 
 #include <wiretap/wtap.h>
 
+#include "ui/failure_message.h"
 #include "ui/util.h"
 
 static void failure_warning_message(const char *msg_format, va_list ap);
@@ -39,6 +44,19 @@ static void open_failure_message(const char *filename, int err,
 	gboolean for_writing);
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
+static int benchmark_filter(const char *text, dfilter_t *df,
+	const char *cf_name, guint iterations, const char *narrowed_text);
+
+static void
+print_usage(FILE *output)
+{
+	fprintf(output, "Usage: dftest [-r <infile> [-n <iterations>] [-N <filter>]] <filter>\n");
+	fprintf(output, "  -r <infile>      benchmark the filter against the packets in <infile>\n");
+	fprintf(output, "  -n <iterations>  apply the filter this many times to each packet\n");
+	fprintf(output, "                   (default: 100)\n");
+	fprintf(output, "  -N <filter>      count the packets that refiltering wouldn't dissect\n");
+	fprintf(output, "                   if the results of <filter> were cached\n");
+}
 
 int
 main(int argc, char **argv)
@@ -47,6 +65,11 @@ main(int argc, char **argv)
 	char		*text;
 	dfilter_t	*df;
 	gchar		*err_msg;
+	const char	*cf_name = NULL;
+	const char	*narrowed_text = NULL;
+	guint		iterations = 100;
+	int		argi = 1;
+	int		ret = 0;
 
 	/*
 	 * Get credential information for later use.
@@ -103,14 +126,38 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
+	/* Options come before the filter, which can itself contain "-". */
+	while (argi + 1 < argc) {
+		if (strcmp(argv[argi], "-r") == 0) {
+			cf_name = argv[argi + 1];
+		} else if (strcmp(argv[argi], "-n") == 0) {
+			char *end;
+			unsigned long n;
+
+			errno = 0;
+			n = strtoul(argv[argi + 1], &end, 10);
+			if (errno != 0 || *end != '\0' || n == 0 || n > G_MAXUINT) {
+				fprintf(stderr, "dftest: \"%s\" isn't a valid iteration count\n",
+					argv[argi + 1]);
+				exit(1);
+			}
+			iterations = (guint)n;
+		} else if (strcmp(argv[argi], "-N") == 0) {
+			narrowed_text = argv[argi + 1];
+		} else {
+			break;
+		}
+		argi += 2;
+	}
+
 	/* Check for filter on command line */
-	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+	if (argc <= argi) {
+		print_usage(stderr);
 		exit(1);
 	}
 
 	/* Get filter text */
-	text = get_args_as_string(argc, argv, 1);
+	text = get_args_as_string(argc, argv, argi);
 
 	printf("Filter: \"%s\"\n", text);
 
@@ -130,10 +177,208 @@ main(int argc, char **argv)
 	else
 		dfilter_dump(df);
 
+	if (cf_name != NULL && df != NULL)
+		ret = benchmark_filter(text, df, cf_name, iterations, narrowed_text);
+
 	dfilter_free(df);
 	epan_cleanup();
 	g_free(text);
-	exit(0);
+	exit(ret);
+}
+
+/*
+ * The frames the benchmark keeps around, for the time stamps of the
+ * reference and previous frames.  Every packet is displayed, so the
+ * previous displayed frame is also the previous captured frame.
+ */
+struct packet_provider_data {
+	const frame_data *ref;
+	const frame_data *prev_dis;
+};
+
+static const nstime_t *
+dftest_get_frame_ts(struct packet_provider_data *prov, guint32 frame_num)
+{
+	if (prov->ref && prov->ref->num == frame_num)
+		return &prov->ref->abs_ts;
+
+	if (prov->prev_dis && prov->prev_dis->num == frame_num)
+		return &prov->prev_dis->abs_ts;
+
+	return NULL;
+}
+
+/*
+ * Dissects each packet in the file once, then applies the filter to it
+ * "iterations" times, both as compiled normally and as compiled without
+ * the type-specialized comparison instructions, and reports the time
+ * each took.  The two have to agree on every packet, and the filter's
+ * prefilter mustn't reject any packet the filter matches.
+ *
+ * If "narrowed_text" is given, and the filter narrows it, as Wireshark
+ * checks before reusing the cached results of "narrowed_text" when the
+ * filter is applied, also count the packets that "narrowed_text"
+ * rejects, which Wireshark wouldn't dissect; the filter mustn't match
+ * any of them.
+ */
+static int
+benchmark_filter(const char *text, dfilter_t *df, const char *cf_name,
+		guint iterations, const char *narrowed_text)
+{
+	static const struct packet_provider_funcs funcs = {
+		dftest_get_frame_ts,
+		NULL,
+		NULL,
+		NULL,
+	};
+	struct packet_provider_data provider = { NULL, NULL };
+	dfilter_t	*df_generic;
+	dfilter_t	*df_narrowed = NULL;
+	gboolean	narrows = FALSE;
+	gchar		*err_msg;
+	wtap		*wth;
+	int		err;
+	gchar		*err_info;
+	gint64		data_offset;
+	wtap_rec	rec;
+	Buffer		buf;
+	epan_t		*session;
+	epan_dissect_t	*edt;
+	frame_data	fd;
+	frame_data	ref_frame, prev_dis_frame;
+	nstime_t	elapsed_time = NSTIME_INIT_ZERO;
+	guint32		framenum = 0, cum_bytes = 0;
+	guint32		matched = 0, prefiltered = 0, skipped = 0;
+	gint64		start, usecs_specialized = 0, usecs_generic = 0;
+	gboolean	passed, passed_generic;
+	guint		i;
+	int		ret = 0;
+
+	if (!dfilter_compile_generic(text, &df_generic, &err_msg)) {
+		fprintf(stderr, "dftest: %s\n", err_msg);
+		g_free(err_msg);
+		return 2;
+	}
+
+	if (narrowed_text != NULL) {
+		if (!dfilter_compile(narrowed_text, &df_narrowed, &err_msg)) {
+			fprintf(stderr, "dftest: %s\n", err_msg);
+			g_free(err_msg);
+			dfilter_free(df_generic);
+			return 2;
+		}
+		narrows = df_narrowed != NULL &&
+		    dfilter_text_narrows(narrowed_text, text);
+	}
+
+	wth = wtap_open_offline(cf_name, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+	if (wth == NULL) {
+		cfile_open_failure_message("dftest", cf_name, err, err_info);
+		dfilter_free(df_narrowed);
+		dfilter_free(df_generic);
+		return 2;
+	}
+
+	session = epan_new(&provider, &funcs);
+	edt = epan_dissect_new(session, TRUE, FALSE);
+	wtap_rec_init(&rec);
+	ws_buffer_init(&buf, 1514);
+
+	while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+		if (rec.rec_type != REC_TYPE_PACKET)
+			continue;
+
+		framenum++;
+		frame_data_init(&fd, framenum, &rec, data_offset, cum_bytes);
+		frame_data_set_before_dissect(&fd, &elapsed_time, &provider.ref,
+		    provider.prev_dis);
+		if (provider.ref == &fd) {
+			ref_frame = fd;
+			provider.ref = &ref_frame;
+		}
+
+		epan_dissect_prime_with_dfilter(edt, df);
+		epan_dissect_prime_with_dfilter(edt, df_generic);
+		if (narrows)
+			epan_dissect_prime_with_dfilter(edt, df_narrowed);
+		epan_dissect_run(edt, wtap_file_type_subtype(wth), &rec,
+		    tvb_new_real_data(ws_buffer_start_ptr(&buf),
+			rec.rec_header.packet_header.caplen,
+			rec.rec_header.packet_header.len),
+		    &fd, NULL);
+
+		passed = dfilter_apply_edt(df, edt);
+		passed_generic = dfilter_apply_edt(df_generic, edt);
+		if (passed != passed_generic) {
+			fprintf(stderr, "dftest: frame %u: the filter %s but the generic filter %s\n",
+				framenum, passed ? "matched" : "didn't match",
+				passed_generic ? "did" : "didn't");
+			ret = 2;
+		}
+		if (passed)
+			matched++;
+
+		/* Nor may it match a packet the filter it narrows rejects. */
+		if (narrows && !dfilter_apply_edt(df_narrowed, edt)) {
+			skipped++;
+			if (passed) {
+				fprintf(stderr, "dftest: frame %u: the filter matched but the filter it narrows didn't\n",
+					framenum);
+				ret = 2;
+			}
+		}
+
+		/* The prefilter mustn't reject a packet the filter matches. */
+		if (!fd.other_data_src &&
+		    !dfilter_may_match_packet(df, rec.rec_header.packet_header.pkt_encap,
+			ws_buffer_start_ptr(&buf), rec.rec_header.packet_header.caplen)) {
+			prefiltered++;
+			if (passed) {
+				fprintf(stderr, "dftest: frame %u: the filter matched but the prefilter rejected it\n",
+					framenum);
+				ret = 2;
+			}
+		}
+
+		start = g_get_monotonic_time();
+		for (i = 0; i < iterations; i++)
+			dfilter_apply_edt(df, edt);
+		usecs_specialized += g_get_monotonic_time() - start;
+
+		start = g_get_monotonic_time();
+		for (i = 0; i < iterations; i++)
+			dfilter_apply_edt(df_generic, edt);
+		usecs_generic += g_get_monotonic_time() - start;
+
+		frame_data_set_after_dissect(&fd, &cum_bytes);
+		prev_dis_frame = fd;
+		provider.prev_dis = &prev_dis_frame;
+		frame_data_destroy(&fd);
+		epan_dissect_reset(edt);
+	}
+	if (err != 0) {
+		cfile_read_failure_message("dftest", cf_name, err, err_info);
+		ret = 2;
+	}
+
+	printf("\n%u packets, %u matched, %u iterations per packet\n",
+		framenum, matched, iterations);
+	printf("Specialized: %" G_GINT64_FORMAT " us\n", usecs_specialized);
+	printf("Generic:     %" G_GINT64_FORMAT " us\n", usecs_generic);
+	printf("Prefilter:   %u rejected without dissection\n", prefiltered);
+	if (narrows)
+		printf("Narrowed:    %u skipped without dissection\n", skipped);
+	else if (narrowed_text != NULL)
+		printf("Narrowed:    doesn't narrow \"%s\"\n", narrowed_text);
+
+	ws_buffer_free(&buf);
+	wtap_rec_cleanup(&rec);
+	epan_dissect_free(edt);
+	epan_free(session);
+	wtap_close(wth);
+	dfilter_free(df_narrowed);
+	dfilter_free(df_generic);
+	return ret;
 }
 
 /*
@@ -351,6 +351,7 @@ static void WS_NORETURN exit_main(int err);
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(unsigned int packet_count);
 static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name);
+static void report_compress_stats(void);
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(capture_options *capture_opts, guint i, const char *errmsg);
 
@@ -427,6 +428,18 @@ print_usage(FILE *output)
     fprintf(output, "                                          an exact multiple of NUM secs\n");
     fprintf(output, "                          printname:FILE - print filename to FILE when written\n");
     fprintf(output, "                                           (can use 'stdout' or 'stderr')\n");
+    fprintf(output, "  --compress-type <type>   compress completed files with 'gzip'"
+#ifdef HAVE_ZSTD
+                    ", 'zstd'"
+#endif
+#ifdef HAVE_LZ4FRAME_H
+                    ", 'lz4'"
+#endif
+                    "\n");
+    fprintf(output, "                           (only with -b and no files:NUM)\n");
+    fprintf(output, "  --compress-threads <n>   number of threads compressing files\n");
+    fprintf(output, "  --compress-cpus <list>   run the compression threads only on these CPUs,\n");
+    fprintf(output, "                           e.g. 2,4-7\n");
     fprintf(output, "  -n                       use pcapng format instead of pcap (default)\n");
     fprintf(output, "  -P                       use libpcap format instead of pcapng\n");
     fprintf(output, "  --capture-comment <comment>\n");
@@ -3571,7 +3584,9 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                 *save_file_fd = ringbuf_init(capfile_name,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
                                              capture_opts->group_read_access,
-                                             capture_opts->compress_type);
+                                             capture_opts->compress_type,
+                                             capture_opts->compress_threads,
+                                             capture_opts->compress_cpus);
 
                 /* capfile_name is unused as the ringbuffer provides its own filename. */
                 if (*save_file_fd != -1) {
@@ -4368,6 +4383,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* close the input file (pcap or capture pipe) */
     capture_loop_close_input(&global_ld);
 
+    /* wait for completed ringbuffer files to be compressed */
+    if (capture_opts->multi_files_on && capture_opts->compress_type != NULL)
+        report_compress_stats();
+
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopped.");
 
     /* ok, if the write and the close were successful. */
@@ -5184,6 +5203,8 @@ main(int argc, char *argv[])
         case 'I':        /* Monitor mode */
 #endif
         case LONGOPT_COMPRESS_TYPE:        /* compress type */
+        case LONGOPT_COMPRESS_THREADS:     /* number of compression threads */
+        case LONGOPT_COMPRESS_CPUS:        /* CPUs for compression threads */
             status = capture_opts_add_opt(&global_capture_opts, opt, optarg, &start_capture);
             if (status != 0) {
                 exit_main(status);
@@ -5765,6 +5786,35 @@ report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32
     }
 }
 
+static void
+report_compress_stats(void)
+{
+    ringbuf_compress_stats cs;
+    guint64 lag_avg_ms;
+
+    ringbuf_compress_finish();
+    ringbuf_get_compress_stats(&cs);
+    if (cs.files_queued == 0)
+        return;
+
+    lag_avg_ms = cs.lag_total_us / cs.files_queued / 1000;
+    if (capture_child) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+            "Files compressed/failed: %u/%u, bytes in/out: %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT
+            ", lag avg/max: %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " ms, max queued: %u, capture stalled: %" G_GUINT64_FORMAT " ms",
+            cs.files_compressed, cs.files_failed, cs.bytes_in, cs.bytes_out,
+            lag_avg_ms, cs.lag_max_us / 1000, cs.max_pending, cs.stall_us / 1000);
+    } else {
+        fprintf(stderr,
+            "Files compressed/failed: %u/%u (%.1f%% of original size), lag avg/max: %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " ms, max queued: %u, capture stalled: %" G_GUINT64_FORMAT " ms\n",
+            cs.files_compressed, cs.files_failed,
+            cs.bytes_in ? 100.0 * cs.bytes_out / cs.bytes_in : 0.0,
+            lag_avg_ms, cs.lag_max_us / 1000, cs.max_pending, cs.stall_us / 1000);
+        /* stderr could be line buffered */
+        fflush(stderr);
+    }
+}
+
 
 /************************************************************************************************/
 /* signal_pipe handling */
@@ -72,7 +72,6 @@
 #include <ui/cmdarg_err.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
-#include <wsutil/wsgcrypt.h>
 #include <wsutil/plugins.h>
 #include <wsutil/privileges.h>
 #include <wsutil/report_message.h>
@@ -81,6 +80,8 @@
 #include <cli_main.h>
 #include <version_info.h>
 #include <wsutil/pint.h>
+#include <wsutil/murmurhash3.h>
+#include <wsutil/wsgcrypt.h>
 #include <wsutil/strtoi.h>
 #include <wiretap/wtap_opttypes.h>
 #include <wiretap/pcapng.h>
@@ -107,19 +108,44 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * Every packet we've seen within the duplicate window is kept, oldest
+ * first, in a FIFO ring of fd_hash_t entries.  Each distinct
+ * (digest, length) pair in the ring has a slot in an open-addressing
+ * hash table, so looking a new packet up costs the same no matter how
+ * large the window is; entries are evicted from the ring when they fall
+ * out of the packet, time or byte window.  The entries with the same
+ * key are linked newest first, so that all of them can be checked
+ * against the time window.
+ *
+ * The -v output shows the MD5 hash of each packet, as it always has;
+ * it's only calculated for that.
  */
 typedef struct _fd_hash_t {
-    guint8     digest[16];
+    guint8     digest[MURMURHASH3_128_LEN];
     guint32    len;
+    guint32    prev;    /* ring index of the previous entry with this key */
     nstime_t   frame_time;
 } fd_hash_t;
 
-#define DEFAULT_DUP_DEPTH       5   /* Used with -d */
-#define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
+typedef struct _fd_hash_slot_t {
+    guint32    newest;  /* ring index of the newest entry with this key */
+    guint32    count;   /* number of entries in the ring with this key; 0 if unused */
+} fd_hash_slot_t;
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
+#define DEFAULT_DUP_DEPTH       5   /* Used with -d */
+#define MAX_DUP_DEPTH     1000000   /* the maximum window for de-duplication */
+
+static fd_hash_t      *fd_hash       = NULL;  /* FIFO ring of dup_window entries */
+static guint32         fd_hash_head  = 0;     /* index of the oldest entry */
+static guint32         fd_hash_count = 0;     /* number of entries in the ring */
+static guint64         fd_hash_bytes = 0;     /* total length of the entries in the ring */
+static fd_hash_slot_t *fd_table      = NULL;
+static guint32         fd_table_mask = 0;
+static guint8          cur_digest[MURMURHASH3_128_LEN];
+static guint8          cur_md5[16];           /* Used with -v */
+static int             dup_window    = DEFAULT_DUP_DEPTH;
+static guint64         dup_byte_window = 0;   /* Used with --dup-byte-window; 0 means no limit */
 
 static guint32   ignored_bytes  = 0;  /* Used with -I */
 
@@ -591,57 +617,113 @@ remove_vlan_info(const wtap_packet_header *phdr, guint8* fd, guint32* len) {
     }
 }
 
-static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-    int i;
-    const struct ieee80211_radiotap_header* tap_header;
-
-    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 offset = ignored_bytes;
-    guint32 new_len;
-    guint8 *new_fd;
-
-    if (len <= ignored_bytes) {
-        offset = 0;
-    }
+static void
+dup_init(void)
+{
+    guint32 table_size = 16;
 
-    /* Get the size of radiotap header and use that as offset (-p option) */
-    if (skip_radiotap == TRUE) {
-        tap_header = (const struct ieee80211_radiotap_header*)fd;
-        offset = pletoh16(&tap_header->it_len);
-        if (offset >= len)
-            offset = 0;
-    }
+    /*
+     * The ring holds the previous dup_window - 1 packets plus the
+     * current one.  Keep the table at most half full so that probe
+     * sequences stay short.
+     */
+    while (table_size < 2 * (guint32)dup_window)
+        table_size <<= 1;
+    fd_hash = g_new(fd_hash_t, dup_window > 0 ? dup_window : 1);
+    fd_table = g_new0(fd_hash_slot_t, table_size);
+    fd_table_mask = table_size - 1;
+}
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
+static void
+dup_cleanup(void)
+{
+    g_free(fd_hash);
+    fd_hash = NULL;
+    g_free(fd_table);
+    fd_table = NULL;
+}
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+static guint32
+dup_table_home(const guint8 *digest, guint32 len)
+{
+    /* The digest is already well mixed; just fold in the length. */
+    return (pletoh32(digest) ^ len) & fd_table_mask;
+}
 
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+/*
+ * Find the table slot for the given key; if there isn't one, return the
+ * empty slot at which it would be inserted.
+ */
+static guint32
+dup_table_find(const guint8 *digest, guint32 len)
+{
+    guint32 i;
 
-    fd_hash[cur_dup_entry].len = len;
+    for (i = dup_table_home(digest, len); fd_table[i].count != 0;
+         i = (i + 1) & fd_table_mask) {
+        const fd_hash_t *entry = &fd_hash[fd_table[i].newest];
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
+        if (entry->len == len &&
+            memcmp(entry->digest, digest, MURMURHASH3_128_LEN) == 0)
+            break;
+    }
+    return i;
+}
 
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
+/*
+ * Remove a slot from the table, moving later entries of its probe
+ * sequence back so that lookups don't need tombstones.
+ */
+static void
+dup_table_remove(guint32 i)
+{
+    guint32 j = i;
+
+    for (;;) {
+        const fd_hash_t *entry;
+        guint32 home;
+
+        fd_table[i].count = 0;
+        for (;;) {
+            j = (j + 1) & fd_table_mask;
+            if (fd_table[j].count == 0)
+                return;
+            entry = &fd_hash[fd_table[j].newest];
+            home = dup_table_home(entry->digest, entry->len);
+            /* Can the entry at j be moved back to i? */
+            if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+                break;
         }
+        fd_table[i] = fd_table[j];
+        i = j;
     }
+}
 
-    return FALSE;
+static void
+dup_evict_oldest(void)
+{
+    fd_hash_t *entry = &fd_hash[fd_hash_head];
+    guint32 i = dup_table_find(entry->digest, entry->len);
+
+    if (--fd_table[i].count == 0)
+        dup_table_remove(i);
+    fd_hash_bytes -= entry->len;
+    fd_hash_head = (fd_hash_head + 1) % (guint32)dup_window;
+    fd_hash_count--;
 }
 
+/*
+ * Returns TRUE if the packet is a duplicate of one in the current
+ * window; the packet is added to the window either way.  If current is
+ * non-null, only packets no more than relative_time_window before it
+ * count.
+ */
 static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
+is_duplicate(guint8* fd, guint32 len, const nstime_t *current) {
+    const struct ieee80211_radiotap_header* tap_header;
+    gboolean dup = FALSE;
+    fd_hash_t *entry;
+    guint32 i;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     guint32 offset = ignored_bytes;
@@ -652,104 +734,90 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
         offset = 0;
     }
 
+    /* Get the size of radiotap header and use that as offset (-p option) */
+    if (skip_radiotap == TRUE) {
+        tap_header = (const struct ieee80211_radiotap_header*)fd;
+        offset = pletoh16(&tap_header->it_len);
+        if (offset >= len)
+            offset = 0;
+    }
+
     new_fd  = &fd[offset];
     new_len = len - (offset);
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
-
     /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    murmurhash3_128(new_fd, new_len, 0, cur_digest);
+    if (verbose)
+        gcry_md_hash_buffer(GCRY_MD_MD5, cur_md5, new_fd, new_len);
 
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
-    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
+    if (dup_window == 0)
+        return FALSE;
 
     /*
-     * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
-     *
-     * Of course this assumes that the input trace file is
-     * "well-formed" in the sense that the packet timestamps are
-     * in strict chronologically increasing order (which is NOT
-     * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
+     * Drop packets that have fallen out of the window.  The time window
+     * assumes that packets are in chronological order; we stop at the
+     * first packet that's not too old.
      */
+    if (current != NULL) {
+        while (fd_hash_count > 0) {
+            nstime_t delta;
 
-    for (i = cur_dup_entry - 1;; i--) {
-        nstime_t delta;
-        int cmp;
-
-        if (i < 0)
-            i = dup_window - 1;
-
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
-            break;
-        }
-
-        if (nstime_is_unset(&(fd_hash[i].frame_time))) {
-            /*
-             * We've decremented to an unused fd_hash[] entry.
-             * Check no more!
-             */
-            break;
+            nstime_delta(&delta, current, &fd_hash[fd_hash_head].frame_time);
+            if (nstime_cmp(&delta, &relative_time_window) <= 0)
+                break;
+            dup_evict_oldest();
         }
+    }
+    if (dup_byte_window != 0) {
+        while (fd_hash_count > 0 && fd_hash_bytes > dup_byte_window)
+            dup_evict_oldest();
+    }
+    if (fd_hash_count == (guint32)dup_window)
+        dup_evict_oldest();
 
-        nstime_delta(&delta, current, &fd_hash[i].frame_time);
-
-        if (delta.secs < 0 || delta.nsecs < 0) {
-            /*
-             * A negative delta implies that the current packet
-             * has an absolute timestamp less than the cached packet
-             * that it is being compared to.  This is NOT a normal
-             * situation since trace files usually have packets in
-             * chronological order (oldest to newest).
-             *
-             * There are several possible ways to deal with this:
-             * 1. 'continue' dup checking with the next cached frame.
-             * 2. 'break' from looking for a duplicate of the current frame.
-             * 3. Take the absolute value of the delta and see if that
-             * falls within the specifed dup time window.
-             *
-             * Currently this code does option 1.  But it would pretty
-             * easy to add yet-another-editcap-option to select one of
-             * the other behaviors for dealing with out-of-sequence
-             * packets.
-             */
-            continue;
-        }
+    /* Look for duplicates */
+    i = dup_table_find(cur_digest, len);
+    if (fd_table[i].count != 0) {
+        if (current == NULL) {
+            dup = TRUE;
+        } else {
+            guint32 j = fd_table[i].newest;
+            guint32 n;
 
-        cmp = nstime_cmp(&delta, &relative_time_window);
+            for (n = 0; n < fd_table[i].count && !dup; n++) {
+                nstime_t delta;
 
-        if (cmp > 0) {
-            /*
-             * The delta time indicates that we are now looking at
-             * cached packets beyond the specified dup time window.
-             * Check no more!
-             */
-            break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
+                /*
+                 * A negative delta implies that the current packet has
+                 * an earlier time stamp than the cached packet; as trace
+                 * files usually have packets in chronological order, we
+                 * don't treat that as a duplicate, but an older packet
+                 * with the same key still might be one.
+                 */
+                nstime_delta(&delta, current, &fd_hash[j].frame_time);
+                if (delta.secs >= 0 && delta.nsecs >= 0 &&
+                    nstime_cmp(&delta, &relative_time_window) <= 0)
+                    dup = TRUE;
+                j = fd_hash[j].prev;
+            }
         }
     }
 
-    return FALSE;
+    /* Add the packet to the window */
+    entry = &fd_hash[(fd_hash_head + fd_hash_count) % (guint32)dup_window];
+    memcpy(entry->digest, cur_digest, MURMURHASH3_128_LEN);
+    entry->len = len;
+    entry->prev = fd_table[i].newest;   /* not used if there's no previous one */
+    if (current != NULL)
+        entry->frame_time = *current;
+    else
+        nstime_set_unset(&entry->frame_time);
+    fd_table[i].newest = (guint32)(entry - fd_hash);
+    fd_table[i].count++;
+    fd_hash_count++;
+    fd_hash_bytes += len;
+
+    return dup;
 }
 
 static void
@@ -782,6 +850,10 @@ print_usage(FILE *output)
     fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
     fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
     fprintf(output, "                         (e.g. 0.000001).\n");
+    fprintf(output, "  --dup-byte-window <bytes>\n");
+    fprintf(output, "                         only compare against previous packets whose combined\n");
+    fprintf(output, "                         length is at most <bytes>; may be combined with\n");
+    fprintf(output, "                         -d, -D or -w.\n");
     fprintf(output, "           NOTE: The use of the 'Duplicate packet removal' options with\n");
     fprintf(output, "           other editcap options except -v may not always work as expected.\n");
     fprintf(output, "           Specifically the -r, -t or -S options will very likely NOT have the\n");
@@ -822,7 +894,7 @@ print_usage(FILE *output)
     fprintf(output, "                         the pseudo-random number generator. This allows one to\n");
     fprintf(output, "                         repeat a particular sequence of errors.\n");
     fprintf(output, "  -I <bytes to ignore>   ignore the specified number of bytes at the beginning\n");
-    fprintf(output, "                         of the frame during MD5 hash calculation, unless the\n");
+    fprintf(output, "                         of the frame during hash calculation, unless the\n");
     fprintf(output, "                         frame is too short, then the full frame is used.\n");
     fprintf(output, "                         Useful to remove duplicated packets taken on\n");
     fprintf(output, "                         several routers (different mac addresses for\n");
@@ -1008,6 +1080,17 @@ editcap_dump_open(const char *filename, const wtap_dump_params *params,
     if (pdh == NULL)
         return NULL;
 
+    /*
+     * Leave the disk I/O to a writer thread, unless we're writing to
+     * the standard output, as whatever's reading it would then see the
+     * data in big bursts.  If that can't be done, write synchronously.
+     */
+    if (strcmp(filename, "-") != 0) {
+        int async_err;
+
+        wtap_dump_set_async(pdh, 0, 0, 0, &async_err);
+    }
+
     /*
      * If the output file supporst identifying the interfaces on which
      * packets arrive, add all the IDBs we've seen so far.
@@ -1090,6 +1173,7 @@ main(int argc, char *argv[])
 #define LONGOPT_DISCARD_ALL_SECRETS  LONGOPT_BASE_APPLICATION+5
 #define LONGOPT_CAPTURE_COMMENT      LONGOPT_BASE_APPLICATION+6
 #define LONGOPT_DISCARD_CAPTURE_COMMENT LONGOPT_BASE_APPLICATION+7
+#define LONGOPT_DUP_BYTE_WINDOW      LONGOPT_BASE_APPLICATION+8
 
     static const struct option long_options[] = {
         {"novlan", no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1101,6 +1185,7 @@ main(int argc, char *argv[])
         {"version", no_argument, NULL, 'V'},
         {"capture-comment", required_argument, NULL, LONGOPT_CAPTURE_COMMENT},
         {"discard-capture-comment", no_argument, NULL, LONGOPT_DISCARD_CAPTURE_COMMENT},
+        {"dup-byte-window", required_argument, NULL, LONGOPT_DUP_BYTE_WINDOW},
         {0, 0, 0, 0 }
     };
 
@@ -1257,6 +1342,17 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_DUP_BYTE_WINDOW:
+        {
+            if (!ws_strtou64(optarg, NULL, &dup_byte_window) || dup_byte_window == 0) {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid duplicate byte window\n\n",
+                        optarg);
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
         case 'a':
         {
             guint frame_number;
@@ -1682,14 +1778,15 @@ main(int argc, char *argv[])
     if (!keep_em)
         max_packet_number = G_MAXUINT;
 
-    if (dup_detect || dup_detect_by_time) {
-        for (i = 0; i < dup_window; i++) {
-            memset(&fd_hash[i].digest, 0, 16);
-            fd_hash[i].len = 0;
-            nstime_set_unset(&fd_hash[i].frame_time);
-        }
+    if (dup_byte_window != 0 && !dup_detect && !dup_detect_by_time) {
+        /* --dup-byte-window on its own; the byte count is the only limit */
+        dup_detect = TRUE;
+        dup_window = MAX_DUP_DEPTH;
     }
 
+    if (dup_detect || dup_detect_by_time)
+        dup_init();
+
     /* Set up an array of all IDBs seen */
     idbs_seen = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
 
@@ -2003,14 +2100,14 @@ main(int argc, char *argv[])
 
                 /* suppress duplicates by packet window */
                 if (dup_detect) {
-                    if (is_duplicate(buf, rec->rec_header.packet_header.caplen)) {
+                    if (is_duplicate(buf, rec->rec_header.packet_header.caplen, NULL)) {
                         if (verbose) {
                             fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
                                     count,
                                     rec->rec_header.packet_header.caplen);
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                        (unsigned char)cur_md5[i]);
                             fprintf(stderr, "\n");
                         }
                         duplicate_count++;
@@ -2023,7 +2120,7 @@ main(int argc, char *argv[])
                                     rec->rec_header.packet_header.caplen);
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                        (unsigned char)cur_md5[i]);
                             fprintf(stderr, "\n");
                         }
                     }
@@ -2037,16 +2134,16 @@ main(int argc, char *argv[])
                         current.secs  = rec->ts.secs;
                         current.nsecs = rec->ts.nsecs;
 
-                        if (is_duplicate_rel_time(buf,
-                                                  rec->rec_header.packet_header.caplen,
-                                                  &current)) {
+                        if (is_duplicate(buf,
+                                         rec->rec_header.packet_header.caplen,
+                                         &current)) {
                             if (verbose) {
                                 fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
                                         count,
                                         rec->rec_header.packet_header.caplen);
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            (unsigned char)cur_md5[i]);
                                 fprintf(stderr, "\n");
                             }
                             duplicate_count++;
@@ -2059,7 +2156,7 @@ main(int argc, char *argv[])
                                         rec->rec_header.packet_header.caplen);
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            (unsigned char)cur_md5[i]);
                                 fprintf(stderr, "\n");
                             }
                         }
@@ -2245,18 +2342,24 @@ main(int argc, char *argv[])
     }
 
     if (dup_detect) {
-        fprintf(stderr, "%u packet%s seen, %u packet%s skipped with duplicate window of %i packets.\n",
+        fprintf(stderr, "%u packet%s seen, %u packet%s skipped with duplicate window of %i packets",
                 count - 1, plurality(count - 1, "", "s"), duplicate_count,
                 plurality(duplicate_count, "", "s"), dup_window);
     } else if (dup_detect_by_time) {
-        fprintf(stderr, "%u packet%s seen, %u packet%s skipped with duplicate time window equal to or less than %ld.%09ld seconds.\n",
+        fprintf(stderr, "%u packet%s seen, %u packet%s skipped with duplicate time window equal to or less than %ld.%09ld seconds",
                 count - 1, plurality(count - 1, "", "s"), duplicate_count,
                 plurality(duplicate_count, "", "s"),
                 (long)relative_time_window.secs,
                 (long int)relative_time_window.nsecs);
     }
+    if (dup_detect || dup_detect_by_time) {
+        if (dup_byte_window != 0)
+            fprintf(stderr, " and at most %" G_GUINT64_FORMAT " bytes", dup_byte_window);
+        fprintf(stderr, ".\n");
+    }
 
 clean_exit:
+    dup_cleanup();
     if (dsb_filenames) {
         g_array_free(dsb_types, TRUE);
         g_ptr_array_free(dsb_filenames, TRUE);
@@ -46,11 +46,52 @@ static GSList *color_filter_valid_list   = NULL;
 /* Color Filters can en-/disabled. */
 static gboolean filters_enabled = TRUE;
 
+/* The enabled filters in 'color_filter_list', compiled into one set so
+ * that they share the work of reading fields and comparing values, and
+ * the color_filter_t of each filter in the set.  Built when first needed
+ * after the list changes. */
+static dfilter_set_t *color_filter_set = NULL;
+static GPtrArray *color_filter_set_filters = NULL;
+
 /* Remember if there are temporary coloring filters set to
  * add sensitivity to the "Reset Coloring 1-10" menu item
  */
 static gboolean tmp_colors_set = FALSE;
 
+static void
+color_filters_invalidate_set(void)
+{
+    dfilter_set_free(color_filter_set);
+    color_filter_set = NULL;
+    if (color_filter_set_filters) {
+        g_ptr_array_free(color_filter_set_filters, TRUE);
+        color_filter_set_filters = NULL;
+    }
+}
+
+static void
+color_filters_build_set(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+    gchar          *err_msg = NULL;
+
+    color_filter_set = dfilter_set_new();
+    color_filter_set_filters = g_ptr_array_new();
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if (colorf->disabled || colorf->c_colorfilter == NULL)
+            continue;
+        if (dfilter_set_add(color_filter_set, colorf->filter_text, &err_msg) < 0) {
+            /* It compiled on its own, so this shouldn't happen. */
+            g_free(err_msg);
+            err_msg = NULL;
+            continue;
+        }
+        g_ptr_array_add(color_filter_set_filters, colorf);
+    }
+}
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const gchar *name,          /* The name of the filter to create */
@@ -187,6 +228,7 @@ color_filters_set_tmp(guint8 filt_nr, const gchar *filter, gboolean disabled, gc
                 colorf->filter_text = g_strdup(tmpfilter);
                 colorf->c_colorfilter = compiled_filter;
                 colorf->disabled = ((i!=filt_nr) ? TRUE : disabled);
+                color_filters_invalidate_set();
                 /* Remember that there are now temporary coloring filters set */
                 if( filter )
                     tmp_colors_set = TRUE;
@@ -346,6 +388,7 @@ gboolean
 color_filters_init(gchar** err_msg, color_filter_add_cb_func add_cb)
 {
     /* delete all currently existing filters */
+    color_filters_invalidate_set();
     color_filter_list_delete(&color_filter_list);
 
     /* now try to construct the filters list */
@@ -357,6 +400,7 @@ color_filters_reload(gchar** err_msg, color_filter_add_cb_func add_cb)
 {
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
+    color_filters_invalidate_set();
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
 
@@ -367,6 +411,8 @@ color_filters_reload(gchar** err_msg, color_filter_add_cb_func add_cb)
 void
 color_filters_cleanup(void)
 {
+    color_filters_invalidate_set();
+
     /* delete the previously deleted filters */
     color_filter_list_delete(&color_filter_deleted_list);
 }
@@ -451,6 +497,7 @@ color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl, gchar** err_msg)
 
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
+    color_filters_invalidate_set();
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
 
@@ -514,25 +561,24 @@ color_filters_prime_edt(epan_dissect_t *edt)
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    color_filter_t *colorf = NULL;
+    guint           i;
 
     /* If we have color filters, "search" for the matching one. */
     if ((edt->tree != NULL) && (color_filters_used())) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
+        if (color_filter_set == NULL)
+            color_filters_build_set();
+
+        for (i = 0; i < color_filter_set_filters->len; i++) {
+            if (dfilter_set_match_edt(color_filter_set, i, edt)) {
+                colorf = (color_filter_t *)g_ptr_array_index(color_filter_set_filters, i);
+                break;
             }
-            curr = g_slist_next(curr);
         }
+        dfilter_set_reset(color_filter_set);
     }
 
-    return NULL;
+    return colorf;
 }
 
 /* read filters from the given file */
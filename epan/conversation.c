@@ -482,62 +482,85 @@ void conversation_epan_reset(void)
 	new_index = 0;
 }
 
+/*
+ * The conversations with the same key in one of the conversation hash tables,
+ * sorted by setup frame, so that the one active in a given frame can be found
+ * with a binary search however often the key is reused.
+ */
+typedef struct conversation_chain {
+	conversation_key_t key;		/* the key the chain is stored under */
+	conversation_t **convs;
+	guint num_convs;
+	guint max_convs;
+} conversation_chain_t;
+
+/*
+ * Returns the number of conversations in the chain set up in or before
+ * frame_num, i.e. the index just past the one active in that frame.
+ */
+static guint
+conversation_chain_upper_bound(const conversation_chain_t *chain, const guint32 frame_num)
+{
+	guint low = 0, high = chain->num_convs, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (chain->convs[mid]->setup_frame <= frame_num)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
 /*
  * Does the right thing when inserting into one of the conversation hash tables,
  * taking into account ordering and hash chains and all that good stuff.
- *
- * Mostly adapted from the old conversation_new().
  */
 static void
 conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
-	conversation_t *chain_head, *chain_tail, *cur, *prev;
+	conversation_chain_t *chain;
+	guint pos;
 
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
+	chain = (conversation_chain_t *)wmem_map_lookup(hashtable, conv->key_ptr);
 
-	if (NULL==chain_head) {
+	if (NULL==chain) {
 		/* New entry */
-		conv->next = NULL;
-		conv->last = conv;
-		wmem_map_insert(hashtable, conv->key_ptr, conv);
+		chain = wmem_new(wmem_file_scope(), conversation_chain_t);
+		chain->key = conv->key_ptr;
+		chain->convs = wmem_new(wmem_file_scope(), conversation_t *);
+		chain->convs[0] = conv;
+		chain->num_convs = 1;
+		chain->max_convs = 1;
+		wmem_map_insert(hashtable, chain->key, chain);
 		DPRINT(("created a new conversation chain"));
+		return;
 	}
-	else {
-		/* There's an existing chain for this key */
-		DPRINT(("there's an existing conversation chain"));
-
-		chain_tail = chain_head->last;
-
-		if (conv->setup_frame >= chain_tail->setup_frame) {
-			/* This convo belongs at the end of the chain */
-			conv->next = NULL;
-			conv->last = NULL;
-			chain_tail->next = conv;
-			chain_head->last = conv;
-		}
-		else {
-			/* Loop through the chain to find the right spot */
-			cur = chain_head;
-			prev = NULL;
-
-			for (; (conv->setup_frame > cur->setup_frame) && cur->next; prev=cur, cur=cur->next)
-				;
-
-			if (NULL==prev) {
-				/* Changing the head of the chain */
-				conv->next = chain_head;
-				conv->last = chain_tail;
-				chain_head->last = NULL;
-				wmem_map_insert(hashtable, conv->key_ptr, conv);
-			}
-			else {
-				/* Inserting into the middle of the chain */
-				conv->next = cur;
-				conv->last = NULL;
-				prev->next = conv;
-			}
-		}
+
+	/* There's an existing chain for this key */
+	DPRINT(("there's an existing conversation chain of %u", chain->num_convs));
+
+	if (chain->num_convs == chain->max_convs) {
+		chain->max_convs *= 2;
+		chain->convs = (conversation_t **)wmem_realloc(wmem_file_scope(),
+		    chain->convs, chain->max_convs * sizeof(conversation_t *));
 	}
+
+	/*
+	 * Conversations are almost always created in frame order, so this
+	 * is normally an append.  Conversations with the same setup frame
+	 * stay in the order they were inserted in.
+	 */
+	if (conv->setup_frame >= chain->convs[chain->num_convs - 1]->setup_frame) {
+		pos = chain->num_convs;
+	} else {
+		pos = conversation_chain_upper_bound(chain, conv->setup_frame);
+		memmove(&chain->convs[pos + 1], &chain->convs[pos],
+		    (chain->num_convs - pos) * sizeof(conversation_t *));
+	}
+	chain->convs[pos] = conv;
+	chain->num_convs++;
 }
 
 /*
@@ -547,56 +570,78 @@ conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 static void
 conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
-	conversation_t *chain_head, *cur, *prev;
-
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
-
-	if (conv == chain_head) {
-		/* We are currently the front of the chain */
-		if (NULL == conv->next) {
-			/* We are the only conversation in the chain, no need to
-			 * update next pointer, but do not call
-			 * wmem_map_remove() either because the conv data
-			 * will be re-inserted. */
-			wmem_map_steal(hashtable, conv->key_ptr);
-		}
-		else {
-			/* Update the head of the chain */
-			chain_head = conv->next;
-			chain_head->last = conv->last;
+	conversation_chain_t *chain;
+	guint bound, pos;
 
-			if (conv->latest_found == conv)
-				chain_head->latest_found = NULL;
-			else
-				chain_head->latest_found = conv->latest_found;
-
-			wmem_map_insert(hashtable, chain_head->key_ptr, chain_head);
-		}
-	}
-	else {
-		/* We are not the front of the chain. Loop through to find us.
-		 * Start loop at chain_head->next rather than chain_head because
-		 * we already know we're not at the head. */
-		cur = chain_head->next;
-		prev = chain_head;
+	chain = (conversation_chain_t *)wmem_map_lookup(hashtable, conv->key_ptr);
+	if (NULL == chain)
+		return;
 
-		for (; (cur != conv) && cur->next; prev=cur, cur=cur->next)
-			;
+	/* Look back from the last conversation set up with conv. */
+	bound = conversation_chain_upper_bound(chain, conv->setup_frame);
+	pos = bound;
+	while (pos > 0 && chain->convs[pos - 1] != conv)
+		pos--;
 
-		if (cur != conv) {
+	if (pos == 0) {
+		/*
+		 * A dissector may have lowered conv->setup_frame itself,
+		 * rather than with conversation_set_setup_frame(), so look
+		 * further on.
+		 */
+		pos = bound;
+		while (pos < chain->num_convs && chain->convs[pos] != conv)
+			pos++;
+		if (pos == chain->num_convs) {
 			/* XXX: Conversation not found. Wrong hashtable? */
 			return;
 		}
+		pos++;
+	}
+	pos--;
+
+	if (chain->num_convs == 1) {
+		/* We are the only conversation in the chain; do not call
+		 * wmem_map_remove() either because the conv data will be
+		 * re-inserted. */
+		wmem_map_steal(hashtable, conv->key_ptr);
+		wmem_free(wmem_file_scope(), chain->convs);
+		wmem_free(wmem_file_scope(), chain);
+		return;
+	}
 
-		prev->next = conv->next;
+	memmove(&chain->convs[pos], &chain->convs[pos + 1],
+	    (chain->num_convs - pos - 1) * sizeof(conversation_t *));
+	chain->num_convs--;
 
-		if (NULL == conv->next) {
-			/* We're at the very end of the list. */
-			chain_head->last = prev;
-		}
+	if (chain->key == conv->key_ptr) {
+		/* The caller is about to change our key, so store the chain
+		 * under the key of another conversation. */
+		wmem_map_steal(hashtable, conv->key_ptr);
+		chain->key = chain->convs[0]->key_ptr;
+		wmem_map_insert(hashtable, chain->key, chain);
+	}
+}
 
-		if (chain_head->latest_found == conv)
-			chain_head->latest_found = prev;
+/*
+ * Returns the conversation hash table that conversations with these options
+ * are kept in.
+ */
+static wmem_map_t *
+conversation_hashtable_for_options(const guint options)
+{
+	if (options & NO_ADDR2) {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return conversation_hashtable_no_addr2_or_port2;
+		} else {
+			return conversation_hashtable_no_addr2;
+		}
+	} else {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return conversation_hashtable_no_port2;
+		} else {
+			return conversation_hashtable_exact;
+		}
 	}
 }
 
@@ -709,19 +754,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	}
 #endif
 
-	if (options & NO_ADDR2) {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
-		} else {
-			hashtable = conversation_hashtable_no_addr2;
-		}
-	} else {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
-		} else {
-			hashtable = conversation_hashtable_exact;
-		}
-	}
+	hashtable = conversation_hashtable_for_options(options);
 
 	new_key = wmem_new(wmem_file_scope(), struct conversation_key);
 	if (addr1 != NULL) {
@@ -765,6 +798,27 @@ conversation_t *conversation_new_by_id(const guint32 setup_frame, const endpoint
 	return conversation_new(setup_frame, NULL, NULL, etype, id, 0, options | NO_ADDR2 | NO_PORT2);
 }
 
+/*
+ * Set the setup frame of a conversation.  Remove it from its table,
+ * update the setup frame, and insert it again, so that the conversations
+ * with its key stay sorted by setup frame.
+ */
+void
+conversation_set_setup_frame(conversation_t *conv, const guint32 setup_frame)
+{
+	wmem_map_t *hashtable;
+
+	DPRINT(("called for setup_frame=%u", setup_frame));
+
+	if (conv->setup_frame == setup_frame)
+		return;
+
+	hashtable = conversation_hashtable_for_options(conv->options);
+	conversation_remove_from_hashtable(hashtable, conv);
+	conv->setup_frame = setup_frame;
+	conversation_insert_into_hashtable(hashtable, conv);
+}
+
 /*
  * Set the port 2 value in a key.  Remove the original from table,
  * update the options and port values, insert the updated key.
@@ -844,10 +898,9 @@ static conversation_t *
 conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
     const endpoint_type etype, const guint32 port1, const guint32 port2)
 {
-	conversation_t* convo=NULL;
-	conversation_t* match=NULL;
-	conversation_t* chain_head=NULL;
+	conversation_chain_t *chain;
 	struct conversation_key key;
+	guint pos;
 
 	/*
 	 * We don't make a copy of the address data, we just copy the
@@ -867,28 +920,16 @@ conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, co
 	key.port1 = port1;
 	key.port2 = port2;
 
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, &key);
-
-	if (chain_head && (chain_head->setup_frame <= frame_num)) {
-		match = chain_head;
-
-		if ((chain_head->last)&&(chain_head->last->setup_frame<=frame_num))
-			return chain_head->last;
-
-		if ((chain_head->latest_found)&&(chain_head->latest_found->setup_frame<=frame_num))
-			match = chain_head->latest_found;
-
-		for (convo = match; convo && convo->setup_frame <= frame_num; convo = convo->next) {
-			if (convo->setup_frame > match->setup_frame) {
-				match = convo;
-			}
-		}
-	}
+	chain = (conversation_chain_t *)wmem_map_lookup(hashtable, &key);
+	if (NULL == chain)
+		return NULL;
 
-	if (match)
-		chain_head->latest_found = match;
+	/* The first pass looks up the latest conversation. */
+	if (chain->convs[chain->num_convs - 1]->setup_frame <= frame_num)
+		return chain->convs[chain->num_convs - 1];
 
-	return match;
+	pos = conversation_chain_upper_bound(chain, frame_num);
+	return pos > 0 ? chain->convs[pos - 1] : NULL;
 }
 
 
@@ -1587,6 +1628,42 @@ get_conversation_hashtable_no_addr2_or_port2(void)
 	return conversation_hashtable_no_addr2_or_port2;
 }
 
+typedef struct {
+	guint *counts;
+	guint num_counts;
+	guint longest;
+} chain_lengths_t;
+
+static void
+count_chain_length(gpointer key _U_, gpointer value, gpointer user_data)
+{
+	const conversation_chain_t *chain = (const conversation_chain_t *)value;
+	chain_lengths_t *lengths = (chain_lengths_t *)user_data;
+	guint i = 0;
+
+	while (i + 1 < lengths->num_counts && (chain->num_convs >> (i + 1)) != 0)
+		i++;
+	lengths->counts[i]++;
+	if (chain->num_convs > lengths->longest)
+		lengths->longest = chain->num_convs;
+}
+
+guint
+conversation_hashtable_chain_lengths(wmem_map_t *hashtable, guint *counts, guint num_counts)
+{
+	chain_lengths_t lengths;
+
+	memset(counts, 0, num_counts * sizeof(guint));
+	if (hashtable == NULL || num_counts == 0)
+		return 0;
+
+	lengths.counts = counts;
+	lengths.num_counts = num_counts;
+	lengths.longest = 0;
+	wmem_map_foreach(hashtable, count_chain_length, &lengths);
+	return lengths.longest;
+}
+
 address*
 conversation_key_addr1(const conversation_key_t key)
 {
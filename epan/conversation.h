@@ -87,12 +87,10 @@ struct conversation_key;
 typedef struct conversation_key* conversation_key_t;
 
 typedef struct conversation {
-	struct conversation *next;	/** pointer to next conversation on hash chain */
-	struct conversation *last;	/** pointer to the last conversation on hash chain */
-	struct conversation *latest_found; /** pointer to the last conversation on hash chain */
 	guint32	conv_index;		/** unique ID for conversation */
 	guint32 setup_frame;		/** frame number that setup this conversation */
 					/* Assume that setup_frame is also the lowest frame number for now. */
+					/* Change it with conversation_set_setup_frame(). */
 	guint32 last_frame;		/** highest frame number in this conversation */
 	wmem_tree_t *data_list;		/** list of data associated with conversation */
 	wmem_tree_t *dissector_tree;	/** tree containing protocol dissector client associated with conversation */
@@ -234,6 +232,11 @@ WS_DLL_PUBLIC gboolean
 try_conversation_dissector_by_id(const endpoint_type etype, const guint32 id, tvbuff_t *tvb,
     packet_info *pinfo, proto_tree *tree, void* data);
 
+/** Change the frame that set up a conversation, keeping the conversations
+ *  with the same key sorted by it. */
+WS_DLL_PUBLIC
+void conversation_set_setup_frame(conversation_t *conv, const guint32 setup_frame);
+
 /* These routines are used to set undefined values for a conversation */
 
 WS_DLL_PUBLIC
@@ -253,6 +256,20 @@ wmem_map_t * get_conversation_hashtable_no_port2(void);
 WS_DLL_PUBLIC
 wmem_map_t *get_conversation_hashtable_no_addr2_or_port2(void);
 
+/**
+ * Counts the chains of conversations sharing a key in one of the hash
+ * tables above by length: counts[i] is the number of chains with
+ * 2^i to 2^(i+1)-1 conversations, except that counts[num_counts-1]
+ * also counts all the longer ones.
+ *
+ * @param hashtable One of the conversation hash tables.
+ * @param counts The counts, of which there are num_counts.
+ * @param num_counts The number of counts, at least 1.
+ * @return The length of the longest chain.
+ */
+WS_DLL_PUBLIC
+guint conversation_hashtable_chain_lengths(wmem_map_t *hashtable, guint *counts, guint num_counts);
+
 /* Temporary function to handle port_type to endpoint_type conversion
    For now it's a 1-1 mapping, but the intention is to remove
    many of the port_type instances in favor of endpoint_type
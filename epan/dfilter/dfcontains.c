@@ -0,0 +1,376 @@
+/* dfcontains.c
+ * Matching of all the "contains" tests on a field in one pass for the
+ * dfilter library
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <epan/exceptions.h>
+#include <epan/tvbuff.h>
+#include <wsutil/ws_mempbrk.h>
+
+#include "dfcontains.h"
+
+/* Every pattern byte adds at most one state, so this bounds the
+ * transition table to 4096 * 256 * 2 bytes. */
+#define MAX_STATES	4096
+#define NO_STATE	G_MAXUINT16
+
+typedef enum {
+	DF_CONTAINS_BYTES,
+	DF_CONTAINS_STRING,
+	DF_CONTAINS_PROTOCOL,
+	DF_CONTAINS_UNSUPPORTED
+} df_contains_class_t;
+
+struct _df_contains {
+	df_contains_class_t	contains_class;
+	GPtrArray	*patterns;	/* GByteArray */
+	guint		num_states;	/* bounded by 1 + total pattern length */
+
+	/* The automaton: delta[state * 256 + byte] is the next state, and
+	 * the patterns that end in a state are out[out_start[state]] up to
+	 * out[out_start[state + 1]]. */
+	guint16		*delta;
+	guint		*out_start;
+	guint		*out;
+
+	/* While in the start state, skip to the next byte that starts a
+	 * pattern (with SSE 4.2, if there are at most 16 of them). */
+	gboolean	use_mempbrk;
+	ws_mempbrk_pattern	mempbrk;
+};
+
+static df_contains_class_t
+contains_class(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return DF_CONTAINS_BYTES;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+			return DF_CONTAINS_STRING;
+
+		case FT_PROTOCOL:
+			return DF_CONTAINS_PROTOCOL;
+
+		default:
+			return DF_CONTAINS_UNSUPPORTED;
+	}
+}
+
+static void
+bytes_free(gpointer data)
+{
+	g_byte_array_free((GByteArray *)data, TRUE);
+}
+
+df_contains_t *
+df_contains_new(ftenum_t ftype)
+{
+	df_contains_t		*c;
+	df_contains_class_t	cls = contains_class(ftype);
+
+	if (cls == DF_CONTAINS_UNSUPPORTED)
+		return NULL;
+
+	c = g_new0(df_contains_t, 1);
+	c->contains_class = cls;
+	c->patterns = g_ptr_array_new_with_free_func(bytes_free);
+	c->num_states = 1;
+	return c;
+}
+
+void
+df_contains_free(df_contains_t *c)
+{
+	if (!c)
+		return;
+
+	g_ptr_array_free(c->patterns, TRUE);
+	g_free(c->delta);
+	g_free(c->out_start);
+	g_free(c->out);
+	g_free(c);
+}
+
+gboolean
+df_contains_accepts(const df_contains_t *c, ftenum_t ftype)
+{
+	return contains_class(ftype) == c->contains_class;
+}
+
+/* Returns the bytes of a protocol's tvbuff, or NULL if it has none. */
+static const guint8 *
+protocol_data(const fvalue_t *fv, guint *len)
+{
+	tvbuff_t	*tvb = fv->value.protocol.tvb;
+	const guint8	* volatile data = NULL;
+
+	*len = 0;
+	if (tvb == NULL)
+		return NULL;
+
+	TRY {
+		*len = tvb_captured_length(tvb);
+		if (*len > 0)
+			data = tvb_get_ptr(tvb, 0, -1);
+	}
+	CATCH_ALL {
+		data = NULL;
+	}
+	ENDTRY;
+
+	return data;
+}
+
+int
+df_contains_add(df_contains_t *c, const fvalue_t *fv)
+{
+	const guint8	*data;
+	guint		len;
+	GByteArray	*pattern;
+	guint		i;
+
+	g_return_val_if_fail(c->delta == NULL, -1);
+
+	if (!df_contains_accepts(c, fvalue_type_ftenum((fvalue_t *)fv)))
+		return -1;
+
+	switch (c->contains_class) {
+		case DF_CONTAINS_BYTES:
+			data = fv->value.bytes->data;
+			len = fv->value.bytes->len;
+			break;
+		case DF_CONTAINS_STRING:
+			data = (const guint8 *)fv->value.string;
+			len = (guint)strlen(fv->value.string);
+			break;
+		case DF_CONTAINS_PROTOCOL:
+			data = protocol_data(fv, &len);
+			break;
+		default:
+			g_assert_not_reached();
+			return -1;
+	}
+
+	/* Nothing contains an empty pattern. */
+	if (data == NULL || len == 0)
+		return -1;
+
+	for (i = 0; i < c->patterns->len; i++) {
+		pattern = (GByteArray *)g_ptr_array_index(c->patterns, i);
+		if (pattern->len == len && memcmp(pattern->data, data, len) == 0)
+			return i;
+	}
+
+	if (c->num_states + len > MAX_STATES)
+		return -1;
+
+	pattern = g_byte_array_sized_new(len);
+	g_byte_array_append(pattern, data, len);
+	g_ptr_array_add(c->patterns, pattern);
+	c->num_states += len;
+	return c->patterns->len - 1;
+}
+
+void
+df_contains_finish(df_contains_t *c)
+{
+	GByteArray	*pattern;
+	GSList		**outputs;
+	GSList		*l;
+	guint		*fail;
+	guint		*queue;
+	guint		head = 0, tail = 0;
+	guint		num_states = 1;
+	guint		num_out = 0;
+	guint		s, t, i, j;
+	guint		b;
+	gchar		needles[17];
+	guint		num_needles = 0;
+
+	g_return_if_fail(c->delta == NULL);
+
+	/* The trie of the patterns. */
+	c->delta = g_new(guint16, c->num_states * 256);
+	for (i = 0; i < c->num_states * 256; i++)
+		c->delta[i] = NO_STATE;
+	outputs = g_new0(GSList *, c->num_states);
+
+	for (i = 0; i < c->patterns->len; i++) {
+		pattern = (GByteArray *)g_ptr_array_index(c->patterns, i);
+		s = 0;
+		for (j = 0; j < pattern->len; j++) {
+			t = c->delta[s * 256 + pattern->data[j]];
+			if (t == NO_STATE) {
+				t = num_states++;
+				c->delta[s * 256 + pattern->data[j]] = (guint16)t;
+			}
+			s = t;
+		}
+		outputs[s] = g_slist_prepend(outputs[s], GUINT_TO_POINTER(i));
+	}
+
+	/* Turn it into an automaton, breadth first so that the state a
+	 * state falls back to is always complete. */
+	fail = g_new0(guint, num_states);
+	queue = g_new(guint, num_states);
+	for (b = 0; b < 256; b++) {
+		t = c->delta[b];
+		if (t == NO_STATE) {
+			c->delta[b] = 0;
+		} else {
+			fail[t] = 0;
+			queue[tail++] = t;
+		}
+	}
+	while (head < tail) {
+		s = queue[head++];
+		for (b = 0; b < 256; b++) {
+			t = c->delta[s * 256 + b];
+			if (t == NO_STATE) {
+				c->delta[s * 256 + b] = c->delta[fail[s] * 256 + b];
+			} else {
+				fail[t] = c->delta[fail[s] * 256 + b];
+				for (l = outputs[fail[t]]; l != NULL; l = g_slist_next(l))
+					outputs[t] = g_slist_prepend(outputs[t], l->data);
+				queue[tail++] = t;
+			}
+		}
+	}
+
+	/* Keep only the states used, and flatten the output lists. */
+	c->num_states = num_states;
+	c->delta = g_renew(guint16, c->delta, num_states * 256);
+	c->out_start = g_new(guint, num_states + 1);
+	for (s = 0; s < num_states; s++)
+		num_out += g_slist_length(outputs[s]);
+	c->out = g_new(guint, MAX(num_out, 1));
+	num_out = 0;
+	for (s = 0; s < num_states; s++) {
+		c->out_start[s] = num_out;
+		for (l = outputs[s]; l != NULL; l = g_slist_next(l))
+			c->out[num_out++] = GPOINTER_TO_UINT(l->data);
+		g_slist_free(outputs[s]);
+	}
+	c->out_start[num_states] = num_out;
+
+	/* ws_mempbrk_compile() takes a NUL-terminated string of needles,
+	 * so it can only be used if no pattern starts with a NUL. */
+	c->use_mempbrk = (c->delta[0] == 0);
+	for (b = 1; b < 256 && c->use_mempbrk; b++) {
+		if (c->delta[b] != 0) {
+			if (num_needles == 16)
+				c->use_mempbrk = FALSE;
+			else
+				needles[num_needles++] = (gchar)b;
+		}
+	}
+	if (c->use_mempbrk) {
+		needles[num_needles] = '\0';
+		memset(&c->mempbrk, 0, sizeof c->mempbrk);
+		ws_mempbrk_compile(&c->mempbrk, needles);
+	}
+
+	g_free(outputs);
+	g_free(fail);
+	g_free(queue);
+}
+
+guint
+df_contains_count(const df_contains_t *c)
+{
+	return c->patterns->len;
+}
+
+static guint
+scan(const df_contains_t *c, const guint8 *p, guint len,
+		gboolean *found, guint remaining)
+{
+	const guint8	*end = p + len;
+	guint		s = 0;
+	guint		i;
+
+	while (p < end) {
+		if (s == 0 && c->use_mempbrk) {
+			p = ws_mempbrk_exec(p, end - p, &c->mempbrk, NULL);
+			if (p == NULL)
+				break;
+		}
+		s = c->delta[s * 256 + *p++];
+		for (i = c->out_start[s]; i < c->out_start[s + 1]; i++) {
+			if (!found[c->out[i]]) {
+				found[c->out[i]] = TRUE;
+				if (--remaining == 0)
+					return 0;
+			}
+		}
+	}
+	return remaining;
+}
+
+guint
+df_contains_scan(const df_contains_t *c, const fvalue_t *fv,
+		gboolean *found, guint remaining)
+{
+	const guint8	*data;
+	guint		len;
+
+	g_assert(c->delta != NULL);
+
+	switch (c->contains_class) {
+		case DF_CONTAINS_BYTES:
+			data = fv->value.bytes->data;
+			len = fv->value.bytes->len;
+			break;
+		case DF_CONTAINS_STRING:
+			data = (const guint8 *)fv->value.string;
+			len = (guint)strlen(fv->value.string);
+			break;
+		case DF_CONTAINS_PROTOCOL:
+			/* A protocol without a tvbuff contains nothing. */
+			data = protocol_data(fv, &len);
+			break;
+		default:
+			g_assert_not_reached();
+			return remaining;
+	}
+
+	if (data == NULL)
+		return remaining;
+	return scan(c, data, len, found, remaining);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,75 @@
+/* dfcontains.h
+ * Matching of all the "contains" tests on a field in one pass for the
+ * dfilter library
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFCONTAINS_H
+#define DFCONTAINS_H
+
+#include <glib.h>
+#include <epan/ftypes/ftypes.h>
+
+/*
+ * The constants of the "contains" tests on one field, compiled into an
+ * Aho-Corasick automaton, so that each value of the field is scanned
+ * once to answer all the tests rather than once per test.  Supported
+ * for byte strings, character strings and protocols; a pattern is
+ * found in a value exactly when the type's "contains" is TRUE.
+ */
+typedef struct _df_contains df_contains_t;
+
+/* Returns a new matcher for values of type ftype, or NULL if the
+ * "contains" of that type isn't supported. */
+df_contains_t *
+df_contains_new(ftenum_t ftype);
+
+void
+df_contains_free(df_contains_t *c);
+
+/* Returns TRUE if values of type ftype can be scanned by the matcher. */
+gboolean
+df_contains_accepts(const df_contains_t *c, ftenum_t ftype);
+
+/* Adds the bytes of the constant as a pattern, and returns its index,
+ * or -1 if it can't be added (it is empty, of another type, or the
+ * matcher would get too large).  Adding a pattern twice returns the
+ * same index. */
+int
+df_contains_add(df_contains_t *c, const fvalue_t *fv);
+
+/* Builds the automaton; must be called after the last pattern is
+ * added. */
+void
+df_contains_finish(df_contains_t *c);
+
+/* Returns the number of different patterns. */
+guint
+df_contains_count(const df_contains_t *c);
+
+/* Scans the value and sets found[i] to TRUE for each pattern i that
+ * occurs in it.  remaining is the number of patterns not found yet;
+ * returns the number still not found, stopping the scan at 0. */
+guint
+df_contains_scan(const df_contains_t *c, const fvalue_t *fv,
+		gboolean *found, guint remaining);
+
+#endif /* DFCONTAINS_H */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -10,6 +10,7 @@
 #define DFILTER_INT_H
 
 #include "dfilter.h"
+#include "dfprefilter.h"
 #include "syntax-tree.h"
 
 #include <epan/proto.h>
@@ -27,6 +28,10 @@ struct epan_dfilter {
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+	df_prefilter_t	*prefilter;
+	GPtrArray	*matchers;	/* df_contains_t, for ANY_CONTAINS_MULTI */
+	gboolean	*matcher_scanned;
+	gboolean	**pattern_found;
 };
 
 typedef struct {
@@ -42,6 +47,10 @@ typedef struct {
 	int		next_const_id;
 	int		next_register;
 	int		first_constant; /* first register used as a constant */
+	gboolean	specialize;	/* use type-specialized instructions */
+	GHashTable	*contains_tests; /* field -> number of "contains" tests */
+	GHashTable	*contains_matchers; /* field -> index in matchers + 1 */
+	GPtrArray	*matchers;
 } dfwork_t;
 
 /*
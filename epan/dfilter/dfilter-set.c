@@ -0,0 +1,515 @@
+/* dfilter-set.c
+ * Evaluation of many display filters against the same packets
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfilter-int.h"
+#include "dfvm.h"
+#include <epan/epan_dissect.h>
+
+/*
+ * The filters of a set are compiled separately, then linked into one
+ * register file: every field is read from the tree into a single
+ * register shared by all the filters that use it, equal constants share
+ * a register, and comparisons with the same operands (a field and a
+ * constant) share a result slot, so that each is done at most once per
+ * packet no matter how many filters contain it.
+ *
+ * Linking happens when the set is first used; no filters can be added
+ * after that.
+ */
+struct epan_dfilter_set {
+	GPtrArray	*filters;	/* dfilter_t, or NULL for an empty filter */
+	gboolean	linked;
+
+	guint		num_registers;	/* registers other than constants */
+	guint		max_registers;
+	GList		**registers;
+	gboolean	*attempted_load;
+	gboolean	*owns_memory;
+
+	int		**result_slots;	/* per filter, per instruction */
+	guint		num_results;
+	gint8		*results;
+
+	guint32		*evaluated;	/* bitmaps, one bit per filter */
+	guint32		*matched;
+	gboolean	dirty;		/* registers or results in use */
+};
+
+#define BITMAP_WORDS(n)		(((n) + 31) / 32)
+#define BITMAP_TEST(b, i)	(((b)[(i) / 32] >> ((i) % 32)) & 1)
+#define BITMAP_SET(b, i)	((b)[(i) / 32] |= (1U << ((i) % 32)))
+
+dfilter_set_t *
+dfilter_set_new(void)
+{
+	dfilter_set_t	*set;
+
+	set = g_new0(dfilter_set_t, 1);
+	set->filters = g_ptr_array_new();
+	return set;
+}
+
+int
+dfilter_set_add(dfilter_set_t *set, const gchar *text, gchar **err_msg)
+{
+	dfilter_t	*df;
+
+	g_return_val_if_fail(!set->linked, -1);
+
+	if (!dfilter_compile(text, &df, err_msg))
+		return -1;
+
+	g_ptr_array_add(set->filters, df);
+	return set->filters->len - 1;
+}
+
+guint
+dfilter_set_count(const dfilter_set_t *set)
+{
+	return set->filters->len;
+}
+
+void
+dfilter_set_free(dfilter_set_t *set)
+{
+	dfilter_t	*df;
+	guint		i;
+
+	if (!set)
+		return;
+
+	if (set->linked) {
+		if (set->dirty)
+			dfilter_set_reset(set);
+		/* The constant registers only point at fvalues owned by the
+		 * instructions of the filters. */
+		for (i = set->num_registers; i < set->max_registers; i++)
+			g_list_free(set->registers[i]);
+	}
+
+	for (i = 0; i < set->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, i);
+		if (df && set->linked) {
+			/* The register file belongs to the set. */
+			df->registers = NULL;
+			df->attempted_load = NULL;
+			df->owns_memory = NULL;
+			df->num_registers = df->max_registers = 0;
+		}
+		dfilter_free(df);
+		if (set->result_slots)
+			g_free(set->result_slots[i]);
+	}
+	g_ptr_array_free(set->filters, TRUE);
+
+	g_free(set->result_slots);
+	g_free(set->results);
+	g_free(set->registers);
+	g_free(set->attempted_load);
+	g_free(set->owns_memory);
+	g_free(set->evaluated);
+	g_free(set->matched);
+	g_free(set);
+}
+
+/* Returns a key identifying the value of a constant, or NULL if constants
+ * of its type aren't shared. */
+static gchar *
+const_key(fvalue_t *fv)
+{
+	ftenum_t	ftype = fvalue_type_ftenum(fv);
+	GString		*key;
+	guint		i;
+
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			return g_strdup_printf("%d:%u", ftype, fv->value.uinteger);
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_EUI64:
+			return g_strdup_printf("%d:%" G_GUINT64_FORMAT, ftype,
+					fv->value.uinteger64);
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return g_strdup_printf("%d:%d", ftype, fv->value.sinteger);
+
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			return g_strdup_printf("%d:%" G_GINT64_FORMAT, ftype,
+					fv->value.sinteger64);
+
+		case FT_IPv4:
+			return g_strdup_printf("%d:%08x/%08x", ftype,
+					fv->value.ipv4.addr, fv->value.ipv4.nmask);
+
+		case FT_IPv6:
+			key = g_string_new(NULL);
+			g_string_printf(key, "%d:", ftype);
+			for (i = 0; i < sizeof fv->value.ipv6.addr.bytes; i++)
+				g_string_append_printf(key, "%02x", fv->value.ipv6.addr.bytes[i]);
+			g_string_append_printf(key, "/%u", fv->value.ipv6.prefix);
+			return g_string_free(key, FALSE);
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			key = g_string_new(NULL);
+			g_string_printf(key, "%d:", ftype);
+			for (i = 0; i < fv->value.bytes->len; i++)
+				g_string_append_printf(key, "%02x", fv->value.bytes->data[i]);
+			return g_string_free(key, FALSE);
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+			return g_strdup_printf("%d:%s", ftype, fv->value.string);
+
+		default:
+			return NULL;
+	}
+}
+
+/* Can this instruction's result be shared with an instruction doing
+ * the same test on the same registers? */
+static gboolean
+shareable_test(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:
+		case ANY_NE:
+		case ANY_GT:
+		case ANY_GE:
+		case ANY_LT:
+		case ANY_LE:
+		case ANY_BITWISE_AND:
+		case ANY_CONTAINS:
+		case ANY_MATCHES:
+		case ANY_IN_RANGE:
+		case ANY_CMP_UINT:
+		case ANY_CMP_UINT64:
+		case ANY_CMP_SINT:
+		case ANY_CMP_SINT64:
+		case ANY_CMP_IPV4:
+		case ANY_CMP_BYTES:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static void
+remap_register(dfvm_value_t *v, const int *map)
+{
+	if (v && v->type == REGISTER)
+		v->value.numeric = map[v->value.numeric];
+}
+
+/* Returns the value of an argument of a test for use in the key that
+ * identifies the test: the register number if it holds a field or a
+ * constant, the value of an INTEGER, -1 if there is no argument, and
+ * -2 if the test can't be shared. */
+static int
+shared_operand(const dfvm_value_t *v, const gboolean *shared)
+{
+	if (!v)
+		return -1;
+	if (v->type == INTEGER)
+		return (int)v->value.numeric;
+	if (v->type != REGISTER || !shared[v->value.numeric])
+		return -2;
+	return (int)v->value.numeric;
+}
+
+static void
+dfilter_set_link(dfilter_set_t *set)
+{
+	GHashTable	*field_regs, *const_regs, *tests;
+	int		**maps;
+	gboolean	*shared;
+	guint		next_register = 0;
+	guint		f, i;
+	dfilter_t	*df;
+	dfvm_insn_t	*insn;
+	gpointer	value;
+	gchar		*key;
+	int		reg, arg1, arg2, arg3;
+
+	maps = g_new0(int *, set->filters->len);
+	field_regs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	const_regs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	/* Fields first, one register per field; then each filter's other
+	 * non-constant registers. */
+	for (f = 0; f < set->filters->len; f++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, f);
+		if (!df)
+			continue;
+		maps[f] = g_new(int, df->max_registers);
+		for (i = 0; i < df->max_registers; i++)
+			maps[f][i] = -1;
+		for (i = 0; i < df->insns->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+			if (insn->op != READ_TREE)
+				continue;
+			if (g_hash_table_lookup_extended(field_regs,
+					insn->arg1->value.hfinfo, NULL, &value)) {
+				reg = GPOINTER_TO_INT(value);
+			} else {
+				reg = next_register++;
+				g_hash_table_insert(field_regs,
+						insn->arg1->value.hfinfo, GINT_TO_POINTER(reg));
+			}
+			maps[f][insn->arg2->value.numeric] = reg;
+		}
+	}
+	for (f = 0; f < set->filters->len; f++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, f);
+		if (!df)
+			continue;
+		for (i = 0; i < df->num_registers; i++) {
+			if (maps[f][i] == -1)
+				maps[f][i] = next_register++;
+		}
+	}
+	set->num_registers = next_register;
+
+	/* Then the constants, after all the others, as in a dfilter_t. */
+	for (f = 0; f < set->filters->len; f++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, f);
+		if (!df)
+			continue;
+		for (i = 0; i < df->consts->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, i);
+			key = const_key(insn->arg1->value.fvalue);
+			if (key && g_hash_table_lookup_extended(const_regs, key, NULL, &value)) {
+				reg = GPOINTER_TO_INT(value);
+				g_free(key);
+			} else {
+				reg = next_register++;
+				if (key)
+					g_hash_table_insert(const_regs, key, GINT_TO_POINTER(reg));
+			}
+			maps[f][insn->arg2->value.numeric] = reg;
+		}
+	}
+	set->max_registers = next_register;
+
+	set->registers = g_new0(GList *, set->max_registers);
+	set->attempted_load = g_new0(gboolean, set->max_registers);
+	set->owns_memory = g_new0(gboolean, set->max_registers);
+
+	/* Registers that hold the same thing for every filter. */
+	shared = g_new0(gboolean, set->max_registers);
+	for (i = 0; i < set->max_registers; i++)
+		shared[i] = (i < g_hash_table_size(field_regs) || i >= set->num_registers);
+
+	/* Renumber the registers of each filter, and point it at the
+	 * shared register file. */
+	for (f = 0; f < set->filters->len; f++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, f);
+		if (!df)
+			continue;
+		for (i = 0; i < df->insns->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+			remap_register(insn->arg1, maps[f]);
+			remap_register(insn->arg2, maps[f]);
+			remap_register(insn->arg3, maps[f]);
+			remap_register(insn->arg4, maps[f]);
+		}
+		for (i = 0; i < df->consts->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, i);
+			remap_register(insn->arg2, maps[f]);
+			reg = insn->arg2->value.numeric;
+			if (set->registers[reg] == NULL)
+				set->registers[reg] = g_list_append(NULL, insn->arg1->value.fvalue);
+		}
+
+		/* Drop the filter's own register file; the constant
+		 * registers only point at the fvalues of its instructions. */
+		for (i = df->num_registers; i < df->max_registers; i++)
+			g_list_free(df->registers[i]);
+		g_free(df->registers);
+		g_free(df->attempted_load);
+		g_free(df->owns_memory);
+		df->registers = set->registers;
+		df->attempted_load = set->attempted_load;
+		df->owns_memory = set->owns_memory;
+		df->num_registers = set->num_registers;
+		df->max_registers = set->max_registers;
+	}
+
+	/* Give identical tests on shared registers the same result slot. */
+	tests = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	set->result_slots = g_new0(int *, set->filters->len);
+	for (f = 0; f < set->filters->len; f++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, f);
+		if (!df)
+			continue;
+		set->result_slots[f] = g_new(int, df->insns->len);
+		for (i = 0; i < df->insns->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+			set->result_slots[f][i] = -1;
+			if (!shareable_test(insn->op))
+				continue;
+			arg1 = shared_operand(insn->arg1, shared);
+			arg2 = shared_operand(insn->arg2, shared);
+			arg3 = shared_operand(insn->arg3, shared);
+			if (arg1 == -2 || arg2 == -2 || arg3 == -2)
+				continue;
+			key = g_strdup_printf("%d:%d:%d:%d", insn->op, arg1, arg2, arg3);
+			if (g_hash_table_lookup_extended(tests, key, NULL, &value)) {
+				set->result_slots[f][i] = GPOINTER_TO_INT(value);
+				g_free(key);
+			} else {
+				set->result_slots[f][i] = set->num_results++;
+				g_hash_table_insert(tests, key,
+						GINT_TO_POINTER(set->result_slots[f][i]));
+			}
+		}
+		g_free(maps[f]);
+	}
+	set->results = g_new(gint8, set->num_results);
+	memset(set->results, -1, set->num_results);
+
+	set->evaluated = g_new0(guint32, BITMAP_WORDS(set->filters->len));
+	set->matched = g_new0(guint32, BITMAP_WORDS(set->filters->len));
+
+	g_hash_table_destroy(tests);
+	g_hash_table_destroy(const_regs);
+	g_hash_table_destroy(field_regs);
+	g_free(shared);
+	g_free(maps);
+	set->linked = TRUE;
+}
+
+void
+dfilter_set_prime_proto_tree(dfilter_set_t *set, proto_tree *tree)
+{
+	dfilter_t	*df;
+	guint		i;
+
+	for (i = 0; i < set->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, i);
+		if (df)
+			dfilter_prime_proto_tree(df, tree);
+	}
+}
+
+gboolean
+dfilter_set_match_edt(dfilter_set_t *set, guint idx, epan_dissect_t *edt)
+{
+	dfilter_t	*df;
+
+	g_assert(idx < set->filters->len);
+
+	if (!set->linked)
+		dfilter_set_link(set);
+
+	if (BITMAP_TEST(set->evaluated, idx))
+		return BITMAP_TEST(set->matched, idx);
+
+	df = (dfilter_t *)g_ptr_array_index(set->filters, idx);
+	set->dirty = TRUE;
+	BITMAP_SET(set->evaluated, idx);
+	if (df == NULL || dfvm_apply_shared(df, edt->tree,
+			set->result_slots[idx], set->results)) {
+		BITMAP_SET(set->matched, idx);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* Frees the field values loaded from the tree, and forgets the results
+ * of the tests done on them. */
+static void
+free_shared_registers(dfilter_set_t *set)
+{
+	dfilter_t	*df;
+	guint		i;
+
+	/* Any filter will do, as they all use the same registers. */
+	for (i = 0; i < set->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, i);
+		if (df) {
+			dfvm_free_registers(df);
+			break;
+		}
+	}
+	memset(set->results, -1, set->num_results);
+}
+
+void
+dfilter_set_reset(dfilter_set_t *set)
+{
+	if (!set->dirty)
+		return;
+
+	free_shared_registers(set);
+	memset(set->evaluated, 0, BITMAP_WORDS(set->filters->len) * sizeof(guint32));
+	memset(set->matched, 0, BITMAP_WORDS(set->filters->len) * sizeof(guint32));
+	set->dirty = FALSE;
+}
+
+const guint32 *
+dfilter_set_apply_edt(dfilter_set_t *set, epan_dissect_t *edt)
+{
+	guint	i;
+
+	if (!set->linked)
+		dfilter_set_link(set);
+
+	dfilter_set_reset(set);
+	for (i = 0; i < set->filters->len; i++)
+		dfilter_set_match_edt(set, i, edt);
+
+	/* Every filter has been evaluated, so keep the bitmap until the
+	 * next reset, but let go of the tree now. */
+	free_shared_registers(set);
+	return set->matched;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
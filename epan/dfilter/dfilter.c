@@ -132,6 +132,15 @@ dfilter_free(dfilter_t *df)
 	}
 
 	g_free(df->interesting_fields);
+	df_prefilter_free(df->prefilter);
+
+	if (df->matchers) {
+		for (i = 0; i < df->matchers->len; i++)
+			g_free(df->pattern_found[i]);
+		g_free(df->pattern_found);
+		g_free(df->matcher_scanned);
+		g_ptr_array_free(df->matchers, TRUE);
+	}
 
 	/* Clear registers with constant values (as set by dfvm_init_const).
 	 * Other registers were cleared on RETURN by free_register_overhead. */
@@ -188,6 +197,18 @@ dfwork_free(dfwork_t *dfw)
 		free_insns(dfw->consts);
 	}
 
+	if (dfw->contains_tests) {
+		g_hash_table_destroy(dfw->contains_tests);
+	}
+
+	if (dfw->contains_matchers) {
+		g_hash_table_destroy(dfw->contains_matchers);
+	}
+
+	if (dfw->matchers) {
+		g_ptr_array_free(dfw->matchers, TRUE);
+	}
+
 	/*
 	 * We don't free the error message string; our caller will return
 	 * it to its caller.
@@ -195,8 +216,9 @@ dfwork_free(dfwork_t *dfw)
 	g_free(dfw);
 }
 
-gboolean
-dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+static gboolean
+dfilter_compile_real(const gchar *text, dfilter_t **dfp, gchar **err_msg,
+		gboolean specialize)
 {
 	gchar		*expanded_text;
 	int		token;
@@ -210,6 +232,7 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	guint		i;
 	/* XXX, GHashTable */
 	GPtrArray	*deprecated;
+	df_prefilter_t	*prefilter = NULL;
 
 	g_assert(dfp);
 
@@ -237,6 +260,7 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	in_buffer = df__scan_string(expanded_text, scanner);
 
 	dfw = dfwork_new();
+	dfw->specialize = specialize;
 
 	state.dfw = dfw;
 	state.quoted_string = NULL;
@@ -334,6 +358,11 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 			goto FAILURE;
 		}
 
+		/* Find what can be checked before dissection; this has
+		 * to be done while the tree still has the constants. */
+		if (specialize)
+			prefilter = df_prefilter_new(dfw->st_root);
+
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
@@ -353,12 +382,25 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
 		dfilter->owns_memory = g_new0(gboolean, dfilter->max_registers);
 
+		if (dfw->matchers && dfw->matchers->len > 0) {
+			dfilter->matchers = dfw->matchers;
+			dfw->matchers = NULL;
+			dfilter->matcher_scanned = g_new0(gboolean, dfilter->matchers->len);
+			dfilter->pattern_found = g_new(gboolean *, dfilter->matchers->len);
+			for (i = 0; i < dfilter->matchers->len; i++) {
+				dfilter->pattern_found[i] = g_new0(gboolean,
+					df_contains_count((df_contains_t *)g_ptr_array_index(dfilter->matchers, i)));
+			}
+		}
+
 		/* Initialize constants */
 		dfvm_init_const(dfilter);
 
 		/* Add any deprecated items */
 		dfilter->deprecated = deprecated;
 
+		dfilter->prefilter = prefilter;
+
 		/* And give it to the user. */
 		*dfp = dfilter;
 	}
@@ -397,6 +439,18 @@ FAILURE:
 	return FALSE;
 }
 
+gboolean
+dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+{
+	return dfilter_compile_real(text, dfp, err_msg, TRUE);
+}
+
+gboolean
+dfilter_compile_generic(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+{
+	return dfilter_compile_real(text, dfp, err_msg, FALSE);
+}
+
 
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
@@ -427,6 +481,100 @@ dfilter_has_interesting_fields(const dfilter_t *df)
 	return (df->num_interesting_fields > 0);
 }
 
+gboolean
+dfilter_interested_in_field(const dfilter_t *df, int hfid)
+{
+	int i;
+
+	for (i = 0; i < df->num_interesting_fields; i++) {
+		if (df->interesting_fields[i] == hfid) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Returns TRUE if the display filter "new_text" is "old_text" and'ed
+ * with something else, i.e. "old_text && ...", "(old_text) and ...",
+ * and so on, so that it can only pass frames that "old_text" passes.
+ * "and" has the lowest precedence in the grammar, so that holds
+ * whatever "old_text" is.
+ */
+gboolean
+dfilter_text_narrows(const char *old_text, const char *new_text)
+{
+	const char *old_end;
+	const char *p = new_text;
+	gboolean parenthesized = FALSE;
+
+	while (g_ascii_isspace(*old_text))
+		old_text++;
+	old_end = old_text + strlen(old_text);
+	while (old_end > old_text && g_ascii_isspace(old_end[-1]))
+		old_end--;
+	if (old_end == old_text)
+		return FALSE;
+
+	while (g_ascii_isspace(*p))
+		p++;
+	if (*p == '(' && strncmp(p, old_text, old_end - old_text) != 0) {
+		parenthesized = TRUE;
+		p++;
+		while (g_ascii_isspace(*p))
+			p++;
+	}
+	if (strncmp(p, old_text, old_end - old_text) != 0)
+		return FALSE;
+	p += old_end - old_text;
+
+	if (parenthesized) {
+		while (g_ascii_isspace(*p))
+			p++;
+		if (*p != ')')
+			return FALSE;
+		p++;
+	}
+
+	if (g_ascii_isspace(*p)) {
+		while (g_ascii_isspace(*p))
+			p++;
+		if (g_ascii_strncasecmp(p, "and", 3) == 0 &&
+				(g_ascii_isspace(p[3]) || p[3] == '('))
+			p += 3;
+		else if (strncmp(p, "&&", 2) == 0)
+			p += 2;
+		else
+			return FALSE;
+	} else if (strncmp(p, "&&", 2) == 0) {
+		p += 2;
+	} else if (parenthesized && g_ascii_strncasecmp(p, "and", 3) == 0 &&
+			(g_ascii_isspace(p[3]) || p[3] == '(')) {
+		p += 3;
+	} else {
+		return FALSE;
+	}
+
+	while (g_ascii_isspace(*p))
+		p++;
+	return *p != '\0';
+}
+
+gboolean
+dfilter_has_prefilter(const dfilter_t *df)
+{
+	return (df->prefilter != NULL);
+}
+
+gboolean
+dfilter_may_match_packet(const dfilter_t *df, int encap,
+		const guint8 *data, guint32 len)
+{
+	if (df->prefilter == NULL)
+		return TRUE;
+	return df_prefilter_may_match(df->prefilter, encap, data, len);
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -443,6 +591,13 @@ dfilter_dump(dfilter_t *df)
 
 	dfvm_dump(stdout, df);
 
+	if (df->prefilter) {
+		ws_debug_printf("\nPrefilter (packets are dissected only if this may match):\n");
+		df_prefilter_dump(stdout, df->prefilter);
+	} else {
+		ws_debug_printf("\nNo prefilter\n");
+	}
+
 	if (df->deprecated && df->deprecated->len) {
 		ws_debug_printf("\nDeprecated tokens: ");
 		for (i = 0; i < df->deprecated->len; i++) {
@@ -49,6 +49,16 @@ WS_DLL_PUBLIC
 gboolean
 dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg);
 
+/* Compiles a string to a dfilter_t like dfilter_compile(), but
+ * without replacing comparisons of fields with constants by the
+ * type-specialized DFVM instructions, so that every comparison goes
+ * through the field type's comparison functions.  Filters compiled
+ * either way match the same packets; this exists for testing and
+ * benchmarking the specialized instructions. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_compile_generic(const gchar *text, dfilter_t **dfp, gchar **err_msg);
+
 /* Frees all memory used by dfilter, and frees
  * the dfilter itself. */
 WS_DLL_PUBLIC
@@ -72,6 +82,34 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 gboolean
 dfilter_has_interesting_fields(const dfilter_t *df);
 
+/* Check if dfilter reads a given field or protocol */
+WS_DLL_PUBLIC
+gboolean
+dfilter_interested_in_field(const dfilter_t *df, int hfid);
+
+/* Check if the filter text "new_text" is "old_text" and'ed with
+ * something else, so that it can only match packets "old_text" matches */
+WS_DLL_PUBLIC
+gboolean
+dfilter_text_narrows(const char *old_text, const char *new_text);
+
+/* Check if dfilter has a prefilter, i.e. tests that can tell from the
+ * raw bytes of a packet that it can't match */
+WS_DLL_PUBLIC
+gboolean
+dfilter_has_prefilter(const dfilter_t *df);
+
+/* Returns FALSE if a packet with the given wiretap encapsulation and
+ * bytes can't match the dfilter, so that it needn't be dissected;
+ * TRUE if it has to be dissected to tell.  Only reliable for packets
+ * that have been dissected before without any fields being read from
+ * data other than their own (see frame_data's other_data_src), as
+ * reassembled or decrypted data isn't in the bytes. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_may_match_packet(const dfilter_t *df, int encap,
+		const guint8 *data, guint32 len);
+
 WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
@@ -81,6 +119,60 @@ WS_DLL_PUBLIC
 void
 dfilter_dump(dfilter_t *df);
 
+/* A set of display filters that are applied to the same packets, such
+ * as the coloring rules or the filters of the tap listeners.  The
+ * filters share the fields they read from the tree and the results of
+ * the comparisons they have in common, so applying all of them costs
+ * less than applying each one separately. */
+typedef struct epan_dfilter_set dfilter_set_t;
+
+WS_DLL_PUBLIC
+dfilter_set_t *
+dfilter_set_new(void);
+
+/* Frees the set and all of its filters. */
+WS_DLL_PUBLIC
+void
+dfilter_set_free(dfilter_set_t *set);
+
+/* Compiles a filter and adds it to the set.  Returns its index in the
+ * set, or -1 on failure, with *err_msg set as by dfilter_compile().
+ * An empty filter matches every packet.  Filters can't be added once
+ * the set has been applied. */
+WS_DLL_PUBLIC
+int
+dfilter_set_add(dfilter_set_t *set, const gchar *text, gchar **err_msg);
+
+WS_DLL_PUBLIC
+guint
+dfilter_set_count(const dfilter_set_t *set);
+
+/* Applies every filter of the set.  Returns a bitmap with bit (i % 32)
+ * of word (i / 32) set if filter i matched; it stays valid until the
+ * set is next applied or reset. */
+WS_DLL_PUBLIC
+const guint32 *
+dfilter_set_apply_edt(dfilter_set_t *set, struct epan_dissect *edt);
+
+/* Applies filter idx of the set, unless it has already been applied
+ * since the last dfilter_set_reset(), in which case the earlier result
+ * is returned.  Lets callers that stop at the first match, or only
+ * need some of the filters, share work between the filters they do
+ * apply. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_set_match_edt(dfilter_set_t *set, guint idx, struct epan_dissect *edt);
+
+/* Forgets the results of dfilter_set_match_edt(); must be called
+ * before applying the set to another packet, or freeing the tree. */
+WS_DLL_PUBLIC
+void
+dfilter_set_reset(dfilter_set_t *set);
+
+/* Prime a proto_tree using the fields/protocols used in a dfilter set. */
+void
+dfilter_set_prime_proto_tree(dfilter_set_t *set, proto_tree *tree);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
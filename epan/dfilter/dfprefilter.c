@@ -0,0 +1,551 @@
+/* dfprefilter.c
+ * Tests on the raw bytes of a packet that reject packets a display
+ * filter can't match, without dissecting them
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <epan/proto.h>
+#include <epan/strutil.h>
+#include <wiretap/wtap.h>
+#include <wsutil/pint.h>
+
+#include "dfprefilter.h"
+#include "sttype-test.h"
+
+typedef enum {
+	PF_LAYER_ETH,
+	PF_LAYER_IPV4,
+	PF_LAYER_IPV6,
+	PF_LAYER_TCP,
+	PF_LAYER_UDP,
+	PF_NUM_LAYERS
+} pf_layer_t;
+
+/* A field found at fixed offsets in the header of its layer. */
+typedef struct {
+	const char	*abbrev;
+	ftenum_t	ftype;
+	pf_layer_t	layer;
+	guint32		len;		/* of its values */
+	int		offsets[2];	/* in the header; -1 if unused */
+} pf_field_t;
+
+static const pf_field_t pf_fields[] = {
+	{ "eth.addr",    FT_ETHER,   PF_LAYER_ETH,   6, {  0,  6 } },
+	{ "eth.dst",     FT_ETHER,   PF_LAYER_ETH,   6, {  0, -1 } },
+	{ "eth.src",     FT_ETHER,   PF_LAYER_ETH,   6, {  6, -1 } },
+	{ "ip.addr",     FT_IPv4,    PF_LAYER_IPV4,  4, { 12, 16 } },
+	{ "ip.src",      FT_IPv4,    PF_LAYER_IPV4,  4, { 12, -1 } },
+	{ "ip.dst",      FT_IPv4,    PF_LAYER_IPV4,  4, { 16, -1 } },
+	{ "ipv6.addr",   FT_IPv6,    PF_LAYER_IPV6, 16, {  8, 24 } },
+	{ "ipv6.src",    FT_IPv6,    PF_LAYER_IPV6, 16, {  8, -1 } },
+	{ "ipv6.dst",    FT_IPv6,    PF_LAYER_IPV6, 16, { 24, -1 } },
+	{ "tcp.port",    FT_UINT16,  PF_LAYER_TCP,   2, {  0,  2 } },
+	{ "tcp.srcport", FT_UINT16,  PF_LAYER_TCP,   2, {  0, -1 } },
+	{ "tcp.dstport", FT_UINT16,  PF_LAYER_TCP,   2, {  2, -1 } },
+	{ "udp.port",    FT_UINT16,  PF_LAYER_UDP,   2, {  0,  2 } },
+	{ "udp.srcport", FT_UINT16,  PF_LAYER_UDP,   2, {  0, -1 } },
+	{ "udp.dstport", FT_UINT16,  PF_LAYER_UDP,   2, {  2, -1 } },
+};
+
+#define PF_MAX_VALUE_LEN	16
+
+typedef enum {
+	PF_TEST,
+	PF_AND,
+	PF_OR
+} pf_node_type_t;
+
+/* A test of a field against one or more values, or two nodes and'ed or
+ * or'ed together.  A NULL node is a test that always passes. */
+typedef struct _pf_node {
+	pf_node_type_t	type;
+	struct _pf_node	*left;
+	struct _pf_node	*right;
+	const pf_field_t *field;
+	GByteArray	*values;	/* field->len bytes each */
+	gchar		*text;		/* the test, for dumping */
+} pf_node_t;
+
+struct _df_prefilter {
+	pf_node_t	*root;
+};
+
+/* Where the outermost headers of a packet are. */
+typedef struct {
+	const guint8	*data;
+	guint32		len;
+	gint64		layer_off[PF_NUM_LAYERS];	/* -1 if not found */
+	guint32		search_off;	/* start of the bytes after the fixed headers */
+	guint32		ports_off;	/* the outermost TCP or UDP ports, which */
+	guint32		ports_len;	/* needn't be searched */
+} pf_packet_t;
+
+static void
+node_free(pf_node_t *node)
+{
+	if (node == NULL)
+		return;
+	node_free(node->left);
+	node_free(node->right);
+	if (node->values)
+		g_byte_array_free(node->values, TRUE);
+	g_free(node->text);
+	g_free(node);
+}
+
+static pf_node_t *
+node_new_pair(pf_node_type_t type, pf_node_t *left, pf_node_t *right)
+{
+	pf_node_t *node = g_new0(pf_node_t, 1);
+
+	node->type = type;
+	node->left = left;
+	node->right = right;
+	return node;
+}
+
+/* Returns the field the node refers to if the prefilter knows where to
+ * find it, and no other field has the same name. */
+static const pf_field_t *
+lookup_field(stnode_t *node)
+{
+	header_field_info *hfinfo;
+	guint		i;
+
+	if (stnode_type_id(node) != STTYPE_FIELD)
+		return NULL;
+
+	hfinfo = (header_field_info *)stnode_data(node);
+	if (hfinfo->same_name_prev_id != -1 || hfinfo->same_name_next != NULL)
+		return NULL;
+
+	for (i = 0; i < G_N_ELEMENTS(pf_fields); i++) {
+		if (pf_fields[i].ftype == hfinfo->type &&
+				strcmp(pf_fields[i].abbrev, hfinfo->abbrev) == 0)
+			return &pf_fields[i];
+	}
+	return NULL;
+}
+
+/* Appends the bytes a field with the value has in the packet, if the
+ * value is a single one (not a network) of the field's type. */
+static gboolean
+append_value(pf_node_t *node, stnode_t *st_value)
+{
+	const fvalue_t	*fv;
+	guint8		buf[PF_MAX_VALUE_LEN];
+
+	if (stnode_type_id(st_value) != STTYPE_FVALUE)
+		return FALSE;
+
+	fv = (const fvalue_t *)stnode_data(st_value);
+	if (fvalue_type_ftenum(fv) != node->field->ftype)
+		return FALSE;
+
+	switch (node->field->ftype) {
+		case FT_ETHER:
+			if (fv->value.bytes->len != 6)
+				return FALSE;
+			memcpy(buf, fv->value.bytes->data, 6);
+			break;
+		case FT_IPv4:
+			if (fv->value.ipv4.nmask != 0xffffffff)
+				return FALSE;
+			phton32(buf, fv->value.ipv4.addr);
+			break;
+		case FT_IPv6:
+			if (fv->value.ipv6.prefix != 128)
+				return FALSE;
+			memcpy(buf, fv->value.ipv6.addr.bytes, 16);
+			break;
+		case FT_UINT16:
+			if (fv->value.uinteger > 0xffff)
+				return FALSE;
+			phton16(buf, (guint16)fv->value.uinteger);
+			break;
+		default:
+			return FALSE;
+	}
+	g_byte_array_append(node->values, buf, node->field->len);
+	return TRUE;
+}
+
+static gchar *
+value_text(stnode_t *st_value)
+{
+	char	*repr;
+	gchar	*text;
+
+	repr = fvalue_to_string_repr(NULL, (fvalue_t *)stnode_data(st_value),
+			FTREPR_DFILTER, BASE_NONE);
+	text = g_strdup(repr);
+	wmem_free(NULL, repr);
+	return text;
+}
+
+static pf_node_t *
+build_eq(stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	pf_node_t	*node;
+	stnode_t	*tmp;
+	gchar		*text;
+
+	if (stnode_type_id(st_arg1) == STTYPE_FVALUE) {
+		tmp = st_arg1;
+		st_arg1 = st_arg2;
+		st_arg2 = tmp;
+	}
+
+	node = g_new0(pf_node_t, 1);
+	node->type = PF_TEST;
+	node->field = lookup_field(st_arg1);
+	if (node->field == NULL) {
+		g_free(node);
+		return NULL;
+	}
+	node->values = g_byte_array_new();
+	if (!append_value(node, st_arg2)) {
+		node_free(node);
+		return NULL;
+	}
+
+	text = value_text(st_arg2);
+	node->text = g_strdup_printf("%s == %s", node->field->abbrev, text);
+	g_free(text);
+	return node;
+}
+
+static pf_node_t *
+build_in(stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	pf_node_t	*node;
+	GSList		*nodelist;
+	stnode_t	*node1, *node2;
+	GString		*text;
+	gchar		*value;
+
+	node = g_new0(pf_node_t, 1);
+	node->type = PF_TEST;
+	node->field = lookup_field(st_arg1);
+	if (node->field == NULL || stnode_type_id(st_arg2) != STTYPE_SET) {
+		g_free(node);
+		return NULL;
+	}
+	node->values = g_byte_array_new();
+
+	text = g_string_new(node->field->abbrev);
+	g_string_append(text, " in {");
+	/* The set is a list of pairs; the second one is NULL unless the
+	 * element is a range, which can't be looked for in the bytes. */
+	for (nodelist = (GSList *)stnode_data(st_arg2); nodelist != NULL;
+			nodelist = g_slist_next(nodelist)) {
+		node1 = (stnode_t *)nodelist->data;
+		nodelist = g_slist_next(nodelist);
+		node2 = (stnode_t *)nodelist->data;
+
+		if (node2 != NULL || !append_value(node, node1)) {
+			g_string_free(text, TRUE);
+			node_free(node);
+			return NULL;
+		}
+		value = value_text(node1);
+		g_string_append_printf(text, "%s%s",
+				node->values->len > node->field->len ? " " : "", value);
+		g_free(value);
+	}
+	g_string_append_c(text, '}');
+	node->text = g_string_free(text, FALSE);
+	return node;
+}
+
+/* Approximates the test by one that passes at least every packet it
+ * passes; returns NULL if that test is always true. */
+static pf_node_t *
+build(stnode_t *st_node)
+{
+	test_op_t	op;
+	stnode_t	*st_arg1, *st_arg2;
+	pf_node_t	*left, *right;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST)
+		return NULL;
+
+	sttype_test_get(st_node, &op, &st_arg1, &st_arg2);
+
+	switch (op) {
+		case TEST_OP_AND:
+			left = build(st_arg1);
+			right = build(st_arg2);
+			if (left == NULL)
+				return right;
+			if (right == NULL)
+				return left;
+			return node_new_pair(PF_AND, left, right);
+
+		case TEST_OP_OR:
+			left = build(st_arg1);
+			right = build(st_arg2);
+			if (left == NULL || right == NULL) {
+				node_free(left);
+				node_free(right);
+				return NULL;
+			}
+			return node_new_pair(PF_OR, left, right);
+
+		case TEST_OP_EQ:
+			return build_eq(st_arg1, st_arg2);
+
+		case TEST_OP_IN:
+			return build_in(st_arg1, st_arg2);
+
+		default:
+			/* Anything else, including "not", has to be
+			 * dissected. */
+			return NULL;
+	}
+}
+
+df_prefilter_t *
+df_prefilter_new(stnode_t *st_root)
+{
+	df_prefilter_t	*pf;
+	pf_node_t	*root;
+
+	root = build(st_root);
+	if (root == NULL)
+		return NULL;
+
+	pf = g_new(df_prefilter_t, 1);
+	pf->root = root;
+	return pf;
+}
+
+void
+df_prefilter_free(df_prefilter_t *pf)
+{
+	if (pf == NULL)
+		return;
+	node_free(pf->root);
+	g_free(pf);
+}
+
+static void
+parse_transport(pf_packet_t *pkt, guint8 proto, guint32 off)
+{
+	if (off >= pkt->len)
+		return;
+
+	if (proto == 6)
+		pkt->layer_off[PF_LAYER_TCP] = off;
+	else if (proto == 17)
+		pkt->layer_off[PF_LAYER_UDP] = off;
+	else
+		return;
+
+	if (off + 4 <= pkt->len) {
+		pkt->ports_off = off;
+		pkt->ports_len = 4;
+	}
+}
+
+/* Finds the IP header at "off", of the given version or, if that is 0,
+ * of either. */
+static void
+parse_ip(pf_packet_t *pkt, guint32 off, guint version)
+{
+	const guint8	*ip;
+	guint32		ihl;
+
+	if (off >= pkt->len)
+		return;
+
+	ip = pkt->data + off;
+	if (version == 0)
+		version = ip[0] >> 4;
+	if (version != (guint)(ip[0] >> 4))
+		return;
+
+	if (version == 4 && off + 20 <= pkt->len) {
+		pkt->layer_off[PF_LAYER_IPV4] = off;
+		/* Options can hold addresses as well. */
+		pkt->search_off = off + 20;
+		ihl = (ip[0] & 0x0f) * 4;
+		/* Only the first fragment has the transport header. */
+		if (ihl >= 20 && (pntoh16(ip + 6) & 0x1fff) == 0)
+			parse_transport(pkt, ip[9], off + ihl);
+	} else if (version == 6 && off + 40 <= pkt->len) {
+		pkt->layer_off[PF_LAYER_IPV6] = off;
+		pkt->search_off = off + 40;
+		parse_transport(pkt, ip[6], off + 40);
+	}
+}
+
+static void
+parse_packet(pf_packet_t *pkt, int encap, const guint8 *data, guint32 len)
+{
+	guint16		type;
+	guint32		off;
+	int		i;
+
+	pkt->data = data;
+	pkt->len = len;
+	for (i = 0; i < PF_NUM_LAYERS; i++)
+		pkt->layer_off[i] = -1;
+	pkt->search_off = 0;
+	pkt->ports_off = 0;
+	pkt->ports_len = 0;
+
+	switch (encap) {
+		case WTAP_ENCAP_ETHERNET:
+			if (len < 14)
+				break;
+			pkt->layer_off[PF_LAYER_ETH] = 0;
+			type = pntoh16(data + 12);
+			off = 14;
+			/* Skip 802.1Q and 802.1ad tags. */
+			while ((type == 0x8100 || type == 0x88a8 || type == 0x9100) &&
+					off + 4 <= len) {
+				type = pntoh16(data + off + 2);
+				off += 4;
+			}
+			pkt->search_off = off;
+			if (type == 0x0800)
+				parse_ip(pkt, off, 4);
+			else if (type == 0x86dd)
+				parse_ip(pkt, off, 6);
+			break;
+		case WTAP_ENCAP_RAW_IP:
+			parse_ip(pkt, 0, 0);
+			break;
+		case WTAP_ENCAP_RAW_IP4:
+			parse_ip(pkt, 0, 4);
+			break;
+		case WTAP_ENCAP_RAW_IP6:
+			parse_ip(pkt, 0, 6);
+			break;
+		default:
+			break;
+	}
+}
+
+/* Looks for the value in the bytes after the outermost headers. */
+static gboolean
+search_value(const pf_packet_t *pkt, const guint8 *value, guint32 len)
+{
+	guint32		start = pkt->search_off;
+
+	if (pkt->ports_len != 0) {
+		if (epan_memmem(pkt->data + start, pkt->ports_off - start,
+					value, len) != NULL)
+			return TRUE;
+		start = pkt->ports_off + pkt->ports_len;
+	}
+	return start < pkt->len &&
+		epan_memmem(pkt->data + start, pkt->len - start,
+			value, len) != NULL;
+}
+
+/* The field has one of the values if the outermost header of its layer
+ * has it, or if an inner header (a tunneled packet, the packet quoted
+ * in an ICMP error, ...) might have it, i.e. it is in the bytes after
+ * the outermost headers. */
+static gboolean
+test_may_match(const pf_node_t *node, const pf_packet_t *pkt)
+{
+	const pf_field_t *field = node->field;
+	gint64		hdr = pkt->layer_off[field->layer];
+	const guint8	*value;
+	guint		i, j;
+
+	for (i = 0; i < node->values->len; i += field->len) {
+		value = node->values->data + i;
+		if (hdr >= 0) {
+			for (j = 0; j < G_N_ELEMENTS(field->offsets); j++) {
+				if (field->offsets[j] >= 0 &&
+						hdr + field->offsets[j] + field->len <= pkt->len &&
+						memcmp(pkt->data + hdr + field->offsets[j],
+							value, field->len) == 0)
+					return TRUE;
+			}
+		}
+		if (search_value(pkt, value, field->len))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean
+node_may_match(const pf_node_t *node, const pf_packet_t *pkt)
+{
+	switch (node->type) {
+		case PF_AND:
+			return node_may_match(node->left, pkt) &&
+				node_may_match(node->right, pkt);
+		case PF_OR:
+			return node_may_match(node->left, pkt) ||
+				node_may_match(node->right, pkt);
+		case PF_TEST:
+		default:
+			return test_may_match(node, pkt);
+	}
+}
+
+gboolean
+df_prefilter_may_match(const df_prefilter_t *pf, int encap,
+		const guint8 *data, guint32 len)
+{
+	pf_packet_t	pkt;
+
+	parse_packet(&pkt, encap, data, len);
+	return node_may_match(pf->root, &pkt);
+}
+
+static void
+dump_node(FILE *f, const pf_node_t *node, pf_node_type_t parent)
+{
+	gboolean	parens;
+
+	if (node->type == PF_TEST) {
+		fprintf(f, "%s", node->text);
+		return;
+	}
+
+	parens = (parent != PF_TEST && parent != node->type);
+	if (parens)
+		fprintf(f, "(");
+	dump_node(f, node->left, node->type);
+	fprintf(f, node->type == PF_AND ? " && " : " || ");
+	dump_node(f, node->right, node->type);
+	if (parens)
+		fprintf(f, ")");
+}
+
+void
+df_prefilter_dump(FILE *f, const df_prefilter_t *pf)
+{
+	dump_node(f, pf->root, PF_TEST);
+	fprintf(f, "\n");
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
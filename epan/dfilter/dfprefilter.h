@@ -0,0 +1,63 @@
+/* dfprefilter.h
+ * Tests on the raw bytes of a packet that reject packets a display
+ * filter can't match, without dissecting them
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFPREFILTER_H
+#define DFPREFILTER_H
+
+#include <stdio.h>
+#include <glib.h>
+
+#include "syntax-tree.h"
+
+/*
+ * A prefilter approximates the ==, "in" and "and"/"or" tests of a
+ * filter on the addresses and ports of Ethernet, IPv4, IPv6, TCP and
+ * UDP by looking at the packet bytes.  The headers of the outermost
+ * Ethernet (with VLAN tags), IP, TCP or UDP layers are found at fixed
+ * offsets and their fields compared with the constants; the constants
+ * of inner headers (tunnels, ICMP errors) must then appear in the bytes
+ * after the outermost headers.  Everything else the filter tests is
+ * assumed to match, so a packet the prefilter rejects can't match the
+ * filter, as long as all its fields come from its own bytes.
+ */
+typedef struct _df_prefilter df_prefilter_t;
+
+/* Returns the prefilter for the semantically checked syntax tree, or
+ * NULL if nothing it tests can be checked on the packet bytes. */
+df_prefilter_t *
+df_prefilter_new(stnode_t *st_root);
+
+void
+df_prefilter_free(df_prefilter_t *pf);
+
+/* Returns FALSE if a packet with the given wiretap encapsulation and
+ * bytes can't match, TRUE if it has to be dissected to tell. */
+gboolean
+df_prefilter_may_match(const df_prefilter_t *pf, int encap,
+		const guint8 *data, guint32 len);
+
+void
+df_prefilter_dump(FILE *f, const df_prefilter_t *pf);
+
+#endif /* DFPREFILTER_H */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,490 @@
+/* dfset.c
+ * Sets of constants for the "in" operator of the dfilter library
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfset.h"
+
+typedef enum {
+	DF_SET_UINT,
+	DF_SET_UINT64,
+	DF_SET_SINT,
+	DF_SET_SINT64,
+	DF_SET_IPV4,
+	DF_SET_IPV6,
+	DF_SET_BYTES,
+	DF_SET_STRING,
+	DF_SET_UNSUPPORTED
+} df_set_class_t;
+
+/* An inclusive range of integers; signed integers are stored with the
+ * sign bit flipped, so that they sort correctly as unsigned ones. */
+typedef struct {
+	guint64		low;
+	guint64		high;
+} df_set_interval_t;
+
+/* The addresses of one netmask (IPv4) or prefix length (IPv6), masked. */
+typedef struct {
+	guint32		mask;
+	GHashTable	*addrs;
+} df_set_prefix_t;
+
+struct _df_set {
+	df_set_class_t	set_class;
+	guint		count;
+	GArray		*intervals;	/* integers */
+	GArray		*prefixes;	/* IPv4 and IPv6 */
+	GArray		*addrs;		/* IPv4 and IPv6, as added */
+	GHashTable	*table;		/* byte strings and character strings */
+};
+
+#define SIGN_FLIP	G_GUINT64_CONSTANT(0x8000000000000000)
+
+static df_set_class_t
+set_class(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			return DF_SET_UINT;
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_EUI64:
+			return DF_SET_UINT64;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return DF_SET_SINT;
+
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			return DF_SET_SINT64;
+
+		case FT_IPv4:
+			return DF_SET_IPV4;
+
+		case FT_IPv6:
+			return DF_SET_IPV6;
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return DF_SET_BYTES;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+			return DF_SET_STRING;
+
+		default:
+			return DF_SET_UNSUPPORTED;
+	}
+}
+
+static guint
+bytes_hash(gconstpointer key)
+{
+	const GByteArray *bytes = (const GByteArray *)key;
+	guint	hash = 5381;
+	guint	i;
+
+	for (i = 0; i < bytes->len; i++)
+		hash = (hash << 5) + hash + bytes->data[i];
+	return hash;
+}
+
+static gboolean
+bytes_equal(gconstpointer a, gconstpointer b)
+{
+	const GByteArray *bytes_a = (const GByteArray *)a;
+	const GByteArray *bytes_b = (const GByteArray *)b;
+
+	return bytes_a->len == bytes_b->len &&
+		memcmp(bytes_a->data, bytes_b->data, bytes_a->len) == 0;
+}
+
+static void
+bytes_free(gpointer data)
+{
+	g_byte_array_free((GByteArray *)data, TRUE);
+}
+
+static guint
+ipv6_hash(gconstpointer key)
+{
+	const ws_in6_addr *addr = (const ws_in6_addr *)key;
+	guint	hash = 5381;
+	guint	i;
+
+	for (i = 0; i < sizeof addr->bytes; i++)
+		hash = (hash << 5) + hash + addr->bytes[i];
+	return hash;
+}
+
+static gboolean
+ipv6_equal(gconstpointer a, gconstpointer b)
+{
+	return memcmp(a, b, sizeof(ws_in6_addr)) == 0;
+}
+
+/* Clears all bits of the address after the first prefix bits. */
+static void
+ipv6_mask(const ws_in6_addr *addr, guint32 prefix, ws_in6_addr *masked)
+{
+	guint	i;
+
+	for (i = 0; i < sizeof masked->bytes; i++) {
+		if (prefix >= 8) {
+			masked->bytes[i] = addr->bytes[i];
+			prefix -= 8;
+		} else {
+			masked->bytes[i] = addr->bytes[i] & (guint8)(0xff00 >> prefix);
+			prefix = 0;
+		}
+	}
+}
+
+df_set_t *
+df_set_new(ftenum_t ftype)
+{
+	df_set_t	*set;
+	df_set_class_t	cls = set_class(ftype);
+
+	if (cls == DF_SET_UNSUPPORTED)
+		return NULL;
+
+	set = g_new0(df_set_t, 1);
+	set->set_class = cls;
+	switch (cls) {
+		case DF_SET_IPV4:
+			set->prefixes = g_array_new(FALSE, FALSE, sizeof(df_set_prefix_t));
+			set->addrs = g_array_new(FALSE, FALSE, sizeof(ipv4_addr_and_mask));
+			break;
+		case DF_SET_IPV6:
+			set->prefixes = g_array_new(FALSE, FALSE, sizeof(df_set_prefix_t));
+			set->addrs = g_array_new(FALSE, FALSE, sizeof(ipv6_addr_and_prefix));
+			break;
+		case DF_SET_BYTES:
+			set->table = g_hash_table_new_full(bytes_hash, bytes_equal,
+					bytes_free, NULL);
+			break;
+		case DF_SET_STRING:
+			set->table = g_hash_table_new_full(g_str_hash, g_str_equal,
+					g_free, NULL);
+			break;
+		default:
+			set->intervals = g_array_new(FALSE, FALSE, sizeof(df_set_interval_t));
+			break;
+	}
+	return set;
+}
+
+void
+df_set_free(df_set_t *set)
+{
+	guint	i;
+
+	if (!set)
+		return;
+
+	if (set->prefixes) {
+		for (i = 0; i < set->prefixes->len; i++)
+			g_hash_table_destroy(g_array_index(set->prefixes, df_set_prefix_t, i).addrs);
+		g_array_free(set->prefixes, TRUE);
+	}
+	if (set->addrs)
+		g_array_free(set->addrs, TRUE);
+	if (set->intervals)
+		g_array_free(set->intervals, TRUE);
+	if (set->table)
+		g_hash_table_destroy(set->table);
+	g_free(set);
+}
+
+gboolean
+df_set_accepts(const df_set_t *set, ftenum_t ftype)
+{
+	return set_class(ftype) == set->set_class;
+}
+
+static guint64
+integer_key(const df_set_t *set, const fvalue_t *fv)
+{
+	switch (set->set_class) {
+		case DF_SET_UINT:
+			return fv->value.uinteger;
+		case DF_SET_UINT64:
+			return fv->value.uinteger64;
+		case DF_SET_SINT:
+			return (guint64)(gint64)fv->value.sinteger ^ SIGN_FLIP;
+		case DF_SET_SINT64:
+			return (guint64)fv->value.sinteger64 ^ SIGN_FLIP;
+		default:
+			g_assert_not_reached();
+			return 0;
+	}
+}
+
+/* Returns the table for the netmask or prefix length, adding it if
+ * there isn't one yet. */
+static GHashTable *
+prefix_table(df_set_t *set, guint32 mask)
+{
+	df_set_prefix_t	prefix;
+	guint		i;
+
+	for (i = 0; i < set->prefixes->len; i++) {
+		if (g_array_index(set->prefixes, df_set_prefix_t, i).mask == mask)
+			return g_array_index(set->prefixes, df_set_prefix_t, i).addrs;
+	}
+
+	prefix.mask = mask;
+	if (set->set_class == DF_SET_IPV4)
+		prefix.addrs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	else
+		prefix.addrs = g_hash_table_new_full(ipv6_hash, ipv6_equal, g_free, NULL);
+	g_array_append_val(set->prefixes, prefix);
+	return prefix.addrs;
+}
+
+gboolean
+df_set_add(df_set_t *set, const fvalue_t *fv)
+{
+	df_set_interval_t	interval;
+	ipv4_addr_and_mask	ipv4;
+	ipv6_addr_and_prefix	ipv6;
+	ws_in6_addr		*masked;
+	GByteArray		*bytes;
+
+	if (!df_set_accepts(set, fvalue_type_ftenum((fvalue_t *)fv)))
+		return FALSE;
+
+	switch (set->set_class) {
+		case DF_SET_IPV4:
+			ipv4 = fv->value.ipv4;
+			g_array_append_val(set->addrs, ipv4);
+			g_hash_table_add(prefix_table(set, ipv4.nmask),
+					GUINT_TO_POINTER(ipv4.addr & ipv4.nmask));
+			break;
+		case DF_SET_IPV6:
+			ipv6 = fv->value.ipv6;
+			ipv6.prefix = MIN(ipv6.prefix, 128);
+			g_array_append_val(set->addrs, ipv6);
+			masked = g_new(ws_in6_addr, 1);
+			ipv6_mask(&ipv6.addr, ipv6.prefix, masked);
+			g_hash_table_add(prefix_table(set, ipv6.prefix), masked);
+			break;
+		case DF_SET_BYTES:
+			bytes = g_byte_array_sized_new(fv->value.bytes->len);
+			g_byte_array_append(bytes, fv->value.bytes->data, fv->value.bytes->len);
+			g_hash_table_add(set->table, bytes);
+			break;
+		case DF_SET_STRING:
+			g_hash_table_add(set->table, g_strdup(fv->value.string));
+			break;
+		default:
+			interval.low = interval.high = integer_key(set, fv);
+			g_array_append_val(set->intervals, interval);
+			break;
+	}
+	set->count++;
+	return TRUE;
+}
+
+gboolean
+df_set_add_range(df_set_t *set, const fvalue_t *low, const fvalue_t *high)
+{
+	df_set_interval_t	interval;
+
+	if (!set->intervals ||
+			!df_set_accepts(set, fvalue_type_ftenum((fvalue_t *)low)) ||
+			!df_set_accepts(set, fvalue_type_ftenum((fvalue_t *)high)))
+		return FALSE;
+
+	interval.low = integer_key(set, low);
+	interval.high = integer_key(set, high);
+	/* A range with its bounds reversed matches nothing. */
+	if (interval.low <= interval.high)
+		g_array_append_val(set->intervals, interval);
+	set->count++;
+	return TRUE;
+}
+
+static gint
+compare_intervals(gconstpointer a, gconstpointer b)
+{
+	const df_set_interval_t *ia = (const df_set_interval_t *)a;
+	const df_set_interval_t *ib = (const df_set_interval_t *)b;
+
+	if (ia->low < ib->low)
+		return -1;
+	return ia->low > ib->low;
+}
+
+void
+df_set_finish(df_set_t *set)
+{
+	df_set_interval_t	*intervals;
+	guint			i, n;
+
+	if (!set->intervals || set->intervals->len == 0)
+		return;
+
+	/* Sort, then merge overlapping and adjacent intervals. */
+	g_array_sort(set->intervals, compare_intervals);
+	intervals = (df_set_interval_t *)(void *)set->intervals->data;
+	n = 0;
+	for (i = 1; i < set->intervals->len; i++) {
+		if (intervals[i].low <= intervals[n].high ||
+				intervals[i].low - 1 == intervals[n].high) {
+			if (intervals[i].high > intervals[n].high)
+				intervals[n].high = intervals[i].high;
+		} else {
+			intervals[++n] = intervals[i];
+		}
+	}
+	g_array_set_size(set->intervals, n + 1);
+}
+
+static gboolean
+contains_integer(const df_set_t *set, guint64 key)
+{
+	const df_set_interval_t *intervals = (const df_set_interval_t *)(void *)set->intervals->data;
+	guint	lo = 0, hi = set->intervals->len, mid;
+
+	/* Find the last interval that starts at or before the key. */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (intervals[mid].low <= key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo > 0 && key <= intervals[lo - 1].high;
+}
+
+static gboolean
+contains_ipv4(const df_set_t *set, const ipv4_addr_and_mask *a)
+{
+	const df_set_prefix_t	*prefix;
+	const ipv4_addr_and_mask *b;
+	guint32	nmask;
+	guint	i;
+
+	if (a->nmask != 0xffffffff) {
+		/* The field itself has a netmask, so compare using the
+		 * shorter one of each pair, as ftype-ipv4.c does. */
+		for (i = 0; i < set->addrs->len; i++) {
+			b = &g_array_index(set->addrs, ipv4_addr_and_mask, i);
+			nmask = MIN(a->nmask, b->nmask);
+			if ((a->addr & nmask) == (b->addr & nmask))
+				return TRUE;
+		}
+		return FALSE;
+	}
+
+	for (i = 0; i < set->prefixes->len; i++) {
+		prefix = &g_array_index(set->prefixes, df_set_prefix_t, i);
+		if (g_hash_table_contains(prefix->addrs,
+				GUINT_TO_POINTER(a->addr & prefix->mask)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean
+contains_ipv6(const df_set_t *set, const ipv6_addr_and_prefix *a)
+{
+	const df_set_prefix_t	*prefix;
+	const ipv6_addr_and_prefix *b;
+	ws_in6_addr	masked_a, masked_b;
+	guint32		bits;
+	guint		i;
+
+	if (a->prefix < 128) {
+		/* As for IPv4, use the shorter prefix of each pair. */
+		for (i = 0; i < set->addrs->len; i++) {
+			b = &g_array_index(set->addrs, ipv6_addr_and_prefix, i);
+			bits = MIN(a->prefix, b->prefix);
+			ipv6_mask(&a->addr, bits, &masked_a);
+			ipv6_mask(&b->addr, bits, &masked_b);
+			if (ipv6_equal(&masked_a, &masked_b))
+				return TRUE;
+		}
+		return FALSE;
+	}
+
+	for (i = 0; i < set->prefixes->len; i++) {
+		prefix = &g_array_index(set->prefixes, df_set_prefix_t, i);
+		ipv6_mask(&a->addr, prefix->mask, &masked_a);
+		if (g_hash_table_contains(prefix->addrs, &masked_a))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+df_set_contains(const df_set_t *set, const fvalue_t *fv)
+{
+	switch (set->set_class) {
+		case DF_SET_IPV4:
+			return contains_ipv4(set, &fv->value.ipv4);
+		case DF_SET_IPV6:
+			return contains_ipv6(set, &fv->value.ipv6);
+		case DF_SET_BYTES:
+			return g_hash_table_contains(set->table, fv->value.bytes);
+		case DF_SET_STRING:
+			return g_hash_table_contains(set->table, fv->value.string);
+		default:
+			return contains_integer(set, integer_key(set, fv));
+	}
+}
+
+guint
+df_set_count(const df_set_t *set)
+{
+	return set->count;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
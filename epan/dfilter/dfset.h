@@ -0,0 +1,75 @@
+/* dfset.h
+ * Sets of constants for the "in" operator of the dfilter library
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFSET_H
+#define DFSET_H
+
+#include <glib.h>
+#include <epan/ftypes/ftypes.h>
+
+/*
+ * A set of constants that a field value can be looked up in without
+ * comparing it with every member in turn: integers and integer ranges
+ * are kept as a sorted array of disjoint intervals, IPv4 and IPv6
+ * addresses in one hash table per netmask or prefix length, and byte
+ * strings and character strings in a hash table.  Membership is the
+ * same as the == (or, for ranges, >= and <=) of the field's type.
+ */
+typedef struct _df_set df_set_t;
+
+/* Returns a new, empty set for values of type ftype, or NULL if
+ * sets of that type aren't supported. */
+df_set_t *
+df_set_new(ftenum_t ftype);
+
+void
+df_set_free(df_set_t *set);
+
+/* Returns TRUE if values of type ftype can be looked up in the set. */
+gboolean
+df_set_accepts(const df_set_t *set, ftenum_t ftype);
+
+/* Adds a copy of the value to the set.  Returns FALSE if the set
+ * doesn't accept values of its type. */
+gboolean
+df_set_add(df_set_t *set, const fvalue_t *fv);
+
+/* Adds all values from low to high, inclusive, to the set.  Returns
+ * FALSE if the set doesn't accept values of their type, or isn't a
+ * set of integers. */
+gboolean
+df_set_add_range(df_set_t *set, const fvalue_t *low, const fvalue_t *high);
+
+/* Prepares the set for lookups; must be called after the last
+ * value is added. */
+void
+df_set_finish(df_set_t *set);
+
+gboolean
+df_set_contains(const df_set_t *set, const fvalue_t *fv);
+
+/* Returns the number of values and ranges that were added. */
+guint
+df_set_count(const df_set_t *set);
+
+#endif /* DFSET_H */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -12,6 +12,8 @@
 
 #include <ftypes/ftypes-int.h>
 
+#include <string.h>
+
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op)
 {
@@ -36,6 +38,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case FVALUE_SET:
+			df_set_free(v->value.set);
+			break;
 		default:
 			/* nothing */
 			;
@@ -73,6 +78,22 @@ dfvm_value_new(dfvm_value_type_t type)
 }
 
 
+static const char *
+cmp_op_string(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:	return "==";
+		case ANY_NE:	return "!=";
+		case ANY_GT:	return ">";
+		case ANY_GE:	return ">=";
+		case ANY_LT:	return "<";
+		case ANY_LE:	return "<=";
+		default:
+			g_assert_not_reached();
+			return "?";
+	}
+}
+
 void
 dfvm_dump(FILE *f, dfilter_t *df)
 {
@@ -119,6 +140,14 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_CMP_UINT:
+			case ANY_CMP_UINT64:
+			case ANY_CMP_SINT:
+			case ANY_CMP_SINT64:
+			case ANY_CMP_IPV4:
+			case ANY_CMP_BYTES:
+			case ANY_IN_SET:
+			case ANY_CONTAINS_MULTI:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -259,6 +288,39 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					arg3->value.numeric);
 				break;
 
+			case ANY_CMP_UINT:
+			case ANY_CMP_UINT64:
+			case ANY_CMP_SINT:
+			case ANY_CMP_SINT64:
+			case ANY_CMP_IPV4:
+			case ANY_CMP_BYTES:
+				fprintf(f, "%05d %s\treg#%u %s reg#%u\n",
+					id,
+					insn->op == ANY_CMP_UINT ? "ANY_CMP_UINT" :
+					insn->op == ANY_CMP_UINT64 ? "ANY_CMP_UINT64" :
+					insn->op == ANY_CMP_SINT ? "ANY_CMP_SINT" :
+					insn->op == ANY_CMP_SINT64 ? "ANY_CMP_SINT64" :
+					insn->op == ANY_CMP_IPV4 ? "ANY_CMP_IPV4" :
+					"ANY_CMP_BYTES",
+					arg1->value.numeric,
+					cmp_op_string((dfvm_opcode_t)arg3->value.numeric),
+					arg2->value.numeric);
+				break;
+
+			case ANY_IN_SET:
+				fprintf(f, "%05d ANY_IN_SET\treg#%u in <set of %u>\n",
+					id, arg1->value.numeric,
+					df_set_count(arg2->value.set));
+				break;
+
+			case ANY_CONTAINS_MULTI:
+				fprintf(f, "%05d ANY_CONTAINS_MULTI\treg#%u contains pattern #%u of <matcher #%u of %u>\n",
+					id, arg1->value.numeric,
+					arg3->value.numeric, arg2->value.numeric,
+					df_contains_count((df_contains_t *)g_ptr_array_index(df->matchers,
+						arg2->value.numeric)));
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -400,6 +462,162 @@ any_in_range(dfilter_t *df, int reg1, int reg2, int reg3)
 	return FALSE;
 }
 
+/*
+ * The specialized comparisons of the values of a field with a constant.
+ * These do what any_test() does with the ftype's comparison function,
+ * without calling through it, and with the constant's value fetched
+ * once rather than for every value of the field.
+ */
+static inline const fvalue_t *
+const_fvalue(dfilter_t *df, int reg)
+{
+	return (const fvalue_t *)df->registers[reg]->data;
+}
+
+#define ANY_CMP_LOOP(list, member, cmp_op, b) \
+	for (; list != NULL; list = g_list_next(list)) { \
+		if (((const fvalue_t *)list->data)->value.member cmp_op (b)) \
+			return TRUE; \
+	} \
+	return FALSE;
+
+#define ANY_CMP(op, list, member, b) \
+	switch (op) { \
+		case ANY_EQ: ANY_CMP_LOOP(list, member, ==, b) \
+		case ANY_NE: ANY_CMP_LOOP(list, member, !=, b) \
+		case ANY_GT: ANY_CMP_LOOP(list, member, >, b) \
+		case ANY_GE: ANY_CMP_LOOP(list, member, >=, b) \
+		case ANY_LT: ANY_CMP_LOOP(list, member, <, b) \
+		case ANY_LE: ANY_CMP_LOOP(list, member, <=, b) \
+		default: \
+			g_assert_not_reached(); \
+			return FALSE; \
+	}
+
+static gboolean
+any_cmp_uint(dfilter_t *df, dfvm_opcode_t op, int reg1, int reg2)
+{
+	GList	*list = df->registers[reg1];
+	guint32	b = const_fvalue(df, reg2)->value.uinteger;
+
+	ANY_CMP(op, list, uinteger, b)
+}
+
+static gboolean
+any_cmp_uint64(dfilter_t *df, dfvm_opcode_t op, int reg1, int reg2)
+{
+	GList	*list = df->registers[reg1];
+	guint64	b = const_fvalue(df, reg2)->value.uinteger64;
+
+	ANY_CMP(op, list, uinteger64, b)
+}
+
+static gboolean
+any_cmp_sint(dfilter_t *df, dfvm_opcode_t op, int reg1, int reg2)
+{
+	GList	*list = df->registers[reg1];
+	gint32	b = const_fvalue(df, reg2)->value.sinteger;
+
+	ANY_CMP(op, list, sinteger, b)
+}
+
+static gboolean
+any_cmp_sint64(dfilter_t *df, dfvm_opcode_t op, int reg1, int reg2)
+{
+	GList	*list = df->registers[reg1];
+	gint64	b = const_fvalue(df, reg2)->value.sinteger64;
+
+	ANY_CMP(op, list, sinteger64, b)
+}
+
+/* As in ftype-ipv4.c, compare using the shorter of the two netmasks. */
+static gboolean
+any_cmp_ipv4(dfilter_t *df, dfvm_opcode_t op, int reg1, int reg2)
+{
+	GList	*list = df->registers[reg1];
+	const ipv4_addr_and_mask *b = &const_fvalue(df, reg2)->value.ipv4;
+	const ipv4_addr_and_mask *a;
+	guint32	nmask, addr_a, addr_b;
+	gboolean	result;
+
+	for (; list != NULL; list = g_list_next(list)) {
+		a = &((const fvalue_t *)list->data)->value.ipv4;
+		nmask = MIN(a->nmask, b->nmask);
+		addr_a = a->addr & nmask;
+		addr_b = b->addr & nmask;
+		switch (op) {
+			case ANY_EQ:	result = addr_a == addr_b; break;
+			case ANY_NE:	result = addr_a != addr_b; break;
+			case ANY_GT:	result = addr_a > addr_b; break;
+			case ANY_GE:	result = addr_a >= addr_b; break;
+			case ANY_LT:	result = addr_a < addr_b; break;
+			case ANY_LE:	result = addr_a <= addr_b; break;
+			default:
+				g_assert_not_reached();
+				return FALSE;
+		}
+		if (result)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Only equality is specialized for byte strings. */
+static gboolean
+any_cmp_bytes(dfilter_t *df, dfvm_opcode_t op, int reg1, int reg2)
+{
+	GList	*list = df->registers[reg1];
+	const GByteArray *b = const_fvalue(df, reg2)->value.bytes;
+	const GByteArray *a;
+	gboolean	want_equal = (op == ANY_EQ);
+	gboolean	equal;
+
+	g_assert(op == ANY_EQ || op == ANY_NE);
+
+	for (; list != NULL; list = g_list_next(list)) {
+		a = ((const fvalue_t *)list->data)->value.bytes;
+		equal = (a->len == b->len && memcmp(a->data, b->data, a->len) == 0);
+		if (equal == want_equal)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean
+any_in_set(dfilter_t *df, int reg, const df_set_t *set)
+{
+	GList	*list = df->registers[reg];
+
+	for (; list != NULL; list = g_list_next(list)) {
+		if (df_set_contains(set, (const fvalue_t *)list->data))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* The first test of a run with a matcher scans the field's values for
+ * all the patterns of the matcher; the others use the results. */
+static gboolean
+any_contains_multi(dfilter_t *df, int reg, guint matcher, guint pattern)
+{
+	const df_contains_t *c = (const df_contains_t *)g_ptr_array_index(df->matchers, matcher);
+	gboolean	*found = df->pattern_found[matcher];
+	GList		*list;
+	guint		remaining;
+
+	if (!df->matcher_scanned[matcher]) {
+		remaining = df_contains_count(c);
+		memset(found, 0, remaining * sizeof(gboolean));
+		for (list = df->registers[reg]; list != NULL && remaining > 0;
+				list = g_list_next(list)) {
+			remaining = df_contains_scan(c, (const fvalue_t *)list->data,
+					found, remaining);
+		}
+		df->matcher_scanned[matcher] = TRUE;
+	}
+	return found[pattern];
+}
+
 
 static void
 free_owned_register(gpointer data, gpointer user_data _U_)
@@ -458,8 +676,16 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 
 
 
-gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+/*
+ * Runs the program.  If result_slots isn't NULL, it maps each instruction
+ * to a slot in results where the outcome of that instruction is kept, or
+ * is -1; instructions sharing a slot compute the same thing, so once the
+ * slot holds a result (0 or 1, rather than -1) the instruction isn't run
+ * again.  Registers are only freed on RETURN if free_registers is TRUE.
+ */
+static gboolean
+dfvm_run(dfilter_t *df, proto_tree *tree, const int *result_slots,
+		gint8 *results, gboolean free_registers)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -476,6 +702,12 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 
 	length = df->insns->len;
 
+	/* Each filter is run at most once on the values loaded into its
+	 * registers, so this is the time to forget the scans of the last
+	 * ones. */
+	if (df->matchers)
+		memset(df->matcher_scanned, 0, df->matchers->len * sizeof(gboolean));
+
 	for (id = 0; id < length; id++) {
 
 	  AGAIN:
@@ -483,6 +715,12 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 		arg1 = insn->arg1;
 		arg2 = insn->arg2;
 
+		if (result_slots && result_slots[id] >= 0 &&
+				results[result_slots[id]] >= 0) {
+			accum = results[result_slots[id]];
+			continue;
+		}
+
 		switch (insn->op) {
 			case CHECK_EXISTS:
 				hfinfo = arg1->value.hfinfo;
@@ -579,12 +817,54 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg3->value.numeric);
 				break;
 
+			case ANY_CMP_UINT:
+				accum = any_cmp_uint(df, (dfvm_opcode_t)insn->arg3->value.numeric,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_CMP_UINT64:
+				accum = any_cmp_uint64(df, (dfvm_opcode_t)insn->arg3->value.numeric,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_CMP_SINT:
+				accum = any_cmp_sint(df, (dfvm_opcode_t)insn->arg3->value.numeric,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_CMP_SINT64:
+				accum = any_cmp_sint64(df, (dfvm_opcode_t)insn->arg3->value.numeric,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_CMP_IPV4:
+				accum = any_cmp_ipv4(df, (dfvm_opcode_t)insn->arg3->value.numeric,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_CMP_BYTES:
+				accum = any_cmp_bytes(df, (dfvm_opcode_t)insn->arg3->value.numeric,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_IN_SET:
+				accum = any_in_set(df, arg1->value.numeric,
+						arg2->value.set);
+				break;
+
+			case ANY_CONTAINS_MULTI:
+				accum = any_contains_multi(df, arg1->value.numeric,
+						arg2->value.numeric,
+						insn->arg3->value.numeric);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
 
 			case RETURN:
-				free_register_overhead(df);
+				if (free_registers)
+					free_register_overhead(df);
 				return accum;
 
 			case IF_TRUE_GOTO:
@@ -613,12 +893,34 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				g_assert_not_reached();
 				break;
 		}
+
+		if (result_slots && result_slots[id] >= 0)
+			results[result_slots[id]] = accum ? 1 : 0;
 	}
 
 	g_assert_not_reached();
 	return FALSE; /* to appease the compiler */
 }
 
+gboolean
+dfvm_apply(dfilter_t *df, proto_tree *tree)
+{
+	return dfvm_run(df, tree, NULL, NULL, TRUE);
+}
+
+gboolean
+dfvm_apply_shared(dfilter_t *df, proto_tree *tree, const int *result_slots,
+		gint8 *results)
+{
+	return dfvm_run(df, tree, result_slots, results, FALSE);
+}
+
+void
+dfvm_free_registers(dfilter_t *df)
+{
+	free_register_overhead(df);
+}
+
 void
 dfvm_init_const(dfilter_t *df)
 {
@@ -654,6 +956,14 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_CMP_UINT:
+			case ANY_CMP_UINT64:
+			case ANY_CMP_SINT:
+			case ANY_CMP_SINT64:
+			case ANY_CMP_IPV4:
+			case ANY_CMP_BYTES:
+			case ANY_IN_SET:
+			case ANY_CONTAINS_MULTI:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -14,6 +14,8 @@
 #include "syntax-tree.h"
 #include "drange.h"
 #include "dfunctions.h"
+#include "dfset.h"
+#include "dfcontains.h"
 
 typedef enum {
 	EMPTY,
@@ -23,7 +25,8 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	FVALUE_SET
 } dfvm_value_type_t;
 
 typedef struct {
@@ -35,6 +38,7 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		df_set_t		*set;
 	} value;
 
 } dfvm_value_t;
@@ -60,7 +64,35 @@ typedef enum {
 	ANY_MATCHES,
 	MK_RANGE,
 	CALL_FUNCTION,
-	ANY_IN_RANGE
+	ANY_IN_RANGE,
+
+	/*
+	 * Comparisons of a field with a constant, used by gencode.c in
+	 * place of ANY_EQ through ANY_LE when the values of the field can
+	 * be compared directly.  arg1 is the field's register, arg2 the
+	 * constant's, and arg3 the generic opcode for the comparison.
+	 */
+	ANY_CMP_UINT,
+	ANY_CMP_UINT64,
+	ANY_CMP_SINT,
+	ANY_CMP_SINT64,
+	ANY_CMP_IPV4,
+	ANY_CMP_BYTES,
+
+	/*
+	 * Looks the values of the field in register arg1 up in the set of
+	 * constants arg2, in place of a series of ANY_EQ and ANY_IN_RANGE
+	 * tests for the "in" operator.
+	 */
+	ANY_IN_SET,
+
+	/*
+	 * Tests if a value of the field in register arg1 contains pattern
+	 * arg3 of the filter's matcher arg2, in place of ANY_CONTAINS when
+	 * the filter has several "contains" tests on the field.  The first
+	 * of these tests scans the values for all the matcher's patterns.
+	 */
+	ANY_CONTAINS_MULTI
 
 } dfvm_opcode_t;
 
@@ -88,6 +120,18 @@ dfvm_dump(FILE *f, dfilter_t *df);
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree);
 
+/* Like dfvm_apply(), but leaves the registers loaded for the next filter
+ * sharing them, and keeps or reuses the results of the instructions that
+ * result_slots maps to a slot in results. */
+gboolean
+dfvm_apply_shared(dfilter_t *df, proto_tree *tree, const int *result_slots,
+		gint8 *results);
+
+/* Frees the values loaded into the registers of a filter by
+ * dfvm_apply_shared(). */
+void
+dfvm_free_registers(dfilter_t *df);
+
 void
 dfvm_init_const(dfilter_t *df);
 
@@ -252,18 +252,191 @@ gen_relation_regs(dfwork_t *dfw, dfvm_opcode_t op, int reg1, int reg2)
 	dfw_append_insn(dfw, insn);
 }
 
+/**
+ * Finds the specialized opcode that compares values of type ftype with a
+ * constant of the same type using the relation op, if there is one.
+ */
+static gboolean
+specialized_opcode(ftenum_t ftype, dfvm_opcode_t op, dfvm_opcode_t *spec_op)
+{
+	gboolean	ordered = TRUE;
+
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			*spec_op = ANY_CMP_UINT;
+			break;
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_EUI64:
+			*spec_op = ANY_CMP_UINT64;
+			break;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			*spec_op = ANY_CMP_SINT;
+			break;
+
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			*spec_op = ANY_CMP_SINT64;
+			break;
+
+		case FT_IPv4:
+			*spec_op = ANY_CMP_IPV4;
+			break;
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			*spec_op = ANY_CMP_BYTES;
+			ordered = FALSE;
+			break;
+
+		default:
+			return FALSE;
+	}
+
+	switch (op) {
+		case ANY_EQ:
+		case ANY_NE:
+			return TRUE;
+		case ANY_GT:
+		case ANY_GE:
+		case ANY_LT:
+		case ANY_LE:
+			return ordered;
+		default:
+			return FALSE;
+	}
+}
+
+/**
+ * Checks whether a relation between a field and a constant can use one of
+ * the type-specialized comparison opcodes.  If it can, and the constant is
+ * on the LHS, the arguments are swapped, and the relation mirrored, so that
+ * the field always comes first; otherwise the arguments and the relation
+ * are left alone.  Every field with the field's name has to have a type
+ * handled by the same opcode, as they are all loaded into the same
+ * register.
+ */
+static gboolean
+specialize_relation(dfwork_t *dfw, dfvm_opcode_t *op,
+		stnode_t **st_arg1, stnode_t **st_arg2, dfvm_opcode_t *spec_op)
+{
+	stnode_t	*st_field, *st_value;
+	dfvm_opcode_t	rel_op = *op;
+	header_field_info *hfinfo;
+	ftenum_t	ftype;
+	dfvm_opcode_t	field_op;
+
+	if (!dfw->specialize)
+		return FALSE;
+
+	if (stnode_type_id(*st_arg1) == STTYPE_FIELD &&
+			stnode_type_id(*st_arg2) == STTYPE_FVALUE) {
+		st_field = *st_arg1;
+		st_value = *st_arg2;
+	}
+	else if (stnode_type_id(*st_arg1) == STTYPE_FVALUE &&
+			stnode_type_id(*st_arg2) == STTYPE_FIELD) {
+		switch (rel_op) {
+			case ANY_EQ:
+			case ANY_NE:	break;
+			case ANY_GT:	rel_op = ANY_LT; break;
+			case ANY_GE:	rel_op = ANY_LE; break;
+			case ANY_LT:	rel_op = ANY_GT; break;
+			case ANY_LE:	rel_op = ANY_GE; break;
+			default:	return FALSE;
+		}
+		st_field = *st_arg2;
+		st_value = *st_arg1;
+	}
+	else
+		return FALSE;
+
+	ftype = fvalue_type_ftenum((fvalue_t *)stnode_data(st_value));
+	if (!specialized_opcode(ftype, rel_op, spec_op))
+		return FALSE;
+
+	hfinfo = (header_field_info*)stnode_data(st_field);
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+	for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+		if (!specialized_opcode(hfinfo->type, rel_op, &field_op) ||
+				field_op != *spec_op)
+			return FALSE;
+	}
+
+	*op = rel_op;
+	*st_arg1 = st_field;
+	*st_arg2 = st_value;
+	return TRUE;
+}
+
+/**
+ * Adds a type-specialized comparison of the field loaded in reg1 with the
+ * constant in reg2; arg3 records the relation.
+ */
+static void
+gen_specialized_relation_regs(dfwork_t *dfw, dfvm_opcode_t spec_op,
+		dfvm_opcode_t op, int reg1, int reg2)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2, *val3;
+
+	insn = dfvm_insn_new(spec_op);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg1;
+	val2 = dfvm_value_new(REGISTER);
+	val2->value.numeric = reg2;
+	val3 = dfvm_value_new(INTEGER);
+	val3->value.numeric = op;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	insn->arg3 = val3;
+	dfw_append_insn(dfw, insn);
+}
+
 static void
 gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
 {
 	dfvm_value_t	*jmp1 = NULL, *jmp2 = NULL;
 	int		reg1 = -1, reg2 = -1;
+	dfvm_opcode_t	spec_op;
+	gboolean	specialized;
+
+	/* This has to be decided before gen_entity() takes the constant. */
+	specialized = specialize_relation(dfw, &op, &st_arg1, &st_arg2, &spec_op);
 
 	/* Create code for the LHS and RHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 	reg2 = gen_entity(dfw, st_arg2, &jmp2);
 
 	/* Then combine them in a DFVM insruction */
-	gen_relation_regs(dfw, op, reg1, reg2);
+	if (specialized)
+		gen_specialized_relation_regs(dfw, spec_op, op, reg1, reg2);
+	else
+		gen_relation_regs(dfw, op, reg1, reg2);
 
 	/* If either of the relation arguments need an "exit" instruction
 	 * to jump to (on failure), mark them */
@@ -287,8 +460,64 @@ fixup_jumps(gpointer data, gpointer user_data)
 	}
 }
 
+/* Builds a set for looking the values of a field up in, if the field,
+ * and every field with the same name, can be looked up in one and the
+ * "in" set contains only constants. */
+static df_set_t *
+build_set(dfwork_t *dfw, stnode_t *st_arg1, GSList *nodelist)
+{
+	header_field_info *hfinfo;
+	stnode_t	*node1, *node2;
+	df_set_t	*set;
+	gboolean	ok;
+
+	if (!dfw->specialize || stnode_type_id(st_arg1) != STTYPE_FIELD)
+		return NULL;
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	set = df_set_new(hfinfo->type);
+	if (set == NULL)
+		return NULL;
+
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+	for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+		if (!df_set_accepts(set, hfinfo->type)) {
+			df_set_free(set);
+			return NULL;
+		}
+	}
+
+	while (nodelist) {
+		node1 = (stnode_t*)nodelist->data;
+		nodelist = g_slist_next(nodelist);
+		node2 = (stnode_t*)nodelist->data;
+		nodelist = g_slist_next(nodelist);
+
+		if (stnode_type_id(node1) != STTYPE_FVALUE ||
+				(node2 && stnode_type_id(node2) != STTYPE_FVALUE)) {
+			df_set_free(set);
+			return NULL;
+		}
+		if (node2)
+			ok = df_set_add_range(set, (fvalue_t*)stnode_data(node1),
+					(fvalue_t*)stnode_data(node2));
+		else
+			ok = df_set_add(set, (fvalue_t*)stnode_data(node1));
+		if (!ok) {
+			df_set_free(set);
+			return NULL;
+		}
+	}
+	df_set_finish(set);
+	return set;
+}
+
 /* Generate the code for the in operator.  It behaves much like an OR-ed
- * series of == tests, but without the redundant existence checks. */
+ * series of == tests, but without the redundant existence checks.
+ * When possible, the set is instead compiled to a df_set_t that all the
+ * field's values are looked up in. */
 static void
 gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 {
@@ -299,12 +528,28 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 	stnode_t	*node1, *node2;
 	GSList		*nodelist_head, *nodelist;
 	GSList		*jumplist = NULL;
+	dfvm_opcode_t	op, spec_op;
+	gboolean	specialized;
+	df_set_t	*set;
 
 	/* Create code for the LHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 
 	/* Create code for the set on the RHS of the relation */
 	nodelist_head = nodelist = (GSList*)stnode_steal_data(st_arg2);
+
+	set = build_set(dfw, st_arg1, nodelist_head);
+	if (set) {
+		insn = dfvm_insn_new(ANY_IN_SET);
+		val1 = dfvm_value_new(REGISTER);
+		val1->value.numeric = reg1;
+		val2 = dfvm_value_new(FVALUE_SET);
+		val2->value.set = set;
+		insn->arg1 = val1;
+		insn->arg2 = val2;
+		dfw_append_insn(dfw, insn);
+		nodelist = NULL;
+	}
 	while (nodelist) {
 		node1 = (stnode_t*)nodelist->data;
 		nodelist = g_slist_next(nodelist);
@@ -332,12 +577,18 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 			dfw_append_insn(dfw, insn);
 		} else {
 			int	reg2;
+			stnode_t *field = st_arg1;
 
 			/* Normal element: add equality test. */
+			op = ANY_EQ;
+			specialized = specialize_relation(dfw, &op, &field, &node1, &spec_op);
 			reg2 = gen_entity(dfw, node1, &jmp2);
 
 			/* Add test to see if the item matches */
-			gen_relation_regs(dfw, ANY_EQ, reg1, reg2);
+			if (specialized)
+				gen_specialized_relation_regs(dfw, spec_op, op, reg1, reg2);
+			else
+				gen_relation_regs(dfw, ANY_EQ, reg1, reg2);
 		}
 
 		/* Exit as soon as we find a match */
@@ -411,6 +662,138 @@ gen_entity(dfwork_t *dfw, stnode_t *st_arg, dfvm_value_t **p_jmp)
 	return reg;
 }
 
+/* Returns the first field with the name of the field that a "contains"
+ * test with a constant looks in, or NULL if it's not such a test. */
+static header_field_info *
+contains_test_field(stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	header_field_info *hfinfo;
+
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD ||
+			stnode_type_id(st_arg2) != STTYPE_FVALUE)
+		return NULL;
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+	return hfinfo;
+}
+
+/* Counts the "contains" tests with a constant on each field. */
+static void
+count_contains_tests(dfwork_t *dfw, stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	header_field_info *hfinfo;
+	guint		count;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_NOT:
+			count_contains_tests(dfw, st_arg1);
+			break;
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			count_contains_tests(dfw, st_arg1);
+			count_contains_tests(dfw, st_arg2);
+			break;
+
+		case TEST_OP_CONTAINS:
+			hfinfo = contains_test_field(st_arg1, st_arg2);
+			if (hfinfo) {
+				count = GPOINTER_TO_UINT(g_hash_table_lookup(dfw->contains_tests, hfinfo));
+				g_hash_table_insert(dfw->contains_tests, hfinfo,
+						GUINT_TO_POINTER(count + 1));
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* Returns the index of the matcher for the "contains" tests on the
+ * field, or -1 if its tests can't share one. */
+static int
+contains_matcher(dfwork_t *dfw, header_field_info *hfinfo)
+{
+	header_field_info *same_name;
+	df_contains_t	*c;
+	int		idx;
+
+	idx = GPOINTER_TO_INT(g_hash_table_lookup(dfw->contains_matchers, hfinfo));
+	if (idx != 0)
+		return idx - 1;
+
+	c = df_contains_new(hfinfo->type);
+	for (same_name = hfinfo; c != NULL && same_name != NULL;
+			same_name = same_name->same_name_next) {
+		if (!df_contains_accepts(c, same_name->type)) {
+			df_contains_free(c);
+			c = NULL;
+		}
+	}
+	if (c == NULL) {
+		idx = -1;
+	} else {
+		g_ptr_array_add(dfw->matchers, c);
+		idx = dfw->matchers->len - 1;
+	}
+	g_hash_table_insert(dfw->contains_matchers, hfinfo, GINT_TO_POINTER(idx + 1));
+	return idx;
+}
+
+/* Generates an ANY_CONTAINS_MULTI test, if the filter has other
+ * "contains" tests on the field that can be answered by the same scan of
+ * the field's values.  Returns FALSE if this isn't possible. */
+static gboolean
+gen_contains_multi(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	header_field_info *hfinfo;
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2, *val3;
+	dfvm_value_t	*jmp1 = NULL;
+	int		reg1, matcher, pattern;
+
+	if (!dfw->specialize)
+		return FALSE;
+
+	hfinfo = contains_test_field(st_arg1, st_arg2);
+	if (hfinfo == NULL ||
+			GPOINTER_TO_UINT(g_hash_table_lookup(dfw->contains_tests, hfinfo)) < 2)
+		return FALSE;
+
+	matcher = contains_matcher(dfw, hfinfo);
+	if (matcher < 0)
+		return FALSE;
+	pattern = df_contains_add((df_contains_t *)g_ptr_array_index(dfw->matchers, matcher),
+			(fvalue_t *)stnode_data(st_arg2));
+	if (pattern < 0)
+		return FALSE;
+
+	reg1 = gen_entity(dfw, st_arg1, &jmp1);
+
+	insn = dfvm_insn_new(ANY_CONTAINS_MULTI);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg1;
+	val2 = dfvm_value_new(INTEGER);
+	val2->value.numeric = matcher;
+	val3 = dfvm_value_new(INTEGER);
+	val3->value.numeric = pattern;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	insn->arg3 = val3;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp1) {
+		jmp1->value.numeric = dfw->next_insn_id;
+	}
+	return TRUE;
+}
 
 static void
 gen_test(dfwork_t *dfw, stnode_t *st_node)
@@ -511,7 +894,8 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_CONTAINS:
-			gen_relation(dfw, ANY_CONTAINS, st_arg1, st_arg2);
+			if (!gen_contains_multi(dfw, st_arg1, st_arg2))
+				gen_relation(dfw, ANY_CONTAINS, st_arg1, st_arg2);
 			break;
 
 		case TEST_OP_MATCHES:
@@ -552,9 +936,20 @@ dfw_gencode(dfwork_t *dfw)
 	dfw->consts = g_ptr_array_new();
 	dfw->loaded_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
 	dfw->interesting_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	if (dfw->specialize) {
+		dfw->contains_tests = g_hash_table_new(g_direct_hash, g_direct_equal);
+		dfw->contains_matchers = g_hash_table_new(g_direct_hash, g_direct_equal);
+		dfw->matchers = g_ptr_array_new_with_free_func((GDestroyNotify)df_contains_free);
+		count_contains_tests(dfw, dfw->st_root);
+	}
 	gencode(dfw, dfw->st_root);
 	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
 
+	if (dfw->matchers) {
+		for (id = 0; id < (int)dfw->matchers->len; id++)
+			df_contains_finish((df_contains_t *)g_ptr_array_index(dfw->matchers, id));
+	}
+
 	/* fixup goto */
 	length = dfw->insns->len;
 
@@ -0,0 +1,197 @@
+/* dissector_table_test.c
+ * Tests and a benchmark of the lookups in uint dissector tables
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/packet.h>
+#include <wiretap/wtap.h>
+
+/* Lookups per table in the benchmark; more with "-m perf". */
+#define BENCHMARK_LOOKUPS	1000000
+#define BENCHMARK_LOOKUPS_PERF	20000000
+
+static dissector_handle_t handle_a;
+static dissector_handle_t handle_b;
+
+static int
+dissect_dummy(tvbuff_t *tvb _U_, packet_info *pinfo _U_, proto_tree *tree _U_,
+	      void *data _U_)
+{
+	return 0;
+}
+
+static void
+check_table(const char *name, ftenum_t type, guint32 max_value)
+{
+	dissector_table_t table;
+	guint32 value;
+
+	table = register_dissector_table(name, name, -1, type, BASE_DEC);
+
+	/* Nothing is found in an empty table. */
+	g_assert(dissector_get_uint_handle(table, 0) == NULL);
+	g_assert(dissector_get_uint_handle(table, max_value) == NULL);
+
+	dissector_add_uint(name, 0, handle_a);
+	dissector_add_uint(name, 80, handle_a);
+	dissector_add_uint(name, max_value, handle_b);
+	g_assert(dissector_get_uint_handle(table, 0) == handle_a);
+	g_assert(dissector_get_uint_handle(table, 80) == handle_a);
+	g_assert(dissector_get_uint_handle(table, 81) == NULL);
+	g_assert(dissector_get_uint_handle(table, max_value) == handle_b);
+	g_assert(dissector_get_uint_handle(table, max_value - 1) == NULL);
+
+	/* Values wider than the table's type are still found. */
+	dissector_add_uint(name, max_value + 1, handle_b);
+	g_assert(dissector_get_uint_handle(table, max_value + 1) == handle_b);
+	g_assert(dissector_get_uint_handle(table, max_value + 2) == NULL);
+
+	/* "Decode As" of a value with and without an entry, and back. */
+	dissector_change_uint(name, 80, handle_b);
+	dissector_change_uint(name, 8080, handle_b);
+	g_assert(dissector_get_uint_handle(table, 80) == handle_b);
+	g_assert(dissector_get_uint_handle(table, 8080) == handle_b);
+	g_assert(dissector_get_default_uint_handle(name, 80) == handle_a);
+	dissector_reset_uint(name, 80);
+	dissector_reset_uint(name, 8080);
+	g_assert(dissector_get_uint_handle(table, 80) == handle_a);
+	g_assert(dissector_get_uint_handle(table, 8080) == NULL);
+
+	dissector_delete_uint(name, 80, handle_a);
+	g_assert(dissector_get_uint_handle(table, 80) == NULL);
+	g_assert(dissector_get_uint_handle(table, 0) == handle_a);
+
+	/* Every value of a small table. */
+	if (max_value <= G_MAXUINT16) {
+		for (value = 0; value <= max_value; value += 3)
+			dissector_add_uint(name, value, handle_b);
+		for (value = 0; value <= max_value; value++) {
+			if (value % 3 == 0)
+				g_assert(dissector_get_uint_handle(table, value) == handle_b);
+			else if (value != max_value)
+				g_assert(dissector_get_uint_handle(table, value) == NULL);
+		}
+	}
+}
+
+static void
+test_uint8(void)
+{
+	check_table("test.uint8", FT_UINT8, G_MAXUINT8);
+}
+
+static void
+test_uint16(void)
+{
+	check_table("test.uint16", FT_UINT16, G_MAXUINT16);
+}
+
+static void
+test_uint32(void)
+{
+	check_table("test.uint32", FT_UINT32, 0x10000);
+}
+
+/* Reports the time of a lookup in a table of dissectors registered by
+ * the real dissectors, over values that are and aren't in it. */
+static void
+benchmark_table(const char *name)
+{
+	dissector_table_t table = find_dissector_table(name);
+	guint lookups = g_test_perf() ? BENCHMARK_LOOKUPS_PERF : BENCHMARK_LOOKUPS;
+	guint found = 0;
+	guint i;
+	gint64 start, elapsed;
+
+	if (table == NULL) {
+		g_test_skip("table not registered");
+		return;
+	}
+
+	/* The first lookup after the registrations builds the table. */
+	dissector_get_uint_handle(table, 0);
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < lookups; i++) {
+		if (dissector_get_uint_handle(table, (i * 40503) & G_MAXUINT16) != NULL)
+			found++;
+	}
+	elapsed = g_get_monotonic_time() - start;
+
+	g_test_message("%s: %u lookups, %u found, %.1f ns per lookup",
+		       name, lookups, found, (double)elapsed * 1000 / lookups);
+	if (g_test_perf())
+		g_test_minimized_result((double)elapsed * 1000 / lookups,
+					"%s: ns per lookup", name);
+}
+
+static void
+benchmark_ethertype(void)
+{
+	benchmark_table("ethertype");
+}
+
+static void
+benchmark_tcp_port(void)
+{
+	benchmark_table("tcp.port");
+}
+
+static void
+benchmark_ip_proto(void)
+{
+	benchmark_table("ip.proto");
+}
+
+int
+main(int argc, char **argv)
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	wtap_init(FALSE);
+	if (!epan_init(NULL, NULL, FALSE))
+		return 2;
+
+	handle_a = create_dissector_handle(dissect_dummy, -1);
+	handle_b = create_dissector_handle(dissect_dummy, -1);
+
+	g_test_add_func("/dissector_table/uint/uint8", test_uint8);
+	g_test_add_func("/dissector_table/uint/uint16", test_uint16);
+	g_test_add_func("/dissector_table/uint/uint32", test_uint32);
+
+	g_test_add_func("/dissector_table/uint/benchmark/ethertype", benchmark_ethertype);
+	g_test_add_func("/dissector_table/uint/benchmark/tcp.port", benchmark_tcp_port);
+	g_test_add_func("/dissector_table/uint/benchmark/ip.proto", benchmark_ip_proto);
+
+	ret = g_test_run();
+
+	epan_cleanup();
+	wtap_cleanup();
+
+	return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
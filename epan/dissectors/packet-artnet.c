@@ -6754,6 +6754,7 @@ proto_register_artnet(void) {
 
 void
 proto_reg_handoff_artnet(void) {
+  static const guint8 artnet_id[] = { 'A', 'r', 't', '-', 'N', 'e', 't', '\0' };
   dissector_handle_t artnet_handle;
 
   artnet_handle   = create_dissector_handle(dissect_artnet, proto_artnet);
@@ -6762,6 +6763,7 @@ proto_reg_handoff_artnet(void) {
   dmx_chan_handle = find_dissector_add_dependency("dmx-chan", proto_artnet);
 
   heur_dissector_add("udp", dissect_artnet_heur, "ARTNET over UDP", "artnet_udp", proto_artnet, HEURISTIC_ENABLE);
+  heur_dissector_add_signature("udp", dissect_artnet_heur, proto_artnet, 0, artnet_id, NULL, sizeof artnet_id);
 }
 
 /*
@@ -52,7 +52,7 @@ static lbtru_transport_t * lbtru_transport_find(const address * source_address,
         {
             if (conv->setup_frame == 0)
             {
-                conv->setup_frame = frame;
+                conversation_set_setup_frame(conv, frame);
             }
             if (frame > conv->last_frame)
             {
@@ -83,7 +83,7 @@ lbtru_transport_t * lbtru_transport_add(const address * source_address, guint16
     {
         if (conv->setup_frame == 0)
         {
-            conv->setup_frame = frame;
+            conversation_set_setup_frame(conv, frame);
         }
         if (frame > conv->last_frame)
         {
@@ -171,8 +171,11 @@ void proto_register_pktgen(void)
 
 void proto_reg_handoff_pktgen(void)
 {
+    static const guint8 pktgen_magic[] = { 0xbe, 0x9b, 0xe9, 0x55 }; /* PKTGEN_MAGIC */
+
     /* Register as a heuristic UDP dissector */
     heur_dissector_add("udp", dissect_pktgen, "Linux Kernel Packet Generator over UDP", "pktgen_udp", proto_pktgen, HEURISTIC_ENABLE);
+    heur_dissector_add_signature("udp", dissect_pktgen, proto_pktgen, 0, pktgen_magic, NULL, sizeof pktgen_magic);
 }
 
 
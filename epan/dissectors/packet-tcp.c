@@ -8199,6 +8199,7 @@ proto_register_tcp(void)
     subdissector_table = register_dissector_table("tcp.port",
         "TCP port", proto_tcp, FT_UINT16, BASE_DEC);
     heur_subdissector_list = register_heur_dissector_list("tcp", proto_tcp);
+    heur_dissector_list_remember_misses(heur_subdissector_list, TRUE);
     tcp_option_table = register_dissector_table("tcp.option",
         "TCP Options", proto_tcp, FT_UINT8, BASE_DEC);
 
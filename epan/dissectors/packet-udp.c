@@ -1368,6 +1368,7 @@ proto_register_udp(void)
   udp_dissector_table = register_dissector_table("udp.port",
                                                  "UDP port", proto_udp, FT_UINT16, BASE_DEC);
   heur_subdissector_list = register_heur_dissector_list("udp", proto_udp);
+  heur_dissector_list_remember_misses(heur_subdissector_list, TRUE);
 
   register_capture_dissector_table("udp.port", "UDP");
 
@@ -542,7 +542,6 @@ epan_dissect_reset(epan_dissect_t *edt)
 
 	g_assert(edt);
 
-	g_slist_free(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
@@ -645,7 +644,6 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 
 	g_slist_foreach(epan_plugins, epan_plugin_dissect_cleanup, edt);
 
-	g_slist_free(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
@@ -682,6 +680,12 @@ epan_dissect_prime_with_dfilter(epan_dissect_t *edt, const dfilter_t* dfcode)
 	dfilter_prime_proto_tree(dfcode, edt->tree);
 }
 
+void
+epan_dissect_prime_with_dfilter_set(epan_dissect_t *edt, dfilter_set_t *dfset)
+{
+	dfilter_set_prime_proto_tree(dfset, edt->tree);
+}
+
 void
 epan_dissect_prime_with_hfid(epan_dissect_t *edt, int hfid)
 {
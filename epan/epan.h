@@ -32,6 +32,7 @@ extern gboolean wireshark_abort_on_dissector_bug;
 typedef struct epan_dissect epan_dissect_t;
 
 struct epan_dfilter;
+struct epan_dfilter_set;
 struct epan_column_info;
 
 /**
@@ -231,6 +232,11 @@ WS_DLL_PUBLIC
 void
 epan_dissect_prime_with_dfilter(epan_dissect_t *edt, const struct epan_dfilter *dfcode);
 
+/** Prime an epan_dissect_t's proto_tree using the fields/protocols used in a set of dfilters. */
+WS_DLL_PUBLIC
+void
+epan_dissect_prime_with_dfilter_set(epan_dissect_t *edt, struct epan_dfilter_set *dfset);
+
 /** Prime an epan_dissect_t's proto_tree with a field/protocol specified by its hfid */
 WS_DLL_PUBLIC
 void
@@ -19,6 +19,12 @@
 #include <epan/column-utils.h>
 #include <epan/timestamp.h>
 
+/*
+ * Few frames are ever time shifted, so how much they are is kept here,
+ * keyed by their frame_data, rather than in every frame_data.
+ */
+static GHashTable *shift_offsets;
+
 #define COMPARE_FRAME_NUM()     ((fdata1->num < fdata2->num) ? -1 : \
                                  (fdata1->num > fdata2->num) ? 1 : \
                                  0)
@@ -162,6 +168,8 @@ frame_data_init(frame_data *fdata, guint32 num, const wtap_rec *rec,
   fdata->dependent_of_displayed = 0;
   fdata->encoding = PACKET_CHAR_ENC_CHAR_ASCII;
   fdata->visited = 0;
+  fdata->other_data_src = 0;
+  fdata->has_shift_offset = 0;
   fdata->marked = 0;
   fdata->ref_time = 0;
   fdata->ignored = 0;
@@ -211,8 +219,6 @@ frame_data_init(frame_data *fdata, guint32 num, const wtap_rec *rec,
   fdata->has_user_comment = 0;
   fdata->need_colorize = 0;
   fdata->color_filter = NULL;
-  fdata->shift_offset.secs = 0;
-  fdata->shift_offset.nsecs = 0;
   fdata->frame_ref_num = 0;
   fdata->prev_dis_num = 0;
 }
@@ -267,24 +273,60 @@ frame_data_set_after_dissect(frame_data *fdata,
   }
 }
 
+void
+frame_data_get_shift_offset(const frame_data *fdata, nstime_t *shift_offset)
+{
+  const nstime_t *offset = NULL;
+
+  if (fdata->has_shift_offset && shift_offsets != NULL)
+    offset = (const nstime_t *)g_hash_table_lookup(shift_offsets, fdata);
+  if (offset != NULL)
+    *shift_offset = *offset;
+  else
+    nstime_set_zero(shift_offset);
+}
+
+void
+frame_data_set_shift_offset(frame_data *fdata, const nstime_t *shift_offset)
+{
+  nstime_t *offset;
+
+  if (nstime_is_zero(shift_offset)) {
+    if (fdata->has_shift_offset) {
+      g_hash_table_remove(shift_offsets, fdata);
+      fdata->has_shift_offset = 0;
+    }
+    return;
+  }
+
+  if (shift_offsets == NULL)
+    shift_offsets = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+  offset = g_new(nstime_t, 1);
+  *offset = *shift_offset;
+  g_hash_table_insert(shift_offsets, fdata, offset);
+  fdata->has_shift_offset = 1;
+}
+
 void
 frame_data_reset(frame_data *fdata)
 {
   fdata->visited = 0;
+  fdata->other_data_src = 0;
   fdata->subnum = 0;
 
-  if (fdata->pfd) {
-    g_slist_free(fdata->pfd);
-    fdata->pfd = NULL;
-  }
+  /* The per frame proto data is allocated from the file scope, so
+     there's nothing to free. */
+  fdata->pfd = NULL;
 }
 
 void
 frame_data_destroy(frame_data *fdata)
 {
-  if (fdata->pfd) {
-    g_slist_free(fdata->pfd);
-    fdata->pfd = NULL;
+  fdata->pfd = NULL;
+
+  if (fdata->has_shift_offset) {
+    g_hash_table_remove(shift_offsets, fdata);
+    fdata->has_shift_offset = 0;
   }
 }
 
@@ -51,15 +51,18 @@ typedef enum {
 
    There is one of these structures for every frame in the capture.
    That means a lot of memory if we have a lot of frames.
-   They are packed into power-of-2 chunks, so their size is effectively
-   rounded up to a power of 2.
-   Try to keep it close to, and less than or equal to, a power of 2.
-   "Smaller than a power of 2" is OK for ILP32 platforms.
+   They are stored in arrays of NODES_PER_LEVEL in frame_data_sequence.c,
+   so every byte counts; don't add fields, or padding, lightly.  The
+   time shift, which few frames have, is kept in a hash table in
+   frame_data.c rather than here (72 bytes on LP64 platforms).  The
+   frames are still stored whole, not as separate arrays per field, and
+   their timestamps and offsets aren't compressed.
 
    XXX - shuffle the fields to try to keep the most commonly-accessed
    fields within the first 16 or 32 bytes, so they all fit in a cache
    line? */
 struct _color_filter; /* Forward */
+struct _proto_data; /* Forward */
 DIAG_OFF_PEDANTIC
 typedef struct _frame_data {
   guint32      num;          /**< Frame number */
@@ -70,11 +73,14 @@ typedef struct _frame_data {
   /* These two are pointers, meaning 64-bit on LP64 (64-bit UN*X) and
      LLP64 (64-bit Windows) platforms.  Put them here, one after the
      other, so they don't require padding between them. */
-  GSList      *pfd;          /**< Per frame proto data */
+  struct _proto_data *pfd;   /**< Per frame proto data */
   const struct _color_filter *color_filter;  /**< Per-packet matching color_filter_t object */
+  nstime_t     abs_ts;       /**< Absolute timestamp */
+  guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
+  guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
   guint16      subnum;       /**< subframe number, for protocols that require this */
-  /* Keep the bitfields below to 16 bits, so this plus the previous field
-     are 32 bits. */
+  /* The bitfields below share the last 8 bytes with subnum, which
+     leaves room for a few more before the structure grows. */
   unsigned int passed_dfilter   : 1; /**< 1 = display, 0 = no display */
   unsigned int dependent_of_displayed : 1; /**< 1 if a displayed frame depends on this frame */
   /* Do NOT use packet_char_enc enum here: MSVC compiler does not handle an enum in a bit field properly */
@@ -88,10 +94,8 @@ typedef struct _frame_data {
   unsigned int has_user_comment : 1; /** 1 = user set (also deleted) comment for this packet */
   unsigned int need_colorize    : 1; /**< 1 = need to (re-)calculate packet color */
   unsigned int tsprec           : 4; /**< Time stamp precision -2^tsprec gives up to femtoseconds */
-  nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
-  guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
-  guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
+  unsigned int other_data_src   : 1; /**< 1 = dissection also read data that isn't in the frame (reassembled, decrypted, ...) */
+  unsigned int has_shift_offset : 1; /**< 1 = abs_ts has been shifted, see frame_data_get_shift_offset() */
 } frame_data;
 DIAG_ON_PEDANTIC
 
@@ -119,6 +123,20 @@ WS_DLL_PUBLIC void frame_data_set_before_dissect(frame_data *fdata,
 WS_DLL_PUBLIC void frame_data_set_after_dissect(frame_data *fdata,
                 guint32 *cum_bytes);
 
+/**
+ * Gets how much the abs_ts of the frame has been shifted (zero if it
+ * hasn't been).
+ */
+WS_DLL_PUBLIC void frame_data_get_shift_offset(const frame_data *fdata,
+                nstime_t *shift_offset);
+
+/**
+ * Sets how much the abs_ts of the frame has been shifted; doesn't
+ * change abs_ts.
+ */
+WS_DLL_PUBLIC void frame_data_set_shift_offset(frame_data *fdata,
+                const nstime_t *shift_offset);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -31,17 +31,20 @@
 
 #include "wmem/wmem.h"
 
+#include <epan/conversation.h>
 #include <epan/exceptions.h>
 #include <epan/reassemble.h>
 #include <epan/stream.h>
 #include <epan/expert.h>
 #include <epan/prefs.h>
+#include <epan/proto_data.h>
 #include <epan/range.h>
 
 #include <wsutil/str_util.h>
 #include <wsutil/ws_printf.h> /* ws_debug_printf */
 
 static gint proto_malformed = -1;
+static gint proto_heur_memo = -1;
 static dissector_handle_t frame_handle = NULL;
 static dissector_handle_t file_handle = NULL;
 static dissector_handle_t data_handle = NULL;
@@ -79,9 +82,22 @@ struct data_source {
  *
  * "protocol" is the protocol associated with the dissector table. Used
  * for determining dependencies.
+ *
+ * "uint_pages", for FT_UINT8 and FT_UINT16 tables, is a copy of the
+ * entries of "hash_table" indexed directly by value, in pages of
+ * UINT_PAGE_SIZE entries that are allocated as they are needed, so that
+ * looking a value up in them doesn't need hashing.  It's rebuilt from
+ * "hash_table" on the first lookup after "uint_pages_valid" has been
+ * cleared, which every change to the table does.
  */
+#define UINT_PAGE_SHIFT	8
+#define UINT_PAGE_SIZE	(1 << UINT_PAGE_SHIFT)
+#define UINT_NUM_PAGES	((G_MAXUINT16 >> UINT_PAGE_SHIFT) + 1)
+
 struct dissector_table {
 	GHashTable	*hash_table;
+	dtbl_entry_t	***uint_pages;
+	gboolean	uint_pages_valid;
 	GSList		*dissector_handles;
 	const char	*ui_name;
 	ftenum_t	type;
@@ -157,8 +173,54 @@ destroy_depend_dissector_list(void *data)
 struct heur_dissector_list {
 	protocol_t	*protocol;
 	GSList		*dissectors;
+	guint		memo_key;	/* of its heur_memo_t in a conversation */
+	gboolean	remember_misses;
 };
 
+/*
+ * A byte pattern that every packet a heuristic dissector accepts has;
+ * "value" has already been masked.
+ */
+typedef struct {
+	guint	offset;
+	guint	length;
+	guint8	value[HEUR_SIGNATURE_MAX_LENGTH];
+	guint8	mask[HEUR_SIGNATURE_MAX_LENGTH];
+} heur_signature_t;
+
+/*
+ * What the dissectors of a heuristic list did with the earlier packets
+ * of a conversation: the last one that accepted a packet is tried first,
+ * and, if the list remembers misses, after HEUR_MEMO_MAX_MISSES frames
+ * in a row that none of them accepted, they aren't tried for the rest
+ * of the conversation.
+ *
+ * It's only updated on the first pass, and "none_from" is the number of
+ * the first frame that wasn't tried, so that later passes do the same.
+ * The one that accepted a frame is also kept with the frame, keyed by
+ * the layer the list was tried at, and later passes try it first rather
+ * than "winner", which by then is the last one of the first pass.
+ */
+typedef struct {
+	heur_dtbl_entry_t	*winner;
+	guint32			misses;
+	guint32			last_miss;	/* frame of the last miss */
+	guint32			none_from;	/* 0 if they're still tried */
+} heur_memo_t;
+
+#define HEUR_MEMO_MAX_MISSES	16
+
+/*
+ * The memos of a conversation are kept in a map, its conversation data
+ * for the "_ws.heur_memo" pseudo-protocol, keyed by the list's memo_key.
+ * The winner for a frame is kept in its proto data for that protocol,
+ * keyed by HEUR_MEMO_FRAME_KEY.
+ */
+static guint next_heur_memo_key = 0;
+
+#define HEUR_MEMO_FRAME_KEY(sub_dissectors, layer_num) \
+	(((sub_dissectors)->memo_key << 8) | (layer_num))
+
 static GHashTable *heur_dissector_lists = NULL;
 
 /* Name hashtables for fast detection of duplicate names */
@@ -170,6 +232,8 @@ destroy_heuristic_dissector_entry(gpointer data)
 	heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)data;
 	g_free(hdtbl_entry->list_name);
 	g_free(hdtbl_entry->short_name);
+	if (hdtbl_entry->signatures != NULL)
+		g_array_free(hdtbl_entry->signatures, TRUE);
 	g_slice_free(heur_dtbl_entry_t, data);
 }
 
@@ -189,6 +253,13 @@ destroy_dissector_table(void *data)
 	struct dissector_table *table = (struct dissector_table *)data;
 
 	g_hash_table_destroy(table->hash_table);
+	if (table->uint_pages != NULL) {
+		guint i;
+
+		for (i = 0; i < UINT_NUM_PAGES; i++)
+			g_free(table->uint_pages[i]);
+		g_free(table->uint_pages);
+	}
 	g_slist_free(table->dissector_handles);
 	g_slice_free(struct dissector_table, data);
 }
@@ -228,6 +299,12 @@ packet_cache_proto_handles(void)
 
 	proto_malformed = proto_get_id_by_filter_name("_ws.malformed");
 	g_assert(proto_malformed != -1);
+
+	/* What the heuristic lists did with a conversation isn't a protocol,
+	   but it's kept with the conversation and the frames as if it were. */
+	proto_heur_memo = proto_register_protocol("Heuristic Dissector Memo",
+	    "Heuristic memo", "_ws.heur_memo");
+	proto_set_cant_toggle(proto_heur_memo);
 }
 
 /* List of routines that are called before we make a pass through a capture file
@@ -603,6 +680,10 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 	}
 	ENDTRY;
 
+	/* Note whether any fields came from data other than the frame's. */
+	if (edt->pi.data_src && edt->pi.data_src->next)
+		fd->other_data_src = 1;
+
 	fd->visited = 1;
 }
 
@@ -969,10 +1050,52 @@ find_dissector_table(const char *name)
 	return dissector_table;
 }
 
+static void
+uint_pages_add_entry(gpointer key, gpointer value, gpointer user_data)
+{
+	dissector_table_t  sub_dissectors = (dissector_table_t)user_data;
+	guint32            pattern = GPOINTER_TO_UINT(key);
+	dtbl_entry_t     **page;
+
+	/* Values that don't fit are still looked up in the hash table. */
+	if (pattern > G_MAXUINT16)
+		return;
+
+	page = sub_dissectors->uint_pages[pattern >> UINT_PAGE_SHIFT];
+	if (page == NULL) {
+		page = g_new0(dtbl_entry_t *, UINT_PAGE_SIZE);
+		sub_dissectors->uint_pages[pattern >> UINT_PAGE_SHIFT] = page;
+	}
+	page[pattern & (UINT_PAGE_SIZE - 1)] = (dtbl_entry_t *)value;
+}
+
+/* Rebuild the direct-indexed copy of a uint dissector table. */
+static void
+uint_pages_rebuild(dissector_table_t sub_dissectors)
+{
+	guint i;
+
+	for (i = 0; i < UINT_NUM_PAGES; i++) {
+		if (sub_dissectors->uint_pages[i] != NULL)
+			memset(sub_dissectors->uint_pages[i], 0, UINT_PAGE_SIZE * sizeof(dtbl_entry_t *));
+	}
+	g_hash_table_foreach(sub_dissectors->hash_table, uint_pages_add_entry, sub_dissectors);
+	sub_dissectors->uint_pages_valid = TRUE;
+}
+
 /* Find an entry in a uint dissector table. */
 static dtbl_entry_t *
 find_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern)
 {
+	if (sub_dissectors->uint_pages != NULL && pattern <= G_MAXUINT16) {
+		dtbl_entry_t **page;
+
+		if (!sub_dissectors->uint_pages_valid)
+			uint_pages_rebuild(sub_dissectors);
+		page = sub_dissectors->uint_pages[pattern >> UINT_PAGE_SHIFT];
+		return page != NULL ? page[pattern & (UINT_PAGE_SIZE - 1)] : NULL;
+	}
+
 	switch (sub_dissectors->type) {
 
 	case FT_UINT8:
@@ -1081,6 +1204,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 	/* do the table insertion */
 	g_hash_table_insert(sub_dissectors->hash_table,
 			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	sub_dissectors->uint_pages_valid = FALSE;
 
 	/*
 	 * Now, if this table supports "Decode As", add this handle
@@ -1242,6 +1366,7 @@ dissector_delete_uint(const char *name, const guint32 pattern,
 		 */
 		g_hash_table_remove(sub_dissectors->hash_table,
 				    GUINT_TO_POINTER(pattern));
+		sub_dissectors->uint_pages_valid = FALSE;
 	}
 }
 
@@ -1283,6 +1408,7 @@ void dissector_delete_all(const char *name, dissector_handle_t handle)
 	g_assert (sub_dissectors);
 
 	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, handle);
+	sub_dissectors->uint_pages_valid = FALSE;
 }
 
 static void
@@ -1292,6 +1418,7 @@ dissector_delete_from_table(gpointer key _U_, gpointer value, gpointer user_data
 	g_assert (sub_dissectors);
 
 	g_hash_table_foreach_remove(sub_dissectors->hash_table, dissector_delete_all_check, user_data);
+	sub_dissectors->uint_pages_valid = FALSE;
 	sub_dissectors->dissector_handles = g_slist_remove(sub_dissectors->dissector_handles, user_data);
 }
 
@@ -1337,6 +1464,7 @@ dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_
 	/* do the table insertion */
 	g_hash_table_insert(sub_dissectors->hash_table,
 			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	sub_dissectors->uint_pages_valid = FALSE;
 }
 
 /* Reset an entry in a uint dissector table to its initial value. */
@@ -1365,6 +1493,7 @@ dissector_reset_uint(const char *name, const guint32 pattern)
 	} else {
 		g_hash_table_remove(sub_dissectors->hash_table,
 				    GUINT_TO_POINTER(pattern));
+		sub_dissectors->uint_pages_valid = FALSE;
 	}
 }
 
@@ -2450,10 +2579,17 @@ register_dissector_table(const char *name, const char *ui_name, const int proto,
 	/* Create and register the dissector table for this name; returns */
 	/* a pointer to the dissector table. */
 	sub_dissectors = g_slice_new(struct dissector_table);
+	sub_dissectors->uint_pages = NULL;
+	sub_dissectors->uint_pages_valid = FALSE;
 	switch (type) {
 
 	case FT_UINT8:
 	case FT_UINT16:
+		/*
+		 * Small enough to also be looked up directly by value.
+		 */
+		sub_dissectors->uint_pages = g_new0(dtbl_entry_t **, UINT_NUM_PAGES);
+		/* FALL THROUGH */
 	case FT_UINT24:
 	case FT_UINT32:
 		/*
@@ -2522,6 +2658,8 @@ dissector_table_t register_custom_dissector_table(const char *name,
 	/* Create and register the dissector table for this name; returns */
 	/* a pointer to the dissector table. */
 	sub_dissectors = g_slice_new(struct dissector_table);
+	sub_dissectors->uint_pages = NULL;
+	sub_dissectors->uint_pages_valid = FALSE;
 	sub_dissectors->hash_func = hash_func;
 	sub_dissectors->hash_table = g_hash_table_new_full(hash_func,
 							       key_equal_func,
@@ -2701,6 +2839,7 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->short_name = g_strdup(internal_name);
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
+	hdtbl_entry->signatures = NULL;
 
 	/* do the table insertion */
 	g_hash_table_insert(heuristic_short_names, (gpointer)hdtbl_entry->short_name, hdtbl_entry);
@@ -2749,12 +2888,154 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 		g_free(found_hdtbl_entry->list_name);
 		g_hash_table_remove(heuristic_short_names, found_hdtbl_entry->short_name);
 		g_free(found_hdtbl_entry->short_name);
+		if (found_hdtbl_entry->signatures != NULL)
+			g_array_free(found_hdtbl_entry->signatures, TRUE);
 		g_slice_free(heur_dtbl_entry_t, found_entry->data);
 		sub_dissectors->dissectors = g_slist_delete_link(sub_dissectors->dissectors,
 		    found_entry);
 	}
 }
 
+void
+heur_dissector_add_signature(const char *name, heur_dissector_t dissector, const int proto,
+			     const guint offset, const guint8 *value, const guint8 *mask,
+			     const guint length)
+{
+	heur_dissector_list_t  sub_dissectors = find_heur_dissector_list(name);
+	heur_dtbl_entry_t      hdtbl_entry;
+	heur_dtbl_entry_t     *found_hdtbl_entry;
+	GSList                *found_entry;
+	heur_signature_t       signature;
+	guint                  i;
+
+	/* sanity check */
+	g_assert(sub_dissectors != NULL);
+	g_assert(length > 0 && length <= HEUR_SIGNATURE_MAX_LENGTH);
+
+	hdtbl_entry.dissector = dissector;
+	hdtbl_entry.protocol  = find_protocol_by_id(proto);
+
+	found_entry = g_slist_find_custom(sub_dissectors->dissectors,
+	    (gpointer) &hdtbl_entry, find_matching_heur_dissector);
+	if (found_entry == NULL) {
+		fprintf(stderr, "OOPS: signature for a heuristic dissector of %s that isn't in \"%s\"\n",
+		    proto_get_protocol_short_name(hdtbl_entry.protocol), name);
+		if (wireshark_abort_on_dissector_bug)
+			abort();
+		return;
+	}
+	found_hdtbl_entry = (heur_dtbl_entry_t *)found_entry->data;
+
+	memset(&signature, 0, sizeof signature);
+	signature.offset = offset;
+	signature.length = length;
+	for (i = 0; i < length; i++) {
+		signature.mask[i] = mask != NULL ? mask[i] : 0xFF;
+		signature.value[i] = value[i] & signature.mask[i];
+	}
+
+	if (found_hdtbl_entry->signatures == NULL)
+		found_hdtbl_entry->signatures = g_array_new(FALSE, FALSE, sizeof(heur_signature_t));
+	g_array_append_val(found_hdtbl_entry->signatures, signature);
+}
+
+/* Returns TRUE if the packet has one of the signatures of a heuristic
+ * dissector, or if it has none. */
+static gboolean
+heur_signatures_match(const heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb)
+{
+	const heur_signature_t *signature;
+	const guint8           *p;
+	guint                   i, j;
+
+	if (hdtbl_entry->signatures == NULL)
+		return TRUE;
+
+	for (i = 0; i < hdtbl_entry->signatures->len; i++) {
+		signature = &g_array_index(hdtbl_entry->signatures, heur_signature_t, i);
+		if (!tvb_bytes_exist(tvb, signature->offset, signature->length))
+			continue;
+		p = tvb_get_ptr(tvb, signature->offset, signature->length);
+		for (j = 0; j < signature->length; j++) {
+			if ((p[j] & signature->mask[j]) != signature->value[j])
+				break;
+		}
+		if (j == signature->length)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Calls one heuristic dissector, if it's enabled and the packet has one
+ * of its signatures, and returns what it returned (or 0). */
+static int
+try_heur_dtbl_entry(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+		    packet_info *pinfo, proto_tree *tree, void *data,
+		    guint16 saved_can_desegment, guint saved_layers_len,
+		    guint saved_tree_count)
+{
+	int proto_id;
+	int len;
+
+	/* XXX - why set this now and above? */
+	pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+
+	if (hdtbl_entry->protocol != NULL &&
+		(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
+		/*
+		 * No - don't try this dissector.
+		 */
+		return 0;
+	}
+
+	if (!heur_signatures_match(hdtbl_entry, tvb)) {
+		/*
+		 * It can't accept this packet.
+		 */
+		return 0;
+	}
+
+	if (hdtbl_entry->protocol != NULL) {
+		proto_id = proto_get_id(hdtbl_entry->protocol);
+		/* do NOT change this behavior - wslua uses the protocol short name set here in order
+		   to determine which Lua-based heurisitc dissector to call */
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		pinfo->curr_layer_num++;
+		wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	}
+
+	pinfo->heur_list_name = hdtbl_entry->list_name;
+
+	len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+	if (hdtbl_entry->protocol != NULL &&
+		(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
+		/*
+		 * We added a protocol layer above. The dissector
+		 * didn't accept the packet or it didn't add any
+		 * items to the tree so remove it from the list.
+		 */
+		while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+			if (len == 0) {
+				/*
+				 * Only reduce the layer number if the dissector
+				 * rejected the data. Since tree can be NULL on
+				 * the first pass, we cannot check it or it will
+				 * break dissectors that rely on a stable value.
+				 */
+				pinfo->curr_layer_num--;
+			}
+			wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+		}
+	}
+	return len;
+}
+
 gboolean
 dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **heur_dtbl_entry, void *data)
@@ -2767,7 +3048,12 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	guint16            saved_can_desegment;
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
-	int                proto_id;
+	conversation_t    *conv;
+	wmem_map_t        *memos = NULL;
+	heur_memo_t       *memo = NULL;
+	heur_dtbl_entry_t *first = NULL;
+	guint32            layer_num = pinfo->curr_layer_num;
+	gboolean           skip_misses;
 	int                len;
 	guint              saved_tree_count = tree ? tree->tree_data->count : 0;
 
@@ -2793,58 +3079,71 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 	DISSECTOR_ASSERT(saved_layers_len < PINFO_LAYER_MAX_RECURSION_DEPTH);
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
-	    entry = g_slist_next(entry)) {
-		/* XXX - why set this now and above? */
-		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
-		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
-
-		if (hdtbl_entry->protocol != NULL &&
-			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
-			/*
-			 * No - don't try this dissector.
-			 */
-			continue;
+	/*
+	 * See what the dissectors did with the earlier packets of this
+	 * conversation, if there is one and it can make a difference.
+	 */
+	skip_misses = sub_dissectors->remember_misses && prefs.skip_heuristics_after_misses;
+	if (skip_misses ||
+	    (sub_dissectors->dissectors != NULL && sub_dissectors->dissectors->next != NULL))
+		conv = find_conversation_pinfo(pinfo, 0);
+	else
+		conv = NULL;
+	if (conv != NULL) {
+		memos = (wmem_map_t *)conversation_get_proto_data(conv, proto_heur_memo);
+		if (memos == NULL && !PINFO_FD_VISITED(pinfo)) {
+			memos = wmem_map_new(wmem_file_scope(), g_direct_hash, g_direct_equal);
+			conversation_add_proto_data(conv, proto_heur_memo, memos);
+		}
+		if (memos != NULL)
+			memo = (heur_memo_t *)wmem_map_lookup(memos, GUINT_TO_POINTER(sub_dissectors->memo_key));
+		if (memo == NULL && !PINFO_FD_VISITED(pinfo)) {
+			memo = wmem_new0(wmem_file_scope(), heur_memo_t);
+			wmem_map_insert(memos, GUINT_TO_POINTER(sub_dissectors->memo_key), memo);
 		}
+	}
 
-		if (hdtbl_entry->protocol != NULL) {
-			proto_id = proto_get_id(hdtbl_entry->protocol);
-			/* do NOT change this behavior - wslua uses the protocol short name set here in order
-			   to determine which Lua-based heurisitc dissector to call */
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
+	if (memo != NULL && skip_misses && memo->none_from != 0 && pinfo->num >= memo->none_from) {
+		/*
+		 * None of them has accepted a packet of this conversation
+		 * for a while; don't try them.
+		 */
+		pinfo->can_desegment = saved_can_desegment;
+		return FALSE;
+	}
 
-			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
-			 */
-			pinfo->curr_layer_num++;
-			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	if (memo != NULL) {
+		/*
+		 * Try the one that accepted the last packet first, or, if
+		 * we've seen this frame, the one that accepted it.
+		 */
+		if (PINFO_FD_VISITED(pinfo))
+			first = (heur_dtbl_entry_t *)p_get_proto_data(wmem_file_scope(), pinfo,
+			    proto_heur_memo, HEUR_MEMO_FRAME_KEY(sub_dissectors, layer_num));
+		else
+			first = memo->winner;
+	}
+	if (first != NULL) {
+		len = try_heur_dtbl_entry(first, tvb, pinfo, tree, data,
+		    saved_can_desegment, saved_layers_len, saved_tree_count);
+		if (len) {
+			*heur_dtbl_entry = first;
+			status = TRUE;
 		}
+	}
 
-		pinfo->heur_list_name = hdtbl_entry->list_name;
+	for (entry = sub_dissectors->dissectors; entry != NULL && !status;
+	    entry = g_slist_next(entry)) {
+		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
 
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
-		if (hdtbl_entry->protocol != NULL &&
-			(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
-			/*
-			 * We added a protocol layer above. The dissector
-			 * didn't accept the packet or it didn't add any
-			 * items to the tree so remove it from the list.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				if (len == 0) {
-					/*
-					 * Only reduce the layer number if the dissector
-					 * rejected the data. Since tree can be NULL on
-					 * the first pass, we cannot check it or it will
-					 * break dissectors that rely on a stable value.
-					 */
-					pinfo->curr_layer_num--;
-				}
-				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
-			}
+		if (hdtbl_entry == first) {
+			/* Already tried. */
+			prev_entry = entry;
+			continue;
 		}
+
+		len = try_heur_dtbl_entry(hdtbl_entry, tvb, pinfo, tree, data,
+		    saved_can_desegment, saved_layers_len, saved_tree_count);
 		if (len) {
 			*heur_dtbl_entry = hdtbl_entry;
 
@@ -2859,6 +3158,27 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 		prev_entry = entry;
 	}
 
+	if (memo != NULL && !PINFO_FD_VISITED(pinfo)) {
+		if (status) {
+			memo->winner = *heur_dtbl_entry;
+			memo->misses = 0;
+			/*
+			 * If the list is tried more than once at the same
+			 * layer of a frame, e.g. for several PDUs in a TCP
+			 * segment, keep the first; it's only tried first.
+			 */
+			if (p_get_proto_data(wmem_file_scope(), pinfo, proto_heur_memo,
+			    HEUR_MEMO_FRAME_KEY(sub_dissectors, layer_num)) == NULL)
+				p_add_proto_data(wmem_file_scope(), pinfo, proto_heur_memo,
+				    HEUR_MEMO_FRAME_KEY(sub_dissectors, layer_num), memo->winner);
+		} else if (skip_misses && memo->last_miss != pinfo->num) {
+			/* Count a frame once, even if it's tried several times. */
+			memo->last_miss = pinfo->num;
+			if (++memo->misses >= HEUR_MEMO_MAX_MISSES)
+				memo->none_from = pinfo->num + 1;
+		}
+	}
+
 	pinfo->current_proto = saved_curr_proto;
 	pinfo->heur_list_name = saved_heur_list_name;
 	pinfo->can_desegment = saved_can_desegment;
@@ -3013,11 +3333,19 @@ register_heur_dissector_list(const char *name, const int proto)
 	sub_dissectors = g_slice_new(struct heur_dissector_list);
 	sub_dissectors->protocol  = find_protocol_by_id(proto);
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->memo_key = next_heur_memo_key++;
+	sub_dissectors->remember_misses = FALSE;
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
 	return sub_dissectors;
 }
 
+void
+heur_dissector_list_remember_misses(heur_dissector_list_t sub_dissectors, gboolean remember)
+{
+	sub_dissectors->remember_misses = remember;
+}
+
 /*
  * Register dissectors by name; used if one dissector always calls a
  * particular dissector, or if it bases the decision of which dissector
@@ -439,6 +439,7 @@ typedef struct heur_dtbl_entry {
 	const gchar *display_name;     /* the string used to present heuristic to user */
 	gchar *short_name;     /* string used for "internal" use to uniquely identify heuristic */
 	gboolean enabled;
+	GArray *signatures;   /* byte patterns one of which a packet must have, or NULL */
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
@@ -449,6 +450,18 @@ typedef struct heur_dtbl_entry {
  */
 WS_DLL_PUBLIC heur_dissector_list_t register_heur_dissector_list(const char *name, const int proto);
 
+/** Stop trying the dissectors of a heuristic list on the packets of a
+ *  conversation once none of them has accepted a packet of it for a while.
+ *  Meant for the lists of transport protocols, whose conversations don't
+ *  usually change protocol. It only takes effect if the
+ *  "protocols.skip_heuristics_after_misses" preference is on, which it
+ *  isn't by default; otherwise the dissectors are always tried.
+ *
+ * @param sub_dissectors the heuristic dissector list
+ * @param remember TRUE to stop trying them
+ */
+WS_DLL_PUBLIC void heur_dissector_list_remember_misses(heur_dissector_list_t sub_dissectors, gboolean remember);
+
 typedef void (*DATFunc_heur) (const gchar *table_name,
     struct heur_dtbl_entry *entry, gpointer user_data);
 typedef void (*DATFunc_heur_table) (const char *table_name,
@@ -531,6 +544,26 @@ WS_DLL_PUBLIC void heur_dissector_add(const char *name, heur_dissector_t dissect
  */
 WS_DLL_PUBLIC void heur_dissector_delete(const char *name, heur_dissector_t dissector, const int proto);
 
+#define HEUR_SIGNATURE_MAX_LENGTH 8
+
+/** Add a signature to a sub-dissector in a heuristic dissector list: bytes
+ *  that every packet it accepts has at a given offset.  Once it has
+ *  signatures, it's only called for packets that have one of them.
+ *  Call this in the proto_handoff function of the sub-dissector, after
+ *  heur_dissector_add().
+ *
+ * @param name the name of the heuristic dissector table, e.g. "udp"
+ * @param dissector the sub-dissector
+ * @param proto the protocol id of the sub-dissector
+ * @param offset the offset of the bytes in the tvbuff
+ * @param value the bytes
+ * @param mask the bits of the bytes to compare, or NULL to compare all of them
+ * @param length the number of bytes, at most HEUR_SIGNATURE_MAX_LENGTH
+ */
+WS_DLL_PUBLIC void heur_dissector_add_signature(const char *name, heur_dissector_t dissector,
+    const int proto, const guint offset, const guint8 *value, const guint8 *mask,
+    const guint length);
+
 /** Register a new dissector. */
 WS_DLL_PUBLIC dissector_handle_t register_dissector(const char *name, dissector_t dissector, const int proto);
 
@@ -141,7 +141,7 @@ typedef struct _packet_info {
 
   int link_dir;                 /**< 3GPP messages are sometime different UP link(UL) or Downlink(DL) */
 
-  GSList* proto_data;          /**< Per packet proto data */
+  struct _proto_data *proto_data; /**< Per packet proto data */
 
   GSList* dependent_frames;     /**< A list of frames which this one depends on */
 
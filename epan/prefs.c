@@ -3439,6 +3439,23 @@ prefs_register_modules(void)
                                    "Enable Packet Editor (Experimental)",
                                    &prefs.gui_packet_editor);
 
+    prefs_register_bool_preference(gui_module, "fast_seek_index.enabled",
+                                   "Save fast-seek indexes for compressed files",
+                                   "After reading a compressed capture file, save the information "
+                                   "needed to seek quickly in it to a .wsidx file next to it, and "
+                                   "use that file when the capture file is opened again.  For pcap "
+                                   "and pcapng files, a packet index is saved and used as well, so "
+                                   "that the file isn't decompressed again when it's reopened",
+                                   &prefs.gui_fast_seek_index);
+
+    prefs_register_bool_preference(gui_module, "packet_index.enabled",
+                                   "Save packet indexes for capture files",
+                                   "After reading a pcap or pcapng file, save the location, length "
+                                   "and time stamp of each packet to a .wspidx file next to it, and "
+                                   "use that file when the capture file is opened again, instead "
+                                   "of reading and dissecting the whole file first",
+                                   &prefs.gui_packet_index);
+
     prefs_register_enum_preference(gui_module, "packet_list_elide_mode",
                        "Elide mode",
                        "The position of \"...\" in packet list text.",
@@ -3740,6 +3757,13 @@ prefs_register_modules(void)
                                    "Currently only ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_bool_preference(protocols_module, "skip_heuristics_after_misses",
+                                   "Stop trying heuristic dissectors on unrecognized conversations",
+                                   "Stop trying the heuristic dissectors of TCP and UDP on a conversation after 16 packets "
+                                   "in a row of it that none of them recognized. Faster, but a conversation that only "
+                                   "starts a recognizable protocol later is then left undissected.",
+                                   &prefs.skip_heuristics_after_misses);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -4185,6 +4209,8 @@ pre_init_prefs(void)
     prefs.gui_layout_content_2       = layout_pane_content_pdetails;
     prefs.gui_layout_content_3       = layout_pane_content_pbytes;
     prefs.gui_packet_editor          = FALSE;
+    prefs.gui_fast_seek_index        = FALSE;
+    prefs.gui_packet_index           = FALSE;
     prefs.gui_packet_list_elide_mode = ELIDE_RIGHT;
     prefs.gui_packet_list_show_related = TRUE;
     prefs.gui_packet_list_show_minimap = TRUE;
@@ -4252,6 +4278,7 @@ pre_init_prefs(void)
     prefs.st_sort_showfullname = FALSE;
     prefs.display_hidden_proto_items = FALSE;
     prefs.display_byte_fields_with_spaces = FALSE;
+    prefs.skip_heuristics_after_misses = FALSE;
 }
 
 /*
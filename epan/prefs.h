@@ -209,6 +209,7 @@ typedef struct _e_prefs {
   gboolean     enable_incomplete_dissectors_check;
   gboolean     incomplete_dissectors_check_debug;
   gboolean     strict_conversation_tracking_heuristics;
+  gboolean     skip_heuristics_after_misses;
   gboolean     filter_expressions_old;  /* TRUE if old filter expressions preferences were loaded. */
   gboolean     gui_update_enabled;
   software_update_channel_e gui_update_channel;
@@ -221,6 +222,8 @@ typedef struct _e_prefs {
   gboolean     gui_qt_show_selected_packet;
   gboolean     gui_qt_show_file_load_time;
   gboolean     gui_packet_editor; /* Enable Packet Editor */
+  gboolean     gui_fast_seek_index; /* Save and load fast-seek indexes for compressed files */
+  gboolean     gui_packet_index; /* Save and load packet indexes, to open files without dissecting them */
   elide_mode_e gui_packet_list_elide_mode;
   gboolean     gui_packet_list_show_related;
   gboolean     gui_packet_list_show_minimap;
@@ -79,6 +79,7 @@ struct _output_fields {
     GPtrArray    *fields;
     GHashTable   *field_indicies;
     GPtrArray   **field_values;
+    GArray       *field_hfids;  /* int: hfid of each field, -1 for a column */
     gchar         quote;
     gboolean      includes_col_fields;
 };
@@ -2096,6 +2097,10 @@ void output_fields_free(output_fields_t* fields)
             g_free(fields->field_values);
         }
 
+        if (NULL != fields->field_hfids) {
+            g_array_free(fields->field_hfids, TRUE);
+        }
+
         for (i = 0; i < fields->fields->len; ++i) {
             gchar* field = (gchar *)g_ptr_array_index(fields->fields,i);
             g_free(field);
@@ -2291,6 +2296,69 @@ gboolean output_fields_has_cols(output_fields_t* fields)
     return fields->includes_col_fields;
 }
 
+gboolean output_fields_can_extract_flat(output_fields_t* fields)
+{
+    GArray *hfids;
+    gsize   i;
+
+    g_assert(fields);
+
+    if (NULL != fields->field_hfids)
+        return TRUE;
+    if (NULL == fields->fields)
+        return FALSE;
+
+    hfids = g_array_sized_new(FALSE, FALSE, sizeof(int), fields->fields->len);
+    for (i = 0; i < fields->fields->len; i++) {
+        gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+        header_field_info *hfinfo;
+        int hfid = -1;
+
+        if (strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)) != 0) {
+            hfinfo = proto_registrar_get_byname(field);
+            /*
+             * The value of a protocol or of a text item is its label,
+             * which isn't generated without a visible tree; and only
+             * the field with this abbreviation would be primed, not
+             * others sharing it.
+             */
+            if (hfinfo == NULL || hfinfo->type == FT_PROTOCOL ||
+                hfinfo->id == hf_text_only ||
+                hfinfo->same_name_prev_id != -1 || hfinfo->same_name_next != NULL) {
+                g_array_free(hfids, TRUE);
+                return FALSE;
+            }
+            hfid = hfinfo->id;
+        }
+        g_array_append_val(hfids, hfid);
+    }
+
+    fields->field_hfids = hfids;
+    return TRUE;
+}
+
+void output_fields_prime_edt(output_fields_t* fields, epan_dissect_t *edt)
+{
+    guint i;
+
+    g_assert(fields);
+    g_assert(fields->field_hfids);
+
+    /*
+     * Items that aren't primed are faked, and anything added under them
+     * goes to their closest real ancestor; keep the protocols, so that
+     * the items of encapsulated protocols stay in tree order.
+     */
+    epan_dissect_fake_protocols(edt, FALSE);
+
+    for (i = 0; i < fields->field_hfids->len; i++) {
+        int hfid = g_array_index(fields->field_hfids, int, i);
+
+        if (hfid != -1)
+            epan_dissect_prime_with_hfid(edt, hfid);
+    }
+}
+
 void write_fields_preamble(output_fields_t* fields, FILE *fh)
 {
     gsize i;
@@ -2454,6 +2522,10 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
     if (NULL == fields->field_values)
         fields->field_values = g_new0(GPtrArray*, fields->fields->len);  /* free'd in output_fields_free() */
 
+    /*
+     * If the tree was primed with output_fields_prime_edt(), it only holds
+     * the protocols and the items of the fields, so this walk is short.
+     */
     proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
                                 &data);
 
@@ -2731,6 +2803,7 @@ output_fields_t* output_fields_new(void)
     fields->fields              = NULL; /*Do lazy initialisation */
     fields->field_indicies      = NULL;
     fields->field_values        = NULL;
+    fields->field_hfids         = NULL;
     fields->quote               ='\0';
     fields->includes_col_fields = FALSE;
     return fields;
@@ -70,6 +70,14 @@ WS_DLL_PUBLIC gsize output_fields_num_fields(output_fields_t* info);
 WS_DLL_PUBLIC gboolean output_fields_set_option(output_fields_t* info, gchar* option);
 WS_DLL_PUBLIC void output_fields_list_options(FILE *fh);
 WS_DLL_PUBLIC gboolean output_fields_has_cols(output_fields_t* info);
+/** Returns TRUE if the values of all the fields can be written from a
+ *  dissection whose protocol tree isn't visible, as long as it has been
+ *  primed with output_fields_prime_edt(); then only the items of those
+ *  fields are built, rather than the whole tree and its labels. */
+WS_DLL_PUBLIC gboolean output_fields_can_extract_flat(output_fields_t* info);
+/** Primes the epan_dissect_t with the fields; see
+ *  output_fields_can_extract_flat(). */
+WS_DLL_PUBLIC void output_fields_prime_edt(output_fields_t* info, epan_dissect_t *edt);
 
 /*
  * Higher-level packet-printing code.
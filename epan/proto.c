@@ -70,6 +70,19 @@ struct ptvcursor {
 
 #define cVALS(x) (const value_string*)(x)
 
+/* The items of the primed fields of a tree are looked up by hfid in a
+ * table of pages of this many entries, allocated as they are needed. */
+#define INTERESTING_PAGE_SHIFT	8
+#define INTERESTING_PAGE_SIZE	(1 << INTERESTING_PAGE_SHIFT)
+
+/* The items of a primed field in a tree, in the order they were added;
+ * empty unless epoch is the tree's interesting_epoch, so that a tree is
+ * emptied by moving to the next epoch. */
+struct _interesting_field {
+	guint      epoch;
+	GPtrArray *finfos;
+};
+
 /** See inlined comments.
  @param tree the tree to append this item to
  @param free_block a code block to call to free resources if this returns
@@ -716,11 +729,10 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 	}
 }
 
+/* Undoes the priming of a field that had items in the tree. */
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+unprime_interesting_field(const int hfid)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	gint               hfid = GPOINTER_TO_UINT(key);
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
@@ -736,8 +748,73 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		}
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
+}
+
+/* Empties the table of interesting fields; the arrays are kept for the
+ * next dissection. */
+static void
+tree_data_reset_interesting_fields(tree_data_t *tree_data)
+{
+	guint i, j;
+
+	if (tree_data->interesting_hfids == NULL)
+		return;
+
+	for (i = 0; i < tree_data->interesting_hfids->len; i++)
+		unprime_interesting_field(g_array_index(tree_data->interesting_hfids, int, i));
+	g_array_set_size(tree_data->interesting_hfids, 0);
+
+	if (++tree_data->interesting_epoch == 0) {
+		/* Wrapped around; make sure that no entry looks current. */
+		for (i = 0; i < tree_data->num_interesting_pages; i++) {
+			if (tree_data->interesting_pages[i] == NULL)
+				continue;
+			for (j = 0; j < INTERESTING_PAGE_SIZE; j++)
+				tree_data->interesting_pages[i][j].epoch = 0;
+		}
+		tree_data->interesting_epoch = 1;
+	}
+}
+
+static void
+tree_data_free_interesting_fields(tree_data_t *tree_data)
+{
+	guint i, j;
+
+	if (tree_data->interesting_hfids == NULL)
+		return;
+
+	tree_data_reset_interesting_fields(tree_data);
+
+	for (i = 0; i < tree_data->num_interesting_pages; i++) {
+		if (tree_data->interesting_pages[i] == NULL)
+			continue;
+		for (j = 0; j < INTERESTING_PAGE_SIZE; j++) {
+			if (tree_data->interesting_pages[i][j].finfos != NULL)
+				g_ptr_array_free(tree_data->interesting_pages[i][j].finfos, TRUE);
+		}
+		g_free(tree_data->interesting_pages[i]);
+	}
+	g_free(tree_data->interesting_pages);
+	g_array_free(tree_data->interesting_hfids, TRUE);
+}
 
-	g_ptr_array_free(ptrs, TRUE);
+/* Returns the entry of a field in the table of interesting fields, or
+ * NULL if it has no items in the tree. */
+static inline struct _interesting_field *
+tree_data_get_interesting_field(const tree_data_t *tree_data, const int hfid)
+{
+	guint                      page = (guint)hfid >> INTERESTING_PAGE_SHIFT;
+	struct _interesting_field *field;
+
+	if (page >= tree_data->num_interesting_pages ||
+	    tree_data->interesting_pages[page] == NULL)
+		return NULL;
+
+	field = &tree_data->interesting_pages[page][hfid & (INTERESTING_PAGE_SIZE - 1)];
+	if (field->epoch != tree_data->interesting_epoch)
+		return NULL;
+	return field;
 }
 
 static void
@@ -758,14 +835,7 @@ proto_tree_reset(proto_tree *tree)
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then remove all values. */
-		g_hash_table_remove_all(tree_data->interesting_hfids);
-	}
+	tree_data_reset_interesting_fields(tree_data);
 
 	/* Reset track of the number of children */
 	tree_data->count = 0;
@@ -782,14 +852,7 @@ proto_tree_free(proto_tree *tree)
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
-	}
+	tree_data_free_interesting_fields(tree_data);
 
 	g_slice_free(tree_data_t, tree_data);
 
@@ -2439,25 +2502,39 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 	const header_field_info *hfinfo = fi->hfinfo;
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		GPtrArray *ptrs = NULL;
+		guint                      page = (guint)hfinfo->id >> INTERESTING_PAGE_SHIFT;
+		struct _interesting_field *field;
 
 		if (tree_data->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			tree_data->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
-		} else if (g_hash_table_size(tree_data->interesting_hfids)) {
-			ptrs = (GPtrArray *)g_hash_table_lookup(tree_data->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
+			/* Initialize the table because we now know that it is needed */
+			tree_data->interesting_hfids = g_array_new(FALSE, FALSE, sizeof(int));
 		}
 
-		if (!ptrs) {
-			/* First element triggers the creation of pointer array */
-			ptrs = g_ptr_array_new();
-			g_hash_table_insert(tree_data->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+		if (page >= tree_data->num_interesting_pages) {
+			guint num_pages = MAX(page + 1, 2 * tree_data->num_interesting_pages);
+
+			tree_data->interesting_pages = g_renew(struct _interesting_field *,
+			    tree_data->interesting_pages, num_pages);
+			memset(&tree_data->interesting_pages[tree_data->num_interesting_pages], 0,
+			    (num_pages - tree_data->num_interesting_pages) * sizeof(struct _interesting_field *));
+			tree_data->num_interesting_pages = num_pages;
+		}
+		if (tree_data->interesting_pages[page] == NULL)
+			tree_data->interesting_pages[page] = g_new0(struct _interesting_field, INTERESTING_PAGE_SIZE);
+
+		field = &tree_data->interesting_pages[page][hfinfo->id & (INTERESTING_PAGE_SIZE - 1)];
+		if (field->epoch != tree_data->interesting_epoch) {
+			/* First element of this dissection; reuse the array of
+			 * an earlier one, if there is one */
+			field->epoch = tree_data->interesting_epoch;
+			if (field->finfos == NULL)
+				field->finfos = g_ptr_array_new();
+			else
+				g_ptr_array_set_size(field->finfos, 0);
+			g_array_append_val(tree_data->interesting_hfids, hfinfo->id);
 		}
 
-		g_ptr_array_add(ptrs, fi);
+		g_ptr_array_add(field->finfos, fi);
 	}
 }
 
@@ -7120,6 +7197,9 @@ proto_tree_create_root(packet_info *pinfo)
 	pnode->tree_data->pinfo = pinfo;
 
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
+	pnode->tree_data->interesting_pages = NULL;
+	pnode->tree_data->num_interesting_pages = 0;
+	pnode->tree_data->interesting_epoch = 1;
 	pnode->tree_data->interesting_hfids = NULL;
 
 	/* Set the default to FALSE so it's easier to
@@ -10406,27 +10486,26 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	struct _interesting_field *field;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
-		return NULL;
+	field = tree_data_get_interesting_field(PTREE_DATA(tree), id);
+	return field ? field->finfos : NULL;
 }
 
 gboolean
 proto_tracking_interesting_fields(const proto_tree *tree)
 {
-	GHashTable *interesting_hfids;
+	GArray *interesting_hfids;
 
 	if (!tree)
 		return FALSE;
 
 	interesting_hfids = PTREE_DATA(tree)->interesting_hfids;
 
-	return (interesting_hfids != NULL) && g_hash_table_size(interesting_hfids);
+	return (interesting_hfids != NULL) && interesting_hfids->len > 0;
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
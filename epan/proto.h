@@ -853,10 +853,15 @@ typedef struct
 #define FI_GET_BITS_OFFSET(fi) (FI_GET_FLAG(fi, FI_BITS_OFFSET(7)) >> 5)
 #define FI_GET_BITS_SIZE(fi)   (FI_GET_FLAG(fi, FI_BITS_SIZE(63)) >> 8)
 
+struct _interesting_field;
+
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable          *interesting_hfids;
+    struct _interesting_field **interesting_pages; /**< items of the primed fields, by hfid */
+    guint                num_interesting_pages;
+    guint                interesting_epoch;  /**< entries of older epochs are empty */
+    GArray              *interesting_hfids;  /**< fields with items in this epoch */
     gboolean             visible;
     gboolean             fake_protocols;
     guint                count;
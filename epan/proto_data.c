@@ -27,50 +27,37 @@
 #include <epan/timestamp.h>
 #endif
 
-/* Protocol-specific data attached to a frame_data structure - protocol
-   index and opaque pointer. */
-typedef struct _proto_data {
+/* Protocol-specific data attached to a frame_data structure or to a
+   packet_info structure - protocol index, key and opaque pointer.  The
+   items are chained through next, and allocated from the scope of the
+   list they're in, so there's no list to free. */
+struct _proto_data {
+  struct _proto_data *next;
   int   proto;
   guint32 key;
   void *proto_data;
-} proto_data_t;
+};
 
-static gint
-p_compare(gconstpointer a, gconstpointer b)
+typedef struct _proto_data proto_data_t;
+
+static proto_data_t **
+proto_data_list(wmem_allocator_t *scope, struct _packet_info* pinfo)
 {
-  const proto_data_t *ap = (const proto_data_t *)a;
-  const proto_data_t *bp = (const proto_data_t *)b;
-
-  if (ap -> proto > bp -> proto) {
-    return 1;
-  } else if (ap -> proto == bp -> proto) {
-    if (ap->key > bp->key){
-      return 1;
-    } else if (ap -> key == bp -> key) {
-      return 0;
-    }
-    return -1;
+  if (scope == pinfo->pool) {
+    return &pinfo->proto_data;
+  } else if (scope == wmem_file_scope()) {
+    return &pinfo->fd->pfd;
   } else {
-    return -1;
+    DISSECTOR_ASSERT(!"invalid wmem scope");
   }
+  return NULL;
 }
 
 void
-p_add_proto_data(wmem_allocator_t *tmp_scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
+p_add_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
 {
+  proto_data_t    **proto_list = proto_data_list(scope, pinfo);
   proto_data_t     *p1;
-  GSList          **proto_list;
-  wmem_allocator_t *scope;
-
-  if (tmp_scope == pinfo->pool) {
-    scope = tmp_scope;
-    proto_list = &pinfo->proto_data;
-  } else if (tmp_scope == wmem_file_scope()) {
-    scope = wmem_file_scope();
-    proto_list = &pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
 
   p1 = wmem_new(scope, proto_data_t);
 
@@ -78,31 +65,19 @@ p_add_proto_data(wmem_allocator_t *tmp_scope, struct _packet_info* pinfo, int pr
   p1->key = key;
   p1->proto_data = proto_data;
 
-  /* Add it to the GSLIST */
-  *proto_list = g_slist_prepend(*proto_list, p1);
+  /* Add it to the front of the list */
+  p1->next = *proto_list;
+  *proto_list = p1;
 }
 
 void *
 p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
 {
-  proto_data_t  temp, *p1;
-  GSList       *item;
-
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
-
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, &temp, p_compare);
-  } else if (scope == wmem_file_scope()) {
-    item = g_slist_find_custom(pinfo->fd->pfd, &temp, p_compare);
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
+  proto_data_t  *p1;
 
-  if (item) {
-    p1 = (proto_data_t *)item->data;
-    return p1->proto_data;
+  for (p1 = *proto_data_list(scope, pinfo); p1 != NULL; p1 = p1->next) {
+    if (p1->proto == proto && p1->key == key)
+      return p1->proto_data;
   }
 
   return NULL;
@@ -111,40 +86,35 @@ p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto,
 void
 p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
 {
-  proto_data_t  temp;
-  GSList       *item;
-  GSList      **proto_list;
+  proto_data_t **item;
 
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
-
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, &temp, p_compare);
-    proto_list = &pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    item = g_slist_find_custom(pinfo->fd->pfd, &temp, p_compare);
-    proto_list = &pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
+  for (item = proto_data_list(scope, pinfo); *item != NULL; item = &(*item)->next) {
+    if ((*item)->proto == proto && (*item)->key == key) {
+      *item = (*item)->next;
+      return;
+    }
   }
+}
 
-  if (item) {
-    *proto_list = g_slist_remove(*proto_list, item->data);
-  }
+guint
+p_get_proto_data_count(wmem_allocator_t *scope, struct _packet_info* pinfo)
+{
+  proto_data_t *p1;
+  guint         count = 0;
+
+  for (p1 = *proto_data_list(scope, pinfo); p1 != NULL; p1 = p1->next)
+    count++;
+
+  return count;
 }
 
 gchar *
 p_get_proto_name_and_key(wmem_allocator_t *scope, struct _packet_info* pinfo, guint pfd_index){
   proto_data_t  *temp;
 
-  if (scope == pinfo->pool) {
-    temp = (proto_data_t *)g_slist_nth_data(pinfo->proto_data, pfd_index);
-  } else if (scope == wmem_file_scope()) {
-    temp = (proto_data_t *)g_slist_nth_data(pinfo->fd->pfd, pfd_index);
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
+  temp = *proto_data_list(scope, pinfo);
+  while (pfd_index-- != 0)
+    temp = temp->next;
 
   return wmem_strdup_printf(wmem_packet_scope(),"[%s, key %u]",proto_get_protocol_name(temp->proto), temp->key);
 }
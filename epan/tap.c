@@ -84,6 +84,7 @@ typedef struct _tap_listener_t {
 	guint flags;
 	gchar *fstring;
 	dfilter_t *code;
+	int filter_index;	/* index of fstring in tap_filter_set, or -1 */
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -93,6 +94,11 @@ typedef struct _tap_listener_t {
 
 static tap_listener_t *tap_listener_queue=NULL;
 
+/* The filters of all the tap listeners, compiled into one set so that
+ * filters reading the same fields, or doing the same comparisons, share
+ * that work.  Built when first needed after the listeners change. */
+static dfilter_set_t *tap_filter_set=NULL;
+
 static GSList *tap_plugins = NULL;
 
 #ifdef HAVE_PLUGINS
@@ -295,6 +301,46 @@ tap_queue_init(epan_dissect_t *edt)
 	tap_build_interesting (edt);
 }
 
+static void
+tap_invalidate_filter_set(void)
+{
+	dfilter_set_free(tap_filter_set);
+	tap_filter_set=NULL;
+}
+
+static void
+tap_build_filter_set(void)
+{
+	tap_listener_t *tl;
+	gchar *err_msg;
+
+	tap_filter_set=dfilter_set_new();
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		tl->filter_index=-1;
+		if(tl->code && tl->fstring){
+			tl->filter_index=dfilter_set_add(tap_filter_set, tl->fstring, &err_msg);
+			if(tl->filter_index<0){
+				/* Use the listener's own filter. */
+				g_free(err_msg);
+			}
+		}
+	}
+}
+
+/* Does the packet pass the filter of the tap listener?  The result is
+ * kept until tap_push_tapped_queue() is done with the packet. */
+static gboolean
+tap_listener_passes(tap_listener_t *tl, epan_dissect_t *edt)
+{
+	if(!tap_filter_set){
+		tap_build_filter_set();
+	}
+	if(tl->filter_index<0){
+		return dfilter_apply_edt(tl->code, edt);
+	}
+	return dfilter_set_match_edt(tap_filter_set, tl->filter_index, edt);
+}
+
 /* this function is called after a packet has been fully dissected to push the tapped
    data to all extensions that has callbacks registered.
 */
@@ -347,7 +393,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 					 * packet passes.
 					 */
 					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
+						if (!tap_listener_passes(tl, edt)){
 							/* The packet didn't
 							 * pass the filter. */
 							continue;
@@ -376,6 +422,10 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 			}
 		}
 	}
+
+	if(tap_filter_set){
+		dfilter_set_reset(tap_filter_set);
+	}
 }
 
 
@@ -561,6 +611,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	}
 	tl->fstring=g_strdup(fstring);
 	tl->code=code;
+	tl->filter_index=-1;
 
 	tl->tap_id=tap_id;
 	tl->tapdata=tapdata;
@@ -571,6 +622,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	tap_invalidate_filter_set();
 
 	return NULL;
 }
@@ -602,6 +654,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
+		tap_invalidate_filter_set();
 		if(tl->code){
 			dfilter_free(tl->code);
 			tl->code=NULL;
@@ -635,6 +688,7 @@ tap_listeners_dfilter_recompile(void)
 	dfilter_t *code;
 	gchar *err_msg;
 
+	tap_invalidate_filter_set();
 	for(tl=tap_listener_queue;tl;tl=tl->next){
 		if(tl->code){
 			dfilter_free(tl->code);
@@ -683,6 +737,7 @@ remove_tap_listener(void *tapdata)
 			return;
 		}
 	}
+	tap_invalidate_filter_set();
 	free_tap_listener(tl);
 }
 
@@ -761,6 +816,8 @@ void tap_cleanup(void)
 	tap_dissector_t *elem_dl;
 	tap_dissector_t *head_dl = tap_dissector_list;
 
+	tap_invalidate_filter_set();
+
 	while(head_lq){
 		elem_lq = head_lq;
 		head_lq = head_lq->next;
@@ -73,7 +73,11 @@
 static gboolean read_record(capture_file *cf, wtap_rec *rec, Buffer *buf,
     dfilter_t *dfcode, epan_dissect_t *edt, column_info *cinfo, gint64 offset);
 
+static gboolean read_packet_index(capture_file *cf, wtap_packet_index *pidx);
+
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect);
+static void filter_cache_clear(capture_file *cf);
+static void filter_cache_forget(capture_file *cf, const char *dftext);
 
 typedef enum {
   MR_NOTMATCHED,
@@ -265,6 +269,11 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   if (wth == NULL)
     goto fail;
 
+  /* If we saved fast-seek information for this file the last time
+     we read it, use it. */
+  if (prefs.gui_fast_seek_index && !is_tempfile)
+    wtap_load_fast_seek_index(wth);
+
   /* The open succeeded.  Close whatever capture file we had open,
      and fill in the information for this file. */
   cf_close(cf);
@@ -426,6 +435,9 @@ cf_close(capture_file *cf)
 
   cf->f_datalen = 0;
   nstime_set_zero(&cf->elapsed_time);
+  cf->first_pass_deferred = FALSE;
+  cf->first_pass_done = 0;
+  filter_cache_clear(cf);
 
   reset_tap_listeners();
 
@@ -508,6 +520,8 @@ cf_read(capture_file *cf, gboolean reloading)
   guint                tap_flags;
   gboolean             compiled;
   volatile gboolean    is_read_aborted = FALSE;
+  wtap_packet_index   *pidx = NULL;
+  gboolean             indexed = FALSE;
 
   /* The update_progress_dlg call below might end up accepting a user request to
    * trigger redissection/rescans which can modify/destroy the dissection
@@ -580,6 +594,51 @@ cf_read(capture_file *cf, gboolean reloading)
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
+  /*
+   * A fast-seek index makes random access to a compressed file quick,
+   * but opening the file again would still mean decompressing all of
+   * it to read it sequentially; use a packet index with it, so that
+   * that isn't necessary.
+   */
+  if ((prefs.gui_packet_index ||
+       (prefs.gui_fast_seek_index && cf->compression_type != WTAP_UNCOMPRESSED)) &&
+      !cf->is_tempfile) {
+    /*
+     * If nothing needs to see every packet as it's read, and we saved
+     * a packet index for this file the last time we read it, set up
+     * the packet list from that, and leave the dissection to be done
+     * when the packets are displayed, filtered or tapped.  Otherwise,
+     * save an index as we read the file.
+     */
+    if (dfcode == NULL && cf->rfcode == NULL &&
+        !tap_listeners_require_dissection() && !postdissectors_want_hfids()) {
+      pidx = wtap_packet_index_open(cf->provider.wth);
+      if (pidx != NULL) {
+        if (wtap_packet_index_count(pidx) <= max_records)
+          indexed = read_packet_index(cf, pidx);
+        wtap_packet_index_close(pidx);
+        pidx = NULL;
+      }
+    }
+    if (!indexed) {
+      int create_err;
+
+      pidx = wtap_packet_index_create(cf->provider.wth, &create_err);
+    }
+  }
+
+  /*
+   * Dissection has to be done on this thread, one frame at a time and in
+   * order, as dissectors keep state from one frame to the next, and the
+   * dissection and filtering code isn't thread-safe.  Reading and parsing
+   * the records isn't part of that, so let wiretap do it on a thread of
+   * its own, ahead of us, if it can.  The packet list is frozen while
+   * we read, and the thread is stopped when the sequential side is closed
+   * below; random reads in between fail rather than race with it.
+   */
+  if (!indexed)
+    wtap_set_read_ahead(cf->provider.wth, 0);
+
   TRY {
     guint32 count             = 0;
 
@@ -589,8 +648,8 @@ cf_read(capture_file *cf, gboolean reloading)
     float   progbar_val;
     gchar   status_str[100];
 
-    while ((wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info,
-            &data_offset))) {
+    while (!indexed && (wtap_read(cf->provider.wth, &rec, &buf, &err,
+            &err_info, &data_offset))) {
       if (size >= 0) {
         if (cf->count == max_records) {
             /*
@@ -649,6 +708,8 @@ cf_read(capture_file *cf, gboolean reloading)
            hours even on fast machines) just to see that it was the wrong file. */
         break;
       }
+      if (pidx != NULL)
+        wtap_packet_index_add(pidx, &rec, data_offset);
       read_record(cf, &rec, &buf, dfcode, &edt, cinfo, data_offset);
     }
   }
@@ -684,6 +745,32 @@ cf_read(capture_file *cf, gboolean reloading)
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
 
+  /* If we read the entire file, save the fast-seek information we
+     gathered, so that we don't have to gather it again the next time.
+     Failing to do so isn't worth bothering the user about. */
+  if (prefs.gui_fast_seek_index && !cf->is_tempfile && err == 0 &&
+      !cf->stop_flag && !too_many_records && !is_read_aborted) {
+    int save_err;
+
+    wtap_save_fast_seek_index(cf->provider.wth, &save_err);
+  }
+
+  /* Likewise for the packet index, which is only any use if it has
+     all the records. */
+  if (pidx != NULL) {
+    int save_err;
+
+    wtap_packet_index_finish(pidx,
+        err == 0 && !cf->stop_flag && !too_many_records && !is_read_aborted,
+        &save_err);
+  }
+
+  /* The packets haven't been dissected yet; they will be, in order, as
+     far as the ones that are displayed, filtered or tapped, when they
+     are. */
+  cf->first_pass_deferred = indexed;
+  cf->first_pass_done = 0;
+
   /* Close the sequential I/O side, to free up memory it requires. */
   wtap_sequential_close(cf->provider.wth);
 
@@ -1169,6 +1256,228 @@ void cf_set_rfcode(capture_file *cf, dfilter_t *rfcode)
   cf->rfcode = rfcode;
 }
 
+/* Number of display filters whose results rescan_packets() remembers. */
+#define FILTER_CACHE_SIZE 8
+
+/*
+ * The frames that passed a display filter, and the frames that those
+ * frames depend upon, the last time the filter was applied to the
+ * frames without redissecting them.  Bit (n - 1) of a bitmap is
+ * frame n.
+ */
+typedef struct {
+  gchar   *dftext;
+  guint32  count;               /* Number of frames the bitmaps cover */
+  guint32 *passed;
+  guint32 *depended_upon;
+} filter_cache_entry_t;
+
+#define FILTER_CACHE_BIT(bits, num) \
+  (((bits)[((num) - 1) / 32] >> (((num) - 1) % 32)) & 1)
+
+/*
+ * Fields whose values depend on what is displayed, marked, ignored,
+ * commented or time-shifted rather than just on the frames' contents;
+ * the results of filters that read them can't be reused.
+ */
+static const char *filter_cache_volatile_fields[] = {
+  "frame.time",
+  "frame.time_epoch",
+  "frame.time_delta",
+  "frame.time_delta_displayed",
+  "frame.time_relative",
+  "frame.ref_time",
+  "frame.marked",
+  "frame.ignored",
+  "frame.comment",
+  "frame.coloring_rule.name",
+  "frame.coloring_rule.string",
+  "pkt_comment",
+};
+
+static void
+filter_cache_entry_free(gpointer data)
+{
+  filter_cache_entry_t *entry = (filter_cache_entry_t *)data;
+
+  g_free(entry->dftext);
+  g_free(entry->passed);
+  g_free(entry->depended_upon);
+  g_free(entry);
+}
+
+static void
+filter_cache_clear(capture_file *cf)
+{
+  if (cf->filter_cache != NULL) {
+    g_queue_free_full(cf->filter_cache, filter_cache_entry_free);
+    cf->filter_cache = NULL;
+  }
+}
+
+static gboolean
+filter_cache_can_store(const char *dftext, dfilter_t *dfcode)
+{
+  guint i;
+  int hfid;
+
+  /* A macro can be redefined without the filter text changing. */
+  if (dfcode == NULL || strchr(dftext, '$') != NULL)
+    return FALSE;
+
+  for (i = 0; i < G_N_ELEMENTS(filter_cache_volatile_fields); i++) {
+    hfid = proto_registrar_get_id_byname(filter_cache_volatile_fields[i]);
+    if (hfid != -1 && dfilter_interested_in_field(dfcode, hfid))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Forget the results of a filter, so that it is applied to every
+   frame again. */
+static void
+filter_cache_forget(capture_file *cf, const char *dftext)
+{
+  GList *link;
+  filter_cache_entry_t *entry;
+
+  if (cf->filter_cache == NULL)
+    return;
+
+  for (link = cf->filter_cache->head; link != NULL; link = link->next) {
+    entry = (filter_cache_entry_t *)link->data;
+    if (strcmp(entry->dftext, dftext) == 0) {
+      g_queue_delete_link(cf->filter_cache, link);
+      filter_cache_entry_free(entry);
+      return;
+    }
+  }
+}
+
+/* Find the results of a filter, making them the most recently used. */
+static filter_cache_entry_t *
+filter_cache_lookup(capture_file *cf, const char *dftext)
+{
+  GList *link;
+  filter_cache_entry_t *entry;
+
+  if (cf->filter_cache == NULL || dftext == NULL)
+    return NULL;
+
+  for (link = cf->filter_cache->head; link != NULL; link = link->next) {
+    entry = (filter_cache_entry_t *)link->data;
+    if (strcmp(entry->dftext, dftext) == 0) {
+      g_queue_unlink(cf->filter_cache, link);
+      g_queue_push_head_link(cf->filter_cache, link);
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Find the results of a filter that "dftext" narrows, if any. */
+static filter_cache_entry_t *
+filter_cache_lookup_narrowed(capture_file *cf, const char *dftext)
+{
+  GList *link;
+  filter_cache_entry_t *entry;
+
+  if (cf->filter_cache == NULL || dftext == NULL)
+    return NULL;
+
+  for (link = cf->filter_cache->head; link != NULL; link = link->next) {
+    entry = (filter_cache_entry_t *)link->data;
+    if (dfilter_text_narrows(entry->dftext, dftext))
+      return entry;
+  }
+  return NULL;
+}
+
+/*
+ * Look up what the cached results say about a frame.  Returns FALSE if
+ * the frame has to be dissected and filtered.
+ */
+static gboolean
+filter_cache_lookup_frame(gboolean all_pass, const filter_cache_entry_t *cached,
+    const filter_cache_entry_t *narrowed, guint32 num,
+    gboolean *passed, gboolean *depended_upon)
+{
+  if (all_pass) {
+    /* There's no filter. */
+    *passed = TRUE;
+    *depended_upon = FALSE;
+    return TRUE;
+  }
+  if (cached != NULL && num <= cached->count) {
+    *passed = FILTER_CACHE_BIT(cached->passed, num);
+    *depended_upon = FILTER_CACHE_BIT(cached->depended_upon, num);
+    return TRUE;
+  }
+  if (narrowed != NULL && num <= narrowed->count &&
+      !FILTER_CACHE_BIT(narrowed->passed, num)) {
+    /* It didn't pass the filter that this one narrows, so it can't
+       pass this one; a frame that does pass may still depend on it. */
+    *passed = FALSE;
+    *depended_upon = FALSE;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* Remember which of the first "count" frames passed the filter. */
+static void
+filter_cache_store(capture_file *cf, const char *dftext, guint32 count)
+{
+  filter_cache_entry_t *entry;
+  guint32     framenum;
+  frame_data *fdata;
+  gsize       words = (count + 31) / 32;
+
+  entry = filter_cache_lookup(cf, dftext);
+  if (entry != NULL) {
+    g_queue_pop_head(cf->filter_cache);
+    filter_cache_entry_free(entry);
+  }
+
+  entry = g_new(filter_cache_entry_t, 1);
+  entry->dftext = g_strdup(dftext);
+  entry->count = count;
+  entry->passed = g_new0(guint32, words);
+  entry->depended_upon = g_new0(guint32, words);
+  for (framenum = 1; framenum <= count; framenum++) {
+    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+    if (fdata->passed_dfilter)
+      entry->passed[(framenum - 1) / 32] |= 1U << ((framenum - 1) % 32);
+    if (fdata->dependent_of_displayed)
+      entry->depended_upon[(framenum - 1) / 32] |= 1U << ((framenum - 1) % 32);
+  }
+
+  if (cf->filter_cache == NULL)
+    cf->filter_cache = g_queue_new();
+  g_queue_push_head(cf->filter_cache, entry);
+  while (g_queue_get_length(cf->filter_cache) > FILTER_CACHE_SIZE)
+    filter_cache_entry_free(g_queue_pop_tail(cf->filter_cache));
+}
+
+static void
+update_displayed_frames(capture_file *cf, frame_data *fdata)
+{
+  if (fdata->passed_dfilter || fdata->ref_time)
+  {
+    cf->displayed_count++;
+
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->provider.prev_dis = fdata;
+
+    /* If we haven't yet seen the first frame, this is it. */
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+
+    /* This is the last frame we've seen so far. */
+    cf->last_displayed = fdata->num;
+  }
+}
+
 static void
 add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
     epan_dissect_t *edt, dfilter_t *dfcode, column_info *cinfo,
@@ -1216,28 +1525,33 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   } else
     fdata->passed_dfilter = 1;
 
-  if (fdata->passed_dfilter || fdata->ref_time)
-    cf->displayed_count++;
-
   if (add_to_packet_list) {
     /* We fill the needed columns from new_packet_list */
     packet_list_append(cinfo, fdata);
   }
 
-  if (fdata->passed_dfilter || fdata->ref_time)
-  {
-    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
-    cf->provider.prev_dis = fdata;
+  update_displayed_frames(cf, fdata);
 
-    /* If we haven't yet seen the first frame, this is it. */
-    if (cf->first_displayed == 0)
-      cf->first_displayed = fdata->num;
+  epan_dissect_reset(edt);
+}
 
-    /* This is the last frame we've seen so far. */
-    cf->last_displayed = fdata->num;
-  }
+/*
+ * Add a frame whose display filter result is already known to the
+ * packet list, without reading or dissecting it.
+ */
+static void
+add_filtered_packet_to_packet_list(frame_data *fdata, capture_file *cf,
+    gboolean passed, gboolean depended_upon)
+{
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &cf->provider.ref, cf->provider.prev_dis);
+  cf->provider.prev_cap = fdata;
 
-  epan_dissect_reset(edt);
+  fdata->passed_dfilter = passed ? 1 : 0;
+  if (depended_upon)
+    fdata->dependent_of_displayed = 1;
+
+  update_displayed_frames(cf, fdata);
 }
 
 /*
@@ -1301,6 +1615,76 @@ read_record(capture_file *cf, wtap_rec *rec, Buffer *buf, dfilter_t *dfcode,
   return added;
 }
 
+/*
+ * Set up the frame list from a packet index, without dissecting any of
+ * the packets; they're all displayed, as there's no display filter.
+ * Returns FALSE, leaving the frame list empty, if the index couldn't be
+ * read.
+ */
+static gboolean
+read_packet_index(capture_file *cf, wtap_packet_index *pidx)
+{
+  wtap_rec      rec;
+  frame_data    fdlocal;
+  frame_data   *fdata;
+  gint64        offset;
+  gboolean      has_comment;
+  guint32       framenum;
+  int           err;
+
+  wtap_rec_init(&rec);
+  while (wtap_packet_index_read(pidx, &rec, &offset, &has_comment, &err)) {
+    if (rec.rec_type == REC_TYPE_PACKET) {
+      cf_add_encapsulation_type(cf, rec.rec_header.packet_header.pkt_encap);
+    }
+
+    frame_data_init(&fdlocal, cf->count + 1, &rec, offset, cf->cum_bytes);
+    fdlocal.has_phdr_comment = has_comment;
+    fdata = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+
+    cf->count++;
+    if (has_comment)
+      cf->packet_comment_count++;
+    cf->f_datalen = offset + fdlocal.cap_len;
+
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &cf->provider.ref, cf->provider.prev_dis);
+    cf->provider.prev_cap = fdata;
+    fdata->passed_dfilter = 1;
+    cf->displayed_count++;
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->provider.prev_dis = fdata;
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+  }
+  wtap_rec_cleanup(&rec);
+
+  if (err != 0 || cf->count != wtap_packet_index_count(pidx)) {
+    /* Forget what we've got; the file will be read the usual way. */
+    free_frame_data_sequence(cf->provider.frames);
+    cf->provider.frames = new_frame_data_sequence();
+    g_array_set_size(cf->linktypes, 0);
+    cf->count = 0;
+    cf->packet_comment_count = 0;
+    cf->f_datalen = 0;
+    cf->displayed_count = 0;
+    cf->first_displayed = 0;
+    cf->last_displayed = 0;
+    cf->cum_bytes = 0;
+    nstime_set_zero(&cf->elapsed_time);
+    cf->provider.ref = NULL;
+    cf->provider.prev_dis = NULL;
+    cf->provider.prev_cap = NULL;
+    return FALSE;
+  }
+
+  for (framenum = 1; framenum <= cf->count; framenum++) {
+    packet_list_append(NULL, frame_data_sequence_find(cf->provider.frames, framenum));
+  }
+  return TRUE;
+}
+
 
 typedef struct _callback_data_t {
   gpointer         pd_window;
@@ -1494,6 +1878,11 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
     return CF_OK;
   }
 
+  /* If told to apply it again, don't reuse what it passed before. */
+  if (force) {
+    filter_cache_forget(cf, filter_new);
+  }
+
   dfcode=NULL;
 
   if (dftext == NULL) {
@@ -1580,6 +1969,54 @@ cf_redissect_packets(capture_file *cf)
   }
 }
 
+/*
+ * If the frames came from a packet index, dissect those up to and
+ * including framenum that haven't been dissected yet, in order, so that
+ * what the dissectors remember from one frame to the next is the same
+ * as if we'd read the file.  Their time references, previous displayed
+ * frames and cumulative byte counts were set up when the index was
+ * read; with no display filter, every frame is displayed.
+ */
+static void
+dissect_deferred_frames(capture_file *cf, guint32 framenum)
+{
+  epan_dissect_t  edt;
+  frame_data     *fdata;
+  wtap_rec        rec;
+  Buffer          buf;
+  int             err;
+  gchar          *err_info;
+
+  if (!cf->first_pass_deferred || framenum <= cf->first_pass_done)
+    return;
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+  epan_dissect_init(&edt, cf->epan, postdissectors_want_hfids(), FALSE);
+
+  while (cf->first_pass_done < framenum) {
+    fdata = frame_data_sequence_find(cf->provider.frames, cf->first_pass_done + 1);
+    if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, &err, &err_info)) {
+      /* Leave it to our caller to report. */
+      g_free(err_info);
+      break;
+    }
+    prime_epan_dissect_with_postdissector_wanted_hfids(&edt);
+    epan_dissect_run(&edt, cf->cd_t, &rec,
+                     frame_tvbuff_new_buffer(&cf->provider, fdata, &buf),
+                     fdata, NULL);
+    epan_dissect_reset(&edt);
+    cf->first_pass_done++;
+  }
+
+  epan_dissect_cleanup(&edt);
+  wtap_rec_cleanup(&rec);
+  ws_buffer_free(&buf);
+
+  if (cf->first_pass_done == cf->count)
+    cf->first_pass_deferred = FALSE;
+}
+
 gboolean
 cf_read_record(capture_file *cf, const frame_data *fdata,
                  wtap_rec *rec, Buffer *buf)
@@ -1587,6 +2024,7 @@ cf_read_record(capture_file *cf, const frame_data *fdata,
   int    err;
   gchar *err_info;
 
+  dissect_deferred_frames(cf, fdata->num);
   if (!wtap_seek_read(cf->provider.wth, fdata->file_off, rec, buf, &err, &err_info)) {
     cfile_read_failure_alert_box(cf->filename, err, err_info);
     return FALSE;
@@ -1601,6 +2039,7 @@ cf_read_record_no_alert(capture_file *cf, const frame_data *fdata,
   int    err;
   gchar *err_info;
 
+  dissect_deferred_frames(cf, fdata->num);
   if (!wtap_seek_read(cf->provider.wth, fdata->file_off, rec, buf, &err, &err_info)) {
     g_free(err_info);
     return FALSE;
@@ -1652,12 +2091,26 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    compiled;
   guint32     frames_count;
   gboolean    queued_rescan_type = RESCAN_NONE;
+  filter_cache_entry_t *cached = NULL;
+  filter_cache_entry_t *narrowed = NULL;
+  gboolean    all_pass = FALSE;
+  gboolean    prefilter = FALSE;
+  gboolean    known, passed, depended_upon;
 
   /* Rescan in progress, clear pending actions. */
   cf->redissection_queued = RESCAN_NONE;
   g_assert(!cf->read_lock);
   cf->read_lock = TRUE;
 
+  /* If the frames came from a packet index, only the first of them have
+     been dissected so far, and we're about to go through all of them;
+     do that as the first pass, from scratch, rather than have some of
+     them skipped below. */
+  if (cf->first_pass_deferred) {
+    redissect = TRUE;
+    cf->first_pass_deferred = FALSE;
+  }
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
@@ -1668,6 +2121,23 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   compiled = dfilter_compile(cf->dfilter, &dfcode, NULL);
   g_assert(!cf->dfilter || (compiled && dfcode));
 
+  /* If redissecting might change what the filters pass, forget what
+     they passed before.  Otherwise, unless a tap listener wants to see
+     every frame, we don't have to dissect the frames we already know
+     the result for: all of them if there's no filter, those for which
+     this filter's result is cached, if it narrows a filter whose result
+     is cached, those that didn't pass that filter, and those whose
+     bytes show that they can't pass it. */
+  if (redissect) {
+    filter_cache_clear(cf);
+  } else if (!tap_listeners_require_dissection()) {
+    all_pass = (dfcode == NULL);
+    prefilter = (dfcode != NULL && dfilter_has_prefilter(dfcode));
+    cached = filter_cache_lookup(cf, cf->dfilter);
+    if (cached == NULL)
+      narrowed = filter_cache_lookup_narrowed(cf, cf->dfilter);
+  }
+
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
@@ -1864,9 +2334,26 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
     fdata->dependent_of_displayed = 0;
 
-    if (!cf_read_record(cf, fdata, &rec, &buf))
+    /* If we already know whether the frame passes, don't dissect it. */
+    known = filter_cache_lookup_frame(all_pass, cached, narrowed, fdata->num,
+                                      &passed, &depended_upon);
+
+    if (!known && !cf_read_record(cf, fdata, &rec, &buf))
       break; /* error reading the frame */
 
+    /* All of the fields of a frame that has been dissected before
+       without reassembly, decryption, ... come from its bytes, so they
+       can show that it can't pass. */
+    if (!known && prefilter && fdata->visited && !fdata->other_data_src &&
+        rec.rec_type == REC_TYPE_PACKET &&
+        !dfilter_may_match_packet(dfcode, rec.rec_header.packet_header.pkt_encap,
+                                  ws_buffer_start_ptr(&buf),
+                                  rec.rec_header.packet_header.caplen)) {
+      known = TRUE;
+      passed = FALSE;
+      depended_upon = FALSE;
+    }
+
     /* If the previous frame is displayed, and we haven't yet seen the
        selected frame, remember that frame - it's the closest one we've
        yet seen before the selected frame. */
@@ -1875,9 +2362,12 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &rec, &buf,
-                                    add_to_packet_list);
+    if (known)
+      add_filtered_packet_to_packet_list(fdata, cf, passed, depended_upon);
+    else
+      add_packet_to_packet_list(fdata, cf, &edt, dfcode,
+                                      cinfo, &rec, &buf,
+                                      add_to_packet_list);
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -1903,6 +2393,10 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
 
+  /* If we've filtered all the frames, remember which ones passed. */
+  if (framenum > frames_count && filter_cache_can_store(cf->dfilter, dfcode))
+    filter_cache_store(cf, cf->dfilter, frames_count);
+
   /* We are done redissecting the packet list. */
   cf->redissecting = FALSE;
 
@@ -28,6 +28,8 @@
  *
  */
 
+#define _GNU_SOURCE /* Otherwise CPU_SET and sched_setaffinity won't be defined on Linux */
+
 #include <config.h>
 
 #ifdef HAVE_LIBPCAP
@@ -51,13 +53,28 @@
 #include <wsutil/win32-utils.h>
 #endif
 
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+#include "ws_attributes.h"
+#include "log.h"
 #include "ringbuffer.h"
 #include <wsutil/file_util.h>
+#include <wsutil/strtoi.h>
 
 #ifdef HAVE_ZLIB
 #include <zlib.h>
 #endif
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+#include <lz4frame.h>
+#endif
+
 /* Ringbuffer file structure */
 typedef struct _rb_file {
   gchar         *name;
@@ -65,6 +82,24 @@ typedef struct _rb_file {
 
 #define MAX_FILENAME_QUEUE  100
 
+#define FS_READ_SIZE                  (1024 * 1024)
+#define COMPRESS_FRAME_SIZE           (4 * 1024 * 1024)  /* input bytes per zstd/LZ4 frame */
+#define COMPRESS_QUEUE_PER_THREAD     2   /* files allowed to wait for each worker */
+#define COMPRESS_DEFAULT_MAX_THREADS  4
+
+typedef enum {
+  RB_COMPRESS_NONE,
+  RB_COMPRESS_GZIP,
+  RB_COMPRESS_ZSTD,
+  RB_COMPRESS_LZ4
+} rb_compress_t;
+
+/* A file waiting to be compressed */
+typedef struct _rb_compress_job {
+  gchar        *name;
+  gint64        queued_time;         /**< monotonic time at which it was queued */
+} rb_compress_job;
+
 /** Ringbuffer data structure */
 typedef struct _ringbuf_data {
   rb_file      *files;
@@ -79,9 +114,17 @@ typedef struct _ringbuf_data {
   char         *io_buffer;              /**< The IO buffer used to write to the file */
   gboolean      group_read_access;   /**< TRUE if files need to be opened with group read access */
   FILE         *name_h;              /**< write names of completed files to this handle */
-  gchar        *compress_type;       /**< compress type */
+  rb_compress_t compress;            /**< compress type */
+  GThreadPool  *compress_pool;       /**< compression workers */
+  guint         compress_pending;    /**< files queued but not yet picked up by a worker */
+  GCond         compress_cond;       /**< signalled when a worker picks up a file */
+  ringbuf_compress_stats compress_stats;
+#ifdef HAVE_SCHED_SETAFFINITY
+  gboolean      has_compress_cpus;
+  cpu_set_t     compress_cpus;       /**< CPUs the compression workers may run on */
+#endif
 
-  GMutex        mutex;               /**< mutex for oldnames */
+  GMutex        mutex;               /**< mutex for oldnames and the compression state */
   gchar        *oldnames[MAX_FILENAME_QUEUE];       /**< filename list of pending to be deleted */
 } ringbuf_data;
 
@@ -123,83 +166,531 @@ static void CleanupOldCap(gchar* name)
   g_mutex_unlock(&rb_data.mutex);
 }
 
+/*
+ * Write a whole buffer to a file descriptor.
+ */
+static gboolean write_all(int fd, const void *buf, size_t len)
+{
+  const guint8 *p = (const guint8 *)buf;
+
+  while (len > 0) {
+    ssize_t n = ws_write(fd, p, (unsigned int)MIN(len, G_MAXINT));
+    if (n <= 0) {
+      return FALSE;
+    }
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+#ifdef HAVE_ZLIB
+/*
+ * compress capture file with gzip
+ */
+static gboolean compress_gzip(int in_fd, int out_fd, guint8 *buffer, guint64 *bytes_in)
+{
+  gboolean ok = TRUE;
+  ssize_t nread;
+  int gz_fd;
+  gzFile fi;
+
+  /* gzclose() closes a duplicate, so the caller still owns out_fd */
+  gz_fd = ws_dup(out_fd);
+  if (gz_fd == -1) {
+    return FALSE;
+  }
+  fi = gzdopen(gz_fd, "wb");
+  if (fi == NULL) {
+    ws_close(gz_fd);
+    return FALSE;
+  }
+
+  while ((nread = ws_read(in_fd, buffer, FS_READ_SIZE)) > 0) {
+    *bytes_in += nread;
+    if (gzwrite(fi, buffer, (unsigned int)nread) <= 0) {
+      ok = FALSE;
+      break;
+    }
+  }
+  if (nread < 0) {
+    ok = FALSE;
+  }
+  if (gzclose(fi) != Z_OK) {
+    ok = FALSE;
+  }
+  return ok;
+}
+#endif /* HAVE_ZLIB */
+
+#ifdef HAVE_ZSTD
+/*
+ * compress capture file with zstd
+ *
+ * The output is split into independent frames, so that readers can
+ * seek in the compressed file without decompressing it from the start.
+ */
+static gboolean compress_zstd(int in_fd, int out_fd, guint8 *buffer, guint64 *bytes_in)
+{
+  ZSTD_CStream *zcs;
+  size_t out_size = ZSTD_CStreamOutSize();
+  guint8 *out_buf;
+  guint64 frame_in = 0;
+  gboolean ok = TRUE;
+  ssize_t nread = 0;
+  size_t ret;
+
+  zcs = ZSTD_createCStream();
+  if (zcs == NULL) {
+    return FALSE;
+  }
+  out_buf = (guint8 *)g_malloc(out_size);
+
+  /* favour speed; the files are compressed while the capture is running */
+  if (ZSTD_isError(ZSTD_initCStream(zcs, 1))) {
+    ok = FALSE;
+  }
+  while (ok && (nread = ws_read(in_fd, buffer, FS_READ_SIZE)) > 0) {
+    ZSTD_inBuffer in = { buffer, (size_t)nread, 0 };
+
+    *bytes_in += nread;
+    while (in.pos < in.size) {
+      ZSTD_outBuffer out = { out_buf, out_size, 0 };
+
+      ret = ZSTD_compressStream(zcs, &out, &in);
+      if (ZSTD_isError(ret) || !write_all(out_fd, out_buf, out.pos)) {
+        ok = FALSE;
+        break;
+      }
+    }
+    frame_in += nread;
+    if (ok && frame_in >= COMPRESS_FRAME_SIZE) {
+      do {
+        ZSTD_outBuffer out = { out_buf, out_size, 0 };
+
+        ret = ZSTD_endStream(zcs, &out);
+        if (ZSTD_isError(ret) || !write_all(out_fd, out_buf, out.pos)) {
+          ok = FALSE;
+          break;
+        }
+      } while (ret != 0);
+      if (ok && ZSTD_isError(ZSTD_initCStream(zcs, 1))) {
+        ok = FALSE;
+      }
+      frame_in = 0;
+    }
+  }
+  if (nread < 0) {
+    ok = FALSE;
+  }
+  while (ok) {
+    ZSTD_outBuffer out = { out_buf, out_size, 0 };
+
+    ret = ZSTD_endStream(zcs, &out);
+    if (ZSTD_isError(ret) || !write_all(out_fd, out_buf, out.pos)) {
+      ok = FALSE;
+    } else if (ret == 0) {
+      break;
+    }
+  }
+
+  g_free(out_buf);
+  ZSTD_freeCStream(zcs);
+  return ok;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+#ifndef LZ4F_HEADER_SIZE_MAX
+#define LZ4F_HEADER_SIZE_MAX 19
+#endif
+
+/*
+ * compress capture file with LZ4
+ *
+ * As with zstd, the output is split into independent frames.
+ */
+static gboolean compress_lz4(int in_fd, int out_fd, guint8 *buffer, guint64 *bytes_in)
+{
+  LZ4F_cctx *cctx;
+  size_t out_size = LZ4F_HEADER_SIZE_MAX + LZ4F_compressBound(FS_READ_SIZE, NULL);
+  guint8 *out_buf;
+  guint64 frame_in = 0;
+  gboolean in_frame = FALSE;
+  gboolean ok = TRUE;
+  ssize_t nread = 0;
+  size_t ret;
+
+  if (LZ4F_isError(LZ4F_createCompressionContext(&cctx, LZ4F_VERSION))) {
+    return FALSE;
+  }
+  out_buf = (guint8 *)g_malloc(out_size);
+
+  while (ok && (nread = ws_read(in_fd, buffer, FS_READ_SIZE)) > 0) {
+    *bytes_in += nread;
+    if (!in_frame) {
+      ret = LZ4F_compressBegin(cctx, out_buf, out_size, NULL);
+      if (LZ4F_isError(ret) || !write_all(out_fd, out_buf, ret)) {
+        ok = FALSE;
+        break;
+      }
+      in_frame = TRUE;
+    }
+    ret = LZ4F_compressUpdate(cctx, out_buf, out_size, buffer, (size_t)nread, NULL);
+    if (LZ4F_isError(ret) || !write_all(out_fd, out_buf, ret)) {
+      ok = FALSE;
+      break;
+    }
+    frame_in += nread;
+    if (frame_in >= COMPRESS_FRAME_SIZE) {
+      ret = LZ4F_compressEnd(cctx, out_buf, out_size, NULL);
+      if (LZ4F_isError(ret) || !write_all(out_fd, out_buf, ret)) {
+        ok = FALSE;
+        break;
+      }
+      in_frame = FALSE;
+      frame_in = 0;
+    }
+  }
+  if (nread < 0) {
+    ok = FALSE;
+  }
+  if (ok && in_frame) {
+    ret = LZ4F_compressEnd(cctx, out_buf, out_size, NULL);
+    if (LZ4F_isError(ret) || !write_all(out_fd, out_buf, ret)) {
+      ok = FALSE;
+    }
+  }
+
+  g_free(out_buf);
+  LZ4F_freeCompressionContext(cctx);
+  return ok;
+}
+#endif /* HAVE_LZ4FRAME_H */
+
 /*
  * compress capture file
  */
-static int ringbuf_exec_compress(gchar* name)
+static gboolean ringbuf_exec_compress(const gchar* name, guint64 *bytes_in, guint64 *bytes_out)
 {
   guint8  *buffer = NULL;
-  gchar* outgz = NULL;
+  gchar* outname = NULL;
   int  fd = -1;
-  ssize_t nread;
-  gboolean delete_org_file = TRUE;
-  gzFile fi = NULL;
+  int  out_fd = -1;
+  gboolean delete_org_file = FALSE;
+  ws_statb64 statb;
+
+  *bytes_in = 0;
+  *bytes_out = 0;
 
   fd = ws_open(name, O_RDONLY | O_BINARY, 0000);
   if (fd < 0) {
-    return -1;
+    return FALSE;
   }
 
-  outgz = g_strdup_printf("%s.gz", name);
-  fi = gzopen(outgz, "wb");
-  g_free(outgz);
-  if (fi == NULL) {
+  switch (rb_data.compress) {
+#ifdef HAVE_ZLIB
+  case RB_COMPRESS_GZIP:
+    outname = g_strdup_printf("%s.gz", name);
+    break;
+#endif
+#ifdef HAVE_ZSTD
+  case RB_COMPRESS_ZSTD:
+    outname = g_strdup_printf("%s.zst", name);
+    break;
+#endif
+#ifdef HAVE_LZ4FRAME_H
+  case RB_COMPRESS_LZ4:
+    outname = g_strdup_printf("%s.lz4", name);
+    break;
+#endif
+  default:
+    break;
+  }
+  if (outname == NULL) {
     ws_close(fd);
-    return -1;
+    return FALSE;
   }
 
-#define FS_READ_SIZE 65536
-  buffer = (guint8*)g_malloc(FS_READ_SIZE);
-  if (buffer == NULL) {
+  /* create the compressed file the same way as the capture file itself */
+  out_fd = ws_open(outname, O_WRONLY|O_BINARY|O_TRUNC|O_CREAT,
+                   rb_data.group_read_access ? 0640 : 0600);
+  if (out_fd == -1) {
     ws_close(fd);
-    gzclose(fi);
-    return -1;
+    g_free(outname);
+    return FALSE;
   }
 
-  while ((nread = ws_read(fd, buffer, FS_READ_SIZE)) > 0) {
-    int n = gzwrite(fi, buffer, (unsigned int)nread);
-    if (n <= 0) {
-      /* mark compression as failed */
-      delete_org_file = FALSE;
-      break;
-    }
+  buffer = (guint8*)g_malloc(FS_READ_SIZE);
+
+  switch (rb_data.compress) {
+
+#ifdef HAVE_ZLIB
+  case RB_COMPRESS_GZIP:
+    delete_org_file = compress_gzip(fd, out_fd, buffer, bytes_in);
+    break;
+#endif
+
+#ifdef HAVE_ZSTD
+  case RB_COMPRESS_ZSTD:
+    delete_org_file = compress_zstd(fd, out_fd, buffer, bytes_in);
+    break;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+  case RB_COMPRESS_LZ4:
+    delete_org_file = compress_lz4(fd, out_fd, buffer, bytes_in);
+    break;
+#endif
+
+  default:
+    break;
   }
-  if (nread < 0) {
-    /* mark compression as failed */
+
+  ws_close(fd);
+  if (ws_close(out_fd) != 0) {
     delete_org_file = FALSE;
   }
-  ws_close(fd);
-  gzclose(fi);
   g_free(buffer);
 
   /* delete the original file only if compression succeeds */
   if (delete_org_file) {
+    if (ws_stat64(outname, &statb) == 0) {
+      *bytes_out = statb.st_size;
+    }
     ws_unlink(name);
     CleanupOldCap(name);
+  } else if (outname != NULL) {
+    /* don't leave a partial compressed file next to the original */
+    ws_unlink(outname);
   }
-  g_free(name);
-  return 0;
+  g_free(outname);
+  return delete_org_file;
 }
 
 /*
- * thread to compress capture file
+ * Run compression threads only on the CPUs given with --compress-cpus,
+ * so that they can be kept away from the one the capture thread uses.
  */
-static void* exec_compress_thread(void* arg)
+static void ringbuf_compress_set_affinity(void)
 {
-  ringbuf_exec_compress((gchar*)arg);
-  return NULL;
+#ifdef HAVE_SCHED_SETAFFINITY
+  if (rb_data.has_compress_cpus) {
+    if (sched_setaffinity(0, sizeof(rb_data.compress_cpus), &rb_data.compress_cpus) != 0) {
+      g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+            "Can't set the CPU affinity of a compression thread: %s", g_strerror(errno));
+    }
+  }
+#endif
+}
+
+/*
+ * compression worker; runs in one of the thread pool's threads
+ */
+static void compress_worker(gpointer data, gpointer user_data _U_)
+{
+  rb_compress_job *job = (rb_compress_job *)data;
+  guint64 bytes_in, bytes_out;
+  gboolean ok;
+  gint64 lag;
+
+  /* this job is no longer waiting; let a blocked capture thread go on */
+  g_mutex_lock(&rb_data.mutex);
+  rb_data.compress_pending--;
+  g_cond_signal(&rb_data.compress_cond);
+  g_mutex_unlock(&rb_data.mutex);
+
+  ringbuf_compress_set_affinity();
+  ok = ringbuf_exec_compress(job->name, &bytes_in, &bytes_out);
+  lag = g_get_monotonic_time() - job->queued_time;
+
+  g_mutex_lock(&rb_data.mutex);
+  if (ok) {
+    rb_data.compress_stats.files_compressed++;
+  } else {
+    rb_data.compress_stats.files_failed++;
+  }
+  rb_data.compress_stats.bytes_in += bytes_in;
+  rb_data.compress_stats.bytes_out += bytes_out;
+  rb_data.compress_stats.lag_total_us += lag;
+  if ((guint64)lag > rb_data.compress_stats.lag_max_us) {
+    rb_data.compress_stats.lag_max_us = lag;
+  }
+  g_mutex_unlock(&rb_data.mutex);
+
+  g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+        "Compressed %s: %" G_GUINT64_FORMAT " -> %" G_GUINT64_FORMAT " bytes, %" G_GINT64_FORMAT " ms after switch%s",
+        job->name, bytes_in, bytes_out, lag / 1000, ok ? "" : " (failed)");
+
+  g_free(job->name);
+  g_free(job);
 }
 
 /*
- * start a thread to compress capture file
+ * hand a capture file to the compression workers
+ *
+ * If too many files are already waiting for a worker, wait for one to
+ * be picked up; the capture then backs up into the capture buffer
+ * rather than the number of uncompressed files growing without bound.
  */
 static int ringbuf_start_compress_file(rb_file* rfile)
 {
-  gchar* name = g_strdup(rfile->name);
-  g_thread_new("exec_compress", &exec_compress_thread, name);
+  rb_compress_job *job;
+  guint max_pending;
+
+  if (rb_data.compress_pool == NULL) {
+    return -1;
+  }
+
+  job = g_new(rb_compress_job, 1);
+  job->name = g_strdup(rfile->name);
+
+  max_pending = COMPRESS_QUEUE_PER_THREAD * (guint)g_thread_pool_get_max_threads(rb_data.compress_pool);
+
+  g_mutex_lock(&rb_data.mutex);
+  if (rb_data.compress_pending >= max_pending) {
+    gint64 stall_start = g_get_monotonic_time();
+
+    while (rb_data.compress_pending >= max_pending) {
+      g_cond_wait(&rb_data.compress_cond, &rb_data.mutex);
+    }
+    rb_data.compress_stats.stall_us += g_get_monotonic_time() - stall_start;
+  }
+  rb_data.compress_pending++;
+  rb_data.compress_stats.files_queued++;
+  if (rb_data.compress_pending > rb_data.compress_stats.max_pending) {
+    rb_data.compress_stats.max_pending = rb_data.compress_pending;
+  }
+  job->queued_time = g_get_monotonic_time();
+  g_mutex_unlock(&rb_data.mutex);
+
+  g_thread_pool_push(rb_data.compress_pool, job, NULL);
   return 0;
 }
 
+#ifdef HAVE_SCHED_SETAFFINITY
+/*
+ * parse a list of CPUs such as "2,4-7"
+ */
+static gboolean parse_cpu_list(const gchar *list, cpu_set_t *set)
+{
+  const gchar *p = list;
+
+  CPU_ZERO(set);
+  while (*p != '\0') {
+    guint32 first, last;
+
+    if (!ws_strtou32(p, &p, &first)) {
+      return FALSE;
+    }
+    last = first;
+    if (*p == '-') {
+      if (!ws_strtou32(p + 1, &p, &last) || last < first) {
+        return FALSE;
+      }
+    }
+    if (last >= CPU_SETSIZE) {
+      return FALSE;
+    }
+    for (; first <= last; first++) {
+      CPU_SET(first, set);
+    }
+    if (*p == ',') {
+      p++;
+    } else if (*p != '\0') {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+#endif
+
+/*
+ * set up the compression worker pool
+ */
+static void ringbuf_compress_init(const gchar *compress_type, guint compress_threads,
+                                  const gchar *compress_cpus)
+{
+  GError *error = NULL;
+
+  rb_data.compress = RB_COMPRESS_NONE;
+  rb_data.compress_pool = NULL;
+  rb_data.compress_pending = 0;
+  memset(&rb_data.compress_stats, 0, sizeof rb_data.compress_stats);
+  g_cond_init(&rb_data.compress_cond);
+
+  if (compress_type == NULL) {
+    return;
+#ifdef HAVE_ZLIB
+  } else if (strcmp(compress_type, "gzip") == 0) {
+    rb_data.compress = RB_COMPRESS_GZIP;
+#endif
+#ifdef HAVE_ZSTD
+  } else if (strcmp(compress_type, "zstd") == 0) {
+    rb_data.compress = RB_COMPRESS_ZSTD;
+#endif
+#ifdef HAVE_LZ4FRAME_H
+  } else if (strcmp(compress_type, "lz4") == 0) {
+    rb_data.compress = RB_COMPRESS_LZ4;
+#endif
+  } else {
+    return;
+  }
+
+#ifdef HAVE_SCHED_SETAFFINITY
+  rb_data.has_compress_cpus = FALSE;
+  if (compress_cpus != NULL) {
+    if (parse_cpu_list(compress_cpus, &rb_data.compress_cpus)) {
+      rb_data.has_compress_cpus = TRUE;
+    } else {
+      g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+            "Ignoring invalid compression CPU list \"%s\"", compress_cpus);
+    }
+  }
+#else
+  if (compress_cpus != NULL) {
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+          "Setting the CPU affinity of compression threads isn't supported on this platform");
+  }
+#endif
+
+  if (compress_threads == 0) {
+    /* leave at least half the CPUs for capturing */
+    compress_threads = MAX(1, MIN(COMPRESS_DEFAULT_MAX_THREADS, g_get_num_processors() / 2));
+  }
+  rb_data.compress_pool = g_thread_pool_new(compress_worker, NULL, compress_threads, TRUE, &error);
+  if (rb_data.compress_pool == NULL) {
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+          "Can't start compression threads, files won't be compressed: %s", error->message);
+    g_error_free(error);
+    rb_data.compress = RB_COMPRESS_NONE;
+  }
+}
+
+/*
+ * Wait for all the files handed to the compression workers to be
+ * compressed, and stop the workers.
+ */
+void
+ringbuf_compress_finish(void)
+{
+  if (rb_data.compress_pool != NULL) {
+    g_thread_pool_free(rb_data.compress_pool, FALSE, TRUE);
+    rb_data.compress_pool = NULL;
+  }
+}
+
+/*
+ * Get the compression statistics so far.
+ */
+void
+ringbuf_get_compress_stats(ringbuf_compress_stats *stats)
+{
+  g_mutex_lock(&rb_data.mutex);
+  *stats = rb_data.compress_stats;
+  g_mutex_unlock(&rb_data.mutex);
+}
+
 /*
  * create the next filename and open a new binary file with that name
  */
@@ -215,7 +706,7 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
       /* remove old file (if any, so ignore error) */
       ws_unlink(rfile->name);
     }
-    else if (rb_data.compress_type != NULL && strcmp(rb_data.compress_type, "gzip") == 0) {
+    else if (rb_data.compress != RB_COMPRESS_NONE) {
       ringbuf_start_compress_file(rfile);
     }
     g_free(rfile->name);
@@ -255,7 +746,8 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
  * Initialize the ringbuffer data structures
  */
 int
-ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access, gchar *compress_type)
+ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access, gchar *compress_type,
+             guint compress_threads, const gchar *compress_cpus)
 {
   unsigned int i;
   char        *pfx, *last_pathsep;
@@ -271,8 +763,8 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.io_buffer = NULL;
   rb_data.group_read_access = group_read_access;
   rb_data.name_h = NULL;
-  rb_data.compress_type = compress_type;
   g_mutex_init(&rb_data.mutex);
+  ringbuf_compress_init(compress_type, compress_threads, compress_cpus);
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -515,6 +1007,8 @@ ringbuf_free(void)
 {
   unsigned int i;
 
+  ringbuf_compress_finish();
+
   if (rb_data.files != NULL) {
     for (i=0; i < rb_data.num_files; i++) {
       if (rb_data.files[i].name != NULL) {
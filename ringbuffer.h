@@ -23,7 +23,21 @@
 /* Maximum number for FAT filesystems */
 #define RINGBUFFER_WARN_NUM_FILES 65535
 
-int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access, gchar* compress_type);
+/** Statistics on the compression of completed ringbuffer files */
+typedef struct _ringbuf_compress_stats {
+  guint         files_queued;        /**< files handed to the compression workers */
+  guint         files_compressed;    /**< files compressed successfully */
+  guint         files_failed;        /**< files left uncompressed because of an error */
+  guint         max_pending;         /**< most files waiting for a worker at one time */
+  guint64       bytes_in;            /**< uncompressed bytes read */
+  guint64       bytes_out;           /**< compressed bytes written */
+  guint64       lag_total_us;        /**< sum over all files of the time from switch to compressed */
+  guint64       lag_max_us;          /**< largest time from switch to compressed */
+  guint64       stall_us;            /**< time the capture spent waiting for a free queue slot */
+} ringbuf_compress_stats;
+
+int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access, gchar* compress_type,
+                 guint compress_threads, const gchar *compress_cpus);
 gboolean ringbuf_is_initialized(void);
 const gchar *ringbuf_current_filename(void);
 FILE *ringbuf_init_libpcap_fdopen(int *err);
@@ -33,6 +47,8 @@ gboolean ringbuf_libpcap_dump_close(gchar **save_file, int *err);
 void ringbuf_free(void);
 void ringbuf_error_cleanup(void);
 gboolean ringbuf_set_print_name(gchar *name, int *err);
+void ringbuf_compress_finish(void);
+void ringbuf_get_compress_stats(ringbuf_compress_stats *stats);
 
 #endif /* ringbuffer.h */
 
@@ -319,15 +319,110 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
 }
 
 
+/*
+ * Set up the frame list from a packet index, without dissecting any of
+ * the packets; they're dissected, in order, by dissect_deferred_frames()
+ * when they're first needed.  Returns FALSE, leaving the frame list
+ * empty, if the index couldn't be read.
+ */
+static gboolean
+load_packet_index(capture_file *cf, wtap_packet_index *pidx)
+{
+  wtap_rec       rec;
+  frame_data     fdlocal;
+  frame_data    *fdata;
+  gint64         offset;
+  gboolean       has_comment;
+  int            err;
+
+  wtap_rec_init(&rec);
+  while (wtap_packet_index_read(pidx, &rec, &offset, &has_comment, &err)) {
+    frame_data_init(&fdlocal, cf->count + 1, &rec, offset, cum_bytes);
+    fdlocal.has_phdr_comment = has_comment;
+    fdata = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+    cf->count++;
+
+    /* As process_packet() does, with every frame passing. */
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &cf->provider.ref, cf->provider.prev_dis);
+    frame_data_set_after_dissect(fdata, &cum_bytes);
+    cf->provider.prev_cap = cf->provider.prev_dis = fdata;
+  }
+  wtap_rec_cleanup(&rec);
+
+  if (err != 0 || cf->count != wtap_packet_index_count(pidx)) {
+    /* Forget what we've got; the file will be read the usual way. */
+    free_frame_data_sequence(cf->provider.frames);
+    cf->provider.frames = new_frame_data_sequence();
+    cf->provider.ref = NULL;
+    cf->provider.prev_dis = NULL;
+    cf->provider.prev_cap = NULL;
+    nstime_set_zero(&cf->elapsed_time);
+    cf->count = 0;
+    cum_bytes = 0;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/*
+ * If the frames came from a packet index, dissect those up to and
+ * including framenum that haven't been dissected yet, in order, so that
+ * what the dissectors remember from one frame to the next is the same
+ * as if we'd read the file.
+ */
+static void
+dissect_deferred_frames(capture_file *cf, guint32 framenum)
+{
+  epan_dissect_t edt;
+  frame_data    *fdata;
+  wtap_rec       rec;
+  Buffer         buf;
+  int            err;
+  gchar         *err_info = NULL;
+
+  if (!cf->first_pass_deferred || framenum <= cf->first_pass_done)
+    return;
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+  epan_dissect_init(&edt, cf->epan, postdissectors_want_hfids(), FALSE);
+
+  while (cf->first_pass_done < framenum) {
+    fdata = frame_data_sequence_find(cf->provider.frames, cf->first_pass_done + 1);
+    if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, &err, &err_info)) {
+      /* Leave it to our caller to report. */
+      g_free(err_info);
+      break;
+    }
+    prime_epan_dissect_with_postdissector_wanted_hfids(&edt);
+    epan_dissect_run(&edt, cf->cd_t, &rec,
+                     frame_tvbuff_new_buffer(&cf->provider, fdata, &buf),
+                     fdata, NULL);
+    epan_dissect_reset(&edt);
+    cf->first_pass_done++;
+  }
+
+  epan_dissect_cleanup(&edt);
+  wtap_rec_cleanup(&rec);
+  ws_buffer_free(&buf);
+
+  if (cf->first_pass_done == cf->count)
+    cf->first_pass_deferred = FALSE;
+}
+
 static int
 load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
 {
-  int          err;
+  int          err = 0;
   gchar       *err_info = NULL;
   gint64       data_offset;
   wtap_rec     rec;
   Buffer       buf;
   epan_dissect_t *edt = NULL;
+  gboolean     stopped_early = FALSE;
+  wtap_packet_index *pidx = NULL;
+  gboolean     indexed = FALSE;
 
   {
     /* Allocate a frame_data_sequence for all the frames. */
@@ -358,7 +453,40 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
 
-    while (wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset)) {
+    /* As in Wireshark, a fast-seek index comes with a packet index, so
+       that loading a compressed file again doesn't decompress all of it. */
+    if ((prefs.gui_packet_index ||
+         (prefs.gui_fast_seek_index &&
+          wtap_get_compression_type(cf->provider.wth) != WTAP_UNCOMPRESSED)) &&
+        !cf->is_tempfile) {
+      /*
+       * If we're reading the whole file, and nothing needs to see every
+       * packet as it's read, and we saved a packet index for this file
+       * the last time we read it, set up the frame list from that, and
+       * leave the dissection to the requests that need it.  Otherwise,
+       * save an index as we read the file.
+       */
+      if (cf->rfcode == NULL && cf->dfcode == NULL && !postdissectors_want_hfids() &&
+          max_packet_count == 0 && max_byte_count == 0) {
+        pidx = wtap_packet_index_open(cf->provider.wth);
+        if (pidx != NULL) {
+          indexed = load_packet_index(cf, pidx);
+          wtap_packet_index_close(pidx);
+          pidx = NULL;
+        }
+      }
+      if (!indexed) {
+        int create_err;
+
+        pidx = wtap_packet_index_create(cf->provider.wth, &create_err);
+      }
+    }
+    cf->first_pass_deferred = indexed;
+    cf->first_pass_done = 0;
+
+    while (!indexed && wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset)) {
+      if (pidx != NULL)
+        wtap_packet_index_add(pidx, &rec, data_offset);
       if (process_packet(cf, edt, data_offset, &rec, &buf)) {
         /* Stop reading if we have the maximum number of packets;
          * When the -c option has not been used, max_packet_count
@@ -367,6 +495,7 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
          */
         if ( (--max_packet_count == 0) || (max_byte_count != 0 && data_offset >= max_byte_count)) {
           err = 0; /* This is not an error */
+          stopped_early = TRUE;
           break;
         }
       }
@@ -380,6 +509,22 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
     wtap_rec_cleanup(&rec);
     ws_buffer_free(&buf);
 
+    /* If we read the entire file, save the fast-seek information we
+       gathered, so that the next load doesn't have to gather it again. */
+    if (prefs.gui_fast_seek_index && err == 0 && !stopped_early) {
+      int save_err;
+
+      wtap_save_fast_seek_index(cf->provider.wth, &save_err);
+    }
+
+    /* Likewise for the packet index, which is only any use if it has
+       all the records. */
+    if (pidx != NULL) {
+      int save_err;
+
+      wtap_packet_index_finish(pidx, err == 0 && !stopped_early, &save_err);
+    }
+
     /* Close the sequential I/O side, to free up memory it requires. */
     wtap_sequential_close(cf->provider.wth);
 
@@ -408,6 +553,11 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   if (wth == NULL)
     goto fail;
 
+  /* If we saved fast-seek information for this file the last time
+     we read it, use it. */
+  if (prefs.gui_fast_seek_index && !is_tempfile)
+    wtap_load_fast_seek_index(wth);
+
   /* The open succeeded.  Fill in the information for this file. */
 
   cf->provider.wth = wth;
@@ -540,6 +690,8 @@ sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num, guint32 prev_dis
   if (fdata == NULL)
     return -1;
 
+  dissect_deferred_frames(&cfile, framenum);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
@@ -600,6 +752,8 @@ sharkd_dissect_columns(frame_data *fdata, guint32 frame_ref_num, guint32 prev_di
   int err;
   char *err_info = NULL;
 
+  dissect_deferred_frames(&cfile, fdata->num);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
@@ -676,6 +830,9 @@ sharkd_retap(void)
   create_proto_tree =
     (have_filtering_tap_listeners() || (tap_flags & TL_REQUIRES_PROTO_TREE));
 
+  /* The taps see the frames after they've all been dissected in order. */
+  dissect_deferred_frames(&cfile, cfile.count);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
   epan_dissect_init(&edt, cfile.epan, create_proto_tree, FALSE);
@@ -736,6 +893,8 @@ sharkd_filter(const char *dftext, guint8 **result)
 
   frames_count = cfile.count;
 
+  dissect_deferred_frames(&cfile, frames_count);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
   epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
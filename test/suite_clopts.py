@@ -285,6 +285,91 @@ class case_tshark_z_expert(subprocesstest.SubprocessTestCase):
         self.assertFalse(self.grepOutput('Chats'))
 
 
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_z_io_stat_filter_set(subprocesstest.SubprocessTestCase):
+    # Tap listener filters are applied as one filter set; filters sharing
+    # fields and comparisons must still get their own results.
+    def io_stat_frames(self, cmd_tshark, capture_file, filters):
+        proc = self.assertRun((cmd_tshark, '-n', '-q',
+            '-r', capture_file('nfs.pcap'),
+            '-z', 'io,stat,0,' + ','.join(filters)))
+        rows = [line for line in proc.stdout_str.splitlines() if ' <> ' in line]
+        self.assertTrue(rows, 'No io,stat rows in output:\n%s' % proc.stdout_str)
+        cells = [cell.strip() for cell in rows[-1].split('|') if cell.strip()]
+        # The interval, then frames and bytes for each filter.
+        return [int(frames) for frames in cells[1::2]]
+
+    def test_tshark_z_io_stat_shared_fields(self, cmd_tshark, capture_file):
+        filters = (
+            'ip.src == 172.25.100.14',
+            'ip.src == 172.25.100.14 || frame.number == 2',
+            'frame.number == 2 && ip.src == 172.25.100.14',
+            'frame.number == 2',
+            'ip.src != 172.25.100.14',
+        )
+        frames = self.io_stat_frames(cmd_tshark, capture_file, filters)
+        self.assertEqual(frames, [1, 2, 0, 1, 1])
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_second_pass_workers(subprocesstest.SubprocessTestCase):
+    # Splitting the second pass between processes mustn't change what's
+    # printed; one frame per worker makes sure the workers are used.
+    def assertSameOutput(self, cmd_tshark, capture_file, *args):
+        if sys.platform == 'win32':
+            self.skipTest('--second-pass-workers is not available on Windows.')
+        cmd = (cmd_tshark, '-n', '-2', '-r', capture_file('http-ooo.pcap')) + args
+        sequential = self.assertRun(cmd)
+        workers = self.assertRun(cmd + ('--second-pass-workers', '4,1'))
+        self.assertTrue(sequential.stdout_str)
+        self.assertEqual(workers.stdout_str, sequential.stdout_str)
+
+    def test_tshark_second_pass_workers_summary(self, cmd_tshark, capture_file):
+        self.assertSameOutput(cmd_tshark, capture_file)
+
+    def test_tshark_second_pass_workers_details(self, cmd_tshark, capture_file):
+        self.assertSameOutput(cmd_tshark, capture_file, '-V')
+
+    def test_tshark_second_pass_workers_json(self, cmd_tshark, capture_file):
+        self.assertSameOutput(cmd_tshark, capture_file, '-T', 'json')
+
+    def test_tshark_second_pass_workers_filter(self, cmd_tshark, capture_file):
+        self.assertSameOutput(cmd_tshark, capture_file, '-Y', 'tcp.len > 0',
+            '-T', 'fields', '-e', 'frame.number', '-e', 'frame.time_delta_displayed')
+
+    def test_tshark_second_pass_workers_time_delta_displayed(self, cmd_tshark, capture_file):
+        self.assertSameOutput(cmd_tshark, capture_file,
+            '-Y', 'tcp.len > 0 && frame.time_delta_displayed > 0',
+            '-T', 'fields', '-e', 'frame.number')
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_fields_flat(subprocesstest.SubprocessTestCase):
+    # Without protocols among the fields, -T fields only primes the tree
+    # with them; a protocol field makes it walk the whole visible tree.
+    # Both must give the same values, in the same order.
+    def test_tshark_fields_flat_same_as_tree(self, cmd_tshark, capture_file):
+        fields = ('frame.number', 'ip.addr', 'dhcp.option.type',
+            'dhcp.option.type', 'udp.port', 'ip.addr')
+        cmd = [cmd_tshark, '-r', capture_file('dhcp.pcap'), '-T', 'fields']
+        for field in fields:
+            cmd += ['-e', field]
+        flat = self.assertRun(cmd).stdout_str.splitlines()
+        tree = self.assertRun(cmd + ['-e', 'frame']).stdout_str.splitlines()
+        self.assertEqual(len(flat), 4)
+        self.assertEqual(flat, [line.rsplit('\t', 1)[0] for line in tree])
+        # A field given twice only fills the last of its columns, and
+        # repeated fields have all their values.
+        cells = flat[0].split('\t')
+        self.assertEqual(cells[1], '')
+        self.assertEqual(cells[2], '')
+        self.assertIn(',', cells[3])
+        self.assertEqual(cells[5], '0.0.0.0,255.255.255.255')
+
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_tshark_extcap(subprocesstest.SubprocessTestCase):
@@ -306,3 +391,74 @@ class case_tshark_extcap(subprocesstest.SubprocessTestCase):
         # Ensure tshark lists 2 interfaces in the preferences
         self.assertRun((cmd_tshark, '-G', 'currentprefs'), env=test_env)
         self.assertEqual(2, self.countOutput('extcap.sampleif.test'))
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_editcap_dedup_clopts(subprocesstest.SubprocessTestCase):
+    # dhcp.pcap has four different packets, 314, 342, 314 and 342 bytes
+    # long, all within 0.1 seconds.
+    def dup_file(self, cmd_mergecap, capture_file, append=True):
+        '''Two copies of dhcp.pcap, one after the other or merged by time.'''
+        dup_pcap = self.filename_from_id('dup.pcap')
+        merge_args = [cmd_mergecap, '-F', 'pcap', '-w', dup_pcap]
+        if append:
+            merge_args.append('-a')
+        self.assertRun(merge_args + [capture_file('dhcp.pcap'), capture_file('dhcp.pcap')])
+        return dup_pcap
+
+    def test_editcap_dedup_d(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''Each copy is at most four packets after the original'''
+        self.assertRun((cmd_editcap, '-d',
+            self.dup_file(cmd_mergecap, capture_file),
+            self.filename_from_id(testout_pcap)))
+        self.assertTrue(self.grepOutput('8 packets seen, 4 packets skipped with duplicate window of 5 packets'))
+        self.checkPacketCount(4)
+
+    def test_editcap_dedup_D_too_small(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''A window of four packets doesn't reach back to the originals'''
+        self.assertRun((cmd_editcap, '-D', '4',
+            self.dup_file(cmd_mergecap, capture_file),
+            self.filename_from_id(testout_pcap)))
+        self.assertTrue(self.grepOutput('8 packets seen, 0 packets skipped'))
+        self.checkPacketCount(8)
+
+    def test_editcap_dedup_w(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''Copies merged by time have the time stamps of the originals'''
+        self.assertRun((cmd_editcap, '-w', '0.000001',
+            self.dup_file(cmd_mergecap, capture_file, append=False),
+            self.filename_from_id(testout_pcap)))
+        self.assertTrue(self.grepOutput('8 packets seen, 4 packets skipped'))
+        self.checkPacketCount(4)
+
+    def test_editcap_dedup_w_all_entries(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''An older copy within the time window counts even if a newer one is later'''
+        first = self.filename_from_id('first.pcap')
+        later = self.filename_from_id('later.pcap')
+        between = self.filename_from_id('between.pcap')
+        ooo_pcap = self.filename_from_id('ooo.pcap')
+        self.assertRun((cmd_editcap, '-r', capture_file('dhcp.pcap'), first, '1'))
+        self.assertRun((cmd_editcap, '-t', '0.8', first, later))
+        self.assertRun((cmd_editcap, '-t', '0.5', first, between))
+        self.assertRun((cmd_mergecap, '-F', 'pcap', '-a', '-w', ooo_pcap, first, later, between))
+        # The last packet is 0.3 seconds before the second one, but 0.5
+        # seconds after the first.
+        self.assertRun((cmd_editcap, '-w', '1', ooo_pcap, self.filename_from_id(testout_pcap)))
+        self.assertTrue(self.grepOutput('3 packets seen, 2 packets skipped'))
+        self.checkPacketCount(1)
+
+    def test_editcap_dedup_byte_window(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''The byte window limits how far back copies are looked for'''
+        dup_pcap = self.dup_file(cmd_mergecap, capture_file)
+        self.assertRun((cmd_editcap, '-d', '--dup-byte-window', '1000',
+            dup_pcap, self.filename_from_id(testout_pcap)))
+        self.assertTrue(self.grepOutput('8 packets seen, 0 packets skipped'))
+        self.assertRun((cmd_editcap, '-d', '--dup-byte-window', '1400',
+            dup_pcap, self.filename_from_id(testout_pcap)))
+        self.assertTrue(self.grepOutput('8 packets seen, 4 packets skipped'))
+
+    def test_editcap_dedup_verbose_md5(self, cmd_editcap, capture_file):
+        '''-v prints the MD5 hash of each packet'''
+        self.assertRun((cmd_editcap, '-v', '-D', '0',
+            capture_file('dhcp.pcap'), self.filename_from_id(testout_pcap)))
+        self.assertTrue(self.grepOutput('Packet: 1, Len: 314, MD5 Hash: fd71192b464be33775fa5576e9301945'))
@@ -57,3 +57,51 @@ def checkDFilterFail(cmd_dftest, base_env):
             'Unexpected dftest exit code: %d. stdout:\n%s\n' % \
             (proc.returncode, outs)
     return checkDFilterFail_real
+
+
+@fixtures.fixture
+def checkDFilterBenchmark(cmd_dftest, capture_file, request, base_env):
+    def checkDFilterBenchmark_real(dfilter, expected_count):
+        """Benchmark a display filter with dftest and expect both the
+        specialized and the generic filter to match a certain number
+        of packets."""
+        proc = subprocess.Popen([cmd_dftest,
+                                 "-r", capture_file(request.instance.trace_file),
+                                 "-n", "1",
+                                 dfilter],
+                                stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE,
+                                universal_newlines=True,
+                                env=base_env)
+        outs, errs = proc.communicate()
+        assert proc.returncode == 0, \
+            'Unexpected dftest exit code: %d. stderr:\n%s\n' % \
+            (proc.returncode, errs)
+        assert (' %d matched,' % (expected_count,)) in outs, \
+            'Unexpected dftest stdout:\n%s' % (outs,)
+    return checkDFilterBenchmark_real
+
+
+@fixtures.fixture
+def checkDFilterPrefilter(cmd_dftest, capture_file, request, base_env):
+    def checkDFilterPrefilter_real(dfilter, expected_count, expected_rejected):
+        """Benchmark a display filter with dftest and expect it to match a
+        certain number of packets, and its prefilter to reject a certain
+        number of packets without dissecting them."""
+        proc = subprocess.Popen([cmd_dftest,
+                                 "-r", capture_file(request.instance.trace_file),
+                                 "-n", "1",
+                                 dfilter],
+                                stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE,
+                                universal_newlines=True,
+                                env=base_env)
+        outs, errs = proc.communicate()
+        assert proc.returncode == 0, \
+            'Unexpected dftest exit code: %d. stderr:\n%s\n' % \
+            (proc.returncode, errs)
+        assert (' %d matched,' % (expected_count,)) in outs, \
+            'Unexpected dftest stdout:\n%s' % (outs,)
+        assert ('Prefilter:   %d rejected' % (expected_rejected,)) in outs, \
+            'Unexpected dftest stdout:\n%s' % (outs,)
+    return checkDFilterPrefilter_real
@@ -0,0 +1,66 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import subprocess
+import unittest
+import fixtures
+from suite_dfilter.dfiltertest import *
+
+
+@fixtures.fixture
+def checkDFilterNarrows(cmd_dftest, capture_file, request, base_env):
+    def checkDFilterNarrows_real(dfilter, cached_dfilter, expected_count, expected_skipped):
+        """Benchmark a display filter with dftest as if the results of
+        another filter were cached, and expect it to match a certain number
+        of packets, and refiltering to skip a certain number of packets
+        without dissecting them, or None if the filter doesn't narrow the
+        cached one."""
+        proc = subprocess.Popen([cmd_dftest,
+                                 "-r", capture_file(request.instance.trace_file),
+                                 "-n", "1",
+                                 "-N", cached_dfilter,
+                                 dfilter],
+                                stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE,
+                                universal_newlines=True,
+                                env=base_env)
+        outs, errs = proc.communicate()
+        assert proc.returncode == 0, \
+            'Unexpected dftest exit code: %d. stderr:\n%s\n' % \
+            (proc.returncode, errs)
+        assert (' %d matched,' % (expected_count,)) in outs, \
+            'Unexpected dftest stdout:\n%s' % (outs,)
+        if expected_skipped is None:
+            narrowed = "Narrowed:    doesn't narrow"
+        else:
+            narrowed = 'Narrowed:    %d skipped' % (expected_skipped,)
+        assert narrowed in outs, \
+            'Unexpected dftest stdout:\n%s' % (outs,)
+    return checkDFilterNarrows_real
+
+
+@fixtures.uses_fixtures
+class case_filter_cache(unittest.TestCase):
+    # dhcp.pcap has a Discover and a Request from the client, and an Offer
+    # and an ACK from the server, 192.168.0.1.
+    trace_file = "dhcp.pcap"
+
+    def test_and(self, checkDFilterNarrows):
+        dfilter = "udp.srcport == 67 && ip.src == 192.168.0.1"
+        checkDFilterNarrows(dfilter, "udp.srcport == 67", 2, 2)
+
+    def test_parenthesized_and(self, checkDFilterNarrows):
+        dfilter = "(udp.srcport == 67) and dhcp"
+        checkDFilterNarrows(dfilter, "udp.srcport == 67", 2, 2)
+
+    def test_and_nothing_matches(self, checkDFilterNarrows):
+        dfilter = "udp.srcport == 68 && ip.src == 192.168.0.1"
+        checkDFilterNarrows(dfilter, "udp.srcport == 68", 0, 2)
+
+    def test_or(self, checkDFilterNarrows):
+        dfilter = "udp.srcport == 67 || udp.srcport == 68"
+        checkDFilterNarrows(dfilter, "udp.srcport == 67", 4, None)
+
+    def test_longer_value(self, checkDFilterNarrows):
+        # "udp.srcport == 6" is a prefix of the text, but not of the filter.
+        dfilter = "udp.srcport == 67 && dhcp"
+        checkDFilterNarrows(dfilter, "udp.srcport == 6", 2, None)
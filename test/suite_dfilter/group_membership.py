@@ -58,3 +58,30 @@ class case_membership(unittest.TestCase):
         dfilter = 'frame.number in {1 "foo"}'
         error = '"foo" cannot be converted to Unsigned integer, 4 bytes.'
         checkDFilterFail(dfilter, error)
+
+    def test_membership_12_large_set(self, checkDFilterCount):
+        ports = ' '.join(str(port) for port in range(1000, 3000))
+        dfilter = 'tcp.port in {%s 80}' % ports
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_13_large_set_no_match(self, checkDFilterCount):
+        ports = ' '.join(str(port) for port in range(1000, 3000))
+        dfilter = 'tcp.port in {%s}' % ports
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_14_overlapping_ranges(self, checkDFilterCount):
+        dfilter = 'tcp.port in {70..75 74..79 79..80}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_15_ip_cidr(self, checkDFilterCount):
+        dfilter = 'ip.addr in {192.168.0.0/16 10.0.0.0/24}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_16_ip_cidr_no_match(self, checkDFilterCount):
+        dfilter = 'ip.addr in {192.168.0.0/16 10.0.1.0/24 10.0.0.200}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_17_set_matches_generic(self, checkDFilterBenchmark):
+        ports = ' '.join(str(port) for port in range(1000, 3000))
+        dfilter = 'tcp.port in {%s 80} && ip.addr in {10.0.0.0/24}' % ports
+        checkDFilterBenchmark(dfilter, 1)
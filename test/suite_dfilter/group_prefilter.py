@@ -0,0 +1,44 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import unittest
+import fixtures
+from suite_dfilter.dfiltertest import *
+
+
+@fixtures.uses_fixtures
+class case_prefilter(unittest.TestCase):
+    trace_file = "dhcp.pcap"
+
+    def test_port(self, checkDFilterPrefilter):
+        dfilter = "udp.srcport == 67"
+        checkDFilterPrefilter(dfilter, 2, 2)
+
+    def test_addr_not_found(self, checkDFilterPrefilter):
+        dfilter = "ip.addr == 10.1.2.3"
+        checkDFilterPrefilter(dfilter, 0, 4)
+
+    def test_addr_in_payload(self, checkDFilterPrefilter):
+        # The DHCP Request carries the server's address in an option,
+        # so it has to be dissected.
+        dfilter = "ip.src == 192.168.0.1"
+        checkDFilterPrefilter(dfilter, 2, 1)
+
+    def test_in_or(self, checkDFilterPrefilter):
+        dfilter = "udp.port in {53 123} || ip.addr == 10.1.2.3"
+        checkDFilterPrefilter(dfilter, 0, 4)
+
+    def test_and_other(self, checkDFilterPrefilter):
+        dfilter = "udp.srcport == 67 && dhcp.option.dhcp == 2"
+        checkDFilterPrefilter(dfilter, 1, 2)
+
+    def test_or_other(self, checkDFilterPrefilter):
+        dfilter = "udp.srcport == 67 || dhcp"
+        checkDFilterPrefilter(dfilter, 4, 0)
+
+    def test_not(self, checkDFilterPrefilter):
+        dfilter = "!(udp.srcport == 67)"
+        checkDFilterPrefilter(dfilter, 2, 0)
+
+    def test_network(self, checkDFilterPrefilter):
+        dfilter = "ip.addr == 192.168.0.0/24"
+        checkDFilterPrefilter(dfilter, 2, 0)
@@ -0,0 +1,87 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import unittest
+import fixtures
+from suite_dfilter.dfiltertest import *
+
+
+@fixtures.uses_fixtures
+class case_specialized(unittest.TestCase):
+    trace_file = "nfs.pcap"
+
+    def test_const_lhs_eq(self, checkDFilterCount):
+        dfilter = "172.25.100.14 == ip.src"
+        checkDFilterCount(dfilter, 1)
+
+    def test_const_lhs_lt(self, checkDFilterCount):
+        dfilter = "1 < frame.number"
+        checkDFilterCount(dfilter, 1)
+
+    def test_const_lhs_ge(self, checkDFilterCount):
+        dfilter = "2 >= frame.number"
+        checkDFilterCount(dfilter, 2)
+
+    def test_in_set(self, checkDFilterCount):
+        dfilter = "frame.number in {1 3}"
+        checkDFilterCount(dfilter, 1)
+
+    def test_bench_const_lhs_gt(self, checkDFilterBenchmark):
+        dfilter = "2 > frame.number"
+        checkDFilterBenchmark(dfilter, 1)
+
+    def test_bench_time_delta_displayed(self, checkDFilterBenchmark):
+        dfilter = "frame.time_delta_displayed > 0"
+        checkDFilterBenchmark(dfilter, 1)
+
+    def test_bench_time_relative(self, checkDFilterBenchmark):
+        dfilter = "frame.time_relative > 0"
+        checkDFilterBenchmark(dfilter, 1)
+
+    def test_bench_uint(self, checkDFilterBenchmark):
+        dfilter = "frame.number > 1"
+        checkDFilterBenchmark(dfilter, 1)
+
+    def test_bench_ipv4(self, checkDFilterBenchmark):
+        dfilter = "ip.src != 255.255.255.255"
+        checkDFilterBenchmark(dfilter, 2)
+
+
+@fixtures.uses_fixtures
+class case_specialized_bytes(unittest.TestCase):
+    trace_file = "ipx_rip.pcap"
+
+    def test_bench_eq(self, checkDFilterBenchmark):
+        dfilter = "eth.dst == ff:ff:ff:ff:ff:ff"
+        checkDFilterBenchmark(dfilter, 1)
+
+    def test_bench_ne(self, checkDFilterBenchmark):
+        dfilter = "eth.src != ff:ff:ff:ff:ff:ff"
+        checkDFilterBenchmark(dfilter, 1)
+
+
+@fixtures.uses_fixtures
+class case_specialized_const_lhs(unittest.TestCase):
+    trace_file = "http.pcap"
+
+    # Only comparisons are specialized; these must keep their operands
+    # in the order they were written.
+    def test_contains(self, checkDFilterCount):
+        dfilter = '"HEADER" contains http.request.method'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_field_lhs(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "HEADER"'
+        checkDFilterCount(dfilter, 0)
+
+    def test_matches(self, checkDFilterCount):
+        # The field isn't a regular expression, so nothing matches it.
+        dfilter = '"HEAD" matches http.request.method'
+        checkDFilterCount(dfilter, 0)
+
+    def test_bench_contains(self, checkDFilterBenchmark):
+        dfilter = '"HEADER" contains http.request.method'
+        checkDFilterBenchmark(dfilter, 1)
+
+    def test_bench_matches(self, checkDFilterBenchmark):
+        dfilter = '"HEAD" matches http.request.method'
+        checkDFilterBenchmark(dfilter, 0)
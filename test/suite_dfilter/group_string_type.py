@@ -132,6 +132,18 @@ class case_string(unittest.TestCase):
         dfilter = 'http.request.method contains 48:45:41:44' # "HEAD"
         checkDFilterCount(dfilter, 1)
 
+    def test_contains_multi_1(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "POST" || http.request.method contains "EA"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_multi_2(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "HEAD" && !(http.request.method contains "ADX")'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_multi_3(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "HEAD" && http.request.method contains "GET"'
+        checkDFilterCount(dfilter, 0)
+
     def test_contains_fail_0(self, checkDFilterCount):
         dfilter = 'http.user_agent contains "update"'
         checkDFilterCount(dfilter, 0)
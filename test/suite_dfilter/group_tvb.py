@@ -60,4 +60,17 @@ class case_tvb(unittest.TestCase):
         dfilter = 'http contains "HEAD"'
         checkDFilterCount(dfilter, 1)
 
+    def test_contains_multi_1(self, checkDFilterCount):
+        dfilter = 'eth contains ff:ff:ff || eth contains 6b:88 || eth contains 88:f5'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_multi_2(self, checkDFilterCount):
+        dfilter = 'eth contains 6b:88 && !(eth contains ff:ff:ff)'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_multi_benchmark(self, checkDFilterBenchmark):
+        # Overlapping patterns, and the same pattern twice.
+        dfilter = 'http contains "EAD /" || http contains "HEAD" || http contains "HEADX" || http contains "HEAD"'
+        checkDFilterBenchmark(dfilter, 1)
+
 
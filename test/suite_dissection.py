@@ -360,6 +360,54 @@ class case_dissect_tcp(subprocesstest.SubprocessTestCase):
             '-Ytls', '-Tfields', '-eframe.number', '-etls.record.length', '-2'))
         self.assertEqual(proc.stdout_str, '2\t16\n')
 
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_dissect_heuristic(subprocesstest.SubprocessTestCase):
+    # UDP packets between ports that no dissector is registered for, so
+    # that only the heuristic dissectors of UDP are tried.
+    artnet = '41 72 74 2d 4e 65 74 00 00 20 00 0e 00 00'  # Art-Net ArtPoll
+    unknown = 'ff ff ff ff'
+
+    def write_udp_capture(self, cmd_text2pcap, payloads):
+        hex_file = self.filename_from_id('heur.txt')
+        with open(hex_file, 'w') as f:
+            for payload in payloads:
+                f.write('0000  %s\n\n' % payload)
+        pcap_file = self.filename_from_id('heur.pcap')
+        self.assertRun((cmd_text2pcap, '-q', '-u', '40000,40001', hex_file, pcap_file))
+        return pcap_file
+
+    def artnet_frames(self, cmd_tshark, pcap_file, *args):
+        proc = self.assertRun((cmd_tshark, '-n', '-r', pcap_file,
+            '-Y', 'artnet', '-T', 'fields', '-e', 'frame.number') + args)
+        return [int(frame) for frame in proc.stdout_str.split()]
+
+    def test_heur_signature(self, cmd_tshark, cmd_text2pcap):
+        '''A heuristic dissector is called for packets with its signature.'''
+        pcap_file = self.write_udp_capture(cmd_text2pcap,
+            [self.unknown, self.artnet, self.unknown])
+        self.assertEqual(self.artnet_frames(cmd_tshark, pcap_file), [2])
+
+    def test_heur_skip_after_misses(self, cmd_tshark, cmd_text2pcap):
+        '''If asked, after 16 unrecognized packets, a conversation isn't tried.'''
+        pcap_file = self.write_udp_capture(cmd_text2pcap,
+            [self.unknown] * 16 + [self.artnet])
+        skip = ('-o', 'protocols.skip_heuristics_after_misses:TRUE')
+        self.assertEqual(self.artnet_frames(cmd_tshark, pcap_file), [17])
+        self.assertEqual(self.artnet_frames(cmd_tshark, pcap_file, '-2'), [17])
+        self.assertEqual(self.artnet_frames(cmd_tshark, pcap_file, *skip), [])
+        self.assertEqual(self.artnet_frames(cmd_tshark, pcap_file, '-2', *skip), [])
+
+    def test_heur_memo_two_pass(self, cmd_tshark, cmd_text2pcap):
+        '''The second pass makes the same decisions as the first.'''
+        pcap_file = self.write_udp_capture(cmd_text2pcap,
+            [self.artnet, self.unknown, self.unknown, self.artnet] +
+            [self.unknown] * 15 + [self.artnet])
+        one_pass = self.assertRun((cmd_tshark, '-n', '-r', pcap_file))
+        two_pass = self.assertRun((cmd_tshark, '-n', '-r', pcap_file, '-2'))
+        self.assertEqual(two_pass.stdout_str, one_pass.stdout_str)
+        self.assertEqual(self.artnet_frames(cmd_tshark, pcap_file, '-2'), [1, 4, 20])
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_dissect_tls(subprocesstest.SubprocessTestCase):
@@ -39,6 +39,8 @@
 
 #ifndef _WIN32
 #include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 #include <glib.h>
@@ -119,6 +121,7 @@
 #include <wsutil/str_util.h>
 #include <wsutil/utf8_entities.h>
 #include <wsutil/json_dumper.h>
+#include <wsutil/tempfile.h>
 
 #include "extcap.h"
 
@@ -143,6 +146,7 @@
 #define LONGOPT_COLOR                   LONGOPT_BASE_APPLICATION+2
 #define LONGOPT_NO_DUPLICATE_KEYS       LONGOPT_BASE_APPLICATION+3
 #define LONGOPT_ELASTIC_MAPPING_FILTER  LONGOPT_BASE_APPLICATION+4
+#define LONGOPT_SECOND_PASS_WORKERS     LONGOPT_BASE_APPLICATION+5
 
 #if 0
 #define tshark_debug(...) g_warning(__VA_ARGS__)
@@ -158,6 +162,12 @@ static frame_data prev_dis_frame;
 static frame_data prev_cap_frame;
 
 static gboolean perform_two_pass_analysis;
+static gboolean prefilter_second_pass; /* TRUE if the second pass can reject packets by their bytes */
+static guint8 *second_pass_passed; /* if non-null, which frames pass the display filter on the second pass */
+#ifndef _WIN32
+static guint second_pass_workers = 0; /* processes to split the second pass between */
+static guint second_pass_min_frames = 10000; /* fewer frames than this per worker aren't worth a process */
+#endif
 static guint32 epan_auto_reset_count = 0;
 static gboolean epan_auto_reset = FALSE;
 
@@ -180,6 +190,7 @@ static gboolean do_dissection;     /* TRUE if we have to dissect each packet */
 static gboolean print_packet_info; /* TRUE if we're to print packet information */
 static gboolean print_summary;     /* TRUE if we're to print packet summary information */
 static gboolean print_details;     /* TRUE if we're to print packet details information */
+static gboolean extract_fields_flat; /* TRUE if -T fields takes the values from an invisible, primed tree */
 static gboolean print_hex;         /* TRUE if we're to print hex/ascii information */
 static gboolean line_buffered;
 static gboolean quiet = FALSE;
@@ -475,6 +486,12 @@ print_usage(FILE *output)
   fprintf(output, "                           values\n");
   fprintf(output, "  --elastic-mapping-filter <protocols> If -G elastic-mapping is specified, put only the\n");
   fprintf(output, "                           specified protocols within the mapping file\n");
+#ifndef _WIN32
+  fprintf(output, "  --second-pass-workers <count>[,<min frames>]\n");
+  fprintf(output, "                           with -2, split the second pass between <count>\n");
+  fprintf(output, "                           worker processes, each given at least <min frames>\n");
+  fprintf(output, "                           frames (default 10000)\n");
+#endif
 
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
@@ -712,6 +729,9 @@ main(int argc, char *argv[])
     {"color", no_argument, NULL, LONGOPT_COLOR},
     {"no-duplicate-keys", no_argument, NULL, LONGOPT_NO_DUPLICATE_KEYS},
     {"elastic-mapping-filter", required_argument, NULL, LONGOPT_ELASTIC_MAPPING_FILTER},
+#ifndef _WIN32
+    {"second-pass-workers", required_argument, NULL, LONGOPT_SECOND_PASS_WORKERS},
+#endif
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -1135,6 +1155,8 @@ main(int argc, char *argv[])
     case 'B':        /* Buffer size */
 #endif
     case LONGOPT_COMPRESS_TYPE:        /* compress type */
+    case LONGOPT_COMPRESS_THREADS:     /* number of compression threads */
+    case LONGOPT_COMPRESS_CPUS:        /* CPUs for compression threads */
       /* These are options only for packet capture. */
 #ifdef HAVE_LIBPCAP
       exit_status = capture_opts_add_opt(&global_capture_opts, opt, optarg, &start_capture);
@@ -1510,6 +1532,19 @@ main(int argc, char *argv[])
       no_duplicate_keys = TRUE;
       node_children_grouper = proto_node_group_children_by_json_key;
       break;
+#ifndef _WIN32
+    case LONGOPT_SECOND_PASS_WORKERS:
+    {
+      gchar *min_frames = strchr(optarg, ',');
+
+      if (min_frames != NULL) {
+        *min_frames++ = '\0';
+        second_pass_min_frames = get_positive_int(min_frames, "second pass minimum frames per worker");
+      }
+      second_pass_workers = get_positive_int(optarg, "second pass worker count");
+      break;
+    }
+#endif
     default:
     case '?':        /* Bad flag - print usage message */
       switch(optopt) {
@@ -1548,6 +1583,14 @@ main(int argc, char *argv[])
     goto clean_exit;
   }
 
+#ifndef _WIN32
+  if (second_pass_workers != 0 && !perform_two_pass_analysis) {
+    cmdarg_err("--second-pass-workers can only be used with -2");
+    exit_status = INVALID_OPTION;
+    goto clean_exit;
+  }
+#endif
+
   /* If we specified output fields, but not the output field type... */
   if ((WRITE_FIELDS != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
         cmdarg_err("Output fields were specified with \"-e\", "
@@ -1889,6 +1932,12 @@ main(int argc, char *argv[])
       goto clean_exit;
     }
   }
+
+  /* With -T fields, only the requested fields have to be in the protocol
+     tree; if they can all be taken without generating the labels, don't
+     make the tree visible, just prime it with those fields. */
+  if (output_action == WRITE_FIELDS)
+    extract_fields_flat = output_fields_can_extract_flat(output_fields);
 #ifdef HAVE_LIBPCAP
   /* We currently don't support taps, or printing dissected packets,
      if we're writing to a pipe. */
@@ -2807,7 +2856,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details && !extract_fields_flat);
 
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
@@ -2815,7 +2864,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
     while (to_read-- && cf->provider.wth) {
       wtap_cleareof(cf->provider.wth);
       ret = wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset);
-      reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+      reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details && !extract_fields_flat);
       if (ret == FALSE) {
         /* read from file failed, tell the capture child to stop */
         sync_pipe_stop(cap_session);
@@ -3223,12 +3272,29 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
      do a dissection and do so.  (This is the second pass of two
      passes over the packets; that's the pass where we print
      packet information or run taps.) */
-  if (edt) {
+  if (edt && ((second_pass_passed != NULL && !second_pass_passed[fdata->num - 1]) ||
+      (prefilter_second_pass && fdata->visited && !fdata->other_data_src &&
+       rec->rec_type == REC_TYPE_PACKET &&
+       !dfilter_may_match_packet(cf->dfcode, rec->rec_header.packet_header.pkt_encap,
+                                 ws_buffer_start_ptr(buf), rec->rec_header.packet_header.caplen)))) {
+    /* The display filter doesn't, or can't, match this packet; don't
+       dissect it. */
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &cf->provider.ref, cf->provider.prev_dis);
+    if (cf->provider.ref == fdata) {
+      ref_frame = *fdata;
+      cf->provider.ref = &ref_frame;
+    }
+    passed = FALSE;
+  } else if (edt) {
     /* If we're running a display filter, prime the epan_dissect_t with that
        filter. */
     if (cf->dfcode)
       epan_dissect_prime_with_dfilter(edt, cf->dfcode);
 
+    if (extract_fields_flat)
+      output_fields_prime_edt(output_fields, edt);
+
     col_custom_prime_edt(edt, &cf->cinfo);
 
     /* We only need the columns if either
@@ -3315,19 +3381,476 @@ process_new_idbs(wtap *wth, wtap_dumper *pdh, int *err, gchar **err_info)
   return TRUE;
 }
 
+/*
+ * Runs the second pass over frames first through last.  If passed isn't
+ * null, passed[framenum - first] is set to whether the frame passed the
+ * display filter.
+ */
 static pass_status_t
-process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
-                             int *err, gchar **err_info,
-                             volatile guint32 *err_framenum)
+process_frames_second_pass(capture_file *cf, wtap_dumper *pdh,
+                           epan_dissect_t *edt, guint tap_flags,
+                           guint32 first, guint32 last, guint8 *passed,
+                           int *err, gchar **err_info,
+                           volatile guint32 *err_framenum)
 {
   wtap_rec        rec;
   Buffer          buf;
   guint32         framenum;
   frame_data     *fdata;
+  pass_status_t   status = PASS_SUCCEEDED;
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+
+  for (framenum = first; framenum <= last; framenum++) {
+    if (read_interrupted) {
+      status = PASS_INTERRUPTED;
+      break;
+    }
+    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+    if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, err,
+                        err_info)) {
+      /* Error reading from the input file. */
+      status = PASS_READ_ERROR;
+      break;
+    }
+    tshark_debug("tshark: invoking process_packet_second_pass() for frame #%d", framenum);
+    if (process_packet_second_pass(cf, edt, fdata, &rec, &buf, tap_flags)) {
+      /* Either there's no read filtering or this packet passed the
+         filter, so, if we're writing to a capture file, write
+         this packet out. */
+      if (pdh != NULL) {
+        tshark_debug("tshark: writing packet #%d to outfile", framenum);
+        if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&buf), err, err_info)) {
+          /* Error writing to the output file. */
+          tshark_debug("tshark: error writing to a capture file (%d)", *err);
+          *err_framenum = framenum;
+          status = PASS_WRITE_ERROR;
+          break;
+        }
+      }
+    }
+    /* Only a frame that passed the display filter becomes prev_dis. */
+    if (passed != NULL)
+      passed[framenum - first] = (cf->provider.prev_dis == fdata);
+  }
+
+  ws_buffer_free(&buf);
+  wtap_rec_cleanup(&rec);
+
+  return status;
+}
+
+#ifndef _WIN32
+/*
+ * With --second-pass-workers, the second pass is split into ranges of
+ * frames, each run by a child process forked once the first pass has
+ * built the state that the dissection of a frame depends on.  (It has
+ * to be processes; the dissection engine isn't thread-safe.)  The
+ * workers write what they'd print to temporary files, which we copy
+ * to the standard output in frame order.
+ *
+ * What's printed for a frame also depends on the frames before it that
+ * passed the display filter (frame.time_delta_displayed, the cumulative
+ * bytes column), so, if there's a display filter, the workers first
+ * only apply it, and then print the frames that passed, each starting
+ * with the state at the beginning of its range.  That doesn't work for
+ * a filter that itself depends on which frames passed it, so one that
+ * refers to frame.time_delta_displayed is applied sequentially.
+ */
+
+static gboolean
+filter_depends_on_displayed_frames(const dfilter_t *dfcode)
+{
+  header_field_info *hfinfo;
+
+  if (dfcode == NULL)
+    return FALSE;
+  hfinfo = proto_registrar_get_byname("frame.time_delta_displayed");
+  return hfinfo != NULL && dfilter_interested_in_field(dfcode, hfinfo->id);
+}
+
+typedef struct {
+  guint32 first;      /* first frame of the range */
+  guint32 last;       /* last frame of the range */
+  pid_t   pid;
+  int     out_fd;     /* temporary file the worker writes its output to */
+  int     report_fd;  /* read side of the pipe the worker reports on */
+} second_pass_worker_t;
+
+/* What a worker reports when it's done; err_info_len bytes of err_info
+   follow it. */
+typedef struct {
+  gint32      status;        /* pass_status_t */
+  gint32      err;
+  guint32     err_info_len;
+  json_dumper jdumper;       /* state of the JSON output after its frames */
+} second_pass_report_t;
+
+static gboolean
+write_fully(int fd, const void *data, size_t len)
+{
+  const char *p = (const char *)data;
+  ssize_t     n;
+
+  while (len != 0) {
+    n = write(fd, p, len);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static gboolean
+read_fully(int fd, void *data, size_t len)
+{
+  char       *p = (char *)data;
+  ssize_t     n;
+
+  while (len != 0) {
+    n = read(fd, p, len);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    if (n == 0)
+      return FALSE;
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static void
+run_second_pass_worker(capture_file *cf, epan_dissect_t *edt, guint tap_flags,
+                       const second_pass_worker_t *worker, gboolean filter_only,
+                       int report_fd)
+{
+  second_pass_report_t report;
+  guint32         count = worker->last - worker->first + 1;
+  guint8         *passed = NULL;
+  int             err = 0;
+  gchar          *err_info = NULL;
+  guint32         err_framenum;
+  pass_status_t   status;
+
+  /*
+   * The random-access descriptor, and so its file position, is shared
+   * with our parent and the other workers; get one of our own.
+   */
+  wtap_fdclose(cf->provider.wth);
+  if (!wtap_fdreopen(cf->provider.wth, cf->filename, &err)) {
+    status = PASS_READ_ERROR;
+  } else {
+    if (filter_only) {
+      print_packet_info = FALSE;
+      passed = (guint8 *)g_malloc(count);
+    } else {
+      dup2(worker->out_fd, 1);
+    }
+
+    status = process_frames_second_pass(cf, NULL, edt, tap_flags,
+                                        worker->first, worker->last, passed,
+                                        &err, &err_info, &err_framenum);
+
+    if (filter_only) {
+      if (!write_fully(worker->out_fd, passed, count)) {
+        show_print_file_io_error(errno);
+        _exit(2);
+      }
+    } else {
+      fflush(stdout);
+      if (ferror(stdout)) {
+        show_print_file_io_error(errno);
+        _exit(2);
+      }
+    }
+  }
+
+  memset(&report, 0, sizeof report);
+  report.status = status;
+  report.err = err;
+  report.err_info_len = err_info != NULL ? (guint32)strlen(err_info) : 0;
+  report.jdumper = jdumper;
+  if (write_fully(report_fd, &report, sizeof report) && err_info != NULL)
+    write_fully(report_fd, err_info, report.err_info_len);
+  _exit(0);
+}
+
+static void
+abandon_second_pass_workers(second_pass_worker_t *workers, guint num_workers)
+{
+  guint i;
+
+  for (i = 0; i < num_workers; i++) {
+    if (workers[i].pid > 0) {
+      kill(workers[i].pid, SIGKILL);
+      waitpid(workers[i].pid, NULL, 0);
+    }
+    if (workers[i].out_fd != -1)
+      close(workers[i].out_fd);
+    if (workers[i].report_fd != -1)
+      close(workers[i].report_fd);
+  }
+}
+
+/*
+ * Forks a worker for each range of frames.  Returns FALSE, with none
+ * of them running, if it can't.
+ */
+static gboolean
+start_second_pass_workers(capture_file *cf, epan_dissect_t *edt,
+                          guint tap_flags, second_pass_worker_t *workers,
+                          guint num_workers, gboolean filter_only)
+{
+  frame_data *saved_prev_dis = cf->provider.prev_dis;
+  guint32     saved_cum_bytes = cum_bytes;
+  guint32     framenum = 1;
+  frame_data *fdata;
+  gchar      *tmpname;
+  GError     *gerr = NULL;
+  int         report_pipe[2];
+  guint       i;
+  gboolean    ok = TRUE;
+
+  for (i = 0; i < num_workers; i++) {
+    workers[i].first = (guint32)((guint64)cf->count * i / num_workers) + 1;
+    workers[i].last = (guint32)((guint64)cf->count * (i + 1) / num_workers);
+    workers[i].pid = -1;
+    workers[i].out_fd = -1;
+    workers[i].report_fd = -1;
+  }
+
+  /* Don't leave anything buffered for the workers to write again. */
+  fflush(stdout);
+  fflush(stderr);
+
+  for (i = 0; i < num_workers && ok; i++) {
+    second_pass_worker_t *worker = &workers[i];
+
+    /*
+     * Set up the state at the beginning of the range, as if we'd gone
+     * through the frames before it.  Which of those pass the display
+     * filter isn't known yet when only applying it, so take the frame
+     * just before the range to be the previous displayed one; we don't
+     * use workers if the filter looks at frame.time_delta_displayed.
+     */
+    for (; framenum < worker->first; framenum++) {
+      fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+      if (filter_only) {
+        cf->provider.prev_dis = fdata;
+      } else if (second_pass_passed == NULL || second_pass_passed[framenum - 1]) {
+        frame_data_set_after_dissect(fdata, &cum_bytes);
+        cf->provider.prev_dis = fdata;
+      }
+    }
+
+    worker->out_fd = create_tempfile(&tmpname, "tshark_pass2", NULL, &gerr);
+    if (worker->out_fd == -1) {
+      tshark_debug("tshark: can't create a temporary file for a worker: %s", gerr->message);
+      g_error_free(gerr);
+      ok = FALSE;
+      break;
+    }
+    /* Nothing else needs it; it goes away when the descriptor is closed. */
+    ws_unlink(tmpname);
+    g_free(tmpname);
+
+    if (pipe(report_pipe) == -1) {
+      ok = FALSE;
+      break;
+    }
+    worker->report_fd = report_pipe[0];
+
+    worker->pid = fork();
+    if (worker->pid == -1) {
+      close(report_pipe[1]);
+      ok = FALSE;
+      break;
+    }
+    if (worker->pid == 0) {
+      close(report_pipe[0]);
+      run_second_pass_worker(cf, edt, tap_flags, worker, filter_only,
+                             report_pipe[1]);
+    }
+    close(report_pipe[1]);
+  }
+
+  cf->provider.prev_dis = saved_prev_dis;
+  cum_bytes = saved_cum_bytes;
+
+  if (!ok)
+    abandon_second_pass_workers(workers, num_workers);
+  return ok;
+}
+
+/*
+ * Waits for the workers in frame order and collects their output; if
+ * filter_only, that's which frames passed the display filter, stored
+ * in passed, otherwise it's copied to the standard output.
+ */
+static pass_status_t
+finish_second_pass_workers(second_pass_worker_t *workers, guint num_workers,
+                           gboolean filter_only, guint8 *passed,
+                           int *err, gchar **err_info)
+{
+  second_pass_report_t report;
+  pass_status_t status = PASS_SUCCEEDED;
+  gboolean      printed = FALSE;
+  gboolean      worker_printed;
+  gboolean      stopped = FALSE;
+  char         *buf = NULL;
+  ssize_t       n;
+  guint         i, j;
+
+  if (!filter_only)
+    buf = (char *)g_malloc(65536);
+
+  for (i = 0; i < num_workers; i++) {
+    second_pass_worker_t *worker = &workers[i];
+
+    if (!read_fully(worker->report_fd, &report, sizeof report)) {
+      if (status == PASS_SUCCEEDED) {
+        status = PASS_READ_ERROR;
+        *err = WTAP_ERR_INTERNAL;
+        *err_info = g_strdup("a second pass worker process exited without reporting");
+      }
+    } else if (report.status != PASS_SUCCEEDED) {
+      if (status == PASS_SUCCEEDED) {
+        status = (pass_status_t)report.status;
+        *err = report.err;
+        *err_info = NULL;
+        if (report.err_info_len != 0) {
+          *err_info = (gchar *)g_malloc(report.err_info_len + 1);
+          if (read_fully(worker->report_fd, *err_info, report.err_info_len)) {
+            (*err_info)[report.err_info_len] = '\0';
+          } else {
+            g_free(*err_info);
+            *err_info = NULL;
+          }
+        }
+      }
+    } else if (status == PASS_SUCCEEDED) {
+      if (lseek(worker->out_fd, 0, SEEK_SET) == -1) {
+        show_print_file_io_error(errno);
+        exit(2);
+      }
+      if (filter_only) {
+        if (!read_fully(worker->out_fd, passed + worker->first - 1,
+                        worker->last - worker->first + 1)) {
+          show_print_file_io_error(errno);
+          exit(2);
+        }
+      } else {
+        /*
+         * Each worker's JSON starts as the first element of the array,
+         * so put a separator between those of different workers, and
+         * carry on from the state the last one left the output in.
+         */
+        worker_printed = FALSE;
+        while ((n = read(worker->out_fd, buf, 65536)) != 0) {
+          if (n == -1) {
+            if (errno == EINTR)
+              continue;
+            show_print_file_io_error(errno);
+            exit(2);
+          }
+          if (!worker_printed && printed &&
+              (output_action == WRITE_JSON || output_action == WRITE_JSON_RAW))
+            fputc(',', stdout);
+          fwrite(buf, 1, n, stdout);
+          worker_printed = TRUE;
+        }
+        if (worker_printed) {
+          printed = TRUE;
+          if (output_action == WRITE_JSON || output_action == WRITE_JSON_RAW)
+            jdumper = report.jdumper;
+        }
+        if (line_buffered)
+          fflush(stdout);
+        if (ferror(stdout)) {
+          show_print_file_io_error(errno);
+          exit(2);
+        }
+      }
+    }
+
+    if (status != PASS_SUCCEEDED && !stopped) {
+      /* Stop the others; we won't use what they do. */
+      for (j = i + 1; j < num_workers; j++)
+        kill(workers[j].pid, SIGTERM);
+      stopped = TRUE;
+    }
+
+    close(worker->report_fd);
+    close(worker->out_fd);
+    waitpid(worker->pid, NULL, 0);
+  }
+
+  g_free(buf);
+  return status;
+}
+
+/*
+ * Runs the second pass in num_workers processes.  Returns FALSE, having
+ * printed nothing, if it can't start them.
+ */
+static gboolean
+process_frames_second_pass_in_workers(capture_file *cf, epan_dissect_t *edt,
+                                      guint tap_flags, guint num_workers,
+                                      pass_status_t *status,
+                                      int *err, gchar **err_info)
+{
+  second_pass_worker_t *workers;
+
+  workers = g_new(second_pass_worker_t, num_workers);
+
+  if (cf->dfcode != NULL) {
+    if (!start_second_pass_workers(cf, edt, tap_flags, workers, num_workers, TRUE)) {
+      g_free(workers);
+      return FALSE;
+    }
+    second_pass_passed = (guint8 *)g_malloc(cf->count);
+    *status = finish_second_pass_workers(workers, num_workers, TRUE,
+                                         second_pass_passed, err, err_info);
+    if (*status != PASS_SUCCEEDED) {
+      g_free(workers);
+      return TRUE;
+    }
+  }
+
+  /*
+   * If we can't print in parallel, we can still do it ourselves, and
+   * needn't dissect the frames that we know don't pass the filter.
+   */
+  if (!start_second_pass_workers(cf, edt, tap_flags, workers, num_workers, FALSE)) {
+    g_free(workers);
+    return FALSE;
+  }
+  *status = finish_second_pass_workers(workers, num_workers, FALSE, NULL,
+                                       err, err_info);
+
+  g_free(workers);
+  return TRUE;
+}
+#endif /* _WIN32 */
+
+static pass_status_t
+process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
+                             int *err, gchar **err_info,
+                             volatile guint32 *err_framenum)
+{
   gboolean        filtering_tap_listeners;
   guint           tap_flags;
   epan_dissect_t *edt = NULL;
   pass_status_t   status = PASS_SUCCEEDED;
+  gboolean        done = FALSE;
 
   /*
    * Process whatever IDBs we haven't seen yet.  This will be all
@@ -3339,9 +3862,6 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
     return PASS_WRITE_ERROR;
   }
 
-  wtap_rec_init(&rec);
-  ws_buffer_init(&buf, 1514);
-
   /* Do we have any tap listeners with filters? */
   filtering_tap_listeners = have_filtering_tap_listeners();
 
@@ -3374,50 +3894,52 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details && !extract_fields_flat);
   }
 
+  /*
+   * All the packets were dissected in the first pass, so, unless a tap
+   * wants to see every packet, those whose bytes show that they can't
+   * match the display filter needn't be dissected again.
+   */
+  prefilter_second_pass = cf->dfcode != NULL && dfilter_has_prefilter(cf->dfcode) &&
+    !tap_listeners_require_dissection();
+
   /*
    * Force synchronous resolution of IP addresses; in this pass, we
    * can't do it in the background and fix up past dissections.
    */
   set_resolution_synchrony(TRUE);
 
-  for (framenum = 1; framenum <= cf->count; framenum++) {
-    if (read_interrupted) {
-      status = PASS_INTERRUPTED;
-      break;
-    }
-    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
-    if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, err,
-                        err_info)) {
-      /* Error reading from the input file. */
-      status = PASS_READ_ERROR;
-      break;
-    }
-    tshark_debug("tshark: invoking process_packet_second_pass() for frame #%d", framenum);
-    if (process_packet_second_pass(cf, edt, fdata, &rec, &buf, tap_flags)) {
-      /* Either there's no read filtering or this packet passed the
-         filter, so, if we're writing to a capture file, write
-         this packet out. */
-      if (pdh != NULL) {
-        tshark_debug("tshark: writing packet #%d to outfile", framenum);
-        if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&buf), err, err_info)) {
-          /* Error writing to the output file. */
-          tshark_debug("tshark: error writing to a capture file (%d)", *err);
-          *err_framenum = framenum;
-          status = PASS_WRITE_ERROR;
-          break;
-        }
-      }
-    }
+#ifndef _WIN32
+  /*
+   * Split the frames between worker processes if asked to, unless
+   * we're writing a capture file, or taps have to see every frame in
+   * order, or the display filter depends on which frames passed it.
+   * (PostScript output has state of its own that spans packets.)
+   */
+  if (second_pass_workers > 1 && pdh == NULL && edt != NULL &&
+      print_packet_info && !tap_listeners_require_dissection() &&
+      !filter_depends_on_displayed_frames(cf->dfcode) &&
+      (output_action != WRITE_TEXT || print_format == PR_FMT_TEXT)) {
+    guint num_workers = MIN(second_pass_workers, cf->count / second_pass_min_frames);
+
+    if (num_workers > 1)
+      done = process_frames_second_pass_in_workers(cf, edt, tap_flags,
+                                                   num_workers, &status,
+                                                   err, err_info);
   }
+#endif
+
+  if (!done)
+    status = process_frames_second_pass(cf, pdh, edt, tap_flags, 1, cf->count,
+                                        NULL, err, err_info, err_framenum);
 
   if (edt)
     epan_dissect_free(edt);
 
-  ws_buffer_free(&buf);
-  wtap_rec_cleanup(&rec);
+  g_free(second_pass_passed);
+  second_pass_passed = NULL;
 
   return status;
 }
@@ -3481,7 +4003,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details && !extract_fields_flat);
   }
 
   /*
@@ -3510,7 +4032,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
 
     tshark_debug("tshark: processing packet #%d", framenum);
 
-    reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+    reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details && !extract_fields_flat);
 
     if (process_packet_single_pass(cf, edt, data_offset, &rec, &buf, tap_flags)) {
       /* Either there's no read filtering or this packet passed the
@@ -3587,6 +4109,12 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
     } else {
       pdh = wtap_dump_open(save_file, out_file_type, WTAP_UNCOMPRESSED, &params,
                            &err, &err_info);
+      if (pdh != NULL) {
+        int async_err;
+
+        /* Leave the disk I/O to a writer thread, if we can. */
+        wtap_dump_set_async(pdh, 0, 0, 0, &async_err);
+      }
     }
 
     g_free(params.idb_inf);
@@ -3635,6 +4163,13 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
     sigaction(SIGHUP, &action, NULL);
 #endif /* _WIN32 */
 
+  /*
+   * Nothing reads the file randomly until the sequential pass is
+   * over, so let wiretap read and parse records on a thread of its
+   * own while we dissect, if it can.
+   */
+  wtap_set_read_ahead(cf->provider.wth, 0);
+
   if (perform_two_pass_analysis) {
     tshark_debug("tshark: perform_two_pass_analysis, do_dissection=%s", do_dissection ? "TRUE" : "FALSE");
 
@@ -3832,6 +4367,9 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
        with the hfids postdissectors want on the first pass. */
     prime_epan_dissect_with_postdissector_wanted_hfids(edt);
 
+    if (extract_fields_flat)
+      output_fields_prime_edt(output_fields, edt);
+
     col_custom_prime_edt(edt, &cf->cinfo);
 
     /* We only need the columns if either
@@ -20,6 +20,9 @@
 #include <ui/qt/utils/qt_ui_utils.h>
 #include "wireshark_application.h"
 
+// Chain lengths are counted by powers of two up to this many.
+static const guint num_chain_length_counts = 8;
+
 ConversationHashTablesDialog::ConversationHashTablesDialog(QWidget *parent) :
     GeometryStateDialog(parent),
     ui(new Ui::ConversationHashTablesDialog)
@@ -71,6 +74,27 @@ const QString ConversationHashTablesDialog::hashTableToHtmlTable(const QString t
     QString html_table = QString("<p>%1, %2 entries</p>").arg(table_name).arg(num_keys);
     if (num_keys > 0)
     {
+        // Conversations sharing a key, e.g. a reused 5-tuple, by powers of two.
+        guint chain_counts[num_chain_length_counts];
+        guint longest = conversation_hashtable_chain_lengths(hash_table, chain_counts, num_chain_length_counts);
+        QStringList chain_lengths;
+        for (guint i = 0; i < num_chain_length_counts; i++) {
+            guint low = 1U << i;
+            QString range;
+            if (i == num_chain_length_counts - 1) {
+                range = QString("%1+").arg(low);
+            } else if (i == 0) {
+                range = QString::number(low);
+            } else {
+                range = QString("%1-%2").arg(low).arg((low << 1) - 1);
+            }
+            if (chain_counts[i] > 0) {
+                chain_lengths << QString("%1: %2").arg(range).arg(chain_counts[i]);
+            }
+        }
+        html_table += QString("<p>Conversations per entry: %1; longest %2</p>\n")
+                .arg(chain_lengths.join(", ")).arg(longest);
+
         int one_em = fontMetrics().height();
         html_table += QString("<table cellpadding=\"%1\">\n").arg(one_em / 4);
 
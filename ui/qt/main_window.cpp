@@ -1339,6 +1339,14 @@ bool MainWindow::saveCaptureFile(capture_file *cf, bool dont_reopen) {
         if (cf->unsaved_changes) {
             cf_write_status_t status;
 
+            if (!wtap_can_write_compression_type(cf->compression_type)) {
+                /* We can read, but not write, files compressed the way
+                   this one is, so it can't be saved on top of itself.
+                   Do a "Save As" so the user can choose a file name
+                   and whether to compress it with gzip. */
+                return saveAsCaptureFile(cf, FALSE, dont_reopen);
+            }
+
             /* This is not a temporary capture file, but it has unsaved
                changes, so saving it means doing a "safe save" on top
                of the existing file, in the same format - no UI needed
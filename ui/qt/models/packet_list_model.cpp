@@ -8,6 +8,7 @@
  */
 
 #include <algorithm>
+#include <functional>
 #include <glib.h>
 
 #include "packet_list_model.h"
@@ -19,6 +20,7 @@
 #include <epan/prefs.h>
 
 #include "ui/packet_list_utils.h"
+#include "ui/progress_dlg.h"
 #include "ui/recent.h"
 
 #include <epan/color_filters.h>
@@ -36,6 +38,9 @@
 #include <QFontMetrics>
 #include <QModelIndex>
 #include <QElapsedTimer>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
 
 // Print timing information
 //#define DEBUG_PACKET_LIST_MODEL 1
@@ -71,6 +76,9 @@ PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
     number_to_row_(QVector<int>()),
     max_row_height_(0),
     max_line_count_(1),
+    sorting_(false),
+    rows_generation_(0),
+    sort_rows_generation_(0),
     idle_dissection_row_(0)
 {
     Q_ASSERT(glbl_plist_model == Q_NULLPTR);
@@ -163,6 +171,8 @@ guint PacketListModel::recreateVisibleRows()
 
 void PacketListModel::clear() {
     emit beginResetModel();
+    // The records are freed; a sort in progress must not use them.
+    rows_generation_++;
     qDeleteAll(physical_rows_);
     physical_rows_.resize(0);
     visible_rows_.resize(0);
@@ -340,30 +350,97 @@ int PacketListModel::text_sort_column_;
 Qt::SortOrder PacketListModel::sort_order_;
 capture_file *PacketListModel::sort_cap_file_;
 
+// What a row is sorted by, extracted once before sorting so that the
+// comparisons don't have to look up or parse column strings.
+struct PacketListModel::SortKey {
+    PacketListRecord *record;
+    frame_data *fdata;
+    QString text;
+    double number;
+    bool number_ok;
+};
+
+// Runs a part of the sort on a thread of the global thread pool.
+class PacketListSortRunnable : public QRunnable
+{
+public:
+    PacketListSortRunnable(std::function<void()> work, QSemaphore *done) :
+        work_(work),
+        done_(done)
+    {}
+
+    void run() {
+        work_();
+        done_->release();
+    }
+
+private:
+    std::function<void()> work_;
+    QSemaphore *done_;
+};
+
 QElapsedTimer busy_timer_;
 const int busy_timeout_ = 65; // ms, approximately 15 fps
+// Sorting fewer rows than this per thread isn't worth starting threads.
+const int min_rows_per_sort_thread_ = 50000;
+// Sort again at most this many times to include packets appended meanwhile.
+const int max_sort_passes_ = 4;
+
 void PacketListModel::sort(int column, Qt::SortOrder order)
 {
     if (!cap_file_ || visible_rows_.count() < 1) return;
     if (column < 0) return;
+    // The progress bar lets events in, including clicks on the header.
+    if (sorting_) return;
 
     sort_column_ = column;
     text_sort_column_ = PacketListRecord::textColumn(column);
     sort_order_ = order;
     sort_cap_file_ = cap_file_;
+    sort_rows_generation_ = rows_generation_;
 
     QString col_title = get_column_title(column);
 
-    // XXX Use updateProgress instead. We'd have to switch from std::sort to
-    // something we can interrupt.
     if (!col_title.isEmpty()) {
         QString busy_msg = tr("Sorting \"%1\"…").arg(col_title);
         wsApp->pushStatus(WiresharkApplication::BusyStatus, busy_msg);
     }
 
+    sorting_ = true;
     busy_timer_.start();
     sort_column_is_numeric_ = isNumericColumn(sort_column_);
-    std::sort(physical_rows_.begin(), physical_rows_.end(), recordLessThan);
+
+    // During a live capture, packets may be appended while the progress
+    // bar or the busy indicator lets events in. Their keys are extracted
+    // and everything is sorted again, a limited number of times.
+    QVector<SortKey> keys;
+    bool sorted = false;
+    for (int pass = 0; pass < max_sort_passes_; pass++) {
+        sorted = extractSortKeys(keys, col_title);
+        if (!sorted) break;
+        sortKeys(keys);
+        if (!sortRowsUnchanged() || keys.count() == physical_rows_.count()) break;
+    }
+    sorting_ = false;
+
+    if (!col_title.isEmpty()) {
+        wsApp->popStatus(WiresharkApplication::BusyStatus);
+    }
+
+    // The user stopped the sort, or closed or reloaded the file.
+    if (!sorted || !sortRowsUnchanged()) return;
+
+    if (keys.count() != physical_rows_.count()) {
+        // Packets kept arriving faster than they could be sorted. Keep the
+        // previous order rather than leaving the new packets out.
+        wsApp->pushStatus(WiresharkApplication::TemporaryStatus,
+                          tr("Packets are arriving too quickly to sort; the previous order was kept."));
+        return;
+    }
+
+    for (int row = 0; row < keys.count(); row++) {
+        physical_rows_[row] = keys[row].record;
+    }
 
     emit beginResetModel();
     visible_rows_.resize(0);
@@ -381,15 +458,128 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
     }
     emit endResetModel();
 
-    if (!col_title.isEmpty()) {
-        wsApp->popStatus(WiresharkApplication::BusyStatus);
-    }
-
     if (cap_file_->current_frame) {
         emit goToPacket(cap_file_->current_frame->num);
     }
 }
 
+// Gets the column text of every row that doesn't have a key yet, parsed
+// as a number for numeric columns. Rows whose columns aren't cached have
+// to be dissected, so this is done on this thread, with a progress bar
+// that can stop it.
+bool PacketListModel::extractSortKeys(QVector<SortKey> &keys, const QString &col_title)
+{
+    int first_row = keys.count();
+    int row_count = physical_rows_.count();
+    progdlg_t *progbar = NULL;
+    gboolean stop_flag = FALSE;
+
+    keys.resize(row_count);
+    for (int row = first_row; row < row_count; row++) {
+        SortKey &key = keys[row];
+
+        key.record = physical_rows_[row];
+        key.fdata = key.record->frameData();
+        key.number = 0.0;
+        key.number_ok = false;
+        if (sort_column_ < 0 || text_sort_column_ < 0) {
+            // The column comes from the frame data.
+            continue;
+        }
+
+        key.text = key.record->columnString(sort_cap_file_, sort_column_);
+        if (sort_column_is_numeric_) {
+            key.number = parseNumericColumn(key.text, &key.number_ok);
+        }
+
+        if (busy_timer_.elapsed() > busy_timeout_) {
+            if (!progbar) {
+                progbar = create_progress_dlg(wsApp->mainWindow(), tr("Sorting").toUtf8().constData(),
+                                              col_title.toUtf8().constData(), FALSE, &stop_flag);
+            }
+            update_progress_dlg(progbar, (gfloat) (row - first_row) / (row_count - first_row), "");
+            busy_timer_.restart();
+
+            if (stop_flag || !sortRowsUnchanged()) {
+                break;
+            }
+        }
+    }
+
+    if (progbar) {
+        destroy_progress_dlg(progbar);
+    }
+
+    return !stop_flag && sortRowsUnchanged();
+}
+
+// Checks that the rows being sorted are still there: the progress bar lets
+// events in, and the file may have been closed or reloaded, even with the
+// same number of rows. Packets appended meanwhile are handled by sort().
+bool PacketListModel::sortRowsUnchanged() const
+{
+    return cap_file_ == sort_cap_file_ && rows_generation_ == sort_rows_generation_;
+}
+
+// Sorts the keys, in parallel if there are enough of them: the rows are
+// split into one run per thread, the runs are sorted, and then merged in
+// pairs. As the frame numbers break ties, the order is the same as that
+// of a single std::sort. User input is held off meanwhile, but packets
+// may still be appended during a live capture.
+void PacketListModel::sortKeys(QVector<SortKey> &keys)
+{
+    QThreadPool *pool = QThreadPool::globalInstance();
+    QSemaphore done;
+    int row_count = keys.count();
+    int runs = 1;
+
+    while (runs * 2 <= pool->maxThreadCount() && row_count / (runs * 2) >= min_rows_per_sort_thread_) {
+        runs *= 2;
+    }
+
+    if (runs == 1) {
+        std::sort(keys.begin(), keys.end(), keyLessThan);
+        return;
+    }
+
+    SortKey *begin = keys.data();
+    QVector<int> bounds;
+    for (int run = 0; run <= runs; run++) {
+        bounds << (int) ((qint64) row_count * run / runs);
+    }
+
+    for (int run = 0; run < runs; run++) {
+        SortKey *first = begin + bounds[run];
+        SortKey *last = begin + bounds[run + 1];
+        pool->start(new PacketListSortRunnable([first, last]() {
+            std::sort(first, last, keyLessThan);
+        }, &done));
+    }
+    waitForSortRunnables(done, runs);
+
+    for (int width = 1; width < runs; width *= 2) {
+        int merges = 0;
+        for (int run = 0; run + width < runs; run += width * 2) {
+            SortKey *first = begin + bounds[run];
+            SortKey *middle = begin + bounds[run + width];
+            SortKey *last = begin + bounds[qMin(run + width * 2, runs)];
+            pool->start(new PacketListSortRunnable([first, middle, last]() {
+                std::inplace_merge(first, middle, last, keyLessThan);
+            }, &done));
+            merges++;
+        }
+        waitForSortRunnables(done, merges);
+    }
+}
+
+void PacketListModel::waitForSortRunnables(QSemaphore &done, int count)
+{
+    while (!done.tryAcquire(count, busy_timeout_)) {
+        // Keep drawing the busy indicator.
+        wsApp->processEvents(QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers, 1);
+    }
+}
+
 bool PacketListModel::isNumericColumn(int column)
 {
     if (column < 0) {
@@ -457,7 +647,7 @@ bool PacketListModel::isNumericColumn(int column)
     return true;
 }
 
-bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
+bool PacketListModel::keyLessThan(const SortKey &k1, const SortKey &k2)
 {
     int cmp_val = 0;
 
@@ -465,45 +655,34 @@ bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
     // _packet_list_compare_records, and packet_list_compare_custom from
     // gtk/packet_list_store.c into one function
 
-    if (busy_timer_.elapsed() > busy_timeout_) {
-        // What's the least amount of processing that we can do which will draw
-        // the busy indicator?
-        wsApp->processEvents(QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers, 1);
-        busy_timer_.restart();
-    }
     if (sort_column_ < 0) {
         // No column.
-        cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
+        cmp_val = frame_data_compare(sort_cap_file_->epan, k1.fdata, k2.fdata, COL_NUMBER);
     } else if (text_sort_column_ < 0) {
         // Column comes directly from frame data
-        cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), sort_cap_file_->cinfo.columns[sort_column_].col_fmt);
+        cmp_val = frame_data_compare(sort_cap_file_->epan, k1.fdata, k2.fdata, sort_cap_file_->cinfo.columns[sort_column_].col_fmt);
     } else  {
-        if (r1->columnString(sort_cap_file_, sort_column_).constData() == r2->columnString(sort_cap_file_, sort_column_).constData()) {
+        if (k1.text.constData() == k2.text.constData()) {
             cmp_val = 0;
         } else if (sort_column_is_numeric_) {
-            // Custom column with numeric data (or something like a port number).
-            // Attempt to convert to numbers.
-            // XXX This is slow. Can we avoid doing this?
-            bool ok_r1, ok_r2;
-            double num_r1 = parseNumericColumn(r1->columnString(sort_cap_file_, sort_column_), &ok_r1);
-            double num_r2 = parseNumericColumn(r2->columnString(sort_cap_file_, sort_column_), &ok_r2);
-
-            if (!ok_r1 && !ok_r2) {
+            // Custom column with numeric data (or something like a port number),
+            // converted to numbers when the keys were extracted.
+            if (!k1.number_ok && !k2.number_ok) {
                 cmp_val = 0;
-            } else if (!ok_r1 || (ok_r2 && num_r1 < num_r2)) {
+            } else if (!k1.number_ok || (k2.number_ok && k1.number < k2.number)) {
                 // either r1 is invalid (and sort it before others) or both
                 // r1 and r2 are valid (sort normally)
                 cmp_val = -1;
-            } else if (!ok_r2 || (num_r1 > num_r2)) {
+            } else if (!k2.number_ok || (k1.number > k2.number)) {
                 cmp_val = 1;
             }
         } else {
-            cmp_val = r1->columnString(sort_cap_file_, sort_column_).compare(r2->columnString(sort_cap_file_, sort_column_));
+            cmp_val = k1.text.compare(k2.text);
         }
 
         if (cmp_val == 0) {
             // All else being equal, compare column numbers.
-            cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
+            cmp_val = frame_data_compare(sort_cap_file_->epan, k1.fdata, k2.fdata, COL_NUMBER);
         }
     }
 
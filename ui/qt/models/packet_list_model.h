@@ -27,6 +27,7 @@
 #include "cfile.h"
 
 class QElapsedTimer;
+class QSemaphore;
 
 class PacketListModel : public QAbstractItemModel
 {
@@ -92,14 +93,22 @@ private:
 
     int max_row_height_; // px
     int max_line_count_;
+    bool sorting_;
+    unsigned rows_generation_; // Incremented whenever the rows are freed
+    unsigned sort_rows_generation_;
 
+    struct SortKey;
     static int sort_column_;
     static int sort_column_is_numeric_;
     static int text_sort_column_;
     static Qt::SortOrder sort_order_;
     static capture_file *sort_cap_file_;
-    static bool recordLessThan(PacketListRecord *r1, PacketListRecord *r2);
+    static bool keyLessThan(const SortKey &k1, const SortKey &k2);
     static double parseNumericColumn(const QString &val, bool *ok);
+    bool extractSortKeys(QVector<SortKey> &keys, const QString &col_title);
+    bool sortRowsUnchanged() const;
+    void sortKeys(QVector<SortKey> &keys);
+    void waitForSortRunnables(QSemaphore &done, int count);
 
     QElapsedTimer *idle_dissection_timer_;
     int idle_dissection_row_;
@@ -13,6 +13,11 @@
 
 #include <errno.h>
 
+#ifdef HAVE_POSIX_FALLOCATE
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include <wsutil/file_util.h>
 #include <wsutil/tempfile.h>
 #ifdef HAVE_PLUGINS
@@ -1159,11 +1164,11 @@ success:
  * to reopen that file and assign the new file descriptor(s) to the sequential
  * stream and, if do_random is TRUE, to the random stream.  Used on Windows
  * after the rename of a file we had open was done or if the rename of a
- * file on top of a file we had open failed.
+ * file on top of a file we had open failed, and by TShark's second pass
+ * workers, so that each has a file position of its own.
  *
- * This is only required by Wireshark, not TShark, and, at the point that
- * Wireshark is doing this, the sequential stream is closed, and the
- * random stream is open, so this refuses to open pipes, and only
+ * At the point that this is done, the sequential stream is closed, and
+ * the random stream is open, so this refuses to open pipes, and only
  * reopens the random stream.
  */
 gboolean
@@ -2150,6 +2155,8 @@ static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int *err,
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
 static int wtap_dump_file_close(wtap_dumper *wdh);
+static int wtap_dump_async_drain(wtap_dumper *wdh);
+static int wtap_dump_async_stop(wtap_dumper *wdh);
 
 static wtap_dumper *
 wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_type,
@@ -2205,6 +2212,12 @@ wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_t
 		return NULL;
 	}
 
+	/* We can read, but not write, zstd and LZ4 compressed files. */
+	if (!wtap_can_write_compression_type(compression_type)) {
+		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+		return NULL;
+	}
+
 	/* Allocate a data structure for the output stream. */
 	wdh = g_new0(wtap_dumper, 1);
 	if (wdh == NULL) {
@@ -2561,6 +2574,11 @@ wtap_dump(wtap_dumper *wdh, const wtap_rec *rec,
 gboolean
 wtap_dump_flush(wtap_dumper *wdh, int *err)
 {
+	if (wdh->async != NULL) {
+		*err = wtap_dump_async_drain(wdh);
+		if (*err != 0)
+			return FALSE;
+	}
 #ifdef HAVE_ZLIB
 	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		if (gzwfile_flush((GZWFILE_T)wdh->fh) == -1) {
@@ -2590,6 +2608,17 @@ wtap_dump_close(wtap_dumper *wdh, int *err, gchar **err_info)
 		if (!(wdh->subtype_finish)(wdh, err, err_info))
 			ret = FALSE;
 	}
+	if (wdh->async != NULL) {
+		/* Wait for the writer thread to write everything, and
+		   report any error it got if nothing else failed first. */
+		int async_err = wtap_dump_async_stop(wdh);
+
+		if (async_err != 0 && ret) {
+			if (err != NULL)
+				*err = async_err;
+			ret = FALSE;
+		}
+	}
 	errno = WTAP_ERR_CANT_CLOSE;
 	if (wtap_dump_file_close(wdh) == EOF) {
 		if (ret) {
@@ -2710,8 +2739,8 @@ wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
 #endif
 
 /* internally writing raw bytes (compressed or not) */
-gboolean
-wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err)
+static gboolean
+wtap_dump_file_write_sync(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err)
 {
 	size_t nwritten;
 
@@ -2745,6 +2774,274 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 	return TRUE;
 }
 
+/*
+ * Asynchronous writing.
+ *
+ * Once wtap_dump_set_async() has been called, wtap_dump_file_write()
+ * copies the data into one of a fixed number of large buffers; full
+ * buffers are queued for a writer thread, which writes them to the
+ * file, compressing them if necessary, and hands them back.  Writers
+ * only wait for the disk if all the buffers are queued.
+ *
+ * Anything else that touches the file - seeking, telling, flushing
+ * and closing - first waits for the writer thread to catch up, so
+ * that only one thread uses the stream at a time.  The first write
+ * error the writer thread gets is reported by the next write, seek,
+ * tell or flush, or by wtap_dump_close().
+ */
+#define WTAP_DUMP_ASYNC_BUFFER_SIZE	(1024 * 1024)
+#define WTAP_DUMP_ASYNC_NUM_BUFFERS	4
+
+typedef struct {
+	guint8	*data;
+	gsize	len;
+} wtap_dump_async_buf;
+
+struct wtap_dump_async {
+	GThread			*thread;
+	GAsyncQueue		*full;		/* buffers to be written */
+	GAsyncQueue		*empty;		/* buffers ready to be filled */
+	wtap_dump_async_buf	*bufs;
+	guint			num_bufs;
+	gsize			buf_size;
+	wtap_dump_async_buf	*cur;		/* buffer being filled */
+	GMutex			lock;
+	GCond			idle;
+	guint			pending;	/* buffers queued or being written */
+	int			err;		/* first write error */
+	gboolean		preallocated;	/* file was pre-sized */
+	gint64			pos;		/* current offset, if preallocated */
+	gint64			end;		/* end of the data, if preallocated */
+};
+
+/* Queued to tell the writer thread to exit. */
+static wtap_dump_async_buf wtap_dump_async_stop_buf;
+
+static gpointer
+wtap_dump_async_thread(gpointer data)
+{
+	wtap_dumper *wdh = (wtap_dumper *)data;
+	struct wtap_dump_async *async = wdh->async;
+	wtap_dump_async_buf *buf;
+	int err;
+
+	while ((buf = (wtap_dump_async_buf *)g_async_queue_pop(async->full)) !=
+	    &wtap_dump_async_stop_buf) {
+		/* After an error, just throw the data away. */
+		g_mutex_lock(&async->lock);
+		err = async->err;
+		g_mutex_unlock(&async->lock);
+		if (err == 0 &&
+		    !wtap_dump_file_write_sync(wdh, buf->data, buf->len, &err)) {
+			g_mutex_lock(&async->lock);
+			async->err = err;
+			g_mutex_unlock(&async->lock);
+		}
+		buf->len = 0;
+		g_async_queue_push(async->empty, buf);
+
+		g_mutex_lock(&async->lock);
+		if (--async->pending == 0)
+			g_cond_signal(&async->idle);
+		g_mutex_unlock(&async->lock);
+	}
+	return NULL;
+}
+
+static void
+wtap_dump_async_free(struct wtap_dump_async *async)
+{
+	guint i;
+
+	for (i = 0; i < async->num_bufs; i++)
+		g_free(async->bufs[i].data);
+	g_free(async->bufs);
+	g_async_queue_unref(async->full);
+	g_async_queue_unref(async->empty);
+	g_mutex_clear(&async->lock);
+	g_cond_clear(&async->idle);
+	g_free(async);
+}
+
+static int
+wtap_dump_async_error(struct wtap_dump_async *async)
+{
+	int err;
+
+	g_mutex_lock(&async->lock);
+	err = async->err;
+	g_mutex_unlock(&async->lock);
+	return err;
+}
+
+/* Hand the current buffer to the writer thread and get an empty one. */
+static void
+wtap_dump_async_queue_cur(struct wtap_dump_async *async)
+{
+	g_mutex_lock(&async->lock);
+	async->pending++;
+	g_mutex_unlock(&async->lock);
+	g_async_queue_push(async->full, async->cur);
+	async->cur = (wtap_dump_async_buf *)g_async_queue_pop(async->empty);
+}
+
+/*
+ * Wait until everything written so far has been written to the file.
+ * Returns 0 on success or the writer thread's error.
+ */
+static int
+wtap_dump_async_drain(wtap_dumper *wdh)
+{
+	struct wtap_dump_async *async = wdh->async;
+	int err;
+
+	if (async->cur->len != 0)
+		wtap_dump_async_queue_cur(async);
+
+	g_mutex_lock(&async->lock);
+	while (async->pending != 0)
+		g_cond_wait(&async->idle, &async->lock);
+	err = async->err;
+	g_mutex_unlock(&async->lock);
+	return err;
+}
+
+/*
+ * Write out everything, stop the writer thread and go back to writing
+ * synchronously.  Returns 0 on success or the writer thread's error.
+ */
+static int
+wtap_dump_async_stop(wtap_dumper *wdh)
+{
+	struct wtap_dump_async *async = wdh->async;
+	int err;
+
+	err = wtap_dump_async_drain(wdh);
+	g_async_queue_push(async->full, &wtap_dump_async_stop_buf);
+	g_thread_join(async->thread);
+	wdh->async = NULL;
+
+#ifdef HAVE_POSIX_FALLOCATE
+	/* Give back whatever we preallocated and didn't use. */
+	if (async->preallocated && err == 0) {
+		if (fflush((FILE *)wdh->fh) == EOF ||
+		    ftruncate(ws_fileno((FILE *)wdh->fh), async->end) == -1)
+			err = errno;
+	}
+#endif
+
+	wtap_dump_async_free(async);
+	return err;
+}
+
+static gboolean
+wtap_dump_async_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
+    int *err)
+{
+	struct wtap_dump_async *async = wdh->async;
+	const guint8 *p = (const guint8 *)buf;
+	gsize chunk;
+
+	*err = wtap_dump_async_error(async);
+	if (*err != 0)
+		return FALSE;
+
+	if (async->preallocated) {
+		async->pos += bufsize;
+		if (async->pos > async->end)
+			async->end = async->pos;
+	}
+	while (bufsize != 0) {
+		chunk = MIN(bufsize, async->buf_size - async->cur->len);
+		memcpy(async->cur->data + async->cur->len, p, chunk);
+		async->cur->len += chunk;
+		p += chunk;
+		bufsize -= chunk;
+		if (async->cur->len == async->buf_size)
+			wtap_dump_async_queue_cur(async);
+	}
+	return TRUE;
+}
+
+gboolean
+wtap_dump_set_async(wtap_dumper *wdh, gsize buffer_size, guint num_buffers,
+    gint64 size_hint, int *err)
+{
+	struct wtap_dump_async *async;
+	guint i;
+
+	*err = 0;
+	if (wdh->async != NULL)
+		return TRUE;
+
+	if (buffer_size == 0)
+		buffer_size = WTAP_DUMP_ASYNC_BUFFER_SIZE;
+	if (num_buffers < 2)
+		num_buffers = WTAP_DUMP_ASYNC_NUM_BUFFERS;
+
+	async = g_new0(struct wtap_dump_async, 1);
+	async->full = g_async_queue_new();
+	async->empty = g_async_queue_new();
+	async->num_bufs = num_buffers;
+	async->buf_size = buffer_size;
+	async->bufs = g_new0(wtap_dump_async_buf, num_buffers);
+	for (i = 0; i < num_buffers; i++) {
+		async->bufs[i].data = (guint8 *)g_malloc(buffer_size);
+		if (i != 0)
+			g_async_queue_push(async->empty, &async->bufs[i]);
+	}
+	async->cur = &async->bufs[0];
+	g_mutex_init(&async->lock);
+	g_cond_init(&async->idle);
+
+#ifdef HAVE_POSIX_FALLOCATE
+	/*
+	 * Reserve space for the file up front, so that the file system
+	 * can lay it out contiguously; the file is truncated to the
+	 * right size when it's closed.  This is only a hint, so don't
+	 * worry if it fails, for example because this is a pipe.
+	 */
+	if (size_hint > 0 && wdh->compression_type == WTAP_UNCOMPRESSED) {
+		gint64 pos = ws_ftell64((FILE *)wdh->fh);
+
+		if (pos != -1 && fflush((FILE *)wdh->fh) != EOF &&
+		    posix_fallocate(ws_fileno((FILE *)wdh->fh), 0,
+		      (off_t)(pos + size_hint)) == 0) {
+			async->preallocated = TRUE;
+			async->pos = async->end = pos;
+		}
+	}
+#else
+	(void)size_hint;
+#endif
+
+	wdh->async = async;
+	async->thread = g_thread_try_new("wtap_dump", wtap_dump_async_thread,
+	    wdh, NULL);
+	if (async->thread == NULL) {
+		/* Keep writing synchronously. */
+		wdh->async = NULL;
+#ifdef HAVE_POSIX_FALLOCATE
+		if (async->preallocated &&
+		    ftruncate(ws_fileno((FILE *)wdh->fh), async->end) == -1)
+			*err = errno;
+#endif
+		wtap_dump_async_free(async);
+		if (*err == 0)
+			*err = WTAP_ERR_INTERNAL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean
+wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err)
+{
+	if (wdh->async != NULL)
+		return wtap_dump_async_write(wdh, buf, bufsize, err);
+	return wtap_dump_file_write_sync(wdh, buf, bufsize, err);
+}
+
 /* internally close a file for writing (compressed or not) */
 static int
 wtap_dump_file_close(wtap_dumper *wdh)
@@ -2760,6 +3057,25 @@ wtap_dump_file_close(wtap_dumper *wdh)
 gint64
 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
+	if (wdh->async != NULL) {
+		*err = wtap_dump_async_drain(wdh);
+		if (*err != 0)
+			return -1;
+		if (wdh->async->preallocated) {
+			/* Keep track of where the data ends; the file
+			   itself ends after the space we reserved. */
+			if (whence == SEEK_END) {
+				offset += wdh->async->end;
+				whence = SEEK_SET;
+			}
+			if (-1 == ws_fseek64((FILE *)wdh->fh, offset, whence) ||
+			    -1 == (wdh->async->pos = ws_ftell64((FILE *)wdh->fh))) {
+				*err = errno;
+				return -1;
+			}
+			return 0;
+		}
+	}
 #ifdef HAVE_ZLIB
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
@@ -2781,6 +3097,12 @@ gint64
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
+
+	if (wdh->async != NULL) {
+		*err = wtap_dump_async_drain(wdh);
+		if (*err != 0)
+			return -1;
+	}
 #ifdef HAVE_ZLIB
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
@@ -21,12 +21,31 @@
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
 
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+#include <lz4.h>
+#include <lz4frame.h>
+#endif /* HAVE_LZ4FRAME_H */
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <time.h>
+#endif /* HAVE_SYS_MMAN_H */
+
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#endif /* HAVE_POSIX_FADVISE */
+
 /*
  * See RFC 1952:
  *
@@ -34,6 +53,16 @@
  *
  * for a description of the gzip file format.
  *
+ * See
+ *
+ *      https://tools.ietf.org/html/rfc8878
+ *
+ * for a description of the Zstandard file format, and
+ *
+ *      https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ *
+ * for a description of the LZ4 frame format.
+ *
  * Some other compressed file formats we might want to support:
  *
  *      XZ format: https://tukaani.org/xz/
@@ -50,20 +79,24 @@ static struct compression_type {
     wtap_compression_type  type;
     const char            *extension;
     const char            *description;
+    gboolean               can_write;
 } compression_types[] = {
 #ifdef HAVE_ZLIB
-    { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed" },
+    { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed", TRUE },
+#endif
+#ifdef HAVE_ZSTD
+    { WTAP_ZSTD_COMPRESSED, "zst", "zstd compressed", FALSE },
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    { WTAP_LZ4_COMPRESSED, "lz4", "lz4 compressed", FALSE },
 #endif
-    { WTAP_UNCOMPRESSED, NULL, NULL }
+    { WTAP_UNCOMPRESSED, NULL, NULL, TRUE }
 };
 
 wtap_compression_type
 wtap_get_compression_type(wtap *wth)
 {
-	gboolean is_compressed;
-
-	is_compressed = file_iscompressed((wth->fh == NULL) ? wth->random_fh : wth->fh);
-	return is_compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED;
+	return file_get_compression_type((wth->fh == NULL) ? wth->random_fh : wth->fh);
 }
 
 const char *
@@ -88,6 +121,18 @@ wtap_compression_type_extension(wtap_compression_type compression_type)
 	return NULL;
 }
 
+gboolean
+wtap_can_write_compression_type(wtap_compression_type compression_type)
+{
+	struct compression_type *p;
+
+	for (p = compression_types; p->type != WTAP_UNCOMPRESSED; p++) {
+		if (p->type == compression_type)
+			return p->can_write;
+	}
+	return compression_type == WTAP_UNCOMPRESSED;
+}
+
 GSList *
 wtap_get_all_compression_type_extensions_list(void)
 {
@@ -111,7 +156,14 @@ typedef enum {
     UNCOMPRESSED,  /* uncompressed - copy input directly */
 #ifdef HAVE_ZLIB
     ZLIB,          /* decompress a zlib stream */
-    GZIP_AFTER_HEADER
+    GZIP_AFTER_HEADER,
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD,          /* decompress a zstd frame */
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    LZ4,           /* decompress an LZ4 frame */
+    LZ4_LEGACY,    /* decompress the blocks of an LZ4 legacy frame */
 #endif
 } compression_t;
 
@@ -135,6 +187,7 @@ struct wtap_reader {
     gint64 raw;                 /* where the raw data started, for seeking */
     compression_t compression;  /* type of compression, if any */
     gboolean is_compressed;     /* FALSE if completely uncompressed, TRUE otherwise */
+    wtap_compression_type compression_type; /* type of compression of the file */
 
     /* seek request */
     gint64 skip;                /* amount to skip (already rewound if backwards) */
@@ -149,9 +202,28 @@ struct wtap_reader {
     z_stream strm;              /* stream structure in-place (not a pointer) */
     gboolean dont_check_crc;    /* TRUE if we aren't supposed to check the CRC */
 #endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd_ds;      /* zstd decompression stream */
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    LZ4F_dctx *lz4_dctx;        /* LZ4 frame decompression context */
+    guint8 *lz4_legacy_in;      /* compressed LZ4 legacy block */
+    guint8 *lz4_legacy_out;     /* decompressed LZ4 legacy block */
+    guint lz4_legacy_next;      /* offset of the next byte to deliver from it */
+    guint lz4_legacy_avail;     /* number of bytes left to deliver from it */
+#endif
+    gboolean decomp_pending;    /* TRUE if the decompressor may have output we haven't asked for yet */
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+    gboolean random_access;     /* TRUE if set up for random access by file_set_random_access() */
+
+#ifdef HAVE_SYS_MMAN_H
+    /* memory-mapped input, used for uncompressed regular files */
+    guint8 *map;                /* start of the mapping, or NULL if not mapped */
+    size_t map_len;             /* length of the mapping */
+    unsigned char *out_buf;     /* allocated output buffer, while out.buf points into the mapping */
+#endif
 };
 
 /* Current read offset within a buffer. */
@@ -228,6 +300,125 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
     return 0;
 }
 
+#ifdef HAVE_SYS_MMAN_H
+/*
+ * Uncompressed regular files are read through a memory mapping of the
+ * file rather than with ws_read(); the output buffer is then a window
+ * into the mapping, so delivering data doesn't require a system call
+ * or a copy into an intermediate buffer.
+ *
+ * Small files aren't worth the mmap()/munmap() overhead, and the window
+ * is limited in size because buffer offsets are unsigned ints.
+ *
+ * If the file is truncated while it's mapped, accessing the part of the
+ * mapping past the new end of the file gets us a SIGBUS rather than a
+ * read error, so only files that don't look as if they're being written
+ * are mapped: a file modified in the last MAP_MIN_AGE seconds isn't
+ * mapped, and if a mapped file turns out to have grown when we get to
+ * the end of the mapping, we drop the mapping and read the rest of it
+ * with ws_read().
+ *
+ * XXX - that still doesn't protect us from somebody else truncating a
+ * file that hasn't been modified for a while, e.g. by capturing to it
+ * again while we're reading it.
+ */
+#define MAP_MIN_SIZE    (1024 * 1024)
+#define MAP_WINDOW_SIZE (1024 * 1024 * 1024)
+#define MAP_MIN_AGE     5
+
+/*
+ * Map the file if it's a regular file that's large enough and doesn't
+ * seem to be being written.  Returns TRUE if the file is mapped, FALSE
+ * otherwise.
+ */
+static gboolean
+map_file(FILE_T state)
+{
+    ws_statb64 st;
+    size_t len;
+    guint8 *map;
+
+    if (state->map != NULL)
+        return TRUE;
+    if (state->fd == -1 || ws_fstat64(state->fd, &st) == -1)
+        return FALSE;
+    if (!S_ISREG(st.st_mode) || (guint64)st.st_size > G_MAXSIZE ||
+        st.st_size < MAP_MIN_SIZE)
+        return FALSE;
+    if (time(NULL) - st.st_mtime < MAP_MIN_AGE)
+        return FALSE;
+
+    len = (size_t)st.st_size;
+    map = (guint8 *)mmap(NULL, len, PROT_READ, MAP_PRIVATE, state->fd, 0);
+    if (map == (guint8 *)MAP_FAILED)
+        return FALSE;
+
+#if defined(MADV_RANDOM) && defined(MADV_SEQUENTIAL)
+    /*
+     * The sequential stream reads the file from beginning to end, so
+     * aggressive read-ahead is good.  The random-access stream usually
+     * seeks to fast seek points and never gets here, but if it maps
+     * the file, read-ahead would just waste I/O and page cache.
+     */
+    (void)madvise(map, len, state->random_access ? MADV_RANDOM : MADV_SEQUENTIAL);
+#endif
+    state->map = map;
+    state->map_len = len;
+    return TRUE;
+}
+
+/*
+ * Drop the mapping and go back to reading the file with ws_read(),
+ * continuing with the first byte not yet delivered.
+ */
+static int
+unmap_file(FILE_T state)
+{
+    if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+        return -1;
+    }
+    munmap(state->map, state->map_len);
+    state->map = NULL;
+    state->map_len = 0;
+    state->out.buf = state->out_buf;
+    buf_reset(&state->out);
+    return 0;
+}
+
+/*
+ * Point the output buffer at the next window of the mapping, starting
+ * at raw_pos.
+ */
+static int
+map_fill(FILE_T state)
+{
+    ws_statb64 st;
+    size_t left;
+
+    if (state->raw_pos >= (gint64)state->map_len) {
+        /*
+         * If the file has grown since we mapped it, it's being
+         * written, so read the rest of it without the mapping.
+         */
+        if (ws_fstat64(state->fd, &st) == 0 && st.st_size > (gint64)state->map_len) {
+            if (unmap_file(state) == -1)
+                return -1;
+            return buf_read(state, &state->out);
+        }
+        state->eof = TRUE;
+        return 0;
+    }
+    left = state->map_len - (size_t)state->raw_pos;
+    state->out.buf = state->map + state->raw_pos;
+    state->out.next = state->out.buf;
+    state->out.avail = left > MAP_WINDOW_SIZE ? MAP_WINDOW_SIZE : (guint)left;
+    state->raw_pos += state->out.avail;
+    return 0;
+}
+#endif /* HAVE_SYS_MMAN_H */
+
 static int /* gz_avail */
 fill_in_buffer(FILE_T state)
 {
@@ -240,6 +431,34 @@ fill_in_buffer(FILE_T state)
     return 0;
 }
 
+/* Try to get at least n bytes into the input buffer; we'll get fewer
+   only if we hit the end of the file.  Returns -1, and sets state->err,
+   on error. */
+static int
+fill_in_buffer_min(FILE_T state, guint n)
+{
+    while (state->in.avail < n && !state->eof) {
+        /* Move what we have to the beginning of the buffer, so that
+           buf_read() appends to it rather than discarding it. */
+        if (state->in.next != state->in.buf) {
+            memmove(state->in.buf, state->in.next, state->in.avail);
+            state->in.next = state->in.buf;
+        }
+        if (fill_in_buffer(state) == -1)
+            return -1;
+    }
+    return 0;
+}
+
+/* TRUE if there's no more data to deliver: we've hit the end of the
+   file, and there's nothing left in the input buffer or inside the
+   decompressor. */
+static gboolean
+input_exhausted(FILE_T state)
+{
+    return state->eof && state->in.avail == 0 && !state->decomp_pending;
+}
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -294,6 +513,23 @@ fast_seek_find(FILE_T file, gint64 pos)
     return smallest;
 }
 
+/* Is this seek point at the beginning of a zstd or LZ4 frame, or of a
+   block of an LZ4 legacy frame?  We can't start decompressing those
+   anywhere else, so we always restart there. */
+static gboolean
+fast_seek_is_frame_start(const struct fast_seek_point *point _U_)
+{
+#ifdef HAVE_ZSTD
+    if (point->compression == ZSTD)
+        return TRUE;
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    if (point->compression == LZ4 || point->compression == LZ4_LEGACY)
+        return TRUE;
+#endif
+    return FALSE;
+}
+
 static void
 fast_seek_header(FILE_T file, gint64 in_pos, gint64 out_pos,
                  compression_t compression)
@@ -642,6 +878,373 @@ DIAG_ON(cast-qual)
 }
 #endif
 
+#ifdef HAVE_ZSTD
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    size_t ret = 1;
+
+    output.dst = buf;
+    output.size = count;
+    output.pos = 0;
+
+    /* fill output buffer up to end of frame or error */
+    do {
+        /* get more input, unless the decompressor might still have
+           output for us from what we've already given it */
+        if (state->in.avail == 0 && !state->decomp_pending) {
+            if (fill_in_buffer(state) == -1)
+                break;
+            if (state->in.avail == 0) {
+                /* EOF */
+                state->err = WTAP_ERR_SHORT_READ;
+                state->err_info = NULL;
+                break;
+            }
+        }
+
+        input.src = state->in.next;
+        input.size = state->in.avail;
+        input.pos = 0;
+        ret = ZSTD_decompressStream(state->zstd_ds, &output, &input);
+        state->in.next += input.pos;
+        state->in.avail -= (guint)input.pos;
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = ZSTD_getErrorName(ret);
+            state->decomp_pending = FALSE;
+            break;
+        }
+
+        /* a full output buffer might have left data inside the
+           decompressor */
+        state->decomp_pending = (output.pos == output.size && ret != 0);
+    } while (output.pos < output.size && ret != 0);
+
+    /* update available output */
+    state->out.next = buf;
+    state->out.avail = (guint)output.pos;
+
+    /* A return value of 0 means we've decompressed and flushed a
+       complete frame; there may be another frame, or something else,
+       after it. */
+    if (ret == 0)
+        state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    size_t ret = 1;
+    size_t in_size, out_size;
+    guint have = 0;
+
+    /* fill output buffer up to end of frame or error */
+    do {
+        /* get more input, unless the decompressor might still have
+           output for us from what we've already given it */
+        if (state->in.avail == 0 && !state->decomp_pending) {
+            if (fill_in_buffer(state) == -1)
+                break;
+            if (state->in.avail == 0) {
+                /* EOF */
+                state->err = WTAP_ERR_SHORT_READ;
+                state->err_info = NULL;
+                break;
+            }
+        }
+
+        in_size = state->in.avail;
+        out_size = count - have;
+        ret = LZ4F_decompress(state->lz4_dctx, buf + have, &out_size,
+                              state->in.next, &in_size, NULL);
+        state->in.next += in_size;
+        state->in.avail -= (guint)in_size;
+        if (LZ4F_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = LZ4F_getErrorName(ret);
+            state->decomp_pending = FALSE;
+            break;
+        }
+        have += (guint)out_size;
+
+        /* a full output buffer might have left data inside the
+           decompressor */
+        state->decomp_pending = (have == count && ret != 0);
+    } while (have < count && ret != 0);
+
+    /* update available output */
+    state->out.next = buf;
+    state->out.avail = have;
+
+    /* A return value of 0 means we've decompressed and flushed a
+       complete frame; there may be another frame, or something else,
+       after it. */
+    if (ret == 0)
+        state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+}
+
+/*
+ * An LZ4 legacy frame is a sequence of independently compressed blocks,
+ * each of which decompresses to at most 8 MB and is preceded by its
+ * compressed size; it ends at the end of the file or at the magic
+ * number of another frame.
+ */
+#define LZ4_LEGACY_BLOCK_SIZE   (8 * 1024 * 1024)
+
+static gboolean is_frame_magic(guint32 magic);
+
+static void
+lz4_legacy_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    guint32 block_len;
+    guint have, n;
+    int ret;
+
+    state->out.next = buf;
+    state->out.avail = 0;
+
+    if (state->lz4_legacy_avail == 0) {
+        /* get the size of the next block */
+        if (fill_in_buffer_min(state, 4) == -1)
+            return;
+        if (state->in.avail == 0) {
+            /* EOF ends the frame */
+            state->compression = UNKNOWN;
+            return;
+        }
+        if (state->in.avail < 4) {
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            return;
+        }
+        block_len = pletoh32(state->in.next);
+        if (is_frame_magic(block_len)) {
+            /* so does another frame; leave its magic number for
+               frame_head() */
+            state->compression = UNKNOWN;
+            return;
+        }
+        if (block_len == 0 || block_len > (guint32)LZ4_compressBound(LZ4_LEGACY_BLOCK_SIZE)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = "LZ4 legacy block has an invalid size";
+            return;
+        }
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, LZ4_LEGACY);
+        state->in.next += 4;
+        state->in.avail -= 4;
+
+        /* get the whole block */
+        if (state->lz4_legacy_in == NULL) {
+            state->lz4_legacy_in = (guint8 *)g_malloc(LZ4_compressBound(LZ4_LEGACY_BLOCK_SIZE));
+            state->lz4_legacy_out = (guint8 *)g_malloc(LZ4_LEGACY_BLOCK_SIZE);
+        }
+        have = 0;
+        while (have < block_len) {
+            if (state->in.avail == 0) {
+                if (fill_in_buffer(state) == -1)
+                    return;
+                if (state->in.avail == 0) {
+                    state->err = WTAP_ERR_SHORT_READ;
+                    state->err_info = NULL;
+                    return;
+                }
+            }
+            n = MIN(state->in.avail, block_len - have);
+            memcpy(state->lz4_legacy_in + have, state->in.next, n);
+            state->in.next += n;
+            state->in.avail -= n;
+            have += n;
+        }
+
+        ret = LZ4_decompress_safe((const char *)state->lz4_legacy_in,
+                                  (char *)state->lz4_legacy_out,
+                                  (int)block_len, LZ4_LEGACY_BLOCK_SIZE);
+        if (ret < 0) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = "LZ4 legacy block is corrupt";
+            return;
+        }
+        state->lz4_legacy_next = 0;
+        state->lz4_legacy_avail = (guint)ret;
+    }
+
+    n = MIN(count, state->lz4_legacy_avail);
+    memcpy(buf, state->lz4_legacy_out + state->lz4_legacy_next, n);
+    state->lz4_legacy_next += n;
+    state->lz4_legacy_avail -= n;
+    state->out.avail = n;
+}
+#endif /* HAVE_LZ4FRAME_H */
+
+/*
+ * zstd and LZ4 skippable frames: a magic number from 0x184D2A50 to
+ * 0x184D2A5F, a four-byte little-endian length, and that many bytes of
+ * data we don't care about.
+ */
+#define SKIPPABLE_MAGIC_MASK    0xFFFFFFF0
+#define SKIPPABLE_MAGIC         0x184D2A50
+
+#define ZSTD_MAGIC              0xFD2FB528
+#define LZ4_MAGIC               0x184D2204
+#define LZ4_LEGACY_MAGIC        0x184C2102
+
+static gboolean
+is_frame_magic(guint32 magic)
+{
+    return magic == ZSTD_MAGIC || magic == LZ4_MAGIC ||
+           magic == LZ4_LEGACY_MAGIC ||
+           (magic & SKIPPABLE_MAGIC_MASK) == SKIPPABLE_MAGIC;
+}
+
+/* Skip len bytes of input; returns 0 on success and -1, with state->err
+   set, on error or if the input ends first. */
+static int
+skip_input(FILE_T state, guint32 len)
+{
+    guint n;
+
+    while (len != 0) {
+        if (state->in.avail == 0) {
+            if (fill_in_buffer(state) == -1)
+                return -1;
+            if (state->in.avail == 0) {
+                state->err = WTAP_ERR_SHORT_READ;
+                state->err_info = NULL;
+                return -1;
+            }
+        }
+        n = MIN(state->in.avail, len);
+        state->in.next += n;
+        state->in.avail -= n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+ * Look for the magic number at the beginning of a zstd or LZ4 frame,
+ * skipping any skippable frames before it.  Returns 1 if we found one
+ * and are set up to decompress the frame, 0 if we didn't find one, and
+ * -1 on error.
+ */
+static int
+frame_head(FILE_T state)
+{
+    guint32 magic;
+
+    for (;;) {
+        /* the magic numbers are 4 bytes long */
+        if (fill_in_buffer_min(state, 4) == -1)
+            return -1;
+        if (state->in.avail < 4)
+            return 0;
+        magic = pletoh32(state->in.next);
+        if ((magic & SKIPPABLE_MAGIC_MASK) != SKIPPABLE_MAGIC)
+            break;
+
+        /* skip the magic number, the length, and the data */
+        if (fill_in_buffer_min(state, 8) == -1)
+            return -1;
+        if (state->in.avail < 8) {
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            return -1;
+        }
+        magic = pletoh32(state->in.next + 4);
+        state->in.next += 8;
+        state->in.avail -= 8;
+        if (skip_input(state, magic) == -1)
+            return -1;
+    }
+
+    /*
+     * We leave the magic number in the input buffer, as the
+     * decompressor wants to see the entire frame header.
+     */
+    if (magic == ZSTD_MAGIC) {
+#ifdef HAVE_ZSTD
+        if (state->zstd_ds == NULL) {
+            state->zstd_ds = ZSTD_createDStream();
+            if (state->zstd_ds == NULL) {
+                state->err = ENOMEM;
+                state->err_info = NULL;
+                return -1;
+            }
+        }
+        if (ZSTD_isError(ZSTD_initDStream(state->zstd_ds))) {
+            state->err = WTAP_ERR_INTERNAL;
+            state->err_info = "Unknown error from ZSTD_initDStream()";
+            return -1;
+        }
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, ZSTD);
+        state->compression = ZSTD;
+        state->is_compressed = TRUE;
+        state->compression_type = WTAP_ZSTD_COMPRESSED;
+        state->decomp_pending = FALSE;
+        return 1;
+#else
+        state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
+        state->err_info = "reading zstd-compressed files isn't supported";
+        return -1;
+#endif
+    }
+
+    if (magic == LZ4_MAGIC) {
+#ifdef HAVE_LZ4FRAME_H
+        /* start from scratch, even if we'd stopped in the middle of a
+           frame before seeking here */
+        if (state->lz4_dctx != NULL) {
+            LZ4F_freeDecompressionContext(state->lz4_dctx);
+            state->lz4_dctx = NULL;
+        }
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION))) {
+            state->lz4_dctx = NULL;
+            state->err = ENOMEM;
+            state->err_info = NULL;
+            return -1;
+        }
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, LZ4);
+        state->compression = LZ4;
+        state->is_compressed = TRUE;
+        state->compression_type = WTAP_LZ4_COMPRESSED;
+        state->decomp_pending = FALSE;
+        return 1;
+#else
+        state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
+        state->err_info = "reading LZ4-compressed files isn't supported";
+        return -1;
+#endif
+    }
+
+    if (magic == LZ4_LEGACY_MAGIC) {
+#ifdef HAVE_LZ4FRAME_H
+        /* the blocks have no header of their own, so drop the magic */
+        state->in.next += 4;
+        state->in.avail -= 4;
+        state->compression = LZ4_LEGACY;
+        state->is_compressed = TRUE;
+        state->compression_type = WTAP_LZ4_COMPRESSED;
+        state->decomp_pending = FALSE;
+        state->lz4_legacy_avail = 0;
+        return 1;
+#else
+        state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
+        state->err_info = "reading LZ4-compressed files isn't supported";
+        return -1;
+#endif
+    }
+
+    return 0;
+}
+
 static int
 gz_head(FILE_T state)
 {
@@ -655,6 +1258,20 @@ gz_head(FILE_T state)
             return 0;
     }
 
+    /* look for a zstd or LZ4 frame */
+    switch (frame_head(state)) {
+
+    case -1:
+        return -1;
+
+    case 1:
+        return 0;
+    }
+
+    /* nothing but skippable frames */
+    if (state->in.avail == 0)
+        return 0;
+
     /* look for the gzip magic header bytes 31 and 139 */
     if (state->in.next[0] == 31) {
         state->in.avail--;
@@ -767,6 +1384,7 @@ gz_head(FILE_T state)
                 state->strm.adler = crc32(0L, Z_NULL, 0);
                 state->compression = ZLIB;
                 state->is_compressed = TRUE;
+                state->compression_type = WTAP_GZIP_COMPRESSED;
 #ifdef Z_BLOCK
                 if (state->fast_seek) {
                     struct zlib_cur_seek_point *cur = g_new(struct zlib_cur_seek_point,1);
@@ -816,6 +1434,19 @@ gz_head(FILE_T state)
        input to output -- this assumes that the output buffer is larger than
        the input buffer, which also assures space for gzungetc() */
     state->raw = state->pos;
+#ifdef HAVE_SYS_MMAN_H
+    /* if the whole file is uncompressed, try delivering it from a
+       mapping instead, starting with what we've read into the input
+       buffer */
+    if (!state->is_compressed && map_file(state)) {
+        if (state->out_buf == NULL)
+            state->out_buf = state->out.buf;
+        state->raw_pos -= bytes_in_buffer(&state->in);
+        buf_reset(&state->in);
+        state->compression = UNCOMPRESSED;
+        return map_fill(state);
+    }
+#endif
     state->out.next = state->out.buf;
     /* not a compressed file -- copy everything we've read into the
        input buffer to the output buffer and fall to raw i/o */
@@ -841,6 +1472,10 @@ fill_out_buffer(FILE_T state)
             return 0;
     }
     if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_SYS_MMAN_H
+        if (state->map != NULL)
+            return map_fill(state);
+#endif
         if (buf_read(state, &state->out) < 0)
             return -1;
     }
@@ -848,6 +1483,19 @@ fill_out_buffer(FILE_T state)
     else if (state->compression == ZLIB) {      /* decompress */
         zlib_read(state, state->out.buf, state->size << 1);
     }
+#endif
+#ifdef HAVE_ZSTD
+    else if (state->compression == ZSTD) {      /* decompress */
+        zstd_read(state, state->out.buf, state->size << 1);
+    }
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    else if (state->compression == LZ4) {       /* decompress */
+        lz4_read(state, state->out.buf, state->size << 1);
+    }
+    else if (state->compression == LZ4_LEGACY) {    /* decompress */
+        lz4_legacy_read(state, state->out.buf, state->size << 1);
+    }
 #endif
     return 0;
 }
@@ -874,7 +1522,7 @@ gz_skip(FILE_T state, gint64 len)
                any more data into the output buffer, so
                return an error indication. */
             return -1;
-        } else if (state->eof && state->in.avail == 0) {
+        } else if (input_exhausted(state)) {
             /* We have nothing in the output buffer, and
                we're at the end of the input; just return. */
             break;
@@ -894,6 +1542,10 @@ gz_reset(FILE_T state)
     buf_reset(&state->out);       /* no output data available */
     state->eof = FALSE;           /* not at end of file */
     state->compression = UNKNOWN; /* look for gzip header */
+    state->decomp_pending = FALSE; /* nothing inside the decompressor */
+#ifdef HAVE_LZ4FRAME_H
+    state->lz4_legacy_avail = 0;  /* nothing left of an LZ4 legacy block */
+#endif
 
     state->seek_pending = FALSE;  /* no seek request pending */
     state->err = 0;               /* clear error */
@@ -945,6 +1597,7 @@ file_fdopen(int fd)
 
     /* we don't yet know whether it's compressed */
     state->is_compressed = FALSE;
+    state->compression_type = WTAP_UNCOMPRESSED;
 
     /* save the current position for rewinding (only if reading) */
     state->start = ws_lseek64(state->fd, 0, SEEK_CUR);
@@ -954,6 +1607,16 @@ file_fdopen(int fd)
     /* initialize stream */
     gz_reset(state);
 
+#ifdef HAVE_POSIX_FADVISE
+    /*
+     * Until we're told otherwise, assume we'll read the file from
+     * beginning to end, and ask for more read-ahead than the default.
+     * When many files are read in an interleaved fashion, as when
+     * merging, that keeps each read from going to the disk.
+     */
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
 #ifdef _STATBUF_ST_BLKSIZE
     if (ws_fstat64(fd, &st) >= 0) {
         /*
@@ -1060,9 +1723,14 @@ file_open(const char *path)
 }
 
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+    stream->random_access = random_flag;
+#ifdef HAVE_POSIX_FADVISE
+    (void)posix_fadvise(stream->fd, 0, 0,
+                        random_flag ? POSIX_FADV_RANDOM : POSIX_FADV_SEQUENTIAL);
+#endif
 }
 
 gint64
@@ -1169,6 +1837,28 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         }
     }
 
+#ifdef HAVE_SYS_MMAN_H
+    /*
+     * We're not seeking within the buffer.  If we're reading the file
+     * through a mapping, every offset is directly addressable, so just
+     * move there; the next read will set up the output buffer.
+     */
+    if (file->map != NULL && file->compression == UNCOMPRESSED) {
+        offset += file->pos;
+        if (offset < 0) {                    /* before start of file! */
+            *err = EINVAL;
+            return -1;
+        }
+        file->raw_pos = file->start + offset;
+        buf_reset(&file->out);
+        file->eof = FALSE;
+        file->err = 0;
+        file->err_info = NULL;
+        file->pos = offset;
+        return file->pos;
+    }
+#endif
+
     /*
      * We're not seeking within the buffer.  Do we have "fast seek" data
      * for the location to which we will be seeking, and is the offset
@@ -1178,7 +1868,9 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
      * XXX, profile
      */
     if ((here = fast_seek_find(file, file->pos + offset)) &&
-        (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED)) {
+        (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED) &&
+        /* restarting the frame we're already in is slower than reading on */
+        !(offset > 0 && here->out <= file->pos && fast_seek_is_frame_start(here))) {
         gint64 off, off2;
 
         /*
@@ -1200,6 +1892,10 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off2 = here->out;
         } else
 #endif
+        if (fast_seek_is_frame_start(here)) {
+            off = here->in;
+            off2 = here->out;
+        } else
         {
             off2 = (file->pos + offset);
             off = here->in + (off2 - here->out);
@@ -1217,6 +1913,7 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         file->seek_pending = FALSE;
         file->err = 0;
         file->err_info = NULL;
+        file->decomp_pending = FALSE;
         buf_reset(&file->in);
 
 #ifdef HAVE_ZLIB
@@ -1252,6 +1949,17 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             file->compression = ZLIB;
         } else
 #endif
+#ifdef HAVE_LZ4FRAME_H
+        if (here->compression == LZ4_LEGACY) {
+            /* read the block from the start */
+            file->compression = LZ4_LEGACY;
+            file->lz4_legacy_avail = 0;
+        } else
+#endif
+        if (fast_seek_is_frame_start(here)) {
+            /* look for the frame header, and set up the decompressor */
+            file->compression = UNKNOWN;
+        } else
             file->compression = here->compression;
 
         offset = (file->pos + offset) - off2;
@@ -1361,6 +2069,12 @@ file_tell(FILE_T stream)
 gint64
 file_tell_raw(FILE_T stream)
 {
+#ifdef HAVE_SYS_MMAN_H
+    /* With a mapping, raw_pos is the end of the window, which could be
+       a long way past what we've actually delivered. */
+    if (stream->map != NULL && stream->compression == UNCOMPRESSED)
+        return stream->raw_pos - stream->out.avail;
+#endif
     return stream->raw_pos;
 }
 
@@ -1381,6 +2095,12 @@ file_iscompressed(FILE_T stream)
     return stream->is_compressed;
 }
 
+wtap_compression_type
+file_get_compression_type(FILE_T stream)
+{
+    return stream->compression_type;
+}
+
 int
 file_read(void *buf, unsigned int len, FILE_T file)
 {
@@ -1423,7 +2143,7 @@ file_read(void *buf, unsigned int len, FILE_T file)
                any more data into the output buffer, so
                return an error indication. */
             return -1;
-        } else if (file->eof && file->in.avail == 0) {
+        } else if (input_exhausted(file)) {
             /* We have nothing in the output buffer, and
                we're at the end of the input; just return
                with what we've gotten so far. */
@@ -1478,7 +2198,7 @@ file_peekc(FILE_T file)
         else if (file->err != 0) {
             return -1;
         }
-        else if (file->eof && file->in.avail == 0) {
+        else if (input_exhausted(file)) {
             return -1;
         }
         else if (fill_out_buffer(file) == -1) {
@@ -1594,7 +2314,7 @@ int
 file_eof(FILE_T file)
 {
     /* return end-of-file state */
-    return (file->eof && file->in.avail == 0 && file->out.avail == 0);
+    return (input_exhausted(file) && file->out.avail == 0);
 }
 
 /*
@@ -1635,6 +2355,15 @@ file_fdreopen(FILE_T file, const char *path)
 
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return FALSE;
+
+    /*
+     * Seeks can be relative to where the old descriptor was, so
+     * put the new one there.
+     */
+    if (ws_lseek64(fd, file->raw_pos, SEEK_SET) == -1) {
+        ws_close(fd);
+        return FALSE;
+    }
     file->fd = fd;
     return TRUE;
 }
@@ -1645,6 +2374,12 @@ file_close(FILE_T file)
     int fd = file->fd;
 
     /* free memory and close file */
+#ifdef HAVE_SYS_MMAN_H
+    if (file->map != NULL) {
+        munmap(file->map, file->map_len);
+        file->out.buf = file->out_buf;
+    }
+#endif
     if (file->size) {
 #ifdef HAVE_ZLIB
         inflateEnd(&(file->strm));
@@ -1652,6 +2387,16 @@ file_close(FILE_T file)
         g_free(file->out.buf);
         g_free(file->in.buf);
     }
+#ifdef HAVE_ZSTD
+    if (file->zstd_ds != NULL)
+        ZSTD_freeDStream(file->zstd_ds);
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    if (file->lz4_dctx != NULL)
+        LZ4F_freeDecompressionContext(file->lz4_dctx);
+    g_free(file->lz4_legacy_in);
+    g_free(file->lz4_legacy_out);
+#endif
     g_free(file->fast_seek_cur);
     file->err = 0;
     file->err_info = NULL;
@@ -1665,6 +2410,421 @@ file_close(FILE_T file)
         ws_close(fd);
 }
 
+/*
+ * Fast-seek index files.
+ *
+ * Finding the fast-seek points for a compressed file requires
+ * decompressing all of it, so, for a big file, it's worth saving them
+ * in a file and reading them back in the next time the capture file is
+ * opened.
+ *
+ * An index file starts with a header containing:
+ *
+ *     8 bytes of magic number;
+ *     4 bytes of version number;
+ *     4 bytes of number of seek points;
+ *     8 bytes of size of the capture file;
+ *     8 bytes of modification time of the capture file, in seconds;
+ *     4 bytes of nanoseconds of that modification time, or 0 if the
+ *       platform doesn't give us those;
+ *     4 bytes of padding;
+ *
+ * followed by the seek points, each of which contains:
+ *
+ *     8 bytes of offset in the uncompressed data;
+ *     8 bytes of offset in the capture file;
+ *     1 byte of seek point type;
+ *     1 byte of number of bits to prime the inflater with (zlib only);
+ *     2 bytes of padding;
+ *     4 bytes of CRC of the uncompressed data so far (zlib only);
+ *     4 bytes of length of the uncompressed data so far (zlib only);
+ *     4 bytes of length of the deflated 32K window that follows (zlib only);
+ *
+ * with all multi-byte values little-endian.  If the size or
+ * modification time of the capture file doesn't match what's in the
+ * header, the capture file has changed, and the index is ignored.
+ *
+ * The index is written to a temporary file that's renamed to the
+ * index file once it's complete, so an index file is never partial.
+ */
+static const guint8 seek_index_magic[8] = { 'W', 'T', 'A', 'P', 'S', 'E', 'E', 'K' };
+#define SEEK_INDEX_VERSION      2
+#define SEEK_INDEX_HDR_LEN      40
+#define SEEK_INDEX_POINT_LEN    32
+
+/*
+ * Seek point types in index files; these don't change if the
+ * compression_t values do.
+ */
+#define SEEK_INDEX_UNCOMPRESSED         1
+#define SEEK_INDEX_ZLIB                 2
+#define SEEK_INDEX_GZIP_AFTER_HEADER    3
+#define SEEK_INDEX_ZSTD                 4
+#define SEEK_INDEX_LZ4                  5
+#define SEEK_INDEX_LZ4_LEGACY           6
+
+static guint8
+seek_index_point_type(compression_t compression)
+{
+    switch (compression) {
+
+    case UNCOMPRESSED:
+        return SEEK_INDEX_UNCOMPRESSED;
+
+#ifdef HAVE_ZLIB
+    case ZLIB:
+        return SEEK_INDEX_ZLIB;
+
+    case GZIP_AFTER_HEADER:
+        return SEEK_INDEX_GZIP_AFTER_HEADER;
+#endif
+
+#ifdef HAVE_ZSTD
+    case ZSTD:
+        return SEEK_INDEX_ZSTD;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+    case LZ4:
+        return SEEK_INDEX_LZ4;
+
+    case LZ4_LEGACY:
+        return SEEK_INDEX_LZ4_LEGACY;
+#endif
+
+    default:
+        return 0;
+    }
+}
+
+/* Returns FALSE if we don't support that type of seek point. */
+static gboolean
+seek_index_point_compression(guint8 type, compression_t *compression)
+{
+    switch (type) {
+
+    case SEEK_INDEX_UNCOMPRESSED:
+        *compression = UNCOMPRESSED;
+        return TRUE;
+
+#ifdef HAVE_ZLIB
+    case SEEK_INDEX_ZLIB:
+        *compression = ZLIB;
+        return TRUE;
+
+    case SEEK_INDEX_GZIP_AFTER_HEADER:
+        *compression = GZIP_AFTER_HEADER;
+        return TRUE;
+#endif
+
+#ifdef HAVE_ZSTD
+    case SEEK_INDEX_ZSTD:
+        *compression = ZSTD;
+        return TRUE;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+    case SEEK_INDEX_LZ4:
+        *compression = LZ4;
+        return TRUE;
+
+    case SEEK_INDEX_LZ4_LEGACY:
+        *compression = LZ4_LEGACY;
+        return TRUE;
+#endif
+
+    default:
+        return FALSE;
+    }
+}
+
+/*
+ * Nanoseconds of the modification time in a stat buffer, or 0 if the
+ * platform doesn't give us those.  Index files record the modification
+ * time of the capture file with them as well as the seconds, so that a
+ * capture file rewritten within the same second isn't taken for the one
+ * that was indexed.
+ */
+guint32
+file_mtime_nsec(const ws_statb64 *st _U_)
+{
+#if defined(HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+    return (guint32)st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
+    return (guint32)st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Create a temporary file, named after path, to write an index file to
+ * before renaming it to path, so that an index file is never partial,
+ * and two programs writing the same index don't write to the same file.
+ * Returns the file, and sets *tmp_path to its name, to be freed with
+ * g_free(); on failure, returns NULL and sets *err.
+ */
+FILE *
+file_create_index_tmp(const char *path, gchar **tmp_path, int *err)
+{
+    int fd;
+    FILE *fp;
+
+    *tmp_path = g_strdup_printf("%s.XXXXXX", path);
+    fd = g_mkstemp_full(*tmp_path, O_WRONLY|O_BINARY, 0666);
+    if (fd == -1) {
+        *err = errno;
+        g_free(*tmp_path);
+        *tmp_path = NULL;
+        return NULL;
+    }
+    fp = ws_fdopen(fd, "wb");
+    if (fp == NULL) {
+        *err = errno;
+        ws_close(fd);
+        ws_unlink(*tmp_path);
+        g_free(*tmp_path);
+        *tmp_path = NULL;
+        return NULL;
+    }
+    return fp;
+}
+
+/*
+ * Write the fast-seek points for a stream to an index file.  Returns
+ * TRUE on success; on failure, returns FALSE and sets *err.
+ */
+gboolean
+file_save_fast_seek_index(FILE_T stream, const char *path, int *err)
+{
+    ws_statb64 st;
+    guint8 hdr[SEEK_INDEX_HDR_LEN];
+    guint8 rec[SEEK_INDEX_POINT_LEN];
+    gchar *tmp_path;
+    FILE *fp;
+    guint i;
+#ifdef HAVE_ZLIB
+    Bytef *window;
+    uLongf window_len = 0;
+#endif
+
+    if (stream->fast_seek == NULL) {
+        *err = WTAP_ERR_INTERNAL;
+        return FALSE;
+    }
+    if (file_fstat(stream, &st, err) == -1)
+        return FALSE;
+
+    fp = file_create_index_tmp(path, &tmp_path, err);
+    if (fp == NULL)
+        return FALSE;
+
+    memset(hdr, 0, sizeof hdr);
+    memcpy(hdr, seek_index_magic, sizeof seek_index_magic);
+    phtole32(hdr + 8, SEEK_INDEX_VERSION);
+    phtole32(hdr + 12, stream->fast_seek->len);
+    phtole64(hdr + 16, (guint64)st.st_size);
+    phtole64(hdr + 24, (guint64)st.st_mtime);
+    phtole32(hdr + 32, file_mtime_nsec(&st));
+    if (fwrite(hdr, 1, sizeof hdr, fp) != sizeof hdr)
+        goto write_error;
+
+#ifdef HAVE_ZLIB
+    window = (Bytef *)g_malloc(compressBound(ZLIB_WINSIZE));
+#endif
+    for (i = 0; i < stream->fast_seek->len; i++) {
+        struct fast_seek_point *point = (struct fast_seek_point *)stream->fast_seek->pdata[i];
+
+        memset(rec, 0, sizeof rec);
+        phtole64(rec + 0, (guint64)point->out);
+        phtole64(rec + 8, (guint64)point->in);
+        rec[16] = seek_index_point_type(point->compression);
+#ifdef HAVE_ZLIB
+        if (point->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+            rec[17] = (guint8)point->data.zlib.bits;
+#endif
+            phtole32(rec + 20, point->data.zlib.adler);
+            phtole32(rec + 24, point->data.zlib.total_out);
+            window_len = compressBound(ZLIB_WINSIZE);
+            if (compress2(window, &window_len, point->data.zlib.window,
+                          ZLIB_WINSIZE, Z_BEST_SPEED) != Z_OK) {
+                g_free(window);
+                fclose(fp);
+                ws_unlink(tmp_path);
+                g_free(tmp_path);
+                *err = WTAP_ERR_INTERNAL;
+                return FALSE;
+            }
+            phtole32(rec + 28, (guint32)window_len);
+        }
+#endif
+        if (fwrite(rec, 1, sizeof rec, fp) != sizeof rec) {
+#ifdef HAVE_ZLIB
+            g_free(window);
+#endif
+            goto write_error;
+        }
+#ifdef HAVE_ZLIB
+        if (point->compression == ZLIB &&
+            fwrite(window, 1, window_len, fp) != window_len) {
+            g_free(window);
+            goto write_error;
+        }
+#endif
+    }
+#ifdef HAVE_ZLIB
+    g_free(window);
+#endif
+
+    if (fclose(fp) == EOF) {
+        *err = errno;
+        ws_unlink(tmp_path);
+        g_free(tmp_path);
+        return FALSE;
+    }
+    if (ws_rename(tmp_path, path) == -1) {
+        *err = errno;
+        ws_unlink(tmp_path);
+        g_free(tmp_path);
+        return FALSE;
+    }
+    g_free(tmp_path);
+    return TRUE;
+
+write_error:
+    *err = ferror(fp) ? errno : WTAP_ERR_SHORT_WRITE;
+    fclose(fp);
+    ws_unlink(tmp_path);
+    g_free(tmp_path);
+    return FALSE;
+}
+
+/*
+ * Replace the fast-seek points for a stream with the ones from an index
+ * file.  Returns TRUE on success; returns FALSE, and sets *err to 0,
+ * if the index file is for a different version of the capture file or
+ * isn't one we understand, and returns FALSE, and sets *err to an
+ * error code, if we couldn't read it.
+ */
+gboolean
+file_load_fast_seek_index(FILE_T stream, const char *path, int *err)
+{
+    ws_statb64 st;
+    guint8 hdr[SEEK_INDEX_HDR_LEN];
+    guint8 rec[SEEK_INDEX_POINT_LEN];
+    FILE *fp;
+    guint32 count, i;
+    GPtrArray *points;
+    struct fast_seek_point *point;
+    gboolean ok = FALSE;
+#ifdef HAVE_ZLIB
+    Bytef *window;
+    uLongf window_len;
+    guint32 stored_len;
+#endif
+
+    if (stream->fast_seek == NULL) {
+        *err = WTAP_ERR_INTERNAL;
+        return FALSE;
+    }
+    if (file_fstat(stream, &st, err) == -1)
+        return FALSE;
+
+    fp = ws_fopen(path, "rb");
+    if (fp == NULL) {
+        *err = errno;
+        return FALSE;
+    }
+
+    *err = 0;
+    if (fread(hdr, 1, sizeof hdr, fp) != sizeof hdr ||
+        memcmp(hdr, seek_index_magic, sizeof seek_index_magic) != 0 ||
+        pletoh32(hdr + 8) != SEEK_INDEX_VERSION ||
+        pletoh64(hdr + 16) != (guint64)st.st_size ||
+        pletoh64(hdr + 24) != (guint64)st.st_mtime ||
+        pletoh32(hdr + 32) != file_mtime_nsec(&st)) {
+        fclose(fp);
+        return FALSE;
+    }
+    count = pletoh32(hdr + 12);
+    if (count == 0) {
+        fclose(fp);
+        return FALSE;
+    }
+
+    points = g_ptr_array_new_with_free_func(g_free);
+#ifdef HAVE_ZLIB
+    window = (Bytef *)g_malloc(compressBound(ZLIB_WINSIZE));
+#endif
+    for (i = 0; i < count; i++) {
+        if (fread(rec, 1, sizeof rec, fp) != sizeof rec)
+            goto done;
+
+        point = g_new0(struct fast_seek_point, 1);
+        g_ptr_array_add(points, point);
+        point->out = (gint64)pletoh64(rec + 0);
+        point->in = (gint64)pletoh64(rec + 8);
+        if (!seek_index_point_compression(rec[16], &point->compression))
+            goto done;
+
+        /* fast_seek_find() does a binary search */
+        if (i != 0 &&
+            point->out <= ((struct fast_seek_point *)points->pdata[i - 1])->out)
+            goto done;
+
+#ifdef HAVE_ZLIB
+        if (point->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+            point->data.zlib.bits = rec[17];
+#else
+            if (rec[17] != 0)
+                goto done;
+#endif
+            point->data.zlib.adler = pletoh32(rec + 20);
+            point->data.zlib.total_out = pletoh32(rec + 24);
+            stored_len = pletoh32(rec + 28);
+            if (stored_len > compressBound(ZLIB_WINSIZE) ||
+                fread(window, 1, stored_len, fp) != stored_len)
+                goto done;
+            window_len = ZLIB_WINSIZE;
+            if (uncompress(point->data.zlib.window, &window_len, window,
+                           stored_len) != Z_OK ||
+                window_len != ZLIB_WINSIZE)
+                goto done;
+        }
+#endif
+    }
+    ok = TRUE;
+
+done:
+    if (ferror(fp))
+        *err = errno;
+    fclose(fp);
+#ifdef HAVE_ZLIB
+    g_free(window);
+#endif
+    if (!ok) {
+        g_ptr_array_free(points, TRUE);
+        return FALSE;
+    }
+
+    /*
+     * The array is shared by the sequential and random-access streams,
+     * so replace its contents rather than the array itself.  Any points
+     * found so far are at the beginning of the file, and are in the
+     * index as well.
+     */
+    for (i = 0; i < stream->fast_seek->len; i++)
+        g_free(stream->fast_seek->pdata[i]);
+    g_ptr_array_set_size(stream->fast_seek, 0);
+    for (i = 0; i < points->len; i++)
+        g_ptr_array_add(stream->fast_seek, points->pdata[i]);
+    g_ptr_array_set_free_func(points, NULL);
+    g_ptr_array_free(points, TRUE);
+    return TRUE;
+}
+
 #ifdef HAVE_ZLIB
 /* internal gzip file state data structure for writing */
 struct wtap_writer {
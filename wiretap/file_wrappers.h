@@ -22,6 +22,7 @@ WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
 extern gint64 file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 WS_DLL_PUBLIC gboolean file_iscompressed(FILE_T stream);
+extern wtap_compression_type file_get_compression_type(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
 WS_DLL_PUBLIC int file_peekc(FILE_T stream);
 WS_DLL_PUBLIC int file_getc(FILE_T stream);
@@ -33,6 +34,10 @@ extern void file_clearerr(FILE_T stream);
 extern void file_fdclose(FILE_T file);
 extern int file_fdreopen(FILE_T file, const char *path);
 extern void file_close(FILE_T file);
+extern guint32 file_mtime_nsec(const ws_statb64 *st);
+extern FILE *file_create_index_tmp(const char *path, gchar **tmp_path, int *err);
+extern gboolean file_save_fast_seek_index(FILE_T stream, const char *path, int *err);
+extern gboolean file_load_fast_seek_index(FILE_T stream, const char *path, int *err);
 
 #ifdef HAVE_ZLIB
 typedef struct wtap_writer *GZWFILE_T;
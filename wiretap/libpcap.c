@@ -343,6 +343,7 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, gchar **err_info)
 	wth->subtype_read = libpcap_read;
 	wth->subtype_seek_read = libpcap_seek_read;
 	wth->subtype_close = libpcap_close;
+	wth->can_skip_data = TRUE;
 	wth->file_encap = file_encap;
 	wth->snapshot_length = hdr.snaplen;
 
@@ -927,8 +928,16 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	rec->rec_header.packet_header.len = orig_size;
 
 	/*
-	 * Read the packet data.
+	 * Read the packet data, unless our caller only wants the
+	 * metadata.
 	 */
+	if (wth->metadata_only && fh == wth->fh) {
+		if (!wtap_skip_packet_bytes(fh, packet_size, err))
+			return FALSE;	/* failed */
+		pcap_read_post_process(is_nokia, wth->file_encap, rec,
+		    NULL, libpcap->byte_swapped, -1);
+		return TRUE;
+	}
 	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
 		return FALSE;	/* failed */
 
@@ -207,21 +207,131 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * Files that currently have a record available are kept in a binary
+ * min-heap, keyed on the time stamp of that record, so that picking the
+ * next record costs O(log n) in the number of input files rather than a
+ * scan of all of them; that matters when merging hundreds of files.
+ */
+typedef struct {
+    merge_in_file_t *in_files;
+    guint           in_file_count;
+    guint          *heap;       /* indices into in_files */
+    guint           heap_len;   /* number of entries in heap */
+    guint           last;       /* file from which we last returned a record */
+    gboolean        primed;     /* have we read the first record from each file? */
+} merge_heap_t;
+
+static void
+merge_heap_init(merge_heap_t *mh, merge_in_file_t in_files[],
+                guint in_file_count)
+{
+    mh->in_files = in_files;
+    mh->in_file_count = in_file_count;
+    mh->heap = g_new(guint, in_file_count);
+    mh->heap_len = 0;
+    mh->last = 0;
+    mh->primed = FALSE;
+}
+
+static void
+merge_heap_cleanup(merge_heap_t *mh)
+{
+    g_free(mh->heap);
+    mh->heap = NULL;
+}
+
+/*
+ * Returns TRUE if the record from file a should be written before the
+ * record from file b.
+ *
+ * Records with no time stamp are treated as earlier than all other
+ * records, and among themselves are taken in file order.  Records with
+ * equal time stamps are taken from the file that comes *last*; that's
+ * what the linear scan this replaced did, and we don't want to change
+ * the output.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_heap_before(const merge_heap_t *mh, guint a, guint b)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return FALSE;
-    } else if (l->secs < r->secs) { /* left is earlier */
+    const wtap_rec *rec_a = &mh->in_files[a].rec;
+    const wtap_rec *rec_b = &mh->in_files[b].rec;
+    gboolean has_ts_a = (rec_a->presence_flags & WTAP_HAS_TS) != 0;
+    gboolean has_ts_b = (rec_b->presence_flags & WTAP_HAS_TS) != 0;
+    int cmp;
+
+    if (!has_ts_a || !has_ts_b) {
+        if (has_ts_a != has_ts_b)
+            return !has_ts_a;
+        return a < b;
+    }
+    cmp = nstime_cmp(&rec_a->ts, &rec_b->ts);
+    if (cmp != 0)
+        return cmp < 0;
+    return a > b;
+}
+
+static void
+merge_heap_push(merge_heap_t *mh, guint file_index)
+{
+    guint pos = mh->heap_len++;
+
+    while (pos > 0) {
+        guint parent = (pos - 1) / 2;
+
+        if (!merge_heap_before(mh, file_index, mh->heap[parent]))
+            break;
+        mh->heap[pos] = mh->heap[parent];
+        pos = parent;
+    }
+    mh->heap[pos] = file_index;
+}
+
+static guint
+merge_heap_pop(merge_heap_t *mh)
+{
+    guint top = mh->heap[0];
+    guint file_index = mh->heap[--mh->heap_len];
+    guint pos = 0;
+
+    for (;;) {
+        guint child = 2 * pos + 1;
+
+        if (child >= mh->heap_len)
+            break;
+        if (child + 1 < mh->heap_len &&
+            merge_heap_before(mh, mh->heap[child + 1], mh->heap[child]))
+            child++;
+        if (!merge_heap_before(mh, mh->heap[child], file_index))
+            break;
+        mh->heap[pos] = mh->heap[child];
+        pos = child;
+    }
+    if (mh->heap_len > 0)
+        mh->heap[pos] = file_index;
+    return top;
+}
+
+/*
+ * Read the next record from the given file and, if we got one, put the
+ * file into the heap.  Returns FALSE on a read error.
+ */
+static gboolean
+merge_heap_fill(merge_heap_t *mh, guint file_index, int *err, gchar **err_info)
+{
+    merge_in_file_t *in_file = &mh->in_files[file_index];
+    gint64 data_offset;
+
+    if (!wtap_read(in_file->wth, &in_file->rec, &in_file->frame_buffer,
+                   err, err_info, &data_offset)) {
+        if (*err != 0) {
+            in_file->state = GOT_ERROR;
+            return FALSE;
+        }
+        in_file->state = AT_EOF;
         return TRUE;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
-        return FALSE;
     }
-    /* either one < two or one == two
-     * either way, return one
-     */
+    in_file->state = RECORD_PRESENT;
+    merge_heap_push(mh, file_index);
     return TRUE;
 }
 
@@ -237,8 +347,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * On an EOF (meaning all the files are at EOF), set *err to 0 and return
  * NULL.
  *
- * @param in_file_count number of entries in in_files
- * @param in_files input file array
+ * @param mh heap of input files
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -246,80 +355,52 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * all files
  */
 static merge_in_file_t *
-merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, gchar **err_info)
+merge_read_packet(merge_heap_t *mh, int *err, gchar **err_info)
 {
-    int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
+    guint i;
 
     /*
      * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
+     * EOF.  The first time through, that means reading a record from
+     * every file; after that, only the file from which we returned the
+     * previous record needs another one.
+     *
+     * Records with no time stamp sort before all other records.  Yes,
+     * this means you won't get a chronological merge of those records,
+     * but you obviously *can't* get that.
      */
-    for (i = 0; i < in_file_count; i++) {
-        gint64 data_offset;
-
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec,
-                           &in_files[i].frame_buffer, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
-        }
-
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
-            }
+    if (!mh->primed) {
+        for (i = 0; i < mh->in_file_count; i++) {
+            if (!merge_heap_fill(mh, i, err, err_info))
+                return &mh->in_files[i];
         }
+        mh->primed = TRUE;
+    } else if (mh->in_files[mh->last].state == RECORD_NOT_PRESENT) {
+        if (!merge_heap_fill(mh, mh->last, err, err_info))
+            return &mh->in_files[mh->last];
     }
 
-    if (ei == -1) {
+    if (mh->heap_len == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
+    i = merge_heap_pop(mh);
+
     /* We'll need to read another packet from this file. */
-    in_files[ei].state = RECORD_NOT_PRESENT;
+    mh->in_files[i].state = RECORD_NOT_PRESENT;
+    mh->last = i;
 
     /* Count this packet. */
-    in_files[ei].packet_num++;
+    mh->in_files[i].packet_num++;
 
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
      */
     *err = 0;
-    return &in_files[ei];
+    return &mh->in_files[i];
 }
 
 /** Read the next packet, in file sequence order, from the set of files
@@ -851,6 +932,9 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     gboolean            stop_flag = FALSE;
     wtap_rec *rec,      snap_rec;
+    merge_heap_t        mh;
+
+    merge_heap_init(&mh, in_files, in_file_count);
 
     for (;;) {
         *err = 0;
@@ -860,8 +944,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
-                                        err_info);
+            in_file = merge_read_packet(&mh, err, err_info);
         }
 
         if (in_file == NULL) {
@@ -950,6 +1033,8 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         }
     }
 
+    merge_heap_cleanup(&mh);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
@@ -1090,6 +1175,27 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
         return MERGE_ERR_CANT_OPEN_OUTFILE;
     }
 
+    if (out_filename || out_filenamep) {
+        /*
+         * Write the output file on another thread.  If none of the
+         * input files are compressed, the output will be about as big
+         * as all of them put together, so reserve that much space.
+         * (Don't do this for the standard output, as whatever's reading
+         * it would then see the data in big bursts.)
+         */
+        gint64 size_hint = 0;
+        int async_err;
+
+        for (guint i = 0; i < in_file_count; i++) {
+            if (wtap_get_compression_type(in_files[i].wth) != WTAP_UNCOMPRESSED) {
+                size_hint = 0;
+                break;
+            }
+            size_hint += in_files[i].size;
+        }
+        wtap_dump_set_async(pdh, 0, 0, size_hint, &async_err);
+    }
+
     if (cb)
         cb->callback_func(MERGE_EVENT_READY_TO_MERGE, 0, in_files, in_file_count, cb->data);
 
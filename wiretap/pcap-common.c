@@ -2273,7 +2273,9 @@ pcap_read_post_process(gboolean is_nokia, int wtap_encap,
 	switch (wtap_encap) {
 
 	case WTAP_ENCAP_ATM_PDUS:
-		if (is_nokia) {
+		if (pd == NULL) {
+			/* The data was skipped; nothing to guess from. */
+		} else if (is_nokia) {
 			/*
 			 * Nokia IPSO ATM.
 			 *
@@ -2299,17 +2301,17 @@ pcap_read_post_process(gboolean is_nokia, int wtap_encap,
 		break;
 
 	case WTAP_ENCAP_SLL:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_linux_sll_pseudoheader(rec, pd);
 		break;
 
 	case WTAP_ENCAP_USB_LINUX:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_linux_usb_pseudoheader(rec, pd, FALSE);
 		break;
 
 	case WTAP_ENCAP_USB_LINUX_MMAPPED:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_linux_usb_pseudoheader(rec, pd, TRUE);
 		break;
 
@@ -2323,7 +2325,7 @@ pcap_read_post_process(gboolean is_nokia, int wtap_encap,
 		break;
 
 	case WTAP_ENCAP_NFLOG:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_nflog_pseudoheader(rec, pd);
 		break;
 
@@ -49,6 +49,8 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
                  wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
 static void
 pcapng_close(wtap *wth);
+static gboolean
+pcapng_set_read_ahead(wtap *wth, guint num_records);
 
 static gboolean
 pcapng_encap_is_ft_specific(int encap);
@@ -233,11 +235,14 @@ typedef struct interface_info_s {
     int fcslen;
 } interface_info_t;
 
+typedef struct pcapng_read_ahead_s pcapng_read_ahead_t;
+
 typedef struct {
     guint current_section_number; /**< Section number of the current section being read sequentially */
     GArray *sections;             /**< Sections found in the capture file. */
     wtap_new_ipv4_callback_t add_new_ipv4;
     wtap_new_ipv6_callback_t add_new_ipv6;
+    pcapng_read_ahead_t *read_ahead; /**< Read-ahead thread state, or NULL if not reading ahead */
 } pcapng_t;
 
 /*
@@ -856,7 +861,7 @@ pcapng_read_section_header_block(FILE_T fh, pcapng_block_header_t *bh,
 
 /* "Interface Description Block" */
 static gboolean
-pcapng_read_if_descr_block(wtap *wth, FILE_T fh, pcapng_block_header_t *bh,
+pcapng_read_if_descr_block(FILE_T fh, pcapng_block_header_t *bh,
                            const section_info_t *section_info,
                            wtapng_block_t *wblock, int *err, gchar **err_info)
 {
@@ -1140,35 +1145,6 @@ pcapng_read_if_descr_block(wtap *wth, FILE_T fh, pcapng_block_header_t *bh,
 
     g_free(option_content);
 
-    /*
-     * If the per-file encapsulation isn't known, set it to this
-     * interface's encapsulation.
-     *
-     * If it *is* known, and it isn't this interface's encapsulation,
-     * set it to WTAP_ENCAP_PER_PACKET, as this file doesn't
-     * have a single encapsulation for all interfaces in the file,
-     * so it probably doesn't have a single encapsulation for all
-     * packets in the file.
-     */
-    if (wth->file_encap == WTAP_ENCAP_UNKNOWN) {
-        wth->file_encap = if_descr_mand->wtap_encap;
-    } else {
-        if (wth->file_encap != if_descr_mand->wtap_encap) {
-            wth->file_encap = WTAP_ENCAP_PER_PACKET;
-        }
-    }
-
-    /*
-     * The same applies to the per-file time stamp resolution.
-     */
-    if (wth->file_tsprec == WTAP_TSPREC_UNKNOWN) {
-        wth->file_tsprec = if_descr_mand->tsprecision;
-    } else {
-        if (wth->file_tsprec != if_descr_mand->tsprecision) {
-            wth->file_tsprec = WTAP_TSPREC_PER_PACKET;
-        }
-    }
-
     /*
      * We don't return these to the caller in pcapng_read().
      */
@@ -1426,17 +1402,23 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     wblock->rec->ts.secs = (time_t)(ts / iface_info.time_units_per_second);
     wblock->rec->ts.nsecs = (int)(((ts % iface_info.time_units_per_second) * 1000000000) / iface_info.time_units_per_second);
 
-    /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                packet.cap_len - pseudo_header_len, err, err_info))
-        return FALSE;
-    block_read += packet.cap_len - pseudo_header_len;
-
-    /* jump over potential padding bytes at end of the packet data */
-    if (padding != 0) {
-        if (!wtap_read_bytes(fh, NULL, padding, err, err_info))
+    /* "(Enhanced) Packet Block" read capture data, and jump over
+       potential padding bytes at end of the packet data */
+    if (wblock->skip_data) {
+        if (!wtap_skip_packet_bytes(fh, packet.cap_len - pseudo_header_len + padding, err))
+            return FALSE;
+        block_read += packet.cap_len - pseudo_header_len + padding;
+    } else {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    packet.cap_len - pseudo_header_len, err, err_info))
             return FALSE;
-        block_read += padding;
+        block_read += packet.cap_len - pseudo_header_len;
+
+        if (padding != 0) {
+            if (!wtap_read_bytes(fh, NULL, padding, err, err_info))
+                return FALSE;
+            block_read += padding;
+        }
     }
 
     /* Option defaults */
@@ -1650,7 +1632,8 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     }
 
     pcap_read_post_process(FALSE, iface_info.wtap_encap,
-                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->rec,
+                           wblock->skip_data ? NULL : ws_buffer_start_ptr(wblock->frame_buffer),
                            section_info->byte_swapped, fcslen);
 
     /*
@@ -1799,19 +1782,25 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh,
 
     memset((void *)&wblock->rec->rec_header.packet_header.pseudo_header, 0, sizeof(union wtap_pseudo_header));
 
-    /* "Simple Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                simple_packet.cap_len, err, err_info))
-        return FALSE;
-
-    /* jump over potential padding bytes at end of the packet data */
-    if ((simple_packet.cap_len % 4) != 0) {
-        if (!wtap_read_bytes(fh, NULL, 4 - (simple_packet.cap_len % 4), err, err_info))
+    /* "Simple Packet Block" read capture data, and jump over
+       potential padding bytes at end of the packet data */
+    if (wblock->skip_data) {
+        if (!wtap_skip_packet_bytes(fh, ROUND_TO_4BYTE(simple_packet.cap_len), err))
             return FALSE;
+    } else {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    simple_packet.cap_len, err, err_info))
+            return FALSE;
+
+        if ((simple_packet.cap_len % 4) != 0) {
+            if (!wtap_read_bytes(fh, NULL, 4 - (simple_packet.cap_len % 4), err, err_info))
+                return FALSE;
+        }
     }
 
     pcap_read_post_process(FALSE, iface_info.wtap_encap,
-                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->rec,
+                           wblock->skip_data ? NULL : ws_buffer_start_ptr(wblock->frame_buffer),
                            section_info->byte_swapped, iface_info.fcslen);
 
     /*
@@ -2371,7 +2360,7 @@ pcapng_read_sysdig_event_block(FILE_T fh, pcapng_block_header_t *bh,
 }
 
 static gboolean
-pcapng_read_systemd_journal_export_block(wtap *wth, FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn _U_, wtapng_block_t *wblock, int *err, gchar **err_info)
+pcapng_read_systemd_journal_export_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn _U_, wtapng_block_t *wblock, int *err, gchar **err_info)
 {
     guint32 entry_length;
     guint32 block_total_length;
@@ -2456,15 +2445,6 @@ pcapng_read_systemd_journal_export_block(wtap *wth, FILE_T fh, pcapng_block_head
      */
     wblock->internal = FALSE;
 
-    if (wth->file_encap == WTAP_ENCAP_UNKNOWN) {
-        /*
-         * Nothing (most notably an IDB) has set a file encap at this point.
-         * Do so here.
-         * XXX Should we set WTAP_ENCAP_SYSTEMD_JOURNAL if appropriate?
-         */
-        wth->file_encap = WTAP_ENCAP_PER_PACKET;
-    }
-
     return TRUE;
 }
 
@@ -2643,7 +2623,7 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
 
         switch (bh.block_type) {
             case(BLOCK_TYPE_IDB):
-                if (!pcapng_read_if_descr_block(wth, fh, &bh, section_info, wblock, err, err_info))
+                if (!pcapng_read_if_descr_block(fh, &bh, section_info, wblock, err, err_info))
                     return PCAPNG_BLOCK_ERROR;
                 break;
             case(BLOCK_TYPE_PB):
@@ -2676,7 +2656,7 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
                     return PCAPNG_BLOCK_ERROR;
                 break;
             case(BLOCK_TYPE_SYSTEMD_JOURNAL):
-                if (!pcapng_read_systemd_journal_export_block(wth, fh, &bh, pn, wblock, err, err_info))
+                if (!pcapng_read_systemd_journal_export_block(fh, &bh, pn, wblock, err, err_info))
                     return PCAPNG_BLOCK_ERROR;
                 break;
             default:
@@ -2706,16 +2686,76 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
     return PCAPNG_BLOCK_OK;
 }
 
-/* Process an IDB that we've just read. The contents of wblock are copied as needed. */
+/*
+ * Update a per-file encapsulation and time stamp resolution for a block
+ * that we've just read.  This is done by whoever consumes the blocks,
+ * rather than when reading them, as, when reading ahead, the blocks are
+ * read on another thread, ahead of the records whose encapsulation and
+ * resolution default to the file's.
+ */
 static void
-pcapng_process_idb(wtap *wth, section_info_t *section_info,
-                   wtapng_block_t *wblock)
+pcapng_update_file_encap(int *file_encap, int *file_tsprec,
+                         wtapng_block_t *wblock)
+{
+    wtapng_if_descr_mandatory_t *if_descr_mand;
+
+    switch (wblock->type) {
+
+        case(BLOCK_TYPE_IDB):
+            if_descr_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(wblock->block);
+
+            /*
+             * If the per-file encapsulation isn't known, set it to this
+             * interface's encapsulation.
+             *
+             * If it *is* known, and it isn't this interface's encapsulation,
+             * set it to WTAP_ENCAP_PER_PACKET, as this file doesn't
+             * have a single encapsulation for all interfaces in the file,
+             * so it probably doesn't have a single encapsulation for all
+             * packets in the file.
+             */
+            if (*file_encap == WTAP_ENCAP_UNKNOWN) {
+                *file_encap = if_descr_mand->wtap_encap;
+            } else {
+                if (*file_encap != if_descr_mand->wtap_encap) {
+                    *file_encap = WTAP_ENCAP_PER_PACKET;
+                }
+            }
+
+            /*
+             * The same applies to the per-file time stamp resolution.
+             */
+            if (*file_tsprec == WTAP_TSPREC_UNKNOWN) {
+                *file_tsprec = if_descr_mand->tsprecision;
+            } else {
+                if (*file_tsprec != if_descr_mand->tsprecision) {
+                    *file_tsprec = WTAP_TSPREC_PER_PACKET;
+                }
+            }
+            break;
+
+        case(BLOCK_TYPE_SYSTEMD_JOURNAL):
+            if (*file_encap == WTAP_ENCAP_UNKNOWN) {
+                /*
+                 * Nothing (most notably an IDB) has set a file encap at this point.
+                 * Do so here.
+                 * XXX Should we set WTAP_ENCAP_SYSTEMD_JOURNAL if appropriate?
+                 */
+                *file_encap = WTAP_ENCAP_PER_PACKET;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Add an IDB that we've just read to the wtap's list of interfaces. */
+static void
+pcapng_add_idb(wtap *wth, wtapng_block_t *wblock)
 {
     wtap_block_t int_data = wtap_block_create(WTAP_BLOCK_IF_ID_AND_INFO);
-    interface_info_t iface_info;
-    wtapng_if_descr_mandatory_t *if_descr_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(int_data),
-                                *wblock_if_descr_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(wblock->block);
-    guint8 if_fcslen;
+    wtapng_if_descr_mandatory_t *if_descr_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(int_data);
 
     wtap_block_copy(int_data, wblock->block);
 
@@ -2725,6 +2765,17 @@ pcapng_process_idb(wtap *wth, section_info_t *section_info,
     if_descr_mand->interface_statistics = NULL;
 
     wtap_add_idb(wth, int_data);
+}
+
+/* Add the information we need to read packets for an IDB that we've just
+   read to the section's list of interfaces. */
+static void
+pcapng_add_interface_info(section_info_t *section_info,
+                          wtapng_block_t *wblock)
+{
+    interface_info_t iface_info;
+    wtapng_if_descr_mandatory_t *wblock_if_descr_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(wblock->block);
+    guint8 if_fcslen;
 
     iface_info.wtap_encap = wblock_if_descr_mand->wtap_encap;
     iface_info.snap_len = wblock_if_descr_mand->snap_len;
@@ -2740,6 +2791,16 @@ pcapng_process_idb(wtap *wth, section_info_t *section_info,
     g_array_append_val(section_info->interfaces, iface_info);
 }
 
+/* Process an IDB that we've just read. The contents of wblock are copied as needed. */
+static void
+pcapng_process_idb(wtap *wth, section_info_t *section_info,
+                   wtapng_block_t *wblock)
+{
+    pcapng_update_file_encap(&wth->file_encap, &wth->file_tsprec, wblock);
+    pcapng_add_idb(wth, wblock);
+    pcapng_add_interface_info(section_info, wblock);
+}
+
 /* Process a DSB that we have just read. */
 static void
 pcapng_process_dsb(wtap *wth, wtapng_block_t *wblock)
@@ -2770,6 +2831,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     /* we don't expect any packet blocks yet */
     wblock.frame_buffer = NULL;
     wblock.rec = NULL;
+    wblock.skip_data = FALSE;
 
     pcapng_debug("pcapng_open: opening file");
     /*
@@ -2826,6 +2888,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     pcapng = g_new(pcapng_t, 1);
     wth->priv = (void *)pcapng;
     *pcapng = pn;
+    pcapng->read_ahead = NULL;
     /*
      * We're currently processing the first section; as this is written
      * in C, that's section 0. :-)
@@ -2847,6 +2910,8 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     wth->subtype_read = pcapng_read;
     wth->subtype_seek_read = pcapng_seek_read;
     wth->subtype_close = pcapng_close;
+    wth->subtype_set_read_ahead = pcapng_set_read_ahead;
+    wth->can_skip_data = TRUE;
     wth->file_type_subtype = pcapng_file_type_subtype;
 
     /* Always initialize the list of Decryption Secret Blocks such that a
@@ -2908,47 +2973,186 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
 }
 
 
-/* classic wtap: read packet */
+/*
+ * Read the next block sequentially, updating our own per-section state
+ * for SHBs and IDBs, as that's needed to read the blocks that follow.
+ * Everything visible through the wtap is done separately, by
+ * pcapng_process_internal_block(), so that, when reading ahead, it's
+ * done on the thread that reads the records.
+ */
 static gboolean
-pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
-            gchar **err_info, gint64 *data_offset)
+pcapng_read_next_block(wtap *wth, pcapng_t *pcapng, wtapng_block_t *wblock,
+                       gint64 *data_offset, int *err, gchar **err_info)
 {
-    pcapng_t *pcapng = (pcapng_t *)wth->priv;
     section_info_t *current_section, new_section;
-    wtapng_block_t wblock;
+
+    *data_offset = file_tell(wth->fh);
+    pcapng_debug("pcapng_read: data_offset is %" G_GINT64_MODIFIER "d", *data_offset);
+
+    /*
+     * Get the section_info_t for the current section.
+     */
+    current_section = &g_array_index(pcapng->sections, section_info_t,
+                                     pcapng->current_section_number);
+
+    /*
+     * Read the next block.
+     */
+    if (pcapng_read_block(wth, wth->fh, pcapng, current_section,
+                          &new_section, wblock,
+                          err, err_info) != PCAPNG_BLOCK_OK) {
+        pcapng_debug("pcapng_read: data_offset is finally %" G_GINT64_MODIFIER "d", *data_offset);
+        pcapng_debug("pcapng_read: couldn't read packet block");
+        wtap_block_free(wblock->block);
+        wblock->block = NULL;
+        return FALSE;
+    }
+
+    switch (wblock->type) {
+
+        case(BLOCK_TYPE_SHB):
+            /*
+             * Update the current section number, and add
+             * the updated section_info_t to the array of
+             * section_info_t's for this file.
+             */
+            pcapng->current_section_number++;
+            new_section.interfaces = g_array_new(FALSE, FALSE, sizeof(interface_info_t));
+            new_section.shb_off = *data_offset;
+            g_array_append_val(pcapng->sections, new_section);
+            break;
+
+        case(BLOCK_TYPE_IDB):
+            pcapng_add_interface_info(current_section, wblock);
+            break;
+
+        default:
+            break;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Process a block that we handle internally rather than returning it
+ * to the caller of pcapng_read().  This takes ownership of wblock->block.
+ */
+static void
+pcapng_process_internal_block(wtap *wth, wtapng_block_t *wblock)
+{
     wtap_block_t wtapng_if_descr;
     wtap_block_t if_stats;
     wtapng_if_stats_mandatory_t *if_stats_mand_block, *if_stats_mand;
     wtapng_if_descr_mandatory_t *wtapng_if_descr_mand;
 
+    switch (wblock->type) {
+
+        case(BLOCK_TYPE_SHB):
+            pcapng_debug("pcapng_read: another section header block");
+            g_array_append_val(wth->shb_hdrs, wblock->block);
+            break;
+
+        case(BLOCK_TYPE_IDB):
+            /* A new interface */
+            pcapng_debug("pcapng_read: block type BLOCK_TYPE_IDB");
+            pcapng_add_idb(wth, wblock);
+            wtap_block_free(wblock->block);
+            break;
+
+        case(BLOCK_TYPE_DSB):
+            /* Decryption secrets. */
+            pcapng_debug("pcapng_read: block type BLOCK_TYPE_DSB");
+            pcapng_process_dsb(wth, wblock);
+            /* Do not free wblock->block, it is consumed by pcapng_process_dsb */
+            break;
+
+        case(BLOCK_TYPE_NRB):
+            /* More name resolution entries */
+            pcapng_debug("pcapng_read: block type BLOCK_TYPE_NRB");
+            if (wth->nrb_hdrs == NULL) {
+                wth->nrb_hdrs = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
+            }
+            g_array_append_val(wth->nrb_hdrs, wblock->block);
+            break;
+
+        case(BLOCK_TYPE_ISB):
+            /*
+             * Another interface statistics report
+             *
+             * XXX - given that they're reports, we should be
+             * supplying them in read calls, and displaying them
+             * in the "packet" list, so you can see what the
+             * statistics were *at the time when the report was
+             * made*.
+             *
+             * The statistics from the *last* ISB could be displayed
+             * in the summary, but if there are packets after the
+             * last ISB, that could be misleading.
+             *
+             * If we only display them if that ISB has an isb_endtime
+             * option, which *should* only appear when capturing ended
+             * on that interface (so there should be no more packet
+             * blocks or ISBs for that interface after that point,
+             * that would be the best way of showing "summary"
+             * statistics.
+             */
+            pcapng_debug("pcapng_read: block type BLOCK_TYPE_ISB");
+            if_stats_mand_block = (wtapng_if_stats_mandatory_t*)wtap_block_get_mandatory_data(wblock->block);
+            if (wth->interface_data->len <= if_stats_mand_block->interface_id) {
+                pcapng_debug("pcapng_read: BLOCK_TYPE_ISB wblock.if_stats.interface_id %u >= number_of_interfaces", if_stats_mand_block->interface_id);
+            } else {
+                /* Get the interface description */
+                wtapng_if_descr = g_array_index(wth->interface_data, wtap_block_t, if_stats_mand_block->interface_id);
+                wtapng_if_descr_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(wtapng_if_descr);
+                if (wtapng_if_descr_mand->num_stat_entries == 0) {
+                    /* First ISB found, no previous entry */
+                    pcapng_debug("pcapng_read: block type BLOCK_TYPE_ISB. First ISB found, no previous entry");
+                    wtapng_if_descr_mand->interface_statistics = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
+                }
+
+                if_stats = wtap_block_create(WTAP_BLOCK_IF_STATISTICS);
+                if_stats_mand = (wtapng_if_stats_mandatory_t*)wtap_block_get_mandatory_data(if_stats);
+                if_stats_mand->interface_id  = if_stats_mand_block->interface_id;
+                if_stats_mand->ts_high       = if_stats_mand_block->ts_high;
+                if_stats_mand->ts_low        = if_stats_mand_block->ts_low;
+
+                wtap_block_copy(if_stats, wblock->block);
+                g_array_append_val(wtapng_if_descr_mand->interface_statistics, if_stats);
+                wtapng_if_descr_mand->num_stat_entries++;
+            }
+            wtap_block_free(wblock->block);
+            break;
+
+        default:
+            /* XXX - improve handling of "unknown" blocks */
+            pcapng_debug("pcapng_read: Unknown block type 0x%08x", wblock->type);
+            break;
+    }
+    wblock->block = NULL;
+}
+
+/* classic wtap: read packet */
+static gboolean
+pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
+            gchar **err_info, gint64 *data_offset)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    wtapng_block_t wblock;
+
     wblock.frame_buffer  = buf;
     wblock.rec = rec;
+    wblock.skip_data = wth->metadata_only;
 
     pcapng->add_new_ipv4 = wth->add_new_ipv4;
     pcapng->add_new_ipv6 = wth->add_new_ipv6;
 
     /* read next block */
     while (1) {
-        *data_offset = file_tell(wth->fh);
-        pcapng_debug("pcapng_read: data_offset is %" G_GINT64_MODIFIER "d", *data_offset);
-
-        /*
-         * Get the section_info_t for the current section.
-         */
-        current_section = &g_array_index(pcapng->sections, section_info_t,
-                                         pcapng->current_section_number);
-
-        /*
-         * Read the next block.
-         */
-        if (pcapng_read_block(wth, wth->fh, pcapng, current_section,
-                              &new_section, &wblock,
-                              err, err_info) != PCAPNG_BLOCK_OK) {
-            pcapng_debug("pcapng_read: data_offset is finally %" G_GINT64_MODIFIER "d", *data_offset);
-            pcapng_debug("pcapng_read: couldn't read packet block");
-            wtap_block_free(wblock.block);
+        if (!pcapng_read_next_block(wth, pcapng, &wblock, data_offset,
+                                    err, err_info))
             return FALSE;
-        }
+
+        pcapng_update_file_encap(&wth->file_encap, &wth->file_tsprec, &wblock);
 
         if (!wblock.internal) {
             /*
@@ -2961,104 +3165,331 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
          * This is a block type we process internally, rather than
          * returning it for the caller to process.
          */
-        switch (wblock.type) {
+        pcapng_process_internal_block(wth, &wblock);
+    }
 
-            case(BLOCK_TYPE_SHB):
-                pcapng_debug("pcapng_read: another section header block");
-                g_array_append_val(wth->shb_hdrs, wblock.block);
+    /*pcapng_debug("Read length: %u Packet length: %u", bytes_read, rec->rec_header.packet_header.caplen);*/
+    pcapng_debug("pcapng_read: data_offset is finally %" G_GINT64_MODIFIER "d", *data_offset);
 
-                /*
-                 * Update the current section number, and add
-                 * the updated section_info_t to the array of
-                 * section_info_t's for this file.
-                 */
-                pcapng->current_section_number++;
-                new_section.interfaces = g_array_new(FALSE, FALSE, sizeof(interface_info_t));
-                new_section.shb_off = *data_offset;
-                g_array_append_val(pcapng->sections, new_section);
-                break;
+    return TRUE;
+}
 
-            case(BLOCK_TYPE_IDB):
-                /* A new interface */
-                pcapng_debug("pcapng_read: block type BLOCK_TYPE_IDB");
-                pcapng_process_idb(wth, current_section, &wblock);
-                wtap_block_free(wblock.block);
-                break;
+/*
+ * Reading ahead.
+ *
+ * A producer thread calls pcapng_read_next_block() into a fixed set of
+ * slots, each with its own wtap_rec and Buffer, and hands them to
+ * pcapng_read_ahead_read() on the reading thread through the "ready"
+ * queue; that thread hands them back through the "empty" queue once
+ * it's done with them.  A record is returned by swapping the slot's
+ * wtap_rec and Buffer with the caller's, so nothing is copied.
+ *
+ * Everything visible through the wtap - IDBs, NRBs, DSBs, ISBs, SHBs,
+ * and the name resolution callbacks - is still done on the reading
+ * thread, in file order; names found by the producer are queued in the
+ * slot for the NRB they came from.  Only the producer touches wth->fh
+ * and our section state until the thread is stopped, so random access
+ * reads must not be done while reading ahead.
+ */
 
-            case(BLOCK_TYPE_DSB):
-                /* Decryption secrets. */
-                pcapng_debug("pcapng_read: block type BLOCK_TYPE_DSB");
-                pcapng_process_dsb(wth, &wblock);
-                /* Do not free wblock.block, it is consumed by pcapng_process_dsb */
-                break;
+#define PCAPNG_READ_AHEAD_DEFAULT_RECORDS 256
 
-            case(BLOCK_TYPE_NRB):
-                /* More name resolution entries */
-                pcapng_debug("pcapng_read: block type BLOCK_TYPE_NRB");
-                if (wth->nrb_hdrs == NULL) {
-                    wth->nrb_hdrs = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
-                }
-                g_array_append_val(wth->nrb_hdrs, wblock.block);
-                break;
+typedef struct {
+    gboolean is_ipv6;
+    guint8 addr[16];
+    gchar *name;
+} pcapng_deferred_name_t;
 
-            case(BLOCK_TYPE_ISB):
-                /*
-                 * Another interface statistics report
-                 *
-                 * XXX - given that they're reports, we should be
-                 * supplying them in read calls, and displaying them
-                 * in the "packet" list, so you can see what the
-                 * statistics were *at the time when the report was
-                 * made*.
-                 *
-                 * The statistics from the *last* ISB could be displayed
-                 * in the summary, but if there are packets after the
-                 * last ISB, that could be misleading.
-                 *
-                 * If we only display them if that ISB has an isb_endtime
-                 * option, which *should* only appear when capturing ended
-                 * on that interface (so there should be no more packet
-                 * blocks or ISBs for that interface after that point,
-                 * that would be the best way of showing "summary"
-                 * statistics.
-                 */
-                pcapng_debug("pcapng_read: block type BLOCK_TYPE_ISB");
-                if_stats_mand_block = (wtapng_if_stats_mandatory_t*)wtap_block_get_mandatory_data(wblock.block);
-                if (wth->interface_data->len <= if_stats_mand_block->interface_id) {
-                    pcapng_debug("pcapng_read: BLOCK_TYPE_ISB wblock.if_stats.interface_id %u >= number_of_interfaces", if_stats_mand_block->interface_id);
-                } else {
-                    /* Get the interface description */
-                    wtapng_if_descr = g_array_index(wth->interface_data, wtap_block_t, if_stats_mand_block->interface_id);
-                    wtapng_if_descr_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(wtapng_if_descr);
-                    if (wtapng_if_descr_mand->num_stat_entries == 0) {
-                        /* First ISB found, no previous entry */
-                        pcapng_debug("pcapng_read: block type BLOCK_TYPE_ISB. First ISB found, no previous entry");
-                        wtapng_if_descr_mand->interface_statistics = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
-                    }
+typedef struct {
+    wtapng_block_t wblock;
+    wtap_rec rec;
+    Buffer buf;
+    gint64 data_offset;
+    gint64 raw_pos;             /* raw position of wth->fh after the block */
+    gboolean ok;
+    int err;
+    gchar *err_info;
+    GArray *names;              /* pcapng_deferred_name_t's from an NRB */
+} pcapng_read_ahead_slot_t;
+
+struct pcapng_read_ahead_s {
+    GThread *thread;
+    GAsyncQueue *ready;         /* slots read by the producer */
+    GAsyncQueue *empty;         /* slots the producer can read into */
+    pcapng_read_ahead_slot_t *slots;
+    guint num_slots;
+    pcapng_read_ahead_slot_t *last; /* the slot with the error or EOF */
+    gint stop;
+    int file_encap;             /* the producer's copy of wth->file_encap */
+    int file_tsprec;            /* the producer's copy of wth->file_tsprec */
+    gint64 read_so_far;         /* raw_pos of the last slot handed back */
+};
 
-                    if_stats = wtap_block_create(WTAP_BLOCK_IF_STATISTICS);
-                    if_stats_mand = (wtapng_if_stats_mandatory_t*)wtap_block_get_mandatory_data(if_stats);
-                    if_stats_mand->interface_id  = if_stats_mand_block->interface_id;
-                    if_stats_mand->ts_high       = if_stats_mand_block->ts_high;
-                    if_stats_mand->ts_low        = if_stats_mand_block->ts_low;
+/* The slot the producer on this thread is reading into. */
+static GPrivate read_ahead_current_slot = G_PRIVATE_INIT(NULL);
 
-                    wtap_block_copy(if_stats, wblock.block);
-                    g_array_append_val(wtapng_if_descr_mand->interface_statistics, if_stats);
-                    wtapng_if_descr_mand->num_stat_entries++;
-                }
-                wtap_block_free(wblock.block);
-                break;
+static void
+pcapng_read_ahead_defer_ipv4(const guint addr, const gchar *name)
+{
+    pcapng_read_ahead_slot_t *slot = (pcapng_read_ahead_slot_t *)g_private_get(&read_ahead_current_slot);
+    pcapng_deferred_name_t deferred;
 
-            default:
-                /* XXX - improve handling of "unknown" blocks */
-                pcapng_debug("pcapng_read: Unknown block type 0x%08x", wblock.type);
-                break;
+    deferred.is_ipv6 = FALSE;
+    memcpy(deferred.addr, &addr, 4);
+    deferred.name = g_strdup(name);
+    g_array_append_val(slot->names, deferred);
+}
+
+static void
+pcapng_read_ahead_defer_ipv6(const void *addrp, const gchar *name)
+{
+    pcapng_read_ahead_slot_t *slot = (pcapng_read_ahead_slot_t *)g_private_get(&read_ahead_current_slot);
+    pcapng_deferred_name_t deferred;
+
+    deferred.is_ipv6 = TRUE;
+    memcpy(deferred.addr, addrp, 16);
+    deferred.name = g_strdup(name);
+    g_array_append_val(slot->names, deferred);
+}
+
+static gpointer
+pcapng_read_ahead_thread(gpointer data)
+{
+    wtap *wth = (wtap *)data;
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    pcapng_read_ahead_t *ra = pcapng->read_ahead;
+    pcapng_read_ahead_slot_t *slot;
+
+    pcapng->add_new_ipv4 = pcapng_read_ahead_defer_ipv4;
+    pcapng->add_new_ipv6 = pcapng_read_ahead_defer_ipv6;
+
+    for (;;) {
+        slot = (pcapng_read_ahead_slot_t *)g_async_queue_pop(ra->empty);
+        if (g_atomic_int_get(&ra->stop))
+            break;
+
+        g_private_set(&read_ahead_current_slot, slot);
+
+        /*
+         * What wtap_read() does to the caller's record, with the
+         * file's encapsulation and resolution as of this point in
+         * the file; the reading thread has its own.
+         */
+        slot->rec.rec_header.packet_header.pkt_encap = ra->file_encap;
+        slot->rec.tsprec = ra->file_tsprec;
+
+        slot->wblock.skip_data = wth->metadata_only;
+        slot->err = 0;
+        slot->err_info = NULL;
+        slot->ok = pcapng_read_next_block(wth, pcapng, &slot->wblock,
+                                          &slot->data_offset,
+                                          &slot->err, &slot->err_info);
+        if (slot->ok)
+            pcapng_update_file_encap(&ra->file_encap, &ra->file_tsprec,
+                                     &slot->wblock);
+        slot->raw_pos = file_tell_raw(wth->fh);
+        g_async_queue_push(ra->ready, slot);
+        if (!slot->ok)
+            break;
+    }
+    return NULL;
+}
+
+static void
+pcapng_read_ahead_free_names(pcapng_read_ahead_slot_t *slot)
+{
+    guint i;
+
+    for (i = 0; i < slot->names->len; i++)
+        g_free(g_array_index(slot->names, pcapng_deferred_name_t, i).name);
+    g_array_free(slot->names, TRUE);
+}
+
+static void
+pcapng_read_ahead_replay_names(wtap *wth, pcapng_read_ahead_slot_t *slot)
+{
+    guint i;
+
+    for (i = 0; i < slot->names->len; i++) {
+        pcapng_deferred_name_t *deferred = &g_array_index(slot->names, pcapng_deferred_name_t, i);
+        if (deferred->is_ipv6) {
+            if (wth->add_new_ipv6)
+                wth->add_new_ipv6(deferred->addr, deferred->name);
+        } else {
+            if (wth->add_new_ipv4) {
+                guint v4_addr;
+
+                memcpy(&v4_addr, deferred->addr, 4);
+                wth->add_new_ipv4(v4_addr, deferred->name);
+            }
         }
+        g_free(deferred->name);
     }
+    g_array_set_size(slot->names, 0);
+}
 
-    /*pcapng_debug("Read length: %u Packet length: %u", bytes_read, rec->rec_header.packet_header.caplen);*/
-    pcapng_debug("pcapng_read: data_offset is finally %" G_GINT64_MODIFIER "d", *data_offset);
+static gboolean
+pcapng_read_ahead_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
+                       gchar **err_info, gint64 *data_offset)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    pcapng_read_ahead_t *ra = pcapng->read_ahead;
+    pcapng_read_ahead_slot_t *slot;
+    wtap_rec tmp_rec;
+    Buffer tmp_buf;
+
+    if (ra->last != NULL) {
+        /* The producer has stopped; report the same thing again. */
+        *err = ra->last->err;
+        *data_offset = ra->last->data_offset;
+        return FALSE;
+    }
+
+    while (1) {
+        slot = (pcapng_read_ahead_slot_t *)g_async_queue_pop(ra->ready);
+        pcapng_read_ahead_replay_names(wth, slot);
+        *data_offset = slot->data_offset;
+        ra->read_so_far = slot->raw_pos;
+
+        if (!slot->ok) {
+            *err = slot->err;
+            *err_info = slot->err_info;
+            slot->err_info = NULL;
+            ra->last = slot;
+            return FALSE;
+        }
+
+        pcapng_update_file_encap(&wth->file_encap, &wth->file_tsprec,
+                                 &slot->wblock);
+
+        if (!slot->wblock.internal) {
+            tmp_rec = *rec;
+            *rec = slot->rec;
+            slot->rec = tmp_rec;
+            tmp_buf = *buf;
+            *buf = slot->buf;
+            slot->buf = tmp_buf;
+            g_async_queue_push(ra->empty, slot);
+            return TRUE;
+        }
+
+        pcapng_process_internal_block(wth, &slot->wblock);
+        g_async_queue_push(ra->empty, slot);
+    }
+}
+
+/* How far the records returned so far go, rather than how far the
+   producer has got. */
+static gint64
+pcapng_read_ahead_read_so_far(wtap *wth)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+
+    return pcapng->read_ahead->read_so_far;
+}
 
+static void
+pcapng_stop_read_ahead(wtap *wth)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    pcapng_read_ahead_t *ra = pcapng->read_ahead;
+    pcapng_read_ahead_slot_t *slot;
+    guint i;
+
+    if (ra == NULL)
+        return;
+
+    /*
+     * The producer only waits for empty slots; wake it up with
+     * something that isn't one.
+     */
+    g_atomic_int_set(&ra->stop, 1);
+    g_async_queue_push(ra->empty, ra);
+    g_thread_join(ra->thread);
+
+    /* Blocks read ahead but never returned are still ours to free. */
+    while ((slot = (pcapng_read_ahead_slot_t *)g_async_queue_try_pop(ra->ready)) != NULL) {
+        if (slot->ok && slot->wblock.internal) {
+            wtap_block_free(slot->wblock.block);
+            slot->wblock.block = NULL;
+        }
+    }
+    for (i = 0; i < ra->num_slots; i++) {
+        slot = &ra->slots[i];
+        pcapng_read_ahead_free_names(slot);
+        g_free(slot->err_info);
+        wtap_rec_cleanup(&slot->rec);
+        ws_buffer_free(&slot->buf);
+    }
+    g_async_queue_unref(ra->ready);
+    g_async_queue_unref(ra->empty);
+    g_free(ra->slots);
+    g_free(ra);
+    pcapng->read_ahead = NULL;
+
+    wth->subtype_read = pcapng_read;
+    wth->subtype_sequential_close = NULL;
+    wth->subtype_read_so_far = NULL;
+}
+
+static gboolean
+pcapng_set_read_ahead(wtap *wth, guint num_records)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    pcapng_read_ahead_t *ra;
+    pcapng_read_ahead_slot_t *slot;
+    guint i;
+
+    if (pcapng->read_ahead != NULL)
+        return TRUE;
+
+    /*
+     * Stopping the thread means waiting for its current read, which,
+     * on a pipe, might never finish.
+     */
+    if (wth->ispipe)
+        return FALSE;
+
+    if (num_records == 0)
+        num_records = PCAPNG_READ_AHEAD_DEFAULT_RECORDS;
+
+    ra = g_new0(pcapng_read_ahead_t, 1);
+    ra->ready = g_async_queue_new();
+    ra->empty = g_async_queue_new();
+    ra->num_slots = num_records;
+    ra->slots = g_new0(pcapng_read_ahead_slot_t, num_records);
+    for (i = 0; i < num_records; i++) {
+        slot = &ra->slots[i];
+        wtap_rec_init(&slot->rec);
+        ws_buffer_init(&slot->buf, 1514);
+        slot->wblock.rec = &slot->rec;
+        slot->wblock.frame_buffer = &slot->buf;
+        slot->names = g_array_new(FALSE, FALSE, sizeof(pcapng_deferred_name_t));
+        g_async_queue_push(ra->empty, slot);
+    }
+    ra->file_encap = wth->file_encap;
+    ra->file_tsprec = wth->file_tsprec;
+    ra->read_so_far = file_tell_raw(wth->fh);
+    pcapng->read_ahead = ra;
+
+    ra->thread = g_thread_try_new("pcapng read-ahead", pcapng_read_ahead_thread, wth, NULL);
+    if (ra->thread == NULL) {
+        for (i = 0; i < num_records; i++) {
+            g_array_free(ra->slots[i].names, TRUE);
+            wtap_rec_cleanup(&ra->slots[i].rec);
+            ws_buffer_free(&ra->slots[i].buf);
+        }
+        g_async_queue_unref(ra->ready);
+        g_async_queue_unref(ra->empty);
+        g_free(ra->slots);
+        g_free(ra);
+        pcapng->read_ahead = NULL;
+        return FALSE;
+    }
+
+    wth->subtype_read = pcapng_read_ahead_read;
+    wth->subtype_sequential_close = pcapng_stop_read_ahead;
+    wth->subtype_read_so_far = pcapng_read_ahead_read_so_far;
     return TRUE;
 }
 
@@ -3073,6 +3504,15 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
     section_info_t *section_info, new_section;
     wtapng_block_t wblock;
 
+    /*
+     * The read-ahead thread adds to the lists of sections and
+     * interfaces we'd be looking at.
+     */
+    if (pcapng->read_ahead != NULL) {
+        *err = WTAP_ERR_INTERNAL;
+        *err_info = g_strdup("pcapng: random access to a file being read ahead");
+        return FALSE;
+    }
 
     /* seek to the right file position */
     if (file_seek(wth->random_fh, seek_off, SEEK_SET, err) < 0) {
@@ -3113,6 +3553,7 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
 
     wblock.frame_buffer = buf;
     wblock.rec = rec;
+    wblock.skip_data = FALSE;
 
     /* read the block */
     if (pcapng_read_block(wth, wth->random_fh, pcapng, section_info,
@@ -3145,6 +3586,8 @@ pcapng_close(wtap *wth)
 
     pcapng_debug("pcapng_close: closing file");
 
+    pcapng_stop_read_ahead(wth);
+
     /*
      * Free up the interfaces tables for all the sections.
      */
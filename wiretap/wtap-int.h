@@ -57,6 +57,8 @@ struct wtap {
     subtype_seek_read_func      subtype_seek_read;
     void                        (*subtype_sequential_close)(struct wtap*);
     void                        (*subtype_close)(struct wtap*);
+    gboolean                    (*subtype_set_read_ahead)(struct wtap*, guint);
+    gint64                      (*subtype_read_so_far)(struct wtap*); /* if NULL, the raw position of fh */
     int                         file_encap;    /* per-file, for those
                                                 * file formats that have
                                                 * per-file encapsulation
@@ -77,6 +79,9 @@ struct wtap {
     wtap_new_ipv6_callback_t    add_new_ipv6;
     wtap_new_secrets_callback_t add_new_secrets;
     GPtrArray                   *fast_seek;
+    gboolean                    fast_seek_loaded;       /**< TRUE if fast_seek came from an index file */
+    gboolean                    can_skip_data;          /**< TRUE if subtype_read honors metadata_only */
+    gboolean                    metadata_only;          /**< TRUE if subtype_read may skip over record data */
 };
 
 struct wtap_dumper;
@@ -122,6 +127,8 @@ struct wtap_dumper {
      */
     const GArray            *dsbs_growing;          /**< A reference to an array of DSBs (of type wtap_block_t) */
     guint                   dsbs_growing_written;   /**< Number of already processed DSBs in dsbs_growing. */
+
+    struct wtap_dump_async  *async;          /**< Writer thread state, or NULL if writing synchronously */
 };
 
 WS_DLL_PUBLIC gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf,
@@ -323,6 +330,17 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * Skip over packet data without reading it, for sequential reads when
+ * wth->metadata_only is set.
+ *
+ * This seeks forward, so, unlike wtap_read_packet_bytes(), it doesn't
+ * notice if the data is cut short by the end of the file.
+ */
+WS_DLL_PUBLIC
+gboolean
+wtap_skip_packet_bytes(FILE_T fh, guint length, int *err);
+
 /*
  * Implementation of wth->subtype_read that reads the full file contents
  * as a single packet.
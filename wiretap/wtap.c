@@ -16,6 +16,7 @@
 #include "wtap-int.h"
 #include "wtap_opttypes.h"
 #include "pcapng.h"
+#include "required_file_handlers.h"
 
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
@@ -1387,6 +1388,47 @@ wtap_strerror(int err)
 		return g_strerror(err);
 }
 
+/*
+ * Fast-seek index files are kept next to the capture file, with this
+ * appended to its name.
+ */
+#define FAST_SEEK_INDEX_SUFFIX ".wsidx"
+
+gboolean
+wtap_load_fast_seek_index(wtap *wth)
+{
+	FILE_T fh = (wth->fh == NULL) ? wth->random_fh : wth->fh;
+	char *path;
+	int err;
+
+	/* Without random access there's no point, and uncompressed
+	   files don't need any fast-seek information. */
+	if (wth->fast_seek == NULL || fh == NULL || !file_iscompressed(fh))
+		return FALSE;
+
+	path = g_strconcat(wth->pathname, FAST_SEEK_INDEX_SUFFIX, NULL);
+	wth->fast_seek_loaded = file_load_fast_seek_index(fh, path, &err);
+	g_free(path);
+	return wth->fast_seek_loaded;
+}
+
+gboolean
+wtap_save_fast_seek_index(wtap *wth, int *err)
+{
+	char *path;
+	gboolean ret;
+
+	*err = 0;
+	if (wth->fast_seek == NULL || wth->fast_seek_loaded ||
+	    wth->fh == NULL || !file_iscompressed(wth->fh))
+		return TRUE;
+
+	path = g_strconcat(wth->pathname, FAST_SEEK_INDEX_SUFFIX, NULL);
+	ret = file_save_fast_seek_index(wth->fh, path, err);
+	g_free(path);
+	return ret;
+}
+
 /* Close only the sequential side, freeing up memory it uses.
 
    Note that we do *not* want to call the subtype's close function,
@@ -1515,6 +1557,23 @@ wtap_init_rec(wtap *wth, wtap_rec *rec)
 	rec->tsprec = wth->file_tsprec;
 }
 
+gboolean
+wtap_set_metadata_only(wtap *wth, gboolean metadata_only)
+{
+	if (!wth->can_skip_data)
+		return FALSE;
+	wth->metadata_only = metadata_only;
+	return TRUE;
+}
+
+gboolean
+wtap_set_read_ahead(wtap *wth, guint num_records)
+{
+	if (wth->subtype_set_read_ahead == NULL)
+		return FALSE;
+	return (*wth->subtype_set_read_ahead)(wth, num_records);
+}
+
 gboolean
 wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	gchar **err_info, gint64 *offset)
@@ -1564,6 +1623,380 @@ wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	return TRUE;	/* success */
 }
 
+/*
+ * Packet index files are kept next to the capture file, with this
+ * appended to its name.  They're written to a temporary file of their
+ * own, created by file_create_index_tmp(), and renamed once they're
+ * complete, so that a partly-written index is never picked up.
+ *
+ * The file starts with a header:
+ *
+ *    8 bytes of magic number;
+ *    4 bytes of format version;
+ *    4 bytes of capture file type/subtype;
+ *    4 bytes of record count;
+ *    4 bytes each of IDB, SHB, NRB, DSB and ISB counts;
+ *    8 bytes of capture file size;
+ *    8 bytes of capture file modification time, in seconds;
+ *    4 bytes of nanoseconds of that modification time, or 0 if the
+ *      platform doesn't give us those;
+ *    4 bytes of padding;
+ *
+ * followed by one PACKET_INDEX_ENTRY_LEN-byte entry per record, all
+ * little-endian.  The block counts are those seen after reading the
+ * whole file; if they don't match the counts seen when the file is
+ * opened, some of the blocks are interleaved with the records, and
+ * the index can't be used, as the sequential read is what processes
+ * them.
+ */
+#define PACKET_INDEX_SUFFIX	".wspidx"
+#define PACKET_INDEX_VERSION	3
+#define PACKET_INDEX_HDR_LEN	64
+#define PACKET_INDEX_ENTRY_LEN	48
+#define PACKET_INDEX_NUM_BLOCK_COUNTS	5
+
+#define PACKET_INDEX_HAS_COMMENT	0x01
+
+static const guint8 packet_index_magic[8] = {
+	'W', 'S', 'P', 'I', 'D', 'X', '\r', '\n'
+};
+
+struct wtap_packet_index {
+	wtap	*wth;
+	FILE	*fp;
+	char	*path;		/* name of the index file */
+	char	*tmp_path;	/* name it's written under, or NULL if reading */
+	guint32	count;		/* records in, or written to, the index */
+	guint32	next;		/* next record to read */
+	int	err;		/* first write error, if any */
+};
+
+/*
+ * Only pcap and pcapng files can be indexed.  Other readers may build
+ * up state as they read the file sequentially - catapult_dct2000, for
+ * example, collects the line prefixes that its dumper needs - and that
+ * state would be missing if that read were skipped.  For pcapng, the
+ * blocks that are processed by the sequential read are counted by
+ * packet_index_block_counts().
+ */
+static gboolean
+packet_index_supported(wtap *wth)
+{
+	return wth->file_type_subtype == pcap_file_type_subtype ||
+	    wth->file_type_subtype == pcap_nsec_file_type_subtype ||
+	    wth->file_type_subtype == pcapng_file_type_subtype;
+}
+
+static void
+packet_index_block_counts(wtap *wth, guint32 *counts)
+{
+	guint i;
+
+	counts[0] = wth->interface_data ? wth->interface_data->len : 0;
+	counts[1] = wth->shb_hdrs ? wth->shb_hdrs->len : 0;
+	counts[2] = wth->nrb_hdrs ? wth->nrb_hdrs->len : 0;
+	counts[3] = wth->dsbs ? wth->dsbs->len : 0;
+
+	/* Interface statistics are attached to the IDBs. */
+	counts[4] = 0;
+	for (i = 0; i < counts[0]; i++) {
+		wtap_block_t idb = g_array_index(wth->interface_data, wtap_block_t, i);
+		wtapng_if_descr_mandatory_t *idb_mand =
+		    (wtapng_if_descr_mandatory_t *)wtap_block_get_mandatory_data(idb);
+
+		counts[4] += idb_mand->num_stat_entries;
+	}
+}
+
+static void
+packet_index_free(wtap_packet_index *pidx)
+{
+	if (pidx->fp != NULL)
+		fclose(pidx->fp);
+	g_free(pidx->path);
+	g_free(pidx->tmp_path);
+	g_free(pidx);
+}
+
+wtap_packet_index *
+wtap_packet_index_open(wtap *wth)
+{
+	wtap_packet_index *pidx;
+	ws_statb64 st, idx_st;
+	guint8 hdr[PACKET_INDEX_HDR_LEN];
+	guint32 counts[PACKET_INDEX_NUM_BLOCK_COUNTS];
+	guint i;
+	int err;
+
+	/*
+	 * The records have to be read with random access; for compressed
+	 * files, that's only quick if we have the fast-seek points
+	 * without having to decompress the whole file first.
+	 */
+	if (!packet_index_supported(wth) ||
+	    wth->ispipe || wth->random_fh == NULL ||
+	    (file_iscompressed(wth->random_fh) && !wth->fast_seek_loaded))
+		return NULL;
+	if (wtap_fstat(wth, &st, &err) == -1)
+		return NULL;
+
+	pidx = g_new0(wtap_packet_index, 1);
+	pidx->wth = wth;
+	pidx->path = g_strconcat(wth->pathname, PACKET_INDEX_SUFFIX, NULL);
+	pidx->fp = ws_fopen(pidx->path, "rb");
+	if (pidx->fp == NULL)
+		goto fail;
+
+	packet_index_block_counts(wth, counts);
+	if (fread(hdr, 1, sizeof hdr, pidx->fp) != sizeof hdr ||
+	    memcmp(hdr, packet_index_magic, sizeof packet_index_magic) != 0 ||
+	    pletoh32(hdr + 8) != PACKET_INDEX_VERSION ||
+	    pletoh32(hdr + 12) != (guint32)wth->file_type_subtype ||
+	    pletoh64(hdr + 40) != (guint64)st.st_size ||
+	    pletoh64(hdr + 48) != (guint64)st.st_mtime ||
+	    pletoh32(hdr + 56) != file_mtime_nsec(&st))
+		goto fail;
+	for (i = 0; i < PACKET_INDEX_NUM_BLOCK_COUNTS; i++) {
+		if (pletoh32(hdr + 20 + 4 * i) != counts[i])
+			goto fail;
+	}
+
+	/* A truncated index is no use to anybody. */
+	pidx->count = pletoh32(hdr + 16);
+	if (ws_fstat64(ws_fileno(pidx->fp), &idx_st) == -1 ||
+	    (guint64)idx_st.st_size !=
+	      PACKET_INDEX_HDR_LEN + (guint64)pidx->count * PACKET_INDEX_ENTRY_LEN)
+		goto fail;
+
+	return pidx;
+
+fail:
+	packet_index_free(pidx);
+	return NULL;
+}
+
+guint32
+wtap_packet_index_count(wtap_packet_index *pidx)
+{
+	return pidx->count;
+}
+
+gboolean
+wtap_packet_index_read(wtap_packet_index *pidx, wtap_rec *rec,
+    gint64 *offset, gboolean *has_comment, int *err)
+{
+	guint8 entry[PACKET_INDEX_ENTRY_LEN];
+	guint32 caplen, len;
+	int encap;
+
+	*err = 0;
+	if (pidx->next >= pidx->count)
+		return FALSE;
+	if (fread(entry, 1, sizeof entry, pidx->fp) != sizeof entry) {
+		*err = ferror(pidx->fp) ? errno : WTAP_ERR_SHORT_READ;
+		return FALSE;
+	}
+	pidx->next++;
+
+	wtap_init_rec(pidx->wth, rec);
+	g_free(rec->opt_comment);
+	rec->opt_comment = NULL;
+
+	*offset = (gint64)pletoh64(entry + 0);
+	rec->ts.secs = (time_t)(gint64)pletoh64(entry + 8);
+	rec->ts.nsecs = (int)pletoh32(entry + 16);
+	caplen = pletoh32(entry + 20);
+	len = pletoh32(entry + 24);
+	encap = (int)pletoh32(entry + 28);
+	rec->presence_flags = pletoh32(entry + 36);
+	rec->rec_type = entry[40];
+	rec->tsprec = (gint8)entry[41];
+	*has_comment = (entry[42] & PACKET_INDEX_HAS_COMMENT) != 0;
+
+	if (rec->ts.nsecs < 0 || rec->ts.nsecs >= 1000000000 ||
+	    rec->tsprec < WTAP_TSPREC_UNKNOWN || rec->tsprec > WTAP_TSPREC_NSEC)
+		goto bad_entry;
+
+	switch (rec->rec_type) {
+
+	case REC_TYPE_PACKET:
+		if (encap < 0 || encap >= wtap_get_num_encap_types() ||
+		    caplen > len)
+			goto bad_entry;
+		rec->rec_header.packet_header.caplen = caplen;
+		rec->rec_header.packet_header.len = len;
+		rec->rec_header.packet_header.pkt_encap = encap;
+		rec->rec_header.packet_header.interface_id = pletoh32(entry + 32);
+		break;
+
+	case REC_TYPE_FT_SPECIFIC_EVENT:
+	case REC_TYPE_FT_SPECIFIC_REPORT:
+		rec->rec_header.ft_specific_header.record_len = len;
+		break;
+
+	case REC_TYPE_SYSCALL:
+		rec->rec_header.syscall_header.event_len = len;
+		rec->rec_header.syscall_header.event_filelen = caplen;
+		break;
+
+	case REC_TYPE_SYSTEMD_JOURNAL:
+		rec->rec_header.systemd_journal_header.record_len = len;
+		break;
+
+	default:
+		goto bad_entry;
+	}
+	return TRUE;
+
+bad_entry:
+	*err = WTAP_ERR_BAD_FILE;
+	return FALSE;
+}
+
+void
+wtap_packet_index_close(wtap_packet_index *pidx)
+{
+	packet_index_free(pidx);
+}
+
+wtap_packet_index *
+wtap_packet_index_create(wtap *wth, int *err)
+{
+	wtap_packet_index *pidx;
+	guint8 hdr[PACKET_INDEX_HDR_LEN];
+
+	*err = 0;
+	if (!packet_index_supported(wth))
+		return NULL;
+	if (wth->ispipe) {
+		*err = WTAP_ERR_CANT_WRITE_TO_PIPE;
+		return NULL;
+	}
+
+	pidx = g_new0(wtap_packet_index, 1);
+	pidx->wth = wth;
+	pidx->path = g_strconcat(wth->pathname, PACKET_INDEX_SUFFIX, NULL);
+	pidx->fp = file_create_index_tmp(pidx->path, &pidx->tmp_path, err);
+	if (pidx->fp == NULL) {
+		packet_index_free(pidx);
+		return NULL;
+	}
+
+	/* The header is filled in by wtap_packet_index_finish(). */
+	memset(hdr, 0, sizeof hdr);
+	if (fwrite(hdr, 1, sizeof hdr, pidx->fp) != sizeof hdr)
+		pidx->err = ferror(pidx->fp) ? errno : WTAP_ERR_SHORT_WRITE;
+	return pidx;
+}
+
+void
+wtap_packet_index_add(wtap_packet_index *pidx, const wtap_rec *rec,
+    gint64 offset)
+{
+	guint8 entry[PACKET_INDEX_ENTRY_LEN];
+	guint32 caplen, len;
+
+	if (pidx->err != 0)
+		return;
+
+	memset(entry, 0, sizeof entry);
+	switch (rec->rec_type) {
+
+	case REC_TYPE_PACKET:
+		caplen = rec->rec_header.packet_header.caplen;
+		len = rec->rec_header.packet_header.len;
+		phtole32(entry + 28, (guint32)rec->rec_header.packet_header.pkt_encap);
+		phtole32(entry + 32, rec->rec_header.packet_header.interface_id);
+		break;
+
+	case REC_TYPE_FT_SPECIFIC_EVENT:
+	case REC_TYPE_FT_SPECIFIC_REPORT:
+		caplen = len = rec->rec_header.ft_specific_header.record_len;
+		break;
+
+	case REC_TYPE_SYSCALL:
+		caplen = rec->rec_header.syscall_header.event_filelen;
+		len = rec->rec_header.syscall_header.event_len;
+		break;
+
+	case REC_TYPE_SYSTEMD_JOURNAL:
+		caplen = len = rec->rec_header.systemd_journal_header.record_len;
+		break;
+
+	default:
+		/* We wouldn't be able to reconstruct it. */
+		pidx->err = WTAP_ERR_UNWRITABLE_REC_TYPE;
+		return;
+	}
+
+	phtole64(entry + 0, (guint64)offset);
+	phtole64(entry + 8, (guint64)(gint64)rec->ts.secs);
+	phtole32(entry + 16, (guint32)rec->ts.nsecs);
+	phtole32(entry + 20, caplen);
+	phtole32(entry + 24, len);
+	phtole32(entry + 36, rec->presence_flags);
+	entry[40] = (guint8)rec->rec_type;
+	entry[41] = (guint8)(gint8)rec->tsprec;
+	entry[42] = rec->opt_comment != NULL ? PACKET_INDEX_HAS_COMMENT : 0;
+	if (fwrite(entry, 1, sizeof entry, pidx->fp) != sizeof entry) {
+		pidx->err = ferror(pidx->fp) ? errno : WTAP_ERR_SHORT_WRITE;
+		return;
+	}
+	pidx->count++;
+}
+
+gboolean
+wtap_packet_index_finish(wtap_packet_index *pidx, gboolean keep, int *err)
+{
+	ws_statb64 st;
+	guint8 hdr[PACKET_INDEX_HDR_LEN];
+	guint32 counts[PACKET_INDEX_NUM_BLOCK_COUNTS];
+	guint i;
+	int ret;
+
+	*err = pidx->err;
+	if (!keep || *err != 0)
+		goto discard;
+
+	if (wtap_fstat(pidx->wth, &st, err) == -1)
+		goto discard;
+
+	packet_index_block_counts(pidx->wth, counts);
+	memset(hdr, 0, sizeof hdr);
+	memcpy(hdr, packet_index_magic, sizeof packet_index_magic);
+	phtole32(hdr + 8, PACKET_INDEX_VERSION);
+	phtole32(hdr + 12, (guint32)pidx->wth->file_type_subtype);
+	phtole32(hdr + 16, pidx->count);
+	for (i = 0; i < PACKET_INDEX_NUM_BLOCK_COUNTS; i++)
+		phtole32(hdr + 20 + 4 * i, counts[i]);
+	phtole64(hdr + 40, (guint64)st.st_size);
+	phtole64(hdr + 48, (guint64)st.st_mtime);
+	phtole32(hdr + 56, file_mtime_nsec(&st));
+	if (fseek(pidx->fp, 0, SEEK_SET) == -1 ||
+	    fwrite(hdr, 1, sizeof hdr, pidx->fp) != sizeof hdr) {
+		*err = ferror(pidx->fp) ? errno : WTAP_ERR_SHORT_WRITE;
+		goto discard;
+	}
+
+	ret = fclose(pidx->fp);
+	pidx->fp = NULL;
+	if (ret == EOF || ws_rename(pidx->tmp_path, pidx->path) == -1) {
+		*err = errno;
+		goto discard;
+	}
+	packet_index_free(pidx);
+	return TRUE;
+
+discard:
+	if (pidx->fp != NULL) {
+		fclose(pidx->fp);
+		pidx->fp = NULL;
+	}
+	ws_unlink(pidx->tmp_path);
+	packet_index_free(pidx);
+	return *err == 0;
+}
+
 /*
  * Read a given number of bytes from a file into a buffer or, if
  * buf is NULL, just discard them.
@@ -1643,6 +2076,14 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 	    err_info);
 }
 
+gboolean
+wtap_skip_packet_bytes(FILE_T fh, guint length, int *err)
+{
+	if (length == 0)
+		return TRUE;
+	return file_seek(fh, length, SEEK_CUR, err) != -1;
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (gint64, in case that's 64 bits.)
@@ -1650,6 +2091,12 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 gint64
 wtap_read_so_far(wtap *wth)
 {
+	/*
+	 * When another thread is reading ahead, it's the one moving
+	 * wth->fh along, and it's ahead of the records returned so far.
+	 */
+	if (wth->subtype_read_so_far != NULL)
+		return wth->subtype_read_so_far(wth);
 	return file_tell_raw(wth->fh);
 }
 
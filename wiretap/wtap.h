@@ -1715,6 +1715,48 @@ typedef void (*wtap_new_secrets_callback_t)(guint32 secrets_type, const void *se
 WS_DLL_PUBLIC
 void wtap_set_cb_new_secrets(wtap *wth, wtap_new_secrets_callback_t add_new_secrets);
 
+/**
+ * @brief Ask wtap_read() to skip over packet data.
+ * @details If @p metadata_only is TRUE, later calls to wtap_read() for
+ *          this file may seek over the data of packet records rather
+ *          than reading it, filling in everything in the wtap_rec but
+ *          leaving the contents of the Buffer undefined, which is much
+ *          faster for programs that only want the record headers.  A
+ *          packet whose data is cut short by the end of the file might
+ *          not be reported as an error.  Random access reads aren't
+ *          affected.  Only some file types, currently pcap and pcapng,
+ *          support this.
+ *
+ * @param wth The wiretap session.
+ * @param metadata_only TRUE to skip packet data, FALSE to read it again.
+ * @return TRUE if the file type supports this, FALSE if it doesn't, in
+ *         which case wtap_read() continues to read the data.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_set_metadata_only(wtap *wth, gboolean metadata_only);
+
+/**
+ * @brief Read records on a separate thread, ahead of wtap_read().
+ * @details Lets the file type's reader parse up to @p num_records
+ *          records ahead of the caller on a thread of its own, so that
+ *          I/O and record parsing overlap with whatever the caller does
+ *          with each record.  Records, and their effects on the
+ *          interface, name resolution and decryption secrets lists and
+ *          callbacks, are still delivered by wtap_read() in file order.
+ *          wtap_seek_read() fails with WTAP_ERR_INTERNAL until the
+ *          thread has been stopped by wtap_sequential_close() or
+ *          wtap_close().  Only
+ *          some file types, currently pcapng, support this, and not when
+ *          reading from a pipe.
+ *
+ * @param wth The wiretap session.
+ * @param num_records The number of records to read ahead, or 0 for a
+ *        default.
+ * @return TRUE if records are now read ahead, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_set_read_ahead(wtap *wth, guint num_records);
+
 /** Read the next record in the file, filling in *phdr and *buf.
  *
  * @wth a wtap * returned by a call that opened a file for reading.
@@ -1767,7 +1809,9 @@ void wtap_rec_cleanup(wtap_rec *rec);
  */
 typedef enum {
     WTAP_UNCOMPRESSED,
-    WTAP_GZIP_COMPRESSED
+    WTAP_GZIP_COMPRESSED,
+    WTAP_ZSTD_COMPRESSED,   /* reading only */
+    WTAP_LZ4_COMPRESSED     /* reading only */
 } wtap_compression_type;
 
 WS_DLL_PUBLIC
@@ -1776,13 +1820,17 @@ WS_DLL_PUBLIC
 const char *wtap_compression_type_description(wtap_compression_type compression_type);
 WS_DLL_PUBLIC
 const char *wtap_compression_type_extension(wtap_compression_type compression_type);
+/* Returns TRUE if files can be written with that type of compression. */
+WS_DLL_PUBLIC
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type);
 WS_DLL_PUBLIC
 GSList *wtap_get_all_compression_type_extensions_list(void);
 
 /*** get various information snippets about the current file ***/
 
 /** Return an approximation of the amount of data we've read sequentially
- * from the file so far. */
+ * from the file so far.  When reading ahead (see wtap_set_read_ahead()),
+ * that's the data up to the last record wtap_read() returned. */
 WS_DLL_PUBLIC
 gint64 wtap_read_so_far(wtap *wth);
 WS_DLL_PUBLIC
@@ -1956,6 +2004,133 @@ void wtap_fdclose(wtap *wth);
 WS_DLL_PUBLIC
 gboolean wtap_fdreopen(wtap *wth, const char *filename, int *err);
 
+/**
+ * @brief Load saved fast-seek information for a compressed file.
+ * @details If the file is compressed, and was opened for random access,
+ *          and a fast-seek index file saved by wtap_save_fast_seek_index()
+ *          exists for it and is up to date, load the index, so that
+ *          random access doesn't have to wait for the sequential pass to
+ *          decompress the whole file.
+ *
+ * @param wth The wiretap session.
+ * @return TRUE if an index was loaded, FALSE otherwise.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_load_fast_seek_index(wtap *wth);
+
+/**
+ * @brief Save fast-seek information for a compressed file.
+ * @details Save the fast-seek points found so far in a file next to the
+ *          capture file, for use by wtap_load_fast_seek_index() the next
+ *          time the file is opened.  This should be called after the
+ *          whole file has been read sequentially, and before
+ *          wtap_sequential_close().  Nothing is saved if the file isn't
+ *          compressed or if the index was loaded by
+ *          wtap_load_fast_seek_index().
+ *
+ * @param wth The wiretap session.
+ * @param[out] err Set to a wiretap or errno error code on failure.
+ * @return TRUE on success or if there was nothing to save, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_save_fast_seek_index(wtap *wth, int *err);
+
+/** An index of the records in a capture file; see wtap_packet_index_open(). */
+typedef struct wtap_packet_index wtap_packet_index;
+
+/**
+ * @brief Open the packet index saved for a capture file.
+ * @details A packet index, written with wtap_packet_index_create() and
+ *          friends during an earlier sequential read of the file, holds
+ *          the offset, lengths, time stamp and encapsulation of every
+ *          record, so that a reader can set up its list of records
+ *          without reading the file sequentially, and read the records
+ *          themselves later with wtap_seek_read().  The index is only
+ *          returned if it's up to date and if nothing that's only
+ *          processed by a sequential read, such as pcapng blocks
+ *          following the first packet, would be missed by skipping that
+ *          read.  Only pcap and pcapng files are indexed, as other
+ *          readers may keep state from the sequential read.  For
+ *          compressed files, the fast-seek index must have been loaded
+ *          with wtap_load_fast_seek_index().
+ *
+ * @param wth The wiretap session.
+ * @return The packet index, or NULL if there's no usable index.
+ */
+WS_DLL_PUBLIC
+wtap_packet_index *wtap_packet_index_open(wtap *wth);
+
+/** Return the number of records in a packet index. */
+WS_DLL_PUBLIC
+guint32 wtap_packet_index_count(wtap_packet_index *pidx);
+
+/**
+ * @brief Read the next record's metadata from a packet index.
+ * @details Fill in the record type, time stamp, lengths and, for packets,
+ *          encapsulation and interface ID of @p rec, as wtap_read() would
+ *          have; the record's options, other than whether it has a
+ *          comment, aren't saved in the index.
+ *
+ * @param pidx The packet index.
+ * @param rec The record to fill in.
+ * @param[out] offset Set to the offset to pass to wtap_seek_read().
+ * @param[out] has_comment Set to TRUE if the record has a comment.
+ * @param[out] err Set to 0 at the end of the index, or to a wiretap or
+ *             errno error code on failure.
+ * @return TRUE if a record was read, FALSE at the end of the index or
+ *         on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_packet_index_read(wtap_packet_index *pidx, wtap_rec *rec,
+    gint64 *offset, gboolean *has_comment, int *err);
+
+/** Close a packet index opened with wtap_packet_index_open(). */
+WS_DLL_PUBLIC
+void wtap_packet_index_close(wtap_packet_index *pidx);
+
+/**
+ * @brief Start writing a packet index for a capture file.
+ * @details Pass every record read with wtap_read() to
+ *          wtap_packet_index_add(), then call wtap_packet_index_finish()
+ *          before wtap_sequential_close().
+ *
+ * @param wth The wiretap session, before any records have been read.
+ * @param[out] err Set to a wiretap or errno error code on failure, or
+ *             to 0 if the file's type can't be indexed.
+ * @return The packet index being written, or NULL on failure.
+ */
+WS_DLL_PUBLIC
+wtap_packet_index *wtap_packet_index_create(wtap *wth, int *err);
+
+/**
+ * @brief Add a record read with wtap_read() to a packet index.
+ * @details Write errors are remembered, and reported by
+ *          wtap_packet_index_finish().
+ *
+ * @param pidx The packet index being written.
+ * @param rec The record.
+ * @param offset The offset wtap_read() returned for it.
+ */
+WS_DLL_PUBLIC
+void wtap_packet_index_add(wtap_packet_index *pidx, const wtap_rec *rec,
+    gint64 offset);
+
+/**
+ * @brief Finish writing a packet index, and free it.
+ * @details If @p keep is TRUE, which it should only be if the whole file
+ *          was read, the index is saved next to the capture file, for
+ *          use by wtap_packet_index_open() the next time the file is
+ *          opened; otherwise it's discarded.
+ *
+ * @param pidx The packet index being written.
+ * @param keep TRUE to save the index, FALSE to discard it.
+ * @param[out] err Set to a wiretap or errno error code on failure.
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_packet_index_finish(wtap_packet_index *pidx, gboolean keep,
+    int *err);
+
 /** Close only the sequential side, freeing up memory it uses. */
 WS_DLL_PUBLIC
 void wtap_sequential_close(wtap *wth);
@@ -2118,6 +2293,32 @@ gboolean wtap_dump(wtap_dumper *, const wtap_rec *, const guint8 *,
      int *err, gchar **err_info);
 WS_DLL_PUBLIC
 gboolean wtap_dump_flush(wtap_dumper *, int *);
+
+/**
+ * @brief Write a capture file on a separate thread.
+ * @details From now on, data written to the file is collected in large
+ *          buffers, which a writer thread writes to the file, so that the
+ *          caller doesn't wait for the disk unless all the buffers are
+ *          waiting to be written.  Errors from the writer thread are
+ *          reported by later calls to wtap_dump(), wtap_dump_flush() or
+ *          wtap_dump_close().  This is best used when writing to a file
+ *          rather than a pipe, as data is only written once a buffer
+ *          fills up or the dumper is flushed.
+ *
+ * @param wdh The dumper.
+ * @param buffer_size The size of each buffer, or 0 for the default.
+ * @param num_buffers The number of buffers, which limits how much data
+ *        can be waiting to be written, or 0 for the default.
+ * @param size_hint If non-zero, the expected number of bytes still to
+ *        be written; space for them is reserved in the file where that's
+ *        supported, and any left over is released when it's closed.
+ * @param[out] err Set to an error code on failure.
+ * @return TRUE on success; FALSE if the writer thread couldn't be
+ *         started, in which case writing continues synchronously.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_dump_set_async(wtap_dumper *wdh, gsize buffer_size,
+     guint num_buffers, gint64 size_hint, int *err);
 WS_DLL_PUBLIC
 int wtap_dump_file_type_subtype(wtap_dumper *wdh);
 WS_DLL_PUBLIC
@@ -0,0 +1,102 @@
+/* murmurhash3.c
+ * MurmurHash3 x64 128-bit non-cryptographic hash
+ * Based on the public domain MurmurHash3 by Austin Appleby
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <glib.h>
+
+#include <wsutil/pint.h>
+#include <wsutil/murmurhash3.h>
+
+#define C1 G_GUINT64_CONSTANT(0x87c37b91114253d5)
+#define C2 G_GUINT64_CONSTANT(0x4cf5ad432745937f)
+
+static inline guint64
+rotl64(guint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64
+fmix64(guint64 k)
+{
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    return k;
+}
+
+void
+murmurhash3_128(const guint8 *buf, size_t len, guint32 seed, guint8 *digest)
+{
+    const size_t nblocks = len / 16;
+    const guint8 *tail = buf + nblocks * 16;
+    size_t tail_len = len & 15;
+    guint64 h1 = seed;
+    guint64 h2 = seed;
+    guint64 k1, k2;
+    size_t i;
+
+    for (i = 0; i < nblocks; i++) {
+        k1 = pletoh64(buf + i * 16);
+        k2 = pletoh64(buf + i * 16 + 8);
+
+        k1 *= C1; k1 = rotl64(k1, 31); k1 *= C2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= C2; k2 = rotl64(k2, 33); k2 *= C1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    /* The last 0 to 15 bytes, as little-endian partial words. */
+    k1 = 0;
+    k2 = 0;
+    for (i = tail_len; i > 8; i--)
+        k2 = (k2 << 8) | tail[i - 1];
+    for (; i > 0; i--)
+        k1 = (k1 << 8) | tail[i - 1];
+    if (tail_len > 8) {
+        k2 *= C2; k2 = rotl64(k2, 33); k2 *= C1; h2 ^= k2;
+    }
+    if (tail_len > 0) {
+        k1 *= C1; k1 = rotl64(k1, 31); k1 *= C2; h1 ^= k1;
+    }
+
+    h1 ^= (guint64)len;
+    h2 ^= (guint64)len;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    phtole64(digest, h1);
+    phtole64(digest + 8, h2);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,46 @@
+/* murmurhash3.h
+ * MurmurHash3 x64 128-bit non-cryptographic hash
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __MURMURHASH3_H__
+#define __MURMURHASH3_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define MURMURHASH3_128_LEN 16
+
+/**
+ * Compute the 128-bit x64 variant of MurmurHash3 over a buffer.
+ *
+ * This is a fast hash with good distribution, suitable for hash tables
+ * and for detecting identical data; it is NOT a cryptographic hash and
+ * must not be used where an attacker could choose colliding input.
+ *
+ * The digest is stored as two little-endian 64-bit words, so the
+ * result is the same on all platforms.
+ *
+ * @param buf data to hash
+ * @param len length of the data
+ * @param seed seed value
+ * @param digest buffer for the MURMURHASH3_128_LEN byte result
+ */
+WS_DLL_PUBLIC void murmurhash3_128(const guint8 *buf, size_t len,
+                                   guint32 seed, guint8 *digest);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __MURMURHASH3_H__ */
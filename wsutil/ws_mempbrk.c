@@ -32,7 +32,7 @@ ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const gchar *needles)
 {
     const gchar *n = needles;
     while (*n) {
-        pattern->patt[(int)*n] = 1;
+        pattern->patt[(guchar)*n] = 1;
         n++;
     }
 